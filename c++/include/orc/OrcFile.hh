@@ -19,7 +19,9 @@
 #ifndef ORC_FILE_HH
 #define ORC_FILE_HH
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "orc/orc-config.hh"
 #include "orc/Reader.hh"
@@ -48,6 +50,23 @@ namespace orc {
     virtual uint64_t getLength() const = 0;
   };
 
+  /**
+   * A contiguous range of bytes in a file.
+   */
+  struct ReadRange {
+    uint64_t offset;
+    uint64_t length;
+
+    ReadRange(uint64_t _offset, uint64_t _length
+              ): offset(_offset), length(_length) {
+      // PASS
+    }
+
+    uint64_t end() const {
+      return offset + length;
+    }
+  };
+
   /**
    * An abstract interface for providing ORC readers a stream of bytes.
    */
@@ -73,6 +92,32 @@ namespace orc {
                          uint64_t length,
                          Buffer* buffer) = 0;
 
+    /**
+     * Tell the stream that the given range will be read soon, so that it
+     * can start fetching it. The default implementation does nothing.
+     * @param offset the position in the file where the range starts
+     * @param length the number of bytes in the range
+     */
+    virtual void willNeed(uint64_t offset, uint64_t length);
+
+    /**
+     * Read several ranges of the file with one call, so that the stream
+     * can issue them together. The default implementation calls read for
+     * each range.
+     * @param ranges the ranges to read
+     * @return a buffer for each range in the same order. The client owns
+     *    the Buffers.
+     */
+    virtual std::vector<Buffer*> readRanges(const std::vector<ReadRange>&
+                                            ranges);
+
+    /**
+     * Get the time that the file was last modified in nanoseconds since
+     * the epoch. The default implementation returns 0, which means that
+     * the time isn't known.
+     */
+    virtual uint64_t getModificationTime() const;
+
     /**
      * Get the name of the stream for error messages.
      */
@@ -85,6 +130,192 @@ namespace orc {
    */
   ORC_UNIQUE_PTR<InputStream> readLocalFile(const std::string& path);
 
+  /**
+   * Create a stream to a local file that is memory mapped. The buffers
+   * returned by the stream point directly into the mapping, so the bytes
+   * are never copied out of the page cache.
+   * @param path the name of the file in the local file system
+   */
+  ORC_UNIQUE_PTR<InputStream> readLocalFileMmap(const std::string& path);
+
+  /**
+   * Create a stream to a local file that reads through an io_uring shared
+   * by all of the streams in the process. The pieces of each read are
+   * submitted together, which keeps the device queue full without a thread
+   * per reader. If io_uring isn't available, the stream uses pread.
+   * @param path the name of the file in the local file system
+   */
+  ORC_UNIQUE_PTR<InputStream> readLocalFileIoUring(const std::string& path);
+
+  /**
+   * Can the streams from readLocalFileIoUring use io_uring in this process?
+   */
+  bool isIoUringAvailable();
+
+  /**
+   * A directory on a local disk that holds copies of fixed size, aligned
+   * blocks of slower files. The blocks and an index of them persist across
+   * processes. When the blocks exceed the capacity, the least recently
+   * used ones are removed. A cache may be shared by any number of streams
+   * and threads, but a directory belongs to one process at a time.
+   */
+  class DiskCache {
+  public:
+    virtual ~DiskCache();
+
+    /**
+     * Get the directory that holds the blocks.
+     */
+    virtual const std::string& getDirectory() const = 0;
+
+    /**
+     * Get the most bytes of blocks that the cache will hold.
+     */
+    virtual uint64_t getCapacity() const = 0;
+
+    /**
+     * Get the size of each block. The last block of a file may be smaller.
+     */
+    virtual uint64_t getBlockSize() const = 0;
+
+    /**
+     * Get the number of bytes in the cached blocks.
+     */
+    virtual uint64_t getCachedBytes() const = 0;
+
+    /**
+     * Get the number of blocks in the cache.
+     */
+    virtual uint64_t getNumberOfBlocks() const = 0;
+
+    /**
+     * Get the number of block reads that were served from the cache.
+     */
+    virtual uint64_t getHits() const = 0;
+
+    /**
+     * Get the number of block reads that went to the underlying stream.
+     */
+    virtual uint64_t getMisses() const = 0;
+  };
+
+  /**
+   * Open or create a disk cache. Opening the same directory again in the
+   * process returns the same cache. If the directory holds blocks of
+   * another size from an earlier process, they are removed. Throws
+   * ParseError if another process has the directory open and
+   * std::logic_error if this process has it open with another block size.
+   * @param directory the local directory to keep the blocks in
+   * @param capacity the most bytes of blocks to keep
+   * @param blockSize the size of the blocks
+   */
+  std::shared_ptr<DiskCache> openDiskCache(const std::string& directory,
+                                           uint64_t capacity,
+                                           uint64_t blockSize);
+
+  /**
+   * Create a stream that reads through a disk cache. Reads are split into
+   * blocks and the blocks that aren't cached are read from the input in as
+   * few requests as possible and then saved in the cache. Blocks are
+   * identified by the input's name, length, and modification time, so an
+   * input whose modification time is unknown (0) is returned without the
+   * cache.
+   * @param input the slower stream to read from
+   * @param cache the cache to keep the blocks in
+   */
+  ORC_UNIQUE_PTR<InputStream>
+    createDiskCachedStream(ORC_UNIQUE_PTR<InputStream> input,
+                           std::shared_ptr<DiskCache> cache);
+
+  /**
+   * A request that reached a SimulatedStorage. The times are in
+   * microseconds since the storage was created.
+   */
+  struct StorageRequest {
+    std::string name;
+    uint64_t offset;
+    uint64_t length;
+    // when the request was made
+    uint64_t start;
+    // how long the request waited for a free connection
+    uint64_t wait;
+    // how long the request took once it had a connection
+    uint64_t duration;
+  };
+
+  /**
+   * A model of remote storage, such as an object store, that is shared by
+   * the streams from createSimulatedStream. Every read waits for one of a
+   * limited number of connections, pays a fixed latency, and transfers
+   * its bytes at a limited bandwidth. Every request is recorded so that
+   * the number and size of the reads can be checked.
+   */
+  class SimulatedStorage {
+  public:
+    virtual ~SimulatedStorage();
+
+    /**
+     * Get the latency of each request in microseconds.
+     */
+    virtual uint64_t getLatency() const = 0;
+
+    /**
+     * Get the bandwidth of each connection in bytes per second or 0 if it
+     * is unlimited.
+     */
+    virtual uint64_t getBandwidth() const = 0;
+
+    /**
+     * Get the number of requests that may run at once or 0 if it is
+     * unlimited.
+     */
+    virtual uint64_t getMaxConcurrency() const = 0;
+
+    /**
+     * Get the requests that have completed, in the order they completed.
+     */
+    virtual std::vector<StorageRequest> getRequests() const = 0;
+
+    /**
+     * Get the number of requests that have completed.
+     */
+    virtual uint64_t getRequestCount() const = 0;
+
+    /**
+     * Get the total number of bytes that have been requested.
+     */
+    virtual uint64_t getBytesRequested() const = 0;
+
+    /**
+     * Forget the recorded requests.
+     */
+    virtual void clearRequests() = 0;
+  };
+
+  /**
+   * Create a simulated remote storage.
+   * @param latency the time each request takes before any bytes arrive in
+   *    microseconds
+   * @param bandwidth the bytes per second of each connection or 0 for
+   *    unlimited
+   * @param maxConcurrency the number of requests that may run at once or
+   *    0 for unlimited
+   */
+  std::shared_ptr<SimulatedStorage>
+    createSimulatedStorage(uint64_t latency,
+                           uint64_t bandwidth,
+                           uint64_t maxConcurrency);
+
+  /**
+   * Create a stream that makes the reads of another stream behave like
+   * requests to the simulated storage.
+   * @param input the stream that holds the bytes, usually a local file
+   * @param storage the storage model to apply and record the reads in
+   */
+  ORC_UNIQUE_PTR<InputStream>
+    createSimulatedStream(ORC_UNIQUE_PTR<InputStream> input,
+                          std::shared_ptr<SimulatedStorage> storage);
+
   /**
    * Create a reader to the for the ORC file.
    * @param stream the stream to read
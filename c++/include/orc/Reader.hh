@@ -31,11 +31,15 @@ namespace orc {
   // classes that hold data members so we can maintain binary compatibility
   struct ReaderOptionsPrivate;
 
+  class ChunkCache;
+
   enum CompressionKind {
     CompressionKind_NONE = 0,
     CompressionKind_ZLIB = 1,
     CompressionKind_SNAPPY = 2,
-    CompressionKind_LZO = 3
+    CompressionKind_LZO = 3,
+    CompressionKind_LZ4 = 4,
+    CompressionKind_ZSTD = 5
   };
 
   /**
@@ -479,6 +483,140 @@ namespace orc {
      */
     ReaderOptions& setMemoryPool(MemoryPool& pool);
 
+    /**
+     * Set the largest gap between two streams of a stripe that is read
+     * through so that both streams are fetched with a single read. The
+     * streams of the selected columns are read with as few reads as this
+     * allows when each stripe is started.
+     *
+     * Defaults to 1 MB.
+     *
+     * @param gap the number of unneeded bytes that may be read to save a
+     *    read request
+     * @return returns *this
+     */
+    ReaderOptions& setReadCoalescingGap(uint64_t gap);
+
+    /**
+     * Set the number of stripes that are loaded ahead of the stripe being
+     * decoded. When it is positive, a background thread reads the footers
+     * and the selected streams of the following stripes, so the
+     * InputStream and MemoryPool must allow concurrent use.
+     *
+     * Defaults to 0, which loads each stripe when it is reached.
+     *
+     * @param depth the maximum number of stripes to load ahead
+     * @return returns *this
+     */
+    ReaderOptions& setPrefetchDepth(uint64_t depth);
+
+    /**
+     * Set the maximum number of bytes held by stripes that have been
+     * prefetched, but not yet started. At least one stripe is always
+     * loaded ahead, even if it is larger than the limit.
+     *
+     * Defaults to 256 MB.
+     *
+     * @param bytes the memory limit for prefetched stripes
+     * @return returns *this
+     */
+    ReaderOptions& setPrefetchMemoryLimit(uint64_t bytes);
+
+    /**
+     * Set the number of threads used to decompress the chunks of large
+     * data streams ahead of the reader. With zero threads, each chunk is
+     * decompressed on the reading thread when it is needed. The readers
+     * in a process that use the same number of threads share one pool.
+     *
+     * Defaults to 0.
+     *
+     * @param threads the size of the decompression thread pool
+     * @return returns *this
+     */
+    ReaderOptions& setDecompressionThreads(uint64_t threads);
+
+    /**
+     * Set the maximum number of chunks of each stream that are
+     * decompressed ahead of the reader when decompression threads are
+     * used. Each chunk holds up to one compression block in memory.
+     *
+     * Defaults to 8.
+     *
+     * @param chunks the number of chunks decompressed ahead
+     * @return returns *this
+     */
+    ReaderOptions& setDecompressionWindow(uint64_t chunks);
+
+    /**
+     * Set the cache of decompressed chunks that the reader looks in
+     * before decompressing a chunk and adds the chunks that it
+     * decompresses to. The cache must outlive the reader.
+     *
+     * Defaults to no cache.
+     *
+     * @param cache the shared chunk cache
+     * @return returns *this
+     */
+    ReaderOptions& setChunkCache(ChunkCache& cache);
+
+    /**
+     * Set the number of bytes read from the end of the file when it is
+     * opened. If the metadata, footer, and postscript don't fit, a second
+     * read fetches the rest of them.
+     *
+     * Defaults to 16 KB.
+     *
+     * @param size the number of bytes to read
+     * @return returns *this
+     */
+    ReaderOptions& setTailReadSize(uint64_t size);
+
+    /**
+     * Set the expected length of this file's tail, for example from
+     * Reader::getFileTailLength on an earlier reader. When it is set, it is
+     * used instead of the tail read size.
+     *
+     * Defaults to 0, which means there is no hint.
+     *
+     * @param length the number of bytes in the file's tail
+     * @return returns *this
+     */
+    ReaderOptions& setTailLengthHint(uint64_t length);
+
+    /**
+     * Should the reader remember the longest file tail that it has seen in
+     * each directory and read at least that much from the other files in
+     * the same directory?
+     *
+     * Defaults to false.
+     *
+     * @param learn whether to learn the tail sizes
+     * @return returns *this
+     */
+    ReaderOptions& setLearnTailSize(bool learn);
+
+    /**
+     * Supply the file's tail from Reader::getSerializedFileTail on an
+     * earlier reader of the same file. The reader then doesn't read or
+     * decompress the tail of the file.
+     * @param serialization the serialized tail of the file
+     * @return returns *this
+     */
+    ReaderOptions& setSerializedFileTail(const std::string& serialization);
+
+    /**
+     * Should the reader look for the file's tail in the process-wide
+     * metadata cache before reading it and add it to the cache afterwards?
+     * Files are identified by their name, length, and modification time,
+     * so streams that don't report a modification time aren't cached.
+     *
+     * Defaults to false.
+     *
+     * @param useCache whether to use the metadata cache
+     * @return returns *this
+     */
+    ReaderOptions& setUseMetadataCache(bool useCache);
+
     /**
      * Get the list of selected columns to read. All children of the selected
      * columns are also selected.
@@ -524,8 +662,216 @@ namespace orc {
      * Get the memory allocator.
      */
     MemoryPool* getMemoryPool() const;
+
+    /**
+     * Get the largest gap between streams that is read through.
+     */
+    uint64_t getReadCoalescingGap() const;
+
+    /**
+     * Get the number of stripes that are loaded ahead.
+     */
+    uint64_t getPrefetchDepth() const;
+
+    /**
+     * Get the memory limit for prefetched stripes.
+     */
+    uint64_t getPrefetchMemoryLimit() const;
+
+    /**
+     * Get the number of threads used to decompress chunks ahead.
+     */
+    uint64_t getDecompressionThreads() const;
+
+    /**
+     * Get the number of chunks of each stream decompressed ahead.
+     */
+    uint64_t getDecompressionWindow() const;
+
+    /**
+     * Get the cache of decompressed chunks or nullptr if there isn't one.
+     */
+    ChunkCache* getChunkCache() const;
+
+    /**
+     * Get the number of bytes read from the end of the file when it is
+     * opened.
+     */
+    uint64_t getTailReadSize() const;
+
+    /**
+     * Get the expected length of the file's tail or 0 if there is no hint.
+     */
+    uint64_t getTailLengthHint() const;
+
+    /**
+     * Get whether the tail sizes are learned for each directory.
+     */
+    bool getLearnTailSize() const;
+
+    /**
+     * Get the serialized file tail that was supplied or an empty string.
+     */
+    std::string getSerializedFileTail() const;
+
+    /**
+     * Get whether the reader uses the metadata cache.
+     */
+    bool getUseMetadataCache() const;
+  };
+
+  /**
+   * The process-wide LRU cache of parsed file tails that is shared by the
+   * readers that were created with ReaderOptions::setUseMetadataCache.
+   * All of the methods are thread safe.
+   */
+  class MetadataCache {
+  public:
+    virtual ~MetadataCache();
+
+    /**
+     * Get the most memory in bytes that the cached tails may use.
+     */
+    virtual uint64_t getCapacity() const = 0;
+
+    /**
+     * Set the most memory that the cached tails may use. The least
+     * recently used tails are dropped until the cache fits. Defaults to
+     * 64MB.
+     * @param capacity the memory budget in bytes
+     */
+    virtual void setCapacity(uint64_t capacity) = 0;
+
+    /**
+     * Get the approximate memory in bytes used by the cached tails.
+     */
+    virtual uint64_t getMemoryUsage() const = 0;
+
+    /**
+     * Get the number of files in the cache.
+     */
+    virtual uint64_t getNumberOfEntries() const = 0;
+
+    /**
+     * Get the number of readers that found their file in the cache.
+     */
+    virtual uint64_t getHits() const = 0;
+
+    /**
+     * Get the number of readers that didn't find their file in the cache.
+     */
+    virtual uint64_t getMisses() const = 0;
+
+    /**
+     * Drop all of the cached tails and reset the counters. Readers that
+     * are using a tail keep it until they are destroyed.
+     */
+    virtual void clear() = 0;
+  };
+
+  /**
+   * Get the metadata cache for this process.
+   */
+  MetadataCache& getMetadataCache();
+
+  /**
+   * A decompressed chunk. Readers keep the chunk that they are using
+   * alive after it is evicted.
+   */
+  typedef std::shared_ptr<DataBuffer<char> > CachedChunk;
+
+  /**
+   * A cache of decompressed chunks that readers on any thread can share
+   * through ReaderOptions::setChunkCache. Chunks are identified by their
+   * file's name, length, and modification time and their position in the
+   * file, so files whose streams don't report a modification time aren't
+   * cached. The readers only call get and put, so an application may
+   * provide its own cache. The one from createChunkCache is an LRU cache.
+   * All of the methods must be thread safe.
+   */
+  class ChunkCache {
+  public:
+    virtual ~ChunkCache();
+
+    /**
+     * Find a decompressed chunk and mark it as used.
+     * @param file a key for the file's name, length, and modification time
+     * @param streamOffset the offset of the stream in the file
+     * @param chunkOffset the offset of the chunk's header in the stream
+     * @return the chunk or nullptr if it isn't cached
+     */
+    virtual CachedChunk get(const std::string& file,
+                            uint64_t streamOffset,
+                            uint64_t chunkOffset) = 0;
+
+    /**
+     * Copy a decompressed chunk into the cache, replacing any chunk with
+     * the same key. The cache may choose not to keep it.
+     * @param file a key for the file's name, length, and modification time
+     * @param streamOffset the offset of the stream in the file
+     * @param chunkOffset the offset of the chunk's header in the stream
+     * @param data the decompressed bytes
+     * @param length the number of decompressed bytes
+     */
+    virtual void put(const std::string& file,
+                     uint64_t streamOffset,
+                     uint64_t chunkOffset,
+                     const char* data,
+                     uint64_t length) = 0;
+
+    /**
+     * Get the most memory in bytes that the cached chunks may use.
+     */
+    virtual uint64_t getCapacity() const = 0;
+
+    /**
+     * Set the most memory that the cached chunks may use. The least
+     * recently used chunks are dropped until the cache fits.
+     * @param capacity the memory budget in bytes
+     */
+    virtual void setCapacity(uint64_t capacity) = 0;
+
+    /**
+     * Get the memory in bytes used by the cached chunks.
+     */
+    virtual uint64_t getMemoryUsage() const = 0;
+
+    /**
+     * Get the number of chunks in the cache.
+     */
+    virtual uint64_t getNumberOfEntries() const = 0;
+
+    /**
+     * Get the number of chunks that were found in the cache.
+     */
+    virtual uint64_t getHits() const = 0;
+
+    /**
+     * Get the number of chunks that had to be decompressed.
+     */
+    virtual uint64_t getMisses() const = 0;
+
+    /**
+     * Get the number of chunks that were dropped to stay in the capacity.
+     */
+    virtual uint64_t getEvictions() const = 0;
+
+    /**
+     * Drop all of the cached chunks and reset the counters. Readers that
+     * are using a chunk keep it until they move on.
+     */
+    virtual void clear() = 0;
   };
 
+  /**
+   * Create a chunk cache.
+   * @param capacity the memory budget in bytes
+   * @param pool the thread safe pool that the chunks are allocated from
+   */
+  std::unique_ptr<ChunkCache> createChunkCache(uint64_t capacity,
+                                               MemoryPool& pool =
+                                                 *getDefaultPool());
+
   /**
    * The interface for reading ORC files.
    * This is an an abstract class that will subclassed as necessary.
@@ -683,6 +1029,49 @@ namespace orc {
      * check file has correct column statistics
      */
     virtual bool hasCorrectStatistics() const = 0;
+
+    /**
+     * Get the number of read requests that this reader has made to its
+     * InputStream so far. Each range of a vectored read counts as a
+     * request.
+     */
+    virtual uint64_t getReadCount() const = 0;
+
+    /**
+     * Get the number of bytes that this reader has requested from its
+     * InputStream so far.
+     */
+    virtual uint64_t getBytesRead() const = 0;
+
+    /**
+     * Get the number of bytes that this reader's column streams have
+     * produced by decompressing chunks.
+     */
+    virtual uint64_t getBytesDecompressed() const = 0;
+
+    /**
+     * Get the number of compressed bytes that this reader's column streams
+     * had to copy because a chunk wasn't contiguous in the input.
+     */
+    virtual uint64_t getBytesCopied() const = 0;
+
+    /**
+     * Get the number of bytes of uncompressed (original) chunks that this
+     * reader's column streams returned without copying them.
+     */
+    virtual uint64_t getBytesPassedThrough() const = 0;
+
+    /**
+     * Get the number of bytes at the end of the file that hold the
+     * metadata, footer, and postscript.
+     */
+    virtual uint64_t getFileTailLength() const = 0;
+
+    /**
+     * Get the parsed postscript, footer, and metadata of the file as a
+     * string that can be passed to ReaderOptions::setSerializedFileTail.
+     */
+    virtual std::string getSerializedFileTail() const = 0;
   };
 }
 
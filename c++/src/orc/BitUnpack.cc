@@ -0,0 +1,266 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "BitUnpack.hh"
+
+#include <algorithm>
+
+#ifdef HAS_BMI2_TARGET
+#include <immintrin.h>
+#endif
+
+namespace orc {
+
+  namespace {
+
+    /**
+     * Read 8 bytes as a big endian number, which compilers turn into a
+     * single load and byte swap.
+     */
+    inline uint64_t readBigEndian(const unsigned char* input) {
+      return (static_cast<uint64_t>(input[0]) << 56) |
+        (static_cast<uint64_t>(input[1]) << 48) |
+        (static_cast<uint64_t>(input[2]) << 40) |
+        (static_cast<uint64_t>(input[3]) << 32) |
+        (static_cast<uint64_t>(input[4]) << 24) |
+        (static_cast<uint64_t>(input[5]) << 16) |
+        (static_cast<uint64_t>(input[6]) << 8) |
+        static_cast<uint64_t>(input[7]);
+    }
+
+    /**
+     * Get the number of groups that can be read with 8 byte loads without
+     * reading past the end of the input. A load starts at most width
+     * bytes into the last group it reads.
+     */
+    inline uint64_t getWideGroups(uint64_t groups, uint32_t width) {
+      uint64_t length = groups * width;
+      return length >= 8 ? std::min(groups, (length - 8) / width) : 0;
+    }
+
+    /**
+     * Get the value at INDEX in a group from an 8 byte load. None of the
+     * RLEv2 widths make a value span more than 8 bytes.
+     */
+    template <uint32_t WIDTH, uint32_t INDEX>
+    inline uint64_t extractWide(const unsigned char* input) {
+      const uint32_t start = INDEX * WIDTH;
+      return (readBigEndian(input + start / 8) >> (64 - start % 8 - WIDTH)) &
+        (~static_cast<uint64_t>(0) >> (64 - WIDTH));
+    }
+
+    /**
+     * Get the value at INDEX in a group, reading only the bytes that hold
+     * it.
+     */
+    template <uint32_t WIDTH, uint32_t INDEX>
+    inline uint64_t extractExact(const unsigned char* input) {
+      const uint32_t start = INDEX * WIDTH;
+      const uint32_t last = (start + WIDTH - 1) / 8;
+      uint64_t word = 0;
+      for(uint32_t b=start / 8; b <= last; ++b) {
+        word = (word << 8) | input[b];
+      }
+      return (word >> (8 * (last + 1) - start - WIDTH)) &
+        (~static_cast<uint64_t>(0) >> (64 - WIDTH));
+    }
+
+    /**
+     * Unpacks the values of a group from INDEX on. The recursion makes
+     * every shift and mask a constant.
+     */
+    template <uint32_t WIDTH, uint32_t INDEX, bool WIDE>
+    struct GroupUnpacker {
+      static inline void unpack(const unsigned char* input, int64_t* output) {
+        output[INDEX] = static_cast<int64_t>
+          (WIDE ? extractWide<WIDTH, INDEX>(input) :
+                  extractExact<WIDTH, INDEX>(input));
+        GroupUnpacker<WIDTH, INDEX + 1, WIDE>::unpack(input, output);
+      }
+    };
+
+    template <uint32_t WIDTH, bool WIDE>
+    struct GroupUnpacker<WIDTH, 8, WIDE> {
+      static inline void unpack(const unsigned char*, int64_t*) {
+        // PASS
+      }
+    };
+
+    template <uint32_t WIDTH>
+    void unpackScalar(const char* input, uint64_t groups, int64_t* output) {
+      const unsigned char* in = reinterpret_cast<const unsigned char*>
+        (input);
+      uint64_t wideGroups = getWideGroups(groups, WIDTH);
+      for(uint64_t g=0; g < wideGroups; ++g) {
+        GroupUnpacker<WIDTH, 0, true>::unpack(in, output);
+        in += WIDTH;
+        output += 8;
+      }
+      for(uint64_t g=wideGroups; g < groups; ++g) {
+        GroupUnpacker<WIDTH, 0, false>::unpack(in, output);
+        in += WIDTH;
+        output += 8;
+      }
+    }
+
+#ifdef HAS_BMI2_TARGET
+    /**
+     * Unpack values of up to 8 bits by depositing each of a group's values
+     * in its own byte. The first value is in the most significant bits,
+     * so the bytes are swapped to put it first before they are widened.
+     */
+    template <uint32_t WIDTH>
+    __attribute__((target("bmi2,avx2")))
+    void unpackBytesBmi2(const char* input, uint64_t groups,
+                         int64_t* output) {
+      const unsigned char* in = reinterpret_cast<const unsigned char*>
+        (input);
+      const uint64_t mask = 0x0101010101010101ULL * ((1u << WIDTH) - 1);
+      uint64_t wideGroups = getWideGroups(groups, WIDTH);
+      for(uint64_t g=0; g < wideGroups; ++g) {
+        uint64_t packed = readBigEndian(in) >> (64 - 8 * WIDTH);
+        __m128i bytes = _mm_cvtsi64_si128(static_cast<long long>
+                                          (__builtin_bswap64
+                                           (_pdep_u64(packed, mask))));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output),
+                            _mm256_cvtepu8_epi64(bytes));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 4),
+                            _mm256_cvtepu8_epi64(_mm_srli_si128(bytes, 4)));
+        in += WIDTH;
+        output += 8;
+      }
+      unpackScalar<WIDTH>(reinterpret_cast<const char*>(in),
+                          groups - wideGroups, output);
+    }
+
+    /**
+     * Unpack values of 9 to 16 bits by depositing each half of a group in
+     * 16 bit lanes and reversing the lanes after they are widened.
+     */
+    template <uint32_t WIDTH>
+    __attribute__((target("bmi2,avx2")))
+    void unpackShortsBmi2(const char* input, uint64_t groups,
+                          int64_t* output) {
+      const unsigned char* in = reinterpret_cast<const unsigned char*>
+        (input);
+      const uint64_t mask = 0x0001000100010001ULL * ((1u << WIDTH) - 1);
+      uint64_t wideGroups = getWideGroups(groups, WIDTH);
+      for(uint64_t g=0; g < wideGroups; ++g) {
+        uint64_t first = readBigEndian(in) >> (64 - 4 * WIDTH);
+        // the second half starts in the middle of a byte for odd widths
+        uint64_t second = (readBigEndian(in + WIDTH / 2) << (WIDTH % 2 * 4))
+          >> (64 - 4 * WIDTH);
+        __m256i values = _mm256_cvtepu16_epi64
+          (_mm_cvtsi64_si128(static_cast<long long>(_pdep_u64(first, mask))));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output),
+                            _mm256_permute4x64_epi64(values, 0x1b));
+        values = _mm256_cvtepu16_epi64
+          (_mm_cvtsi64_si128(static_cast<long long>(_pdep_u64(second,
+                                                              mask))));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + 4),
+                            _mm256_permute4x64_epi64(values, 0x1b));
+        in += WIDTH;
+        output += 8;
+      }
+      unpackScalar<WIDTH>(reinterpret_cast<const char*>(in),
+                          groups - wideGroups, output);
+    }
+
+    bool hasBmi2() {
+      static const bool result = __builtin_cpu_supports("bmi2") &&
+        __builtin_cpu_supports("avx2");
+      return result;
+    }
+
+    /**
+     * Get the BMI2 unpacker for a width, if there is one. Widths of 8 and
+     * 16 bits are as fast with the scalar unpackers.
+     */
+    BitUnpacker getBmi2BitUnpacker(uint32_t width) {
+      switch (width) {
+      case 1: return unpackBytesBmi2<1>;
+      case 2: return unpackBytesBmi2<2>;
+      case 3: return unpackBytesBmi2<3>;
+      case 4: return unpackBytesBmi2<4>;
+      case 5: return unpackBytesBmi2<5>;
+      case 6: return unpackBytesBmi2<6>;
+      case 7: return unpackBytesBmi2<7>;
+      case 9: return unpackShortsBmi2<9>;
+      case 10: return unpackShortsBmi2<10>;
+      case 11: return unpackShortsBmi2<11>;
+      case 12: return unpackShortsBmi2<12>;
+      case 13: return unpackShortsBmi2<13>;
+      case 14: return unpackShortsBmi2<14>;
+      case 15: return unpackShortsBmi2<15>;
+      default: return nullptr;
+      }
+    }
+#endif
+  }
+
+  BitUnpacker getScalarBitUnpacker(uint32_t width) {
+    switch (width) {
+    case 1: return unpackScalar<1>;
+    case 2: return unpackScalar<2>;
+    case 3: return unpackScalar<3>;
+    case 4: return unpackScalar<4>;
+    case 5: return unpackScalar<5>;
+    case 6: return unpackScalar<6>;
+    case 7: return unpackScalar<7>;
+    case 8: return unpackScalar<8>;
+    case 9: return unpackScalar<9>;
+    case 10: return unpackScalar<10>;
+    case 11: return unpackScalar<11>;
+    case 12: return unpackScalar<12>;
+    case 13: return unpackScalar<13>;
+    case 14: return unpackScalar<14>;
+    case 15: return unpackScalar<15>;
+    case 16: return unpackScalar<16>;
+    case 17: return unpackScalar<17>;
+    case 18: return unpackScalar<18>;
+    case 19: return unpackScalar<19>;
+    case 20: return unpackScalar<20>;
+    case 21: return unpackScalar<21>;
+    case 22: return unpackScalar<22>;
+    case 23: return unpackScalar<23>;
+    case 24: return unpackScalar<24>;
+    case 26: return unpackScalar<26>;
+    case 28: return unpackScalar<28>;
+    case 30: return unpackScalar<30>;
+    case 32: return unpackScalar<32>;
+    case 40: return unpackScalar<40>;
+    case 48: return unpackScalar<48>;
+    case 56: return unpackScalar<56>;
+    case 64: return unpackScalar<64>;
+    default: return nullptr;
+    }
+  }
+
+  BitUnpacker getBitUnpacker(uint32_t width) {
+#ifdef HAS_BMI2_TARGET
+    if (hasBmi2()) {
+      BitUnpacker result = getBmi2BitUnpacker(width);
+      if (result != nullptr) {
+        return result;
+      }
+    }
+#endif
+    return getScalarBitUnpacker(width);
+  }
+}
@@ -0,0 +1,56 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_BIT_UNPACK_HH
+#define ORC_BIT_UNPACK_HH
+
+#include "orc/Adaptor.hh"
+
+namespace orc {
+
+  /**
+   * Unpacks values that are bit packed with a fixed width, most
+   * significant bit first, the way RLEv2 stores DIRECT, PATCHED_BASE and
+   * DELTA runs. The values are unpacked in groups of 8, which take exactly
+   * width bytes, so every group starts on a byte boundary.
+   * @param input the packed groups, which must hold groups * width bytes
+   * @param groups the number of groups
+   * @param output where the 8 * groups values are written
+   */
+  typedef void (*BitUnpacker)(const char* input,
+                              uint64_t groups,
+                              int64_t* output);
+
+  /**
+   * Get the fastest unpacker for a width that this machine supports.
+   * @param width the number of bits in each value
+   * @return the unpacker or nullptr if the width isn't one that RLEv2
+   *   uses
+   */
+  BitUnpacker getBitUnpacker(uint32_t width);
+
+  /**
+   * Get the unpacker for a width that only uses portable code.
+   * @param width the number of bits in each value
+   * @return the unpacker or nullptr if the width isn't one that RLEv2
+   *   uses
+   */
+  BitUnpacker getScalarBitUnpacker(uint32_t width);
+}
+
+#endif
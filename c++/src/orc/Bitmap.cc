@@ -0,0 +1,123 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "Bitmap.hh"
+
+#include <string.h>
+
+namespace orc {
+
+  namespace {
+
+    uint64_t loadWord(const unsigned char* input) {
+      uint64_t word;
+      memcpy(&word, input, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      word = __builtin_bswap64(word);
+#endif
+      return word;
+    }
+
+    void storeWord(char* output, uint64_t word) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+      word = __builtin_bswap64(word);
+#endif
+      memcpy(output, &word, sizeof(word));
+    }
+
+    /**
+     * Spread the 8 bits of a byte to the low bits of the bytes of a word.
+     */
+    uint64_t spreadBits(unsigned char bits) {
+      // copy the byte to every byte and keep bit i in byte i
+      uint64_t word = (bits * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+      // move each kept bit to the high bit of its byte and then down
+      return ((word + 0x7f7f7f7f7f7f7f7fULL) >> 7) & 0x0101010101010101ULL;
+    }
+  }
+
+  void packBitmap(const char* notNull, uint64_t numValues,
+                  unsigned char* bitmap) {
+    const uint64_t ALL_ZERO = 0x8080808080808080ULL;
+    uint64_t i = 0;
+    for( ; i + 64 <= numValues; i += 64) {
+      uint64_t zeros[8];
+      uint64_t anyZero = 0;
+      uint64_t allZero = ALL_ZERO;
+      for(uint64_t w = 0; w < 8; ++w) {
+        zeros[w] = findZeroBytes(loadMaskWord(notNull + i + 8 * w));
+        anyZero |= zeros[w];
+        allZero &= zeros[w];
+      }
+      if (anyZero == 0 || allZero == ALL_ZERO) {
+        memset(bitmap + i / 8, anyZero == 0 ? 0xff : 0, 8);
+        continue;
+      }
+      for(uint64_t w = 0; w < 8; ++w) {
+        // gather the high bits of the zero bytes into a byte and flip it
+        uint64_t bits = ((zeros[w] >> 7) * 0x0102040810204080ULL) >> 56;
+        bitmap[i / 8 + w] = static_cast<unsigned char>(~bits);
+      }
+    }
+    for( ; i < numValues; i += 8) {
+      unsigned char bits = 0;
+      for(uint64_t j = i; j < numValues && j < i + 8; ++j) {
+        if (notNull[j]) {
+          bits = static_cast<unsigned char>(bits | (1 << (j - i)));
+        }
+      }
+      bitmap[i / 8] = bits;
+    }
+  }
+
+  uint64_t countBits(const unsigned char* bitmap, uint64_t numValues) {
+    uint64_t result = 0;
+    uint64_t bytes = numValues / 8;
+    uint64_t i = 0;
+    for( ; i + 8 <= bytes; i += 8) {
+      result += static_cast<uint64_t>(__builtin_popcountll(loadWord(bitmap +
+                                                                    i)));
+    }
+    for( ; i < bytes; ++i) {
+      result += static_cast<uint64_t>(__builtin_popcount(bitmap[i]));
+    }
+    if (numValues % 8 != 0) {
+      unsigned int mask = (1u << (numValues % 8)) - 1;
+      result += static_cast<uint64_t>(__builtin_popcount(bitmap[bytes] &
+                                                         mask));
+    }
+    return result;
+  }
+
+  void expandBitmap(const unsigned char* bitmap, uint64_t numValues,
+                    char* output) {
+    // work backwards so that the bitmap isn't clobbered when output starts
+    // at it, since the bytes of each value are after its bit
+    uint64_t bytes = numValues / 8;
+    if (numValues % 8 != 0) {
+      unsigned char last = bitmap[bytes];
+      for(uint64_t i = bytes * 8; i < numValues; ++i) {
+        output[i] = static_cast<char>((last >> (i % 8)) & 1);
+      }
+    }
+    for(uint64_t i = bytes; i > 0; --i) {
+      storeWord(output + 8 * (i - 1), spreadBits(bitmap[i - 1]));
+    }
+  }
+}
@@ -0,0 +1,111 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_BITMAP_HH
+#define ORC_BITMAP_HH
+
+#include "orc/Adaptor.hh"
+
+#include <stdint.h>
+#include <string.h>
+
+namespace orc {
+
+  /**
+   * The bitmaps have the value for row i in bit i % 8 of byte i / 8, which
+   * is the order that Arrow uses for validity bitmaps.
+   */
+
+  /**
+   * Reverse the order of the bits in each of the 8 bytes of a word.
+   */
+  inline uint64_t reverseBitsInBytes(uint64_t word) {
+    word = ((word >> 4) & 0x0f0f0f0f0f0f0f0fULL) |
+      ((word & 0x0f0f0f0f0f0f0f0fULL) << 4);
+    word = ((word >> 2) & 0x3333333333333333ULL) |
+      ((word & 0x3333333333333333ULL) << 2);
+    return ((word >> 1) & 0x5555555555555555ULL) |
+      ((word & 0x5555555555555555ULL) << 1);
+  }
+
+  /**
+   * Load 8 bytes of a mask of one byte per value, with the first value in
+   * the low byte.
+   */
+  inline uint64_t loadMaskWord(const char* mask) {
+    uint64_t word;
+    memcpy(&word, mask, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+  }
+
+  /**
+   * Find the bytes of a word that are 0.
+   * @return a word with the high bit set in each byte that is 0
+   */
+  inline uint64_t findZeroBytes(uint64_t word) {
+    const uint64_t low7 = 0x7f7f7f7f7f7f7f7fULL;
+    return ~(((word & low7) + low7) | word | low7);
+  }
+
+  /**
+   * Count the non-zero bytes of a mask, 8 at a time.
+   */
+  inline uint64_t countNonNulls(const char* notNull, uint64_t length) {
+    uint64_t result = 0;
+    uint64_t i = 0;
+    for( ; i + 8 <= length; i += 8) {
+      result += 8 - static_cast<uint64_t>
+        (__builtin_popcountll(findZeroBytes(loadMaskWord(notNull + i))));
+    }
+    for( ; i < length; ++i) {
+      result += notNull[i] != 0;
+    }
+    return result;
+  }
+
+  /**
+   * Pack a mask of one byte per value into a bitmap with the bits past the
+   * last value cleared. Blocks of 64 values that are all set or all clear
+   * are written as whole words.
+   * @param notNull the mask, where values that aren't 0 are set
+   * @param numValues the number of values
+   * @param bitmap the (numValues + 7) / 8 bytes to write
+   */
+  void packBitmap(const char* notNull, uint64_t numValues,
+                  unsigned char* bitmap);
+
+  /**
+   * Count the bits that are set in the first numValues bits of a bitmap.
+   */
+  uint64_t countBits(const unsigned char* bitmap, uint64_t numValues);
+
+  /**
+   * Expand a bitmap to one byte per value that is 0 or 1. The bytes of 8
+   * values are made together from their bits with a multiply.
+   * @param bitmap the bits of the values
+   * @param numValues the number of values
+   * @param output the numValues bytes to write, which may start at bitmap
+   */
+  void expandBitmap(const unsigned char* bitmap, uint64_t numValues,
+                    char* output);
+}
+
+#endif
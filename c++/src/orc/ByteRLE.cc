@@ -21,8 +21,10 @@
 #include <string.h>
 #include <utility>
 
+#include "Bitmap.hh"
 #include "ByteRLE.hh"
 #include "Exceptions.hh"
+#include "InputCursor.hh"
 
 namespace orc {
 
@@ -53,35 +55,24 @@ namespace orc {
      */
     virtual void next(char* data, uint64_t numValues, char* notNull);
 
+    /**
+     * Byte streams don't have bitmaps.
+     */
+    virtual uint64_t nextBitmap(unsigned char* bitmap, uint64_t numValues);
+
   protected:
-    inline void nextBuffer();
     inline signed char readByte();
     inline void readHeader();
 
     std::unique_ptr<SeekableInputStream> inputStream;
+    InputCursor cursor;
     size_t remainingValues;
     char value;
-    const char* bufferStart;
-    const char* bufferEnd;
     bool repeating;
   };
 
-  void ByteRleDecoderImpl::nextBuffer() {
-    int bufferLength;
-    const void* bufferPointer;
-    bool result = inputStream->Next(&bufferPointer, &bufferLength);
-    if (!result) {
-      throw ParseError("bad read in nextBuffer");
-    }
-    bufferStart = static_cast<const char*>(bufferPointer);
-    bufferEnd = bufferStart + bufferLength;
-  }
-
   signed char ByteRleDecoderImpl::readByte() {
-    if (bufferStart == bufferEnd) {
-      nextBuffer();
-    }
-    return *(bufferStart++);
+    return static_cast<signed char>(cursor.readByte());
   }
 
   void ByteRleDecoderImpl::readHeader() {
@@ -97,13 +88,13 @@ namespace orc {
   }
 
   ByteRleDecoderImpl::ByteRleDecoderImpl(std::unique_ptr<SeekableInputStream>
-                                         input) {
-    inputStream = std::move(input);
+                                         input
+                                         ): inputStream(std::move(input)),
+                                            cursor(inputStream.get(),
+                                                   "bad read in nextBuffer") {
     repeating = false;
     remainingValues = 0;
     value = 0;
-    bufferStart = 0;
-    bufferEnd = 0;
   }
 
   ByteRleDecoderImpl::~ByteRleDecoderImpl() {
@@ -114,7 +105,7 @@ namespace orc {
     // move the input stream
     inputStream->seek(location);
     // force a re-read from the stream
-    bufferEnd = bufferStart;
+    cursor.reset();
     // read a new header
     readHeader();
     // skip ahead the given number of records
@@ -130,19 +121,9 @@ namespace orc {
       remainingValues -= count;
       numValues -= count;
       // for literals we need to skip over count bytes, which may involve
-      // reading from the underlying stream
+      // skipping in the underlying stream
       if (!repeating) {
-        size_t consumedBytes = count;
-        while (consumedBytes > 0) {
-          if (bufferStart == bufferEnd) {
-            nextBuffer();
-          }
-          size_t skipSize = std::min(static_cast<size_t>(consumedBytes),
-                                     static_cast<size_t>(bufferEnd -
-                                                         bufferStart));
-          bufferStart += skipSize;
-          consumedBytes -= skipSize;
-        }
+        cursor.skip(count);
       }
     }
   }
@@ -184,18 +165,7 @@ namespace orc {
             }
           }
         } else {
-          uint64_t i = 0;
-          while (i < count) {
-            if (bufferStart == bufferEnd) {
-              nextBuffer();
-            }
-            uint64_t copyBytes =
-              std::min(static_cast<uint64_t>(count - i),
-                       static_cast<uint64_t>(bufferEnd - bufferStart));
-            memcpy(data + position + i, bufferStart, copyBytes);
-            bufferStart += copyBytes;
-            i += copyBytes;
-          }
+          cursor.readBytes(data + position, count);
           consumed = count;
         }
       }
@@ -208,6 +178,10 @@ namespace orc {
     }
   }
 
+  uint64_t ByteRleDecoderImpl::nextBitmap(unsigned char*, uint64_t) {
+    throw std::logic_error("nextBitmap is only for boolean streams");
+  }
+
   std::unique_ptr<ByteRleDecoder> createByteRleDecoder
                                  (std::unique_ptr<SeekableInputStream> input) {
     return std::unique_ptr<ByteRleDecoder>(new ByteRleDecoderImpl
@@ -235,6 +209,11 @@ namespace orc {
      */
     virtual void next(char* data, uint64_t numValues, char* notNull);
 
+    /**
+     * Read a number of values into a bitmap.
+     */
+    virtual uint64_t nextBitmap(unsigned char* bitmap, uint64_t numValues);
+
   protected:
     size_t remainingBits;
     char lastByte;
@@ -344,6 +323,58 @@ namespace orc {
     }
   }
 
+  uint64_t BooleanRleDecoderImpl::nextBitmap(unsigned char* bitmap,
+                                             uint64_t numValues) {
+    if (numValues == 0) {
+      return 0;
+    }
+    // the stream has the first value in the high bit of each byte, so the
+    // bits are reversed in each byte. The bits left in the last byte go
+    // first and the new ones are shifted after them.
+    uint64_t shift = std::min(static_cast<uint64_t>(remainingBits),
+                              numValues);
+    uint64_t carry = reverseBitsInBytes(static_cast<unsigned char>(lastByte));
+    carry = (carry >> (8 - remainingBits)) & ((1u << shift) - 1);
+    remainingBits -= shift;
+    uint64_t needed = numValues - shift;
+    uint64_t bitmapBytes = (numValues + 7) / 8;
+    uint64_t i = 0;
+    if (needed > 0) {
+      uint64_t bytesRead = (needed + 7) / 8;
+      ByteRleDecoderImpl::next(reinterpret_cast<char*>(bitmap), bytesRead,
+                               nullptr);
+      lastByte = static_cast<char>(bitmap[bytesRead - 1]);
+      remainingBits = bytesRead * 8 - needed;
+      for( ; i + 8 <= bytesRead; i += 8) {
+        uint64_t word;
+        memcpy(&word, bitmap + i, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        word = __builtin_bswap64(word);
+#endif
+        word = reverseBitsInBytes(word);
+        uint64_t result = (word << shift) | carry;
+        carry = shift == 0 ? 0 : word >> (64 - shift);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        result = __builtin_bswap64(result);
+#endif
+        memcpy(bitmap + i, &result, sizeof(result));
+      }
+      for( ; i < bytesRead; ++i) {
+        uint64_t byte = reverseBitsInBytes(bitmap[i]);
+        bitmap[i] = static_cast<unsigned char>((byte << shift) | carry);
+        carry = byte >> (8 - shift);
+      }
+    }
+    if (i < bitmapBytes) {
+      bitmap[i] = static_cast<unsigned char>(carry);
+    }
+    if (numValues % 8 != 0) {
+      bitmap[bitmapBytes - 1] &=
+        static_cast<unsigned char>((1u << (numValues % 8)) - 1);
+    }
+    return numValues - countBits(bitmap, numValues);
+  }
+
   std::unique_ptr<ByteRleDecoder> createBooleanRleDecoder
                                  (std::unique_ptr<SeekableInputStream> input) {
     BooleanRleDecoderImpl* decoder = new BooleanRleDecoderImpl(std::move(input)) ;
@@ -47,6 +47,16 @@ namespace orc {
      *    pointer is not null, positions that are false are skipped.
      */
     virtual void next(char* data, uint64_t numValues, char* notNull) = 0;
+
+    /**
+     * Read a number of values of a boolean stream into a bitmap, with the
+     * value for row i in bit i % 8 of byte i / 8. The bits after the last
+     * value in its byte are cleared. Only boolean decoders support it.
+     * @param bitmap the (numValues + 7) / 8 bytes to read into
+     * @param numValues the number of values to read
+     * @return the number of values that are false
+     */
+    virtual uint64_t nextBitmap(unsigned char* bitmap, uint64_t numValues) = 0;
   };
 
   /**
@@ -0,0 +1,161 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "ChunkCache.hh"
+
+#include <string.h>
+
+namespace orc {
+
+  ChunkCache::~ChunkCache() {
+    // PASS
+  }
+
+  bool ChunkCacheImpl::Key::operator<(const Key& other) const {
+    if (streamOffset != other.streamOffset) {
+      return streamOffset < other.streamOffset;
+    }
+    if (chunkOffset != other.chunkOffset) {
+      return chunkOffset < other.chunkOffset;
+    }
+    return file < other.file;
+  }
+
+  ChunkCacheImpl::ChunkCacheImpl(uint64_t _capacity,
+                                 MemoryPool& _pool
+                                 ): pool(_pool),
+                                    capacity(_capacity),
+                                    memoryUsage(0),
+                                    hits(0),
+                                    misses(0),
+                                    evictions(0) {
+    // PASS
+  }
+
+  ChunkCacheImpl::~ChunkCacheImpl() {
+    // PASS
+  }
+
+  uint64_t ChunkCacheImpl::getCapacity() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return capacity;
+  }
+
+  void ChunkCacheImpl::setCapacity(uint64_t _capacity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = _capacity;
+    evict();
+  }
+
+  uint64_t ChunkCacheImpl::getMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return memoryUsage;
+  }
+
+  uint64_t ChunkCacheImpl::getNumberOfEntries() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+  }
+
+  uint64_t ChunkCacheImpl::getHits() const {
+    return hits;
+  }
+
+  uint64_t ChunkCacheImpl::getMisses() const {
+    return misses;
+  }
+
+  uint64_t ChunkCacheImpl::getEvictions() const {
+    return evictions;
+  }
+
+  void ChunkCacheImpl::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    memoryUsage = 0;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+  }
+
+  CachedChunk ChunkCacheImpl::get(const std::string& file,
+                                  uint64_t streamOffset,
+                                  uint64_t chunkOffset) {
+    Key key;
+    key.file = file;
+    key.streamOffset = streamOffset;
+    key.chunkOffset = chunkOffset;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<Key, std::list<Entry>::iterator>::iterator itr =
+      index.find(key);
+    if (itr == index.end()) {
+      misses += 1;
+      return nullptr;
+    }
+    hits += 1;
+    entries.splice(entries.begin(), entries, itr->second);
+    return itr->second->chunk;
+  }
+
+  void ChunkCacheImpl::put(const std::string& file,
+                           uint64_t streamOffset,
+                           uint64_t chunkOffset,
+                           const char* data,
+                           uint64_t length) {
+    if (length > getCapacity()) {
+      return;
+    }
+    // copy outside of the lock
+    CachedChunk chunk(new DataBuffer<char>(pool, length));
+    memcpy(chunk->data(), data, length);
+    Entry entry;
+    entry.key.file = file;
+    entry.key.streamOffset = streamOffset;
+    entry.key.chunkOffset = chunkOffset;
+    entry.chunk = chunk;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<Key, std::list<Entry>::iterator>::iterator itr =
+      index.find(entry.key);
+    if (itr != index.end()) {
+      memoryUsage -= itr->second->chunk->size();
+      entries.erase(itr->second);
+      index.erase(itr);
+    }
+    entries.push_front(entry);
+    index[entry.key] = entries.begin();
+    memoryUsage += length;
+    evict();
+  }
+
+  void ChunkCacheImpl::evict() {
+    while (memoryUsage > capacity) {
+      memoryUsage -= entries.back().chunk->size();
+      index.erase(entries.back().key);
+      entries.pop_back();
+      evictions += 1;
+    }
+  }
+
+  std::unique_ptr<ChunkCache> createChunkCache(uint64_t capacity,
+                                               MemoryPool& pool) {
+    return std::unique_ptr<ChunkCache>(new ChunkCacheImpl(capacity, pool));
+  }
+}
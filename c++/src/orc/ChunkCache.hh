@@ -0,0 +1,103 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_CHUNK_CACHE_HH
+#define ORC_CHUNK_CACHE_HH
+
+#include "orc/Adaptor.hh"
+#include "orc/MemoryPool.hh"
+#include "orc/Reader.hh"
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace orc {
+
+  class ChunkCacheImpl: public ChunkCache {
+  private:
+    struct Key {
+      std::string file;
+      uint64_t streamOffset;
+      uint64_t chunkOffset;
+
+      bool operator<(const Key& other) const;
+    };
+
+    struct Entry {
+      Key key;
+      CachedChunk chunk;
+    };
+
+    MemoryPool& pool;
+    mutable std::mutex mutex;
+    // the most recently used entry is at the front
+    std::list<Entry> entries;
+    std::map<Key, std::list<Entry>::iterator> index;
+    uint64_t capacity;
+    uint64_t memoryUsage;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> evictions;
+
+    void evict();
+
+  public:
+    ChunkCacheImpl(uint64_t capacity, MemoryPool& pool);
+    ~ChunkCacheImpl();
+
+    uint64_t getCapacity() const override;
+    void setCapacity(uint64_t capacity) override;
+    uint64_t getMemoryUsage() const override;
+    uint64_t getNumberOfEntries() const override;
+    uint64_t getHits() const override;
+    uint64_t getMisses() const override;
+    uint64_t getEvictions() const override;
+    void clear() override;
+
+    /**
+     * Find a decompressed chunk and mark it as the most recently used.
+     */
+    CachedChunk get(const std::string& file,
+                    uint64_t streamOffset,
+                    uint64_t chunkOffset) override;
+
+    /**
+     * Copy a decompressed chunk into the cache. Chunks that are larger
+     * than the capacity aren't kept.
+     */
+    void put(const std::string& file,
+             uint64_t streamOffset,
+             uint64_t chunkOffset,
+             const char* data,
+             uint64_t length) override;
+  };
+
+  /**
+   * Identifies a compressed stream's chunks in a chunk cache.
+   */
+  struct ChunkCacheStream {
+    ChunkCache* cache;
+    std::string file;
+    uint64_t streamOffset;
+  };
+}
+
+#endif
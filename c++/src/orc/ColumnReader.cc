@@ -17,9 +17,11 @@
  */
 
 #include "orc/Adaptor.hh"
+#include "Bitmap.hh"
 #include "ByteRLE.hh"
 #include "ColumnReader.hh"
 #include "Exceptions.hh"
+#include "InputCursor.hh"
 #include "orc/Int128.hh"
 #include "RLE.hh"
 
@@ -66,21 +68,13 @@ namespace orc {
       // page through the values that we want to skip
       // and count how many are non-null
       const size_t MAX_BUFFER_SIZE = 32768;
-      size_t bufferSize = std::min(MAX_BUFFER_SIZE,
-                                   static_cast<size_t>(numValues));
-      char buffer[MAX_BUFFER_SIZE];
+      unsigned char buffer[MAX_BUFFER_SIZE / 8];
       uint64_t remaining = numValues;
       while (remaining > 0) {
         uint64_t chunkSize =
-          std::min(remaining,
-                   static_cast<uint64_t>(bufferSize));
-        decoder->next(buffer, chunkSize, 0);
+          std::min(remaining, static_cast<uint64_t>(MAX_BUFFER_SIZE));
+        numValues -= decoder->nextBitmap(buffer, chunkSize);
         remaining -= chunkSize;
-        for(uint64_t i=0; i < chunkSize; ++i) {
-          if (!buffer[i]) {
-            numValues -= 1;
-          }
-        }
       }
     }
     return numValues;
@@ -96,13 +90,24 @@ namespace orc {
     ByteRleDecoder* decoder = notNullDecoder.get();
     if (decoder) {
       char* notNullArray = rowBatch.notNull.data();
-      decoder->next(notNullArray, numValues, incomingMask);
-      // check to see if there are nulls in this batch
-      for(uint64_t i=0; i < numValues; ++i) {
-        if (!notNullArray[i]) {
+      if (incomingMask) {
+        decoder->next(notNullArray, numValues, incomingMask);
+        // check to see if there are nulls in this batch
+        if (countNonNulls(notNullArray, numValues) != numValues) {
           rowBatch.hasNulls = true;
           return;
         }
+      } else {
+        // decode the bits into the start of the array, which counts the
+        // nulls, and only expand them when there are some
+        unsigned char* bitmap = reinterpret_cast<unsigned char*>
+          (notNullArray);
+        if (decoder->nextBitmap(bitmap, numValues) != 0) {
+          expandBitmap(bitmap, numValues, notNullArray);
+          rowBatch.hasNulls = true;
+          return;
+        }
+        memset(notNullArray, 1, numValues);
       }
     } else if (incomingMask) {
       // If we don't have a notNull stream, copy the incomingMask
@@ -347,39 +352,50 @@ namespace orc {
 
   private:
     std::unique_ptr<SeekableInputStream> inputStream;
+    InputCursor cursor;
     TypeKind columnKind;
     const uint64_t bytesPerValue ;
-    const char *bufferPointer;
-    const char *bufferEnd;
-
-    unsigned char readByte() {
-      if (bufferPointer == bufferEnd) {
-        int length;
-        if (!inputStream->Next
-            (reinterpret_cast<const void**>(&bufferPointer), &length)) {
-          throw ParseError("bad read in DoubleColumnReader::next()");
-        }
-        bufferEnd = bufferPointer + length;
-      }
-      return static_cast<unsigned char>(*(bufferPointer++));
-    }
 
-    double readDouble() {
-      int64_t bits = 0;
-      for (uint64_t i=0; i < 8; i++) {
-        bits |= static_cast<int64_t>(readByte()) << (i*8);
+    static double decodeValue(const char* input, uint32_t width) {
+      if (width == 4) {
+        int32_t bits = static_cast<int32_t>
+          (InputCursor::decodeLittleEndian(input, 4));
+        float *result = reinterpret_cast<float*>(&bits);
+        return *result;
       }
+      int64_t bits = static_cast<int64_t>
+        (InputCursor::decodeLittleEndian(input, 8));
       double *result = reinterpret_cast<double*>(&bits);
       return *result;
     }
 
-    double readFloat() {
-      int32_t bits = 0;
-      for (uint64_t i=0; i < 4; i++) {
-        bits |= readByte() << (i*8);
+    /**
+     * Read values of WIDTH bytes. The values that are whole in the current
+     * buffer are decoded without checking for its end.
+     */
+    template <uint32_t WIDTH>
+    void readValues(double* output, uint64_t numValues, const char* notNull) {
+      uint64_t i = 0;
+      while (i < numValues) {
+        if (notNull && !notNull[i]) {
+          ++i;
+          continue;
+        }
+        uint64_t values = cursor.available() / WIDTH;
+        if (values == 0) {
+          // the value is split between buffers
+          output[i++] = decodeValue(cursor.read(WIDTH), WIDTH);
+          continue;
+        }
+        const char* input = cursor.data();
+        uint64_t used = 0;
+        for(; i < numValues && used < values; ++i) {
+          if (!notNull || notNull[i]) {
+            output[i] = decodeValue(input + WIDTH * used++, WIDTH);
+          }
+        }
+        cursor.advance(WIDTH * used);
       }
-      float *result = reinterpret_cast<float*>(&bits);
-      return *result;
     }
   };
 
@@ -391,11 +407,12 @@ namespace orc {
                                                 (columnId,
                                                  proto::Stream_Kind_DATA,
                                                  true)),
+                                            cursor(inputStream.get(),
+                                                   "bad read in "
+                                                   "DoubleColumnReader::next()"),
                                             columnKind(type.getKind()),
                                             bytesPerValue((type.getKind() ==
-                                                           FLOAT) ? 4 : 8),
-                                            bufferPointer(NULL),
-                                            bufferEnd(NULL) {
+                                                           FLOAT) ? 4 : 8) {
     // PASS
   }
 
@@ -405,18 +422,7 @@ namespace orc {
 
   uint64_t DoubleColumnReader::skip(uint64_t numValues) {
     numValues = ColumnReader::skip(numValues);
-
-    if (static_cast<size_t>(bufferEnd - bufferPointer) >=
-        bytesPerValue * numValues) {
-      bufferPointer+= bytesPerValue*numValues;
-    } else {
-      inputStream->Skip(static_cast<int>(bytesPerValue*numValues -
-                                         static_cast<size_t>(bufferEnd -
-                                                             bufferPointer)));
-      bufferEnd = NULL;
-      bufferPointer = NULL;
-    }
-
+    cursor.skip(bytesPerValue * numValues);
     return numValues;
   }
 
@@ -429,29 +435,9 @@ namespace orc {
     double* outArray = dynamic_cast<DoubleVectorBatch&>(rowBatch).data.data();
 
     if (columnKind == FLOAT) {
-      if (notNull) {
-        for(size_t i=0; i < numValues; ++i) {
-          if (notNull[i]) {
-            outArray[i] = readFloat();
-          }
-        }
-      } else {
-        for(size_t i=0; i < numValues; ++i) {
-          outArray[i] = readFloat();
-        }
-      }
+      readValues<4>(outArray, numValues, notNull);
     } else {
-      if (notNull) {
-        for(size_t i=0; i < numValues; ++i) {
-          if (notNull[i]) {
-            outArray[i] = readDouble();
-          }
-        }
-      } else {
-        for(size_t i=0; i < numValues; ++i) {
-          outArray[i] = readDouble();
-        }
-      }
+      readValues<8>(outArray, numValues, notNull);
     }
   }
 
@@ -693,8 +679,10 @@ namespace orc {
     size_t usedBytes = 0;
     ptr = blobBuffer.data();
     if (notNull) {
+      // the lengths of the null slots aren't set, so they are passed over
       while (filledSlots < numValues &&
-             (usedBytes + static_cast<size_t>(lengthPtr[filledSlots]) <=
+             (!notNull[filledSlots] ||
+              usedBytes + static_cast<size_t>(lengthPtr[filledSlots]) <=
               bytesBuffered)) {
         if (notNull[filledSlots]) {
           startPtr[filledSlots] = ptr + usedBytes;
@@ -1130,40 +1118,16 @@ namespace orc {
 
   protected:
     std::unique_ptr<SeekableInputStream> valueStream;
+    InputCursor valueCursor;
     int32_t precision;
     int32_t scale;
-    const char* buffer;
-    const char* bufferEnd;
 
     std::unique_ptr<RleDecoder> scaleDecoder;
 
     /**
-     * Read the valueStream for more bytes.
+     * Change a decoded value to the desired scale.
      */
-    void readBuffer() {
-      while (buffer == bufferEnd) {
-        int length;
-        if (!valueStream->Next(reinterpret_cast<const void**>(&buffer),
-                               &length)) {
-          throw ParseError("Read past end of stream in Decimal64ColumnReader "+
-                           valueStream->getName());
-        }
-        bufferEnd = buffer + length;
-      }
-    }
-
-    void readInt64(int64_t& value, int32_t currentScale) {
-      value = 0;
-      size_t offset = 0;
-      while (true) {
-        readBuffer();
-        unsigned char ch = static_cast<unsigned char>(*(buffer++));
-        value |= static_cast<uint64_t>(ch & 0x7f) << offset;
-        offset += 7;
-        if (!(ch & 0x80)) {
-          break;
-        }
-      }
+    void rescaleInt64(int64_t& value, int32_t currentScale) {
       value = unZigZag(static_cast<uint64_t>(value));
       if (scale > currentScale) {
         value *= POWERS_OF_TEN[scale - currentScale];
@@ -1207,12 +1171,19 @@ namespace orc {
 
   Decimal64ColumnReader::Decimal64ColumnReader(const Type& type,
                                                StripeStreams& stripe
-                                               ): ColumnReader(type, stripe) {
+                                               ): ColumnReader(type, stripe),
+                                                  valueStream
+                                                    (stripe.getStream
+                                                     (columnId,
+                                                      proto::Stream_Kind_DATA,
+                                                      true)),
+                                                  valueCursor
+                                                    (valueStream.get(),
+                                                     "Read past end of stream "
+                                                     "in Decimal64ColumnReader "
+                                                     + valueStream->getName()) {
     scale = static_cast<int32_t>(type.getScale());
     precision = static_cast<int32_t>(type.getPrecision());
-    valueStream = stripe.getStream(columnId, proto::Stream_Kind_DATA, true);
-    buffer = nullptr;
-    bufferEnd = nullptr;
     RleVersion vers = convertRleVersion(stripe.getEncoding(columnId).kind());
     scaleDecoder = createRleDecoder(stripe.getStream
                                     (columnId,
@@ -1229,10 +1200,17 @@ namespace orc {
     numValues = ColumnReader::skip(numValues);
     uint64_t skipped = 0;
     while (skipped < numValues) {
-      readBuffer();
-      if (!(0x80 & *(buffer++))) {
-        skipped += 1;
+      valueCursor.fill();
+      // each value ends with the first byte that has the high bit clear
+      const char* bytes = valueCursor.data();
+      size_t length = valueCursor.available();
+      size_t used = 0;
+      while (used < length && skipped < numValues) {
+        if (!(0x80 & bytes[used++])) {
+          skipped += 1;
+        }
       }
+      valueCursor.advance(used);
     }
     scaleDecoder->skip(numValues);
     return numValues;
@@ -1251,15 +1229,21 @@ namespace orc {
     scaleDecoder->next(scaleBuffer, numValues, notNull);
     batch.precision = precision;
     batch.scale = scale;
+    // decode the values together and then move them to the non-null
+    // positions
     if (notNull) {
+      uint64_t count = countNonNulls(notNull, numValues);
+      valueCursor.readVarints(values, count);
+      spreadNonNulls(values, numValues, count, notNull);
       for(size_t i=0; i < numValues; ++i) {
         if (notNull[i]) {
-          readInt64(values[i], static_cast<int32_t>(scaleBuffer[i]));
+          rescaleInt64(values[i], static_cast<int32_t>(scaleBuffer[i]));
         }
       }
     } else {
+      valueCursor.readVarints(values, numValues);
       for(size_t i=0; i < numValues; ++i) {
-        readInt64(values[i], static_cast<int32_t>(scaleBuffer[i]));
+        rescaleInt64(values[i], static_cast<int32_t>(scaleBuffer[i]));
       }
     }
   }
@@ -1301,8 +1285,7 @@ namespace orc {
       Int128 work;
       uint32_t offset = 0;
       while (true) {
-        readBuffer();
-        unsigned char ch = static_cast<unsigned char>(*(buffer++));
+        unsigned char ch = valueCursor.readByte();
         work = ch & 0x7f;
         work <<= offset;
         value |=  work;
@@ -1372,8 +1355,7 @@ namespace orc {
       uint32_t offset = 0;
       bool result = true;
       while (true) {
-        readBuffer();
-        unsigned char ch = static_cast<unsigned char>(*(buffer++));
+        unsigned char ch = valueCursor.readByte();
         work = ch & 0x7f;
         // If we have read more than 128 bits, we flag the error, but keep
         // reading bytes so the stream isn't thrown off.
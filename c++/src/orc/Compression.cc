@@ -19,6 +19,8 @@
 #include "orc/Adaptor.hh"
 #include "Compression.hh"
 #include "Exceptions.hh"
+#include "Lz4.hh"
+#include "Lzo.hh"
 
 #include <algorithm>
 #include <iomanip>
@@ -29,6 +31,8 @@
 
 #include "wrap/snappy-wrapper.h"
 
+#include "zstd.h"
+
 namespace orc {
 
   void printBuffer(std::ostream& out,
@@ -59,10 +63,75 @@ namespace orc {
     return result;
   }
 
+  uint64_t PositionProvider::current() const {
+    return *position;
+  }
+
   SeekableInputStream::~SeekableInputStream() {
     // PASS
   }
 
+  bool SeekableInputStream::nextContiguous(const void**, uint64_t) {
+    return false;
+  }
+
+  DecompressionCounters::DecompressionCounters(): decompressedBytes(0),
+                                                  copiedBytes(0),
+                                                  passedThroughBytes(0) {
+    // PASS
+  }
+
+  const uint64_t ChunkIndex::UNKNOWN_LENGTH;
+
+  void ChunkIndex::addChunk(uint64_t headerOffset,
+                            uint64_t compressedLength,
+                            bool isOriginal) {
+    std::unordered_map<uint64_t, Chunk>::iterator itr =
+      chunks.find(headerOffset);
+    if (itr == chunks.end() ||
+        itr->second.compressedLength != compressedLength) {
+      Chunk chunk;
+      chunk.compressedLength = compressedLength;
+      chunk.uncompressedLength = isOriginal ? compressedLength :
+        UNKNOWN_LENGTH;
+      chunks[headerOffset] = chunk;
+    }
+  }
+
+  void ChunkIndex::setUncompressedLength(uint64_t headerOffset,
+                                         uint64_t length) {
+    std::unordered_map<uint64_t, Chunk>::iterator itr =
+      chunks.find(headerOffset);
+    if (itr != chunks.end()) {
+      itr->second.uncompressedLength = length;
+    }
+  }
+
+  const ChunkIndex::Chunk* ChunkIndex::findChunk(uint64_t headerOffset
+                                                 ) const {
+    std::unordered_map<uint64_t, Chunk>::const_iterator itr =
+      chunks.find(headerOffset);
+    return itr == chunks.end() ? nullptr : &itr->second;
+  }
+
+  uint64_t ChunkIndex::skipChunks(uint64_t headerOffset,
+                                  uint64_t count,
+                                  uint64_t* compressedBytes) const {
+    uint64_t skipped = 0;
+    *compressedBytes = 0;
+    const Chunk* chunk = findChunk(headerOffset);
+    while (chunk != nullptr && chunk->uncompressedLength <= count - skipped) {
+      skipped += chunk->uncompressedLength;
+      *compressedBytes += 3 + chunk->compressedLength;
+      chunk = findChunk(headerOffset + *compressedBytes);
+    }
+    return skipped;
+  }
+
+  uint64_t ChunkIndex::size() const {
+    return chunks.size();
+  }
+
   SeekableArrayInputStream::~SeekableArrayInputStream() {
     // PASS
   }
@@ -143,6 +212,16 @@ namespace orc {
     position = seekPosition.next();
   }
 
+  bool SeekableArrayInputStream::nextContiguous(const void** buffer,
+                                                uint64_t count) {
+    if (count > length - position) {
+      return false;
+    }
+    *buffer = (data ? data : ownedData->data()) + position;
+    position += count;
+    return true;
+  }
+
   std::string SeekableArrayInputStream::getName() const {
     std::ostringstream result;
     result << "SeekableArrayInputStream " << position << " of " << length;
@@ -230,6 +309,25 @@ namespace orc {
     pushBack = 0;
   }
 
+  bool SeekableFileInputStream::nextContiguous(const void** data,
+                                               uint64_t count) {
+    if (count > length - position) {
+      return false;
+    }
+    if (pushBack >= count) {
+      // the bytes are all in the buffer that was backed up
+      *data = buffer->getStart() + (buffer->getLength() - pushBack);
+      pushBack -= count;
+    } else {
+      // read exactly this range, even if part of it was already read
+      buffer = input->read(start + position, count, buffer);
+      *data = static_cast<void*>(buffer->getStart());
+      pushBack = 0;
+    }
+    position += count;
+    return true;
+  }
+
   std::string SeekableFileInputStream::getName() const {
     std::ostringstream result;
     result << input->getName() << " from " << start << " for "
@@ -239,16 +337,23 @@ namespace orc {
 
   enum DecompressState { DECOMPRESS_HEADER,
                          DECOMPRESS_START,
-                         DECOMPRESS_CONTINUE,
                          DECOMPRESS_ORIGINAL,
                          DECOMPRESS_EOF};
 
-  class ZlibDecompressionStream: public SeekableInputStream {
+  /**
+   * A stream that decompresses each chunk as a single block, which must
+   * be contiguous before it can be decompressed.
+   */
+  class BlockDecompressionStream: public SeekableInputStream {
   public:
-    ZlibDecompressionStream(std::unique_ptr<SeekableInputStream> inStream,
-                            size_t blockSize,
-                            MemoryPool& pool);
-    virtual ~ZlibDecompressionStream();
+    BlockDecompressionStream(std::unique_ptr<ChunkDecompressor> codec,
+                             std::unique_ptr<SeekableInputStream> inStream,
+                             size_t blockSize,
+                             MemoryPool& pool,
+                             DecompressionCounters* counters,
+                             const ChunkCacheStream* cacheStream);
+
+    virtual ~BlockDecompressionStream() {}
     virtual bool Next(const void** data, int*size) override;
     virtual void BackUp(int count) override;
     virtual bool Skip(int count) override;
@@ -257,277 +362,49 @@ namespace orc {
     virtual std::string getName() const override;
 
   private:
-    void readBuffer(bool failOnEof) {
-      int length;
-      if (!input->Next(reinterpret_cast<const void**>(&inputBuffer),
-                       &length)) {
-        if (failOnEof) {
-          throw ParseError("Read past EOF in "
-                           "ZlibDecompressionStream::readBuffer");
-        }
-        state = DECOMPRESS_EOF;
-        inputBuffer = nullptr;
-        inputBufferEnd = nullptr;
-      } else {
-        inputBufferEnd = inputBuffer + length;
-      }
-    }
-
-    uint32_t readByte(bool failOnEof) {
-      if (inputBuffer == inputBufferEnd) {
-        readBuffer(failOnEof);
-        if (state == DECOMPRESS_EOF) {
-          return 0;
-        }
-      }
-      return static_cast<unsigned char>(*(inputBuffer++));
-    }
-
-    void readHeader() {
-      uint32_t header = readByte(false);
-      if (state != DECOMPRESS_EOF) {
-        header |= readByte(true) << 8;
-        header |= readByte(true) << 16;
-        if (header & 1) {
-          state = DECOMPRESS_ORIGINAL;
-        } else {
-          state = DECOMPRESS_START;
-        }
-        remainingLength = header >> 1;
-      } else {
-        remainingLength = 0;
+    /**
+     * Move past bytes of the input without reading them, if they aren't
+     * already buffered.
+     */
+    void skipInput(size_t count);
+
+    /**
+     * Ask the input for the rest of the current chunk as one buffer.
+     * If it can't, the current input buffer is left as it was.
+     */
+    bool readContiguous(const char** compressed) {
+      input->BackUp(static_cast<int>(inputBufferPtrEnd - inputBufferPtr));
+      const void* data;
+      if (input->nextContiguous(&data, remainingLength)) {
+        *compressed = static_cast<const char*>(data);
+        inputBufferPtr = nullptr;
+        inputBufferPtrEnd = nullptr;
+        return true;
       }
-    }
-
-    MemoryPool& pool;
-    const size_t blockSize;
-    std::unique_ptr<SeekableInputStream> input;
-    z_stream zstream;
-    DataBuffer<char> buffer;
-
-    // the current state
-    DecompressState state;
-
-    // the start of the current buffer
-    // This pointer is not owned by us. It is either owned by zstream or
-    // the underlying stream.
-    const char* outputBuffer;
-    // the size of the current buffer
-    size_t outputBufferLength;
-    // the size of the current chunk
-    size_t remainingLength;
-
-    // the last buffer returned from the input
-    const char *inputBuffer;
-    const char *inputBufferEnd;
-
-    // roughly the number of bytes returned
-    off_t bytesReturned;
-  };
-
-DIAGNOSTIC_PUSH
-DIAGNOSTIC_IGNORE("-Wold-style-cast")
-
-  ZlibDecompressionStream::ZlibDecompressionStream
-                   (std::unique_ptr<SeekableInputStream> inStream,
-                    size_t _blockSize,
-                    MemoryPool& _pool
-                    ): pool(_pool),
-                       blockSize(_blockSize),
-                       buffer(pool, _blockSize) {
-    input.reset(inStream.release());
-    zstream.next_in = Z_NULL;
-    zstream.avail_in = 0;
-    zstream.zalloc = Z_NULL;
-    zstream.zfree = Z_NULL;
-    zstream.opaque = Z_NULL;
-    zstream.next_out = reinterpret_cast<Bytef*>(buffer.data());
-    zstream.avail_out = static_cast<uInt>(blockSize);
-    int64_t result = inflateInit2(&zstream, -15);
-    switch (result) {
-    case Z_OK:
-      break;
-    case Z_MEM_ERROR:
-      throw std::logic_error("Memory error from inflateInit2");
-    case Z_VERSION_ERROR:
-      throw std::logic_error("Version error from inflateInit2");
-    case Z_STREAM_ERROR:
-      throw std::logic_error("Stream error from inflateInit2");
-    default:
-      throw std::logic_error("Unknown error from inflateInit2");
-    }
-    outputBuffer = nullptr;
-    outputBufferLength = 0;
-    remainingLength = 0;
-    state = DECOMPRESS_HEADER;
-    inputBuffer = nullptr;
-    inputBufferEnd = nullptr;
-    bytesReturned = 0;
-  }
-
-DIAGNOSTIC_POP
-
-  ZlibDecompressionStream::~ZlibDecompressionStream() {
-    int64_t result = inflateEnd(&zstream);
-    if (result != Z_OK) {
-      // really can't throw in destructors
-      std::cout << "Error in ~ZlibDecompressionStream() " << result << "\n";
-    }
-  }
-
-  bool ZlibDecompressionStream::Next(const void** data, int*size) {
-    // if the user pushed back, return them the partial buffer
-    if (outputBufferLength) {
-      *data = outputBuffer;
-      *size = static_cast<int>(outputBufferLength);
-      outputBuffer += outputBufferLength;
-      outputBufferLength = 0;
-      return true;
-    }
-    if (state == DECOMPRESS_HEADER || remainingLength == 0) {
-      readHeader();
-    }
-    if (state == DECOMPRESS_EOF) {
-      return false;
-    }
-    if (inputBuffer == inputBufferEnd) {
+      // get back the bytes that we backed up, which may come with more
       readBuffer(true);
+      return false;
     }
-    size_t availSize =
-      std::min(static_cast<size_t>(inputBufferEnd - inputBuffer),
-               remainingLength);
-    if (state == DECOMPRESS_ORIGINAL) {
-      *data = inputBuffer;
-      *size = static_cast<int>(availSize);
-      outputBuffer = inputBuffer + availSize;
-      outputBufferLength = 0;
-    } else if (state == DECOMPRESS_START) {
-      zstream.next_in =
-        reinterpret_cast<Bytef*>(const_cast<char*>(inputBuffer));
-      zstream.avail_in = static_cast<uInt>(availSize);
-      outputBuffer = buffer.data();
-      zstream.next_out =
-        reinterpret_cast<Bytef*>(const_cast<char*>(outputBuffer));
-      zstream.avail_out = static_cast<uInt>(blockSize);
-      if (inflateReset(&zstream) != Z_OK) {
-        throw std::logic_error("Bad inflateReset in "
-                               "ZlibDecompressionStream::Next");
-      }
-      int64_t result;
-      do {
-        result = inflate(&zstream, availSize == remainingLength ? Z_FINISH :
-                         Z_SYNC_FLUSH);
-        switch (result) {
-        case Z_OK:
-          remainingLength -= availSize;
-          inputBuffer += availSize;
-          readBuffer(true);
-          availSize =
-            std::min(static_cast<size_t>(inputBufferEnd - inputBuffer),
-                     remainingLength);
-          zstream.next_in =
-            reinterpret_cast<Bytef*>(const_cast<char*>(inputBuffer));
-          zstream.avail_in = static_cast<uInt>(availSize);
-          break;
-        case Z_STREAM_END:
-          break;
-        case Z_BUF_ERROR:
-          throw std::logic_error("Buffer error in "
-                                 "ZlibDecompressionStream::Next");
-        case Z_DATA_ERROR:
-          throw std::logic_error("Data error in "
-                                 "ZlibDecompressionStream::Next");
-        case Z_STREAM_ERROR:
-          throw std::logic_error("Stream error in "
-                                 "ZlibDecompressionStream::Next");
-        default:
-          throw std::logic_error("Unknown error in "
-                                 "ZlibDecompressionStream::Next");
-        }
-      } while (result != Z_STREAM_END);
-      *size = static_cast<int>(blockSize - zstream.avail_out);
-      *data = outputBuffer;
-      outputBufferLength = 0;
-      outputBuffer += *size;
-    } else {
-      throw std::logic_error("Unknown compression state in "
-                             "ZlibDecompressionStream::Next");
-    }
-    inputBuffer += availSize;
-    remainingLength -= availSize;
-    bytesReturned += *size;
-    return true;
-  }
-
-  void ZlibDecompressionStream::BackUp(int count) {
-    if (outputBuffer == nullptr || outputBufferLength != 0) {
-      throw std::logic_error("Backup without previous Next in "
-                             "ZlibDecompressionStream");
-    }
-    outputBuffer -= static_cast<size_t>(count);
-    outputBufferLength = static_cast<size_t>(count);
-    bytesReturned -= count;
-  }
 
-  bool ZlibDecompressionStream::Skip(int count) {
-    bytesReturned += count;
-    // this is a stupid implementation for now.
-    // should skip entire blocks without decompressing
-    while (count > 0) {
-      const void *ptr;
-      int len;
-      if (!Next(&ptr, &len)) {
+    /**
+     * Look for the current chunk in the cache.
+     */
+    bool findCachedChunk() {
+      if (cacheStream.get() == nullptr) {
         return false;
       }
-      if (len > count) {
-        BackUp(len - count);
-        count = 0;
-      } else {
-        count -= len;
-      }
+      cachedChunk = cacheStream->cache->get(cacheStream->file,
+                                            cacheStream->streamOffset,
+                                            chunkOffset);
+      return cachedChunk.get() != nullptr;
     }
-    return true;
-  }
 
-  int64_t ZlibDecompressionStream::ByteCount() const {
-    return bytesReturned;
-  }
-
-  void ZlibDecompressionStream::seek(PositionProvider& position) {
-    input->seek(position);
-    bytesReturned = input->ByteCount();
-    if (!Skip(static_cast<int>(position.next()))) {
-      throw ParseError("Bad skip in ZlibDecompressionStream::seek");
-    }
-  }
-
-  std::string ZlibDecompressionStream::getName() const {
-    std::ostringstream result;
-    result << "zlib(" << input->getName() << ")";
-    return result.str();
-  }
-
-  class SnappyDecompressionStream: public SeekableInputStream {
-  public:
-    SnappyDecompressionStream(std::unique_ptr<SeekableInputStream> inStream,
-                              size_t blockSize,
-                              MemoryPool& pool);
-
-    virtual ~SnappyDecompressionStream() {}
-    virtual bool Next(const void** data, int*size) override;
-    virtual void BackUp(int count) override;
-    virtual bool Skip(int count) override;
-    virtual int64_t ByteCount() const override;
-    virtual void seek(PositionProvider& position) override;
-    virtual std::string getName() const override;
-
-  private:
     void readBuffer(bool failOnEof) {
       int length;
       if (!input->Next(reinterpret_cast<const void**>(&inputBufferPtr),
                        &length)) {
         if (failOnEof) {
-          throw ParseError("SnappyDecompressionStream read past EOF");
+          throw ParseError(codec->getName() + " read past EOF");
         }
         state = DECOMPRESS_EOF;
         inputBufferPtr = nullptr;
@@ -548,6 +425,8 @@ DIAGNOSTIC_POP
     }
 
     void readHeader() {
+      chunkOffset = getInputOffset();
+      decodedChunk = nullptr;
       uint32_t header = readByte(false);
       if (state != DECOMPRESS_EOF) {
         header |= readByte(true) << 8;
@@ -558,16 +437,48 @@ DIAGNOSTIC_POP
           state = DECOMPRESS_START;
         }
         remainingLength = header >> 1;
+        chunkIndex.addChunk(chunkOffset, remainingLength, header & 1);
       } else {
         remainingLength = 0;
       }
     }
 
+    /**
+     * Get the offset in the input of the next byte to read.
+     */
+    uint64_t getInputOffset() const {
+      return static_cast<uint64_t>(input->ByteCount()) -
+        static_cast<uint64_t>(inputBufferPtrEnd - inputBufferPtr);
+    }
+
+    /**
+     * Remember the whole chunk that is being returned.
+     */
+    void setDecodedChunk(const char* chunk, size_t length) {
+      chunkIndex.setUncompressedLength(chunkOffset, length);
+      decodedChunk = chunk;
+      decodedLength = length;
+    }
+
+    /**
+     * Skip the whole chunks at the current position whose lengths are in
+     * the index.
+     * @return the number of uncompressed bytes skipped
+     */
+    size_t skipIndexedChunks(size_t count);
+
+    const std::unique_ptr<ChunkDecompressor> codec;
     std::unique_ptr<SeekableInputStream> input;
     MemoryPool& pool;
+    DecompressionCounters* const counters;
+
+    // where the decompressed chunks are cached, if they are
+    const std::unique_ptr<ChunkCacheStream> cacheStream;
+    // the cached chunk that is being returned
+    CachedChunk cachedChunk;
 
     // may need to stitch together multiple input buffers;
-    // to give snappy a contiguous block
+    // to give the codec a contiguous block
     DataBuffer<char> inputBuffer;
 
     // uncompressed output
@@ -583,6 +494,15 @@ DIAGNOSTIC_POP
 
     // the size of the current chunk
     size_t remainingLength;
+    // the offset of the current chunk's header in the input
+    uint64_t chunkOffset;
+
+    // the chunks that have been read
+    ChunkIndex chunkIndex;
+    // the chunk that was returned last while the input is still just
+    // past it
+    const char* decodedChunk;
+    size_t decodedLength;
 
     // the last buffer returned from the input
     const char *inputBufferPtr;
@@ -592,24 +512,34 @@ DIAGNOSTIC_POP
     off_t bytesReturned;
   };
 
-  SnappyDecompressionStream::SnappyDecompressionStream
-                   (std::unique_ptr<SeekableInputStream> inStream,
+  BlockDecompressionStream::BlockDecompressionStream
+                   (std::unique_ptr<ChunkDecompressor> _codec,
+                    std::unique_ptr<SeekableInputStream> inStream,
                     size_t bufferSize,
-                    MemoryPool& _pool
-                    ) : pool(_pool),
+                    MemoryPool& _pool,
+                    DecompressionCounters* _counters,
+                    const ChunkCacheStream* _cacheStream
+                    ) : codec(std::move(_codec)),
+                        pool(_pool),
+                        counters(_counters),
+                        cacheStream(_cacheStream == nullptr ? nullptr :
+                                    new ChunkCacheStream(*_cacheStream)),
                         inputBuffer(pool, bufferSize),
                         outputBuffer(pool, bufferSize),
                         state(DECOMPRESS_HEADER),
                         outputBufferPtr(0),
                         outputBufferLength(0),
                         remainingLength(0),
+                        chunkOffset(0),
+                        decodedChunk(nullptr),
+                        decodedLength(0),
                         inputBufferPtr(0),
                         inputBufferPtrEnd(0),
                         bytesReturned(0) {
     input.reset(inStream.release());
   }
 
-  bool SnappyDecompressionStream::Next(const void** data, int*size) {
+  bool BlockDecompressionStream::Next(const void** data, int*size) {
     // if the user pushed back, return them the partial buffer
     if (outputBufferLength) {
       *data = outputBufferPtr;
@@ -639,13 +569,34 @@ DIAGNOSTIC_POP
       outputBufferLength = 0;
       inputBufferPtr += availSize;
       remainingLength -= availSize;
+      if (counters != nullptr) {
+        counters->passedThroughBytes += availSize;
+      }
+    } else if (state == DECOMPRESS_START && findCachedChunk()) {
+      // another reader already decompressed this chunk
+      skipInput(remainingLength);
+      remainingLength = 0;
+      state = DECOMPRESS_HEADER;
+      *data = cachedChunk->data();
+      *size = static_cast<int>(cachedChunk->size());
+      setDecodedChunk(cachedChunk->data(), cachedChunk->size());
+      outputBufferPtr = cachedChunk->data() + cachedChunk->size();
+      outputBufferLength = 0;
     } else if (state == DECOMPRESS_START) {
       // Get contiguous bytes of compressed block.
       const char *compressed = inputBufferPtr;
       if (remainingLength == availSize) {
           inputBufferPtr += availSize;
+      } else if (readContiguous(&compressed)) {
+        // the input gave us the whole chunk at once
       } else {
-        // Did not read enough from input.
+        // Did not read enough from input, so copy the pieces together.
+        availSize =
+          std::min(static_cast<size_t>(inputBufferPtrEnd - inputBufferPtr),
+                   remainingLength);
+        if (counters != nullptr) {
+          counters->copiedBytes += remainingLength;
+        }
         if (inputBuffer.capacity() < remainingLength) {
           inputBuffer.resize(remainingLength);
         }
@@ -664,20 +615,19 @@ DIAGNOSTIC_POP
         }
       }
 
-      if (!snappy::GetUncompressedLength(compressed, remainingLength,
-                                         &outputBufferLength)) {
-        throw ParseError("SnappyDecompressionStream choked on corrupt input");
+      outputBufferLength = codec->decompress(compressed, remainingLength,
+                                      outputBuffer.data(),
+                                      outputBuffer.capacity());
+      if (counters != nullptr) {
+        counters->decompressedBytes += outputBufferLength;
       }
-
-      if (outputBufferLength > outputBuffer.capacity()) {
-        throw std::logic_error("uncompressed length exceeds block size");
-      }
-
-      if (!snappy::RawUncompress(compressed, remainingLength,
-                                 outputBuffer.data())) {
-        throw ParseError("SnappyDecompressionStream choked on corrupt input");
+      if (cacheStream.get() != nullptr) {
+        cacheStream->cache->put(cacheStream->file, cacheStream->streamOffset,
+                                chunkOffset, outputBuffer.data(),
+                                outputBufferLength);
       }
 
+      setDecodedChunk(outputBuffer.data(), outputBufferLength);
       remainingLength = 0;
       state = DECOMPRESS_HEADER;
       *data = outputBuffer.data();
@@ -690,71 +640,404 @@ DIAGNOSTIC_POP
     return true;
   }
 
-  void SnappyDecompressionStream::BackUp(int count) {
+  void BlockDecompressionStream::BackUp(int count) {
     if (outputBufferPtr == nullptr || outputBufferLength != 0) {
-      throw std::logic_error("Backup without previous Next in "
-                             "SnappyDecompressionStream");
+      throw std::logic_error("Backup without previous Next in " +
+                             codec->getName());
     }
     outputBufferPtr -= static_cast<size_t>(count);
     outputBufferLength = static_cast<size_t>(count);
     bytesReturned -= count;
   }
 
-  bool SnappyDecompressionStream::Skip(int count) {
-    bytesReturned += count;
-    // this is a stupid implementation for now.
-    // should skip entire blocks without decompressing
+  void BlockDecompressionStream::skipInput(size_t count) {
+    size_t buffered =
+      std::min(static_cast<size_t>(inputBufferPtrEnd - inputBufferPtr),
+               count);
+    inputBufferPtr += buffered;
+    count -= buffered;
+    if (count > 0) {
+      int64_t before = input->ByteCount();
+      input->Skip(static_cast<int>(count));
+      if (static_cast<size_t>(input->ByteCount() - before) != count) {
+        throw ParseError(codec->getName() + " skip past EOF");
+      }
+    }
+  }
+
+  size_t BlockDecompressionStream::skipIndexedChunks(size_t count) {
+    uint64_t compressedBytes;
+    uint64_t skipped = chunkIndex.skipChunks(getInputOffset(), count,
+                                             &compressedBytes);
+    if (compressedBytes > 0) {
+      skipInput(compressedBytes);
+      bytesReturned += skipped;
+      outputBufferPtr = nullptr;
+      decodedChunk = nullptr;
+    }
+    return skipped;
+  }
+
+  bool BlockDecompressionStream::Skip(int signedCount) {
+    if (signedCount < 0) {
+      return false;
+    }
+    size_t count = static_cast<size_t>(signedCount);
+    // first use up anything that was pushed back
+    size_t buffered = std::min(outputBufferLength, count);
+    outputBufferPtr += buffered;
+    outputBufferLength -= buffered;
+    bytesReturned += buffered;
+    count -= buffered;
     while (count > 0) {
-      const void *ptr;
-      int len;
-      if (!Next(&ptr, &len)) {
+      if (state == DECOMPRESS_HEADER || remainingLength == 0) {
+        count -= skipIndexedChunks(count);
+        if (count == 0) {
+          break;
+        }
+        readHeader();
+      }
+      if (state == DECOMPRESS_EOF) {
         return false;
       }
-      if (len > count) {
-        BackUp(len - count);
-        count = 0;
+      if (state == DECOMPRESS_ORIGINAL) {
+        // the uncompressed bytes are the input bytes
+        size_t skipped = std::min(remainingLength, count);
+        skipInput(skipped);
+        remainingLength -= skipped;
+        bytesReturned += skipped;
+        count -= skipped;
+        outputBufferPtr = nullptr;
+        continue;
+      }
+      if (inputBufferPtr == inputBufferPtrEnd) {
+        readBuffer(true);
+      }
+      uint64_t chunkLength;
+      size_t availSize =
+        std::min(static_cast<size_t>(inputBufferPtrEnd - inputBufferPtr),
+                 remainingLength);
+      if (codec->getUncompressedLength(inputBufferPtr, availSize, remainingLength,
+                                &chunkLength) && chunkLength <= count) {
+        // the whole chunk is skipped, so don't decompress it
+        chunkIndex.setUncompressedLength(chunkOffset, chunkLength);
+        skipInput(remainingLength);
+        remainingLength = 0;
+        state = DECOMPRESS_HEADER;
+        bytesReturned += chunkLength;
+        count -= chunkLength;
+        outputBufferPtr = nullptr;
       } else {
-        count -= len;
+        // decompress the chunk and push back what wasn't skipped
+        const void *ptr;
+        int len;
+        if (!Next(&ptr, &len)) {
+          return false;
+        }
+        size_t unsignedLen = static_cast<size_t>(len);
+        if (unsignedLen > count) {
+          BackUp(static_cast<int>(unsignedLen - count));
+          count = 0;
+        } else {
+          count -= unsignedLen;
+        }
       }
     }
     return true;
   }
 
-  int64_t SnappyDecompressionStream::ByteCount() const {
+  int64_t BlockDecompressionStream::ByteCount() const {
     return bytesReturned;
   }
 
-  void SnappyDecompressionStream::seek(PositionProvider& position) {
+  void BlockDecompressionStream::seek(PositionProvider& position) {
+    // seeking inside the chunk that was just decompressed doesn't read or
+    // decompress anything
+    if (decodedChunk != nullptr && position.current() == chunkOffset) {
+      position.next();
+      uint64_t offset = position.next();
+      if (offset > decodedLength) {
+        throw ParseError("Bad skip in " + codec->getName() + "::seek");
+      }
+      outputBufferPtr = decodedChunk + offset;
+      outputBufferLength = decodedLength - offset;
+      bytesReturned = static_cast<off_t>(chunkOffset + offset);
+      return;
+    }
     input->seek(position);
+    // drop whatever was buffered from the old position
+    state = DECOMPRESS_HEADER;
+    outputBufferPtr = nullptr;
+    outputBufferLength = 0;
+    remainingLength = 0;
+    decodedChunk = nullptr;
+    inputBufferPtr = nullptr;
+    inputBufferPtrEnd = nullptr;
+    bytesReturned = input->ByteCount();
     if (!Skip(static_cast<int>(position.next()))) {
-      throw ParseError("Bad skip in SnappyDecompressionStream::seek");
+      throw ParseError("Bad skip in " + codec->getName() + "::seek");
     }
   }
 
-  std::string SnappyDecompressionStream::getName() const {
+  std::string BlockDecompressionStream::getName() const {
     std::ostringstream result;
-    result << "snappy(" << input->getName() << ")";
+    result << codec->getName() << "(" << input->getName() << ")";
     return result.str();
   }
 
-  std::unique_ptr<SeekableInputStream>
-     createDecompressor(CompressionKind kind,
-                        std::unique_ptr<SeekableInputStream> input,
-                        uint64_t blockSize,
-                        MemoryPool& pool) {
+  ChunkDecompressor::~ChunkDecompressor() {
+    // PASS
+  }
+
+  bool ChunkDecompressor::getUncompressedLength(const char*,
+                                                uint64_t,
+                                                uint64_t,
+                                                uint64_t*) const {
+    return false;
+  }
+
+  /**
+   * Inflates each chunk with a single call, so the whole chunk must be
+   * contiguous.
+   */
+  class ZlibChunkDecompressor: public ChunkDecompressor {
+  public:
+    ZlibChunkDecompressor();
+    virtual ~ZlibChunkDecompressor();
+    virtual uint64_t decompress(const char* input,
+                                uint64_t length,
+                                char* output,
+                                uint64_t maxOutputLength) override;
+    virtual std::string getName() const override {
+      return "zlib";
+    }
+
+  private:
+    z_stream zstream;
+  };
+
+DIAGNOSTIC_PUSH
+DIAGNOSTIC_IGNORE("-Wold-style-cast")
+
+  ZlibChunkDecompressor::ZlibChunkDecompressor() {
+    zstream.next_in = Z_NULL;
+    zstream.avail_in = 0;
+    zstream.zalloc = Z_NULL;
+    zstream.zfree = Z_NULL;
+    zstream.opaque = Z_NULL;
+    if (inflateInit2(&zstream, -15) != Z_OK) {
+      throw std::logic_error("Error from inflateInit2");
+    }
+  }
+
+DIAGNOSTIC_POP
+
+  ZlibChunkDecompressor::~ZlibChunkDecompressor() {
+    inflateEnd(&zstream);
+  }
+
+  uint64_t ZlibChunkDecompressor::decompress(const char* input,
+                                             uint64_t length,
+                                             char* output,
+                                             uint64_t maxOutputLength) {
+    if (inflateReset(&zstream) != Z_OK) {
+      throw std::logic_error("Bad inflateReset in ZlibChunkDecompressor");
+    }
+    zstream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+    zstream.avail_in = static_cast<uInt>(length);
+    zstream.next_out = reinterpret_cast<Bytef*>(output);
+    zstream.avail_out = static_cast<uInt>(maxOutputLength);
+    switch (inflate(&zstream, Z_FINISH)) {
+    case Z_STREAM_END:
+      break;
+    case Z_BUF_ERROR:
+      throw ParseError("Chunk doesn't fit in ZlibChunkDecompressor");
+    case Z_DATA_ERROR:
+      throw ParseError("Data error in ZlibChunkDecompressor");
+    default:
+      throw std::logic_error("Unknown error in ZlibChunkDecompressor");
+    }
+    return maxOutputLength - zstream.avail_out;
+  }
+
+  class SnappyChunkDecompressor: public ChunkDecompressor {
+  public:
+    virtual uint64_t decompress(const char* input,
+                                uint64_t length,
+                                char* output,
+                                uint64_t maxOutputLength) override;
+
+    virtual std::string getName() const override {
+      return "snappy";
+    }
+
+    virtual bool getUncompressedLength(const char* input,
+                                       uint64_t available,
+                                       uint64_t,
+                                       uint64_t* result) const override {
+      // snappy starts each block with a varint of the length
+      size_t length;
+      if (!snappy::GetUncompressedLength(input, available, &length)) {
+        return false;
+      }
+      *result = length;
+      return true;
+    }
+  };
+
+  uint64_t SnappyChunkDecompressor::decompress(const char* input,
+                                               uint64_t length,
+                                               char* output,
+                                               uint64_t maxOutputLength) {
+    size_t outLength;
+    if (!snappy::GetUncompressedLength(input, length, &outLength)) {
+      throw ParseError("SnappyDecompressionStream choked on corrupt input");
+    }
+
+    if (outLength > maxOutputLength) {
+      throw std::logic_error("uncompressed length exceeds block size");
+    }
+
+    if (!snappy::RawUncompress(input, length, output)) {
+      throw ParseError("SnappyDecompressionStream choked on corrupt input");
+    }
+    return outLength;
+  }
+
+  class LzoChunkDecompressor: public ChunkDecompressor {
+  public:
+    virtual uint64_t decompress(const char* input,
+                                uint64_t length,
+                                char* output,
+                                uint64_t maxOutputLength) override {
+      return lzoDecompress(input, length, output, maxOutputLength);
+    }
+
+    virtual std::string getName() const override {
+      return "lzo";
+    }
+  };
+
+  class Lz4ChunkDecompressor: public ChunkDecompressor {
+  public:
+    virtual uint64_t decompress(const char* input,
+                                uint64_t length,
+                                char* output,
+                                uint64_t maxOutputLength) override {
+      return lz4Decompress(input, length, output, maxOutputLength);
+    }
+
+    virtual std::string getName() const override {
+      return "lz4";
+    }
+
+    virtual bool getUncompressedLength(const char* input,
+                                       uint64_t available,
+                                       uint64_t length,
+                                       uint64_t* result) const override {
+      // walking the sequences needs the whole block
+      if (available != length) {
+        return false;
+      }
+      *result = lz4UncompressedLength(input, length);
+      return true;
+    }
+  };
+
+  /**
+   * Each ZSTD chunk is a complete zstd frame.
+   */
+  class ZstdChunkDecompressor: public ChunkDecompressor {
+  public:
+    ZstdChunkDecompressor();
+    virtual ~ZstdChunkDecompressor();
+
+    virtual uint64_t decompress(const char* input,
+                                uint64_t length,
+                                char* output,
+                                uint64_t maxOutputLength) override;
+
+    virtual std::string getName() const override {
+      return "zstd";
+    }
+
+    virtual bool getUncompressedLength(const char* input,
+                                       uint64_t available,
+                                       uint64_t,
+                                       uint64_t* result) const override {
+      // the frame header records the size unless the writer streamed it
+      unsigned long long length = ZSTD_getFrameContentSize(input, available);
+      if (length == ZSTD_CONTENTSIZE_UNKNOWN ||
+          length == ZSTD_CONTENTSIZE_ERROR) {
+        return false;
+      }
+      *result = length;
+      return true;
+    }
+
+  private:
+    // reused for each chunk to avoid reallocating the decoder's tables
+    ZSTD_DCtx* context;
+  };
+
+  ZstdChunkDecompressor::ZstdChunkDecompressor(
+                                              ): context(ZSTD_createDCtx()) {
+    if (context == nullptr) {
+      throw std::logic_error("Memory error from ZSTD_createDCtx");
+    }
+  }
+
+  ZstdChunkDecompressor::~ZstdChunkDecompressor() {
+    ZSTD_freeDCtx(context);
+  }
+
+  uint64_t ZstdChunkDecompressor::decompress(const char* input,
+                                             uint64_t length,
+                                             char* output,
+                                             uint64_t maxOutputLength) {
+    size_t result = ZSTD_decompressDCtx(context, output, maxOutputLength,
+                                        input, length);
+    if (ZSTD_isError(result)) {
+      throw ParseError(std::string("ZstdDecompressionStream choked on "
+                                   "corrupt input: ") +
+                       ZSTD_getErrorName(result));
+    }
+    return result;
+  }
+
+  std::unique_ptr<ChunkDecompressor>
+     createChunkDecompressor(CompressionKind kind) {
     switch (static_cast<int64_t>(kind)) {
-    case CompressionKind_NONE:
-      return std::move(input);
     case CompressionKind_ZLIB:
-      return std::unique_ptr<SeekableInputStream>
-        (new ZlibDecompressionStream(std::move(input), blockSize, pool));
+      return std::unique_ptr<ChunkDecompressor>(new ZlibChunkDecompressor());
     case CompressionKind_SNAPPY:
-      return std::unique_ptr<SeekableInputStream>
-        (new SnappyDecompressionStream(std::move(input), blockSize, pool));
+      return std::unique_ptr<ChunkDecompressor>
+        (new SnappyChunkDecompressor());
     case CompressionKind_LZO:
+      return std::unique_ptr<ChunkDecompressor>(new LzoChunkDecompressor());
+    case CompressionKind_LZ4:
+      return std::unique_ptr<ChunkDecompressor>(new Lz4ChunkDecompressor());
+    case CompressionKind_ZSTD:
+      return std::unique_ptr<ChunkDecompressor>(new ZstdChunkDecompressor());
     default:
       throw NotImplementedYet("compression codec");
     }
   }
 
+  std::unique_ptr<SeekableInputStream>
+     createDecompressor(CompressionKind kind,
+                        std::unique_ptr<SeekableInputStream> input,
+                        uint64_t blockSize,
+                        MemoryPool& pool,
+                        DecompressionCounters* counters,
+                        const ChunkCacheStream* cacheStream) {
+    if (kind == CompressionKind_NONE) {
+      return std::move(input);
+    }
+    return std::unique_ptr<SeekableInputStream>
+      (new BlockDecompressionStream(createChunkDecompressor(kind),
+                                    std::move(input), blockSize, pool,
+                                    counters, cacheStream));
+  }
+
 }
@@ -21,14 +21,17 @@
 
 #include "orc/Adaptor.hh"
 #include "orc/OrcFile.hh"
+#include "ChunkCache.hh"
 #include "wrap/zero-copy-stream-wrapper.h"
 
+#include <atomic>
 #include <list>
 #include <vector>
 #include <fstream>
 #include <iostream>
 #include <sstream>
 #include <memory>
+#include <unordered_map>
 
 namespace orc {
 
@@ -42,6 +45,11 @@ namespace orc {
   public:
     PositionProvider(const std::list<uint64_t>& positions);
     uint64_t next();
+
+    /**
+     * Get the value that next will return without moving past it.
+     */
+    uint64_t current() const;
   };
 
   /**
@@ -54,6 +62,17 @@ namespace orc {
     virtual ~SeekableInputStream();
     virtual void seek(PositionProvider& position) = 0;
     virtual std::string getName() const = 0;
+
+    /**
+     * Get the next length bytes as a single contiguous buffer, so that a
+     * compressed chunk never has to be copied together from pieces. This
+     * may be called after Next and a BackUp of the unused bytes.
+     * The default implementation returns false without consuming anything.
+     * @param data set to the start of the bytes
+     * @param length the number of bytes needed
+     * @return true if the bytes were returned
+     */
+    virtual bool nextContiguous(const void** data, uint64_t length);
   };
 
   /**
@@ -87,6 +106,7 @@ namespace orc {
     virtual google::protobuf::int64 ByteCount() const override;
     virtual void seek(PositionProvider& position) override;
     virtual std::string getName() const override;
+    virtual bool nextContiguous(const void** data, uint64_t length) override;
   };
 
   /**
@@ -115,20 +135,149 @@ namespace orc {
     virtual int64_t ByteCount() const override;
     virtual void seek(PositionProvider& position) override;
     virtual std::string getName() const override;
+    virtual bool nextContiguous(const void** data, uint64_t length) override;
+  };
+
+  /**
+   * Counts of where the bytes returned by decompression streams came from.
+   * One set of counters may be shared by all of the streams of a reader.
+   */
+  struct DecompressionCounters {
+    // bytes that were produced by decompressing chunks
+    std::atomic<uint64_t> decompressedBytes;
+    // compressed bytes that were copied to make a chunk contiguous
+    std::atomic<uint64_t> copiedBytes;
+    // bytes of original chunks that were returned without a copy
+    std::atomic<uint64_t> passedThroughBytes;
+
+    DecompressionCounters();
+  };
+
+  /**
+   * Decompresses whole chunks that are in memory. An object may keep state
+   * between chunks, so each thread needs its own.
+   */
+  class ChunkDecompressor {
+  public:
+    virtual ~ChunkDecompressor();
+
+    /**
+     * Decompress a chunk.
+     * @param input the compressed chunk without its header
+     * @param length the length of the compressed chunk
+     * @param output where to put the uncompressed bytes
+     * @param maxOutputLength the size of the output buffer
+     * @return the number of uncompressed bytes
+     */
+    virtual uint64_t decompress(const char* input,
+                                uint64_t length,
+                                char* output,
+                                uint64_t maxOutputLength) = 0;
+
+    /**
+     * Find the uncompressed length of a chunk without decompressing it.
+     * The default implementation can't.
+     * @param input the start of the compressed chunk
+     * @param available the number of bytes of the chunk at input
+     * @param length the length of the whole compressed chunk
+     * @param result set to the uncompressed length
+     * @return true if the length was found
+     */
+    virtual bool getUncompressedLength(const char* input,
+                                       uint64_t available,
+                                       uint64_t length,
+                                       uint64_t* result) const;
+
+    /**
+     * Get the name of the codec for error messages.
+     */
+    virtual std::string getName() const = 0;
   };
 
+  /**
+   * The chunks of a compressed stream that have been read so far. The
+   * index is built as the stream reads each chunk's header and learns its
+   * uncompressed length, so that later seeks and skips can move over the
+   * chunk without decompressing it again.
+   */
+  class ChunkIndex {
+  public:
+    static const uint64_t UNKNOWN_LENGTH = ~static_cast<uint64_t>(0);
+
+    struct Chunk {
+      // the length of the chunk after its header
+      uint64_t compressedLength;
+      // the length of the chunk's bytes, or UNKNOWN_LENGTH
+      uint64_t uncompressedLength;
+    };
+
+    /**
+     * Record a chunk's header.
+     * @param headerOffset the offset of the header in the stream
+     * @param compressedLength the length after the header
+     * @param isOriginal whether the chunk isn't compressed, which means
+     *   its uncompressed length is known
+     */
+    void addChunk(uint64_t headerOffset,
+                  uint64_t compressedLength,
+                  bool isOriginal);
+
+    /**
+     * Record the uncompressed length of a chunk that was added.
+     */
+    void setUncompressedLength(uint64_t headerOffset, uint64_t length);
+
+    /**
+     * Find the chunk whose header is at the given offset.
+     * @return the chunk or nullptr if it hasn't been read
+     */
+    const Chunk* findChunk(uint64_t headerOffset) const;
+
+    /**
+     * Find how far the known chunks starting at headerOffset can be
+     * skipped without decompressing any of them.
+     * @param headerOffset the offset of the first chunk's header
+     * @param count the most uncompressed bytes to skip
+     * @param compressedBytes set to the bytes of the stream to skip,
+     *   including the headers
+     * @return the number of uncompressed bytes skipped
+     */
+    uint64_t skipChunks(uint64_t headerOffset,
+                        uint64_t count,
+                        uint64_t* compressedBytes) const;
+
+    /**
+     * Get the number of chunks in the index.
+     */
+    uint64_t size() const;
+
+  private:
+    std::unordered_map<uint64_t, Chunk> chunks;
+  };
+
+  /**
+   * Create a chunk decompressor for the given compression kind.
+   * @param kind the compression type, which must not be NONE
+   */
+  std::unique_ptr<ChunkDecompressor>
+     createChunkDecompressor(CompressionKind kind);
+
   /**
    * Create a decompressor for the given compression kind.
    * @param kind the compression type to implement
    * @param input the input stream that is the underlying source
    * @param bufferSize the maximum size of the buffer
    * @param pool the memory pool
+   * @param counters if not null, the counters to add this stream's bytes to
+   * @param cacheStream if not null, where the stream's chunks are cached
    */
   std::unique_ptr<SeekableInputStream>
      createDecompressor(CompressionKind kind,
                         std::unique_ptr<SeekableInputStream> input,
                         uint64_t bufferSize,
-                        MemoryPool& pool);
+                        MemoryPool& pool,
+                        DecompressionCounters* counters = nullptr,
+                        const ChunkCacheStream* cacheStream = nullptr);
 }
 
 #endif
@@ -0,0 +1,635 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "orc/OrcFile.hh"
+#include "Exceptions.hh"
+#include "HeapBuffer.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace orc {
+
+  static const char* const INDEX_NAME = "index";
+  static const char* const LOCK_NAME = "lock";
+  static const char* const INDEX_MAGIC = "orc-disk-cache";
+  static const std::string BLOCK_PREFIX = "block-";
+
+  // the index is rewritten once it has this many more records than blocks
+  static const uint64_t MAX_STALE_RECORDS = 1024;
+
+  DiskCache::~DiskCache() {
+    // PASS
+  }
+
+  /**
+   * A block is identified by the key of its file and its number in the
+   * file.
+   */
+  typedef std::pair<std::string, uint64_t> BlockId;
+
+  /**
+   * The blocks are kept in files named block-<number> and the index is a
+   * journal of the blocks that were added and removed. When the cache is
+   * opened, the journal is replayed, the blocks are checked against their
+   * files, and the journal is rewritten. The index is also rewritten when
+   * the cache is closed so that it records the order in which the blocks
+   * were used. The cache holds an exclusive flock on the lock file for as
+   * long as it is open, so a directory belongs to one process at a time.
+   */
+  class DiskCacheImpl: public DiskCache {
+  private:
+    struct Block {
+      BlockId id;
+      uint64_t length;
+      uint64_t fileNumber;
+    };
+
+    const std::string directory;
+    const uint64_t capacity;
+    const uint64_t blockSize;
+    int lockFile;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+
+    mutable std::mutex mutex;
+    // the most recently used block is at the front
+    std::list<Block> blocks;
+    std::map<BlockId, std::list<Block>::iterator> index;
+    uint64_t cachedBytes;
+    uint64_t nextFileNumber;
+    FILE* journal;
+    uint64_t journalRecords;
+
+    std::string getPath(const std::string& name) const;
+    std::string getBlockPath(uint64_t fileNumber) const;
+    void loadIndex();
+    void writeIndex();
+    void appendRecord(const std::string& record);
+    void evict();
+
+    static std::string formatAdd(const Block& block);
+
+  public:
+    DiskCacheImpl(const std::string& directory,
+                  uint64_t capacity,
+                  uint64_t blockSize);
+    ~DiskCacheImpl();
+
+    const std::string& getDirectory() const override;
+    uint64_t getCapacity() const override;
+    uint64_t getBlockSize() const override;
+    uint64_t getCachedBytes() const override;
+    uint64_t getNumberOfBlocks() const override;
+    uint64_t getHits() const override;
+    uint64_t getMisses() const override;
+
+    /**
+     * Copy part of a block out of the cache.
+     * @param id the block to read
+     * @param offset the offset within the block
+     * @param length the number of bytes to copy
+     * @param dest where to copy the bytes
+     * @return true if the block was cached
+     */
+    bool readBlock(const BlockId& id,
+                   uint64_t offset,
+                   uint64_t length,
+                   char* dest);
+
+    /**
+     * Save a block in the cache. Since the cache is only a copy, failures
+     * to write the block are ignored.
+     * @param id the block to save
+     * @param data the contents of the block
+     * @param length the length of the block
+     */
+    void writeBlock(const BlockId& id, const char* data, uint64_t length);
+  };
+
+  DiskCacheImpl::DiskCacheImpl(const std::string& _directory,
+                               uint64_t _capacity,
+                               uint64_t _blockSize
+                               ): directory(_directory),
+                                  capacity(_capacity),
+                                  blockSize(_blockSize),
+                                  lockFile(-1),
+                                  hits(0),
+                                  misses(0),
+                                  cachedBytes(0),
+                                  nextFileNumber(0),
+                                  journal(nullptr),
+                                  journalRecords(0) {
+    if (blockSize == 0) {
+      throw std::logic_error("Disk cache block size must be positive");
+    }
+    if (mkdir(directory.c_str(), 0755) == -1 && errno != EEXIST) {
+      throw ParseError("Can't create " + directory + ": " +
+                       strerror(errno));
+    }
+    std::string lockPath = getPath(LOCK_NAME);
+    lockFile = open(lockPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if (lockFile == -1) {
+      throw ParseError("Can't create " + lockPath + ": " + strerror(errno));
+    }
+    if (flock(lockFile, LOCK_EX | LOCK_NB) == -1) {
+      int error = errno;
+      close(lockFile);
+      if (error == EWOULDBLOCK) {
+        throw ParseError("Disk cache " + directory +
+                         " is in use by another process");
+      }
+      throw ParseError("Can't lock " + lockPath + ": " + strerror(error));
+    }
+    try {
+      loadIndex();
+      writeIndex();
+      evict();
+    } catch (...) {
+      if (journal != nullptr) {
+        fclose(journal);
+      }
+      close(lockFile);
+      throw;
+    }
+  }
+
+  DiskCacheImpl::~DiskCacheImpl() {
+    try {
+      writeIndex();
+    } catch (...) {
+      // there is no way to report a failure from the destructor
+    }
+    if (journal != nullptr) {
+      fclose(journal);
+    }
+    // closing the file releases the lock
+    close(lockFile);
+  }
+
+  std::string DiskCacheImpl::getPath(const std::string& name) const {
+    return directory + "/" + name;
+  }
+
+  std::string DiskCacheImpl::getBlockPath(uint64_t fileNumber) const {
+    std::ostringstream name;
+    name << BLOCK_PREFIX << fileNumber;
+    return getPath(name.str());
+  }
+
+  std::string DiskCacheImpl::formatAdd(const Block& block) {
+    std::ostringstream record;
+    record << "add " << block.fileNumber << " " << block.id.second << " "
+           << block.length << " " << block.id.first.size() << " "
+           << block.id.first << "\n";
+    return record.str();
+  }
+
+  void DiskCacheImpl::loadIndex() {
+    std::string contents;
+    FILE* file = fopen(getPath(INDEX_NAME).c_str(), "r");
+    if (file != nullptr) {
+      char buffer[64 * 1024];
+      size_t bytes;
+      while ((bytes = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        contents.append(buffer, bytes);
+      }
+      fclose(file);
+    }
+
+    // replay the journal, stopping at the first damaged record. The blocks
+    // of a cache with another block size don't line up with ours, so an
+    // index with a different size is dropped along with its blocks.
+    std::istringstream in(contents);
+    std::string magic;
+    uint64_t savedBlockSize = 0;
+    std::list<Block> live;
+    std::map<uint64_t, std::list<Block>::iterator> byNumber;
+    if (in >> magic >> savedBlockSize && magic == INDEX_MAGIC &&
+        savedBlockSize == blockSize) {
+      std::string op;
+      while (in >> op) {
+        Block block;
+        if (op == "add") {
+          uint64_t keyLength;
+          if (!(in >> block.fileNumber >> block.id.second >> block.length
+                >> keyLength) || in.get() != ' ') {
+            break;
+          }
+          block.id.first.resize(keyLength);
+          if (!in.read(&block.id.first[0],
+                       static_cast<std::streamsize>(keyLength))) {
+            break;
+          }
+          if (byNumber.find(block.fileNumber) == byNumber.end()) {
+            byNumber[block.fileNumber] = live.insert(live.end(), block);
+          }
+        } else if (op == "del") {
+          if (!(in >> block.fileNumber)) {
+            break;
+          }
+          std::map<uint64_t, std::list<Block>::iterator>::iterator itr =
+            byNumber.find(block.fileNumber);
+          if (itr != byNumber.end()) {
+            live.erase(itr->second);
+            byNumber.erase(itr);
+          }
+        } else {
+          break;
+        }
+      }
+    }
+
+    // keep the blocks whose files are intact, oldest first in the journal
+    std::set<std::string> kept;
+    for(std::list<Block>::const_iterator itr = live.begin();
+        itr != live.end(); ++itr) {
+      std::string path = getBlockPath(itr->fileNumber);
+      struct stat fileStat;
+      if (stat(path.c_str(), &fileStat) == 0 &&
+          static_cast<uint64_t>(fileStat.st_size) == itr->length &&
+          index.find(itr->id) == index.end()) {
+        blocks.push_front(*itr);
+        index[itr->id] = blocks.begin();
+        cachedBytes += itr->length;
+        kept.insert(path);
+      }
+      nextFileNumber = std::max(nextFileNumber, itr->fileNumber + 1);
+    }
+
+    // remove any block files that aren't in the index
+    DIR* dir = opendir(directory.c_str());
+    if (dir == nullptr) {
+      throw ParseError("Can't open " + directory + ": " + strerror(errno));
+    }
+    std::vector<std::string> orphans;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+      std::string name(entry->d_name);
+      if (name.compare(0, BLOCK_PREFIX.size(), BLOCK_PREFIX) == 0 &&
+          kept.find(getPath(name)) == kept.end()) {
+        orphans.push_back(getPath(name));
+      }
+    }
+    closedir(dir);
+    for(size_t i=0; i < orphans.size(); ++i) {
+      unlink(orphans[i].c_str());
+    }
+  }
+
+  void DiskCacheImpl::writeIndex() {
+    std::string tmpPath = getPath(std::string(INDEX_NAME) + ".tmp");
+    FILE* file = fopen(tmpPath.c_str(), "w");
+    if (file == nullptr) {
+      throw ParseError("Can't create " + tmpPath + ": " + strerror(errno));
+    }
+    std::ostringstream contents;
+    contents << INDEX_MAGIC << " " << blockSize << "\n";
+    for(std::list<Block>::const_reverse_iterator itr = blocks.rbegin();
+        itr != blocks.rend(); ++itr) {
+      contents << formatAdd(*itr);
+    }
+    std::string text = contents.str();
+    bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmpPath.c_str(), getPath(INDEX_NAME).c_str()) != 0) {
+      unlink(tmpPath.c_str());
+      throw ParseError("Can't write the index of " + directory);
+    }
+    if (journal != nullptr) {
+      fclose(journal);
+    }
+    journal = fopen(getPath(INDEX_NAME).c_str(), "a");
+    if (journal == nullptr) {
+      throw ParseError("Can't open the index of " + directory + ": " +
+                       strerror(errno));
+    }
+    journalRecords = blocks.size();
+  }
+
+  void DiskCacheImpl::appendRecord(const std::string& record) {
+    fputs(record.c_str(), journal);
+    fflush(journal);
+    journalRecords += 1;
+    if (journalRecords > 2 * blocks.size() + MAX_STALE_RECORDS) {
+      writeIndex();
+    }
+  }
+
+  void DiskCacheImpl::evict() {
+    while (cachedBytes > capacity) {
+      Block victim = blocks.back();
+      blocks.pop_back();
+      index.erase(victim.id);
+      cachedBytes -= victim.length;
+      unlink(getBlockPath(victim.fileNumber).c_str());
+      std::ostringstream record;
+      record << "del " << victim.fileNumber << "\n";
+      appendRecord(record.str());
+    }
+  }
+
+  const std::string& DiskCacheImpl::getDirectory() const {
+    return directory;
+  }
+
+  uint64_t DiskCacheImpl::getCapacity() const {
+    return capacity;
+  }
+
+  uint64_t DiskCacheImpl::getBlockSize() const {
+    return blockSize;
+  }
+
+  uint64_t DiskCacheImpl::getCachedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cachedBytes;
+  }
+
+  uint64_t DiskCacheImpl::getNumberOfBlocks() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return blocks.size();
+  }
+
+  uint64_t DiskCacheImpl::getHits() const {
+    return hits;
+  }
+
+  uint64_t DiskCacheImpl::getMisses() const {
+    return misses;
+  }
+
+  bool DiskCacheImpl::readBlock(const BlockId& id,
+                                uint64_t offset,
+                                uint64_t length,
+                                char* dest) {
+    int file = -1;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::map<BlockId, std::list<Block>::iterator>::iterator itr =
+        index.find(id);
+      if (itr != index.end() && offset + length <= itr->second->length) {
+        blocks.splice(blocks.begin(), blocks, itr->second);
+        // an open file can still be read after the block is evicted
+        file = open(getBlockPath(itr->second->fileNumber).c_str(),
+                    O_RDONLY);
+      }
+    }
+    if (file == -1) {
+      misses += 1;
+      return false;
+    }
+    ssize_t bytesRead = pread(file, dest, length,
+                              static_cast<off_t>(offset));
+    close(file);
+    if (bytesRead != static_cast<ssize_t>(length)) {
+      misses += 1;
+      return false;
+    }
+    hits += 1;
+    return true;
+  }
+
+  void DiskCacheImpl::writeBlock(const BlockId& id,
+                                 const char* data,
+                                 uint64_t length) {
+    Block block;
+    block.id = id;
+    block.length = length;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (length > capacity || index.find(id) != index.end()) {
+        return;
+      }
+      block.fileNumber = nextFileNumber++;
+    }
+
+    // write the block outside of the lock and then move it into place
+    std::string path = getBlockPath(block.fileNumber);
+    std::string tmpPath = path + ".tmp";
+    int file = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file == -1) {
+      return;
+    }
+    uint64_t written = 0;
+    while (written < length) {
+      ssize_t bytes = write(file, data + written, length - written);
+      if (bytes <= 0) {
+        break;
+      }
+      written += static_cast<uint64_t>(bytes);
+    }
+    bool ok = close(file) == 0 && written == length &&
+      rename(tmpPath.c_str(), path.c_str()) == 0;
+    if (!ok) {
+      unlink(tmpPath.c_str());
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (index.find(id) != index.end()) {
+      // another reader saved the block first
+      unlink(path.c_str());
+      return;
+    }
+    blocks.push_front(block);
+    index[id] = blocks.begin();
+    cachedBytes += length;
+    appendRecord(formatAdd(block));
+    evict();
+  }
+
+  std::shared_ptr<DiskCache> openDiskCache(const std::string& directory,
+                                           uint64_t capacity,
+                                           uint64_t blockSize) {
+    static std::mutex openMutex;
+    static std::map<std::string, std::weak_ptr<DiskCache> > openCaches;
+    std::lock_guard<std::mutex> lock(openMutex);
+    std::shared_ptr<DiskCache> result = openCaches[directory].lock();
+    if (result && result->getBlockSize() != blockSize) {
+      std::ostringstream message;
+      message << "Disk cache " << directory << " is already open with block"
+              << " size " << result->getBlockSize();
+      throw std::logic_error(message.str());
+    }
+    if (!result) {
+      result.reset(new DiskCacheImpl(directory, capacity, blockSize));
+      openCaches[directory] = result;
+    }
+    return result;
+  }
+
+  /**
+   * An InputStream that reads the blocks of another stream through a
+   * DiskCache.
+   */
+  class DiskCachedInputStream: public InputStream {
+  private:
+    std::unique_ptr<InputStream> input;
+    std::shared_ptr<DiskCacheImpl> cache;
+    std::string key;
+    uint64_t totalLength;
+    uint64_t blockSize;
+
+    void fetchBlocks(uint64_t firstBlock,
+                     uint64_t lastBlock,
+                     uint64_t offset,
+                     uint64_t end,
+                     char* dest);
+
+  public:
+    DiskCachedInputStream(std::unique_ptr<InputStream> input,
+                          std::shared_ptr<DiskCacheImpl> cache);
+    ~DiskCachedInputStream();
+
+    uint64_t getLength() const override {
+      return totalLength;
+    }
+
+    uint64_t getModificationTime() const override {
+      return input->getModificationTime();
+    }
+
+    const std::string& getName() const override {
+      return input->getName();
+    }
+
+    Buffer* read(uint64_t offset,
+                 uint64_t length,
+                 Buffer* buffer) override;
+  };
+
+  DiskCachedInputStream::DiskCachedInputStream
+      (std::unique_ptr<InputStream> _input,
+       std::shared_ptr<DiskCacheImpl> _cache
+       ): input(std::move(_input)),
+          cache(_cache),
+          totalLength(input->getLength()),
+          blockSize(cache->getBlockSize()) {
+    std::ostringstream buffer;
+    buffer << totalLength << ":" << input->getModificationTime() << ":"
+           << input->getName();
+    key = buffer.str();
+  }
+
+  DiskCachedInputStream::~DiskCachedInputStream() {
+    // PASS
+  }
+
+  Buffer* DiskCachedInputStream::read(uint64_t offset,
+                                      uint64_t length,
+                                      Buffer* buffer) {
+    if (offset + length > totalLength) {
+      delete buffer;
+      throw ParseError("Read past end of " + getName());
+    }
+    if (buffer == nullptr) {
+      buffer = new HeapBuffer(length);
+    } else if (buffer->getLength() < length) {
+      delete buffer;
+      buffer = new HeapBuffer(length);
+    }
+    if (length == 0) {
+      return buffer;
+    }
+    char* dest = buffer->getStart();
+    uint64_t end = offset + length;
+    uint64_t lastBlock = (end - 1) / blockSize;
+    // the blocks that miss are fetched with one read per run
+    uint64_t missingStart = 0;
+    bool missing = false;
+    try {
+      for(uint64_t block = offset / blockSize; block <= lastBlock; ++block) {
+        uint64_t blockStart = block * blockSize;
+        uint64_t from = std::max(offset, blockStart);
+        uint64_t to = std::min(end, blockStart + blockSize);
+        if (cache->readBlock(BlockId(key, block), from - blockStart,
+                             to - from, dest + (from - offset))) {
+          if (missing) {
+            fetchBlocks(missingStart, block, offset, end, dest);
+            missing = false;
+          }
+        } else if (!missing) {
+          missing = true;
+          missingStart = block;
+        }
+      }
+      if (missing) {
+        fetchBlocks(missingStart, lastBlock + 1, offset, end, dest);
+      }
+    } catch (...) {
+      delete buffer;
+      throw;
+    }
+    return buffer;
+  }
+
+  void DiskCachedInputStream::fetchBlocks(uint64_t firstBlock,
+                                          uint64_t lastBlock,
+                                          uint64_t offset,
+                                          uint64_t end,
+                                          char* dest) {
+    uint64_t fetchStart = firstBlock * blockSize;
+    uint64_t fetchEnd = std::min(lastBlock * blockSize, totalLength);
+    std::unique_ptr<Buffer> fetched(input->read(fetchStart,
+                                                fetchEnd - fetchStart,
+                                                nullptr));
+    uint64_t from = std::max(offset, fetchStart);
+    uint64_t to = std::min(end, fetchEnd);
+    memcpy(dest + (from - offset), fetched->getStart() + (from - fetchStart),
+           to - from);
+    for(uint64_t block = firstBlock; block < lastBlock; ++block) {
+      uint64_t blockStart = block * blockSize;
+      cache->writeBlock(BlockId(key, block),
+                        fetched->getStart() + (blockStart - fetchStart),
+                        std::min(blockSize, fetchEnd - blockStart));
+    }
+  }
+
+  std::unique_ptr<InputStream>
+      createDiskCachedStream(std::unique_ptr<InputStream> input,
+                             std::shared_ptr<DiskCache> cache) {
+    std::shared_ptr<DiskCacheImpl> impl =
+      std::dynamic_pointer_cast<DiskCacheImpl>(cache);
+    if (!impl) {
+      throw std::logic_error("Disk cache wasn't created by openDiskCache");
+    }
+    // without a modification time a rewritten file of the same length
+    // would get the old blocks, so it isn't cached
+    if (input->getModificationTime() == 0) {
+      return input;
+    }
+    return std::unique_ptr<InputStream>
+      (new DiskCachedInputStream(std::move(input), impl));
+  }
+}
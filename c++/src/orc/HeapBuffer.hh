@@ -0,0 +1,53 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_HEAP_BUFFER_HH
+#define ORC_HEAP_BUFFER_HH
+
+#include "orc/Adaptor.hh"
+#include "orc/OrcFile.hh"
+
+namespace orc {
+
+  /**
+   * A Buffer that owns an array allocated on the heap.
+   */
+  class HeapBuffer: public Buffer {
+  private:
+    char* start;
+    uint64_t length;
+
+  public:
+    HeapBuffer(uint64_t size) {
+      start = new char[size];
+      length = size;
+    }
+
+    virtual ~HeapBuffer();
+
+    virtual char *getStart() const override {
+      return start;
+    }
+
+    virtual uint64_t getLength() const override {
+      return length;
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "InputCursor.hh"
+#include "Exceptions.hh"
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+namespace orc {
+
+  const size_t InputCursor::MAX_WINDOW;
+
+  InputCursor::InputCursor(SeekableInputStream* _stream,
+                           const std::string& _errorMessage
+                           ): stream(_stream),
+                              errorMessage(_errorMessage),
+                              start(nullptr),
+                              end(nullptr) {
+    // PASS
+  }
+
+  void InputCursor::nextBuffer() {
+    // streams may return empty buffers, which are passed over
+    while (start == end) {
+      const void* buffer;
+      int length;
+      if (!stream->Next(&buffer, &length)) {
+        throw ParseError(errorMessage);
+      }
+      start = static_cast<const char*>(buffer);
+      end = start + length;
+    }
+  }
+
+  const char* InputCursor::gather(size_t length) {
+    if (length > MAX_WINDOW) {
+      throw std::logic_error("InputCursor window is too large");
+    }
+    readBytes(scratch, length);
+    return scratch;
+  }
+
+  uint64_t InputCursor::readVarintSlow() {
+    uint64_t result = 0;
+    uint32_t offset = 0;
+    unsigned char ch;
+    do {
+      ch = readByte();
+      // the bits past 64 of a varint that is too long are dropped
+      if (offset < 64) {
+        result |= static_cast<uint64_t>(ch & 0x7f) << offset;
+      }
+      offset += 7;
+    } while (ch >= 0x80);
+    return result;
+  }
+
+  void InputCursor::readVarints(int64_t* output, uint64_t count) {
+    uint64_t decoded = 0;
+    while (decoded < count) {
+      uint64_t used;
+      decoded += decodeVarints(start, available(), output + decoded,
+                               count - decoded, used);
+      start += used;
+      // the varints near the end of the buffer may continue in the next
+      if (decoded < count) {
+        output[decoded++] = static_cast<int64_t>(readVarint());
+      }
+    }
+  }
+
+  void InputCursor::readBytes(char* output, uint64_t length) {
+    while (length > 0) {
+      fill();
+      size_t count = static_cast<size_t>(std::min<uint64_t>(length,
+                                                            available()));
+      memcpy(output, start, count);
+      start += count;
+      output += count;
+      length -= count;
+    }
+  }
+
+  void InputCursor::skip(uint64_t length) {
+    if (length <= available()) {
+      start += length;
+      return;
+    }
+    length -= available();
+    reset();
+    while (length > 0) {
+      int count = static_cast<int>
+        (std::min<uint64_t>(length,
+                            static_cast<uint64_t>
+                            (std::numeric_limits<int>::max())));
+      if (!stream->Skip(count)) {
+        throw ParseError(errorMessage);
+      }
+      length -= static_cast<uint64_t>(count);
+    }
+  }
+}
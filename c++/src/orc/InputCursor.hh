@@ -0,0 +1,198 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_INPUT_CURSOR_HH
+#define ORC_INPUT_CURSOR_HH
+
+#include "orc/Adaptor.hh"
+#include "Compression.hh"
+#include "Varint.hh"
+
+#include <string>
+
+namespace orc {
+
+  /**
+   * Reads the bytes of a SeekableInputStream a buffer at a time for the
+   * decoders. Instead of checking for the end of the buffer before every
+   * byte, a decoder asks for the whole value or run it is about to read.
+   * Values that are split between two buffers are gathered into a small
+   * scratch buffer, so the decoder always gets contiguous bytes.
+   */
+  class InputCursor {
+  public:
+    /**
+     * The most bytes that read() can gather from several buffers.
+     */
+    static const size_t MAX_WINDOW = 16;
+
+    /**
+     * @param stream the stream to read, which the caller keeps
+     * @param errorMessage the message of the ParseError that is thrown
+     *   when the stream ends early
+     */
+    InputCursor(SeekableInputStream* stream, const std::string& errorMessage);
+
+    /**
+     * Forget the current buffer after the stream has been moved.
+     */
+    void reset() {
+      start = nullptr;
+      end = nullptr;
+    }
+
+    /**
+     * Get the number of bytes left in the current buffer.
+     */
+    size_t available() const {
+      return static_cast<size_t>(end - start);
+    }
+
+    /**
+     * Get the next byte of the current buffer.
+     */
+    const char* data() const {
+      return start;
+    }
+
+    /**
+     * Move past bytes of the current buffer.
+     * @param length at most available() bytes
+     */
+    void advance(size_t length) {
+      start += length;
+    }
+
+    /**
+     * Make sure that the current buffer has at least one byte.
+     */
+    void fill() {
+      if (start == end) {
+        nextBuffer();
+      }
+    }
+
+    unsigned char readByte() {
+      if (start == end) {
+        nextBuffer();
+      }
+      return static_cast<unsigned char>(*(start++));
+    }
+
+    /**
+     * Read the next bytes as one contiguous window.
+     * @param length the number of bytes, at most MAX_WINDOW
+     * @return the bytes, which are valid until the next call
+     */
+    const char* read(size_t length) {
+      if (available() >= length) {
+        const char* result = start;
+        start += length;
+        return result;
+      }
+      return gather(length);
+    }
+
+    /**
+     * Read an unsigned base 128 varint, least significant group first.
+     * The unchecked path only needs 8 readable bytes, not the 10 of the
+     * longest varint, because it decodes a single 8 byte load. Varints of
+     * 9 or 10 bytes, and any varint when fewer than 8 bytes are left in
+     * the buffer, take the byte at a time path.
+     */
+    uint64_t readVarint() {
+      if (available() >= 8) {
+        uint64_t result;
+        uint32_t length = decodeShortVarint(start, result);
+        if (length > 0) {
+          start += length;
+          return result;
+        }
+      }
+      return readVarintSlow();
+    }
+
+    /**
+     * Read a run of unsigned varints. The ones that are whole in the
+     * current buffer are decoded together.
+     */
+    void readVarints(int64_t* output, uint64_t count);
+
+    /**
+     * Read the next length bytes, at most 8, as a big endian number.
+     */
+    uint64_t readBigEndian(uint32_t length) {
+      const unsigned char* bytes =
+        reinterpret_cast<const unsigned char*>(read(length));
+      uint64_t result = 0;
+      for(uint32_t i=0; i < length; ++i) {
+        result = (result << 8) | bytes[i];
+      }
+      return result;
+    }
+
+    /**
+     * Read the next length bytes, at most 8, as a little endian number.
+     */
+    uint64_t readLittleEndian(uint32_t length) {
+      return decodeLittleEndian(read(length), length);
+    }
+
+    /**
+     * Decode bytes that are already known to be in the buffer as a little
+     * endian number.
+     */
+    static uint64_t decodeLittleEndian(const char* input, uint32_t length) {
+      const unsigned char* bytes =
+        reinterpret_cast<const unsigned char*>(input);
+      uint64_t result = 0;
+      for(uint32_t i=0; i < length; ++i) {
+        result |= static_cast<uint64_t>(bytes[i]) << (i * 8);
+      }
+      return result;
+    }
+
+    /**
+     * Copy the next bytes, which may be in any number of buffers.
+     */
+    void readBytes(char* output, uint64_t length);
+
+    /**
+     * Move past the next bytes. The ones after the current buffer are
+     * skipped in the stream without being read.
+     */
+    void skip(uint64_t length);
+
+  private:
+    SeekableInputStream* stream;
+    const std::string errorMessage;
+    const char* start;
+    const char* end;
+    char scratch[MAX_WINDOW];
+
+    // DELIBERATELY NOT IMPLEMENTED
+    InputCursor(const InputCursor&);
+    InputCursor& operator=(const InputCursor&);
+
+    void nextBuffer();
+    const char* gather(size_t length);
+    uint64_t readVarintSlow();
+  };
+}
+
+#endif
@@ -0,0 +1,338 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "IoUring.hh"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+#ifdef HAS_IO_URING
+  #include <chrono>
+  #include <condition_variable>
+  #include <errno.h>
+  #include <linux/io_uring.h>
+  #include <mutex>
+  #include <string.h>
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  #include <thread>
+  #include <unistd.h>
+#endif
+
+namespace orc {
+
+  IoRing::~IoRing() {
+    // PASS
+  }
+
+#ifdef HAS_IO_URING
+
+  // the number of submission queue entries in the shared ring
+  static const unsigned RING_ENTRIES = 256;
+
+  class IoRingImpl: public IoRing {
+  private:
+    int ringFd;
+    unsigned sqEntries;
+    unsigned cqEntries;
+
+    void* sqRing;
+    size_t sqRingSize;
+    void* cqRing;
+    size_t cqRingSize;
+    struct io_uring_sqe* sqes;
+    size_t sqesSize;
+
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned* sqMask;
+    unsigned* sqArray;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned* cqMask;
+    struct io_uring_cqe* cqes;
+
+    std::mutex mutex;
+    std::condition_variable completed;
+    // is a thread blocked in the kernel waiting for completions?
+    bool isWaiting;
+    // reads submitted, but not yet reaped
+    unsigned inFlight;
+    // entries in the submission queue that the kernel hasn't taken
+    unsigned unsubmitted;
+    // set when io_uring_enter fails for a reason other than a full queue,
+    // after which the ring is never entered again
+    bool isBroken;
+
+    void* mapRing(size_t size, off_t offset);
+    bool prepare(RingRead& read);
+    void submit();
+    void reap();
+    void waitForCompletion(std::unique_lock<std::mutex>& lock);
+    bool isTakenAndPending(const RingRead& read) const;
+
+  public:
+    IoRingImpl(unsigned entries);
+    ~IoRingImpl();
+
+    void readAll(std::vector<RingRead>& reads) override;
+  };
+
+  IoRingImpl::IoRingImpl(unsigned entries
+                         ): isWaiting(false),
+                            inFlight(0),
+                            unsubmitted(0),
+                            isBroken(false) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries,
+                                      &params));
+    if (ringFd < 0) {
+      throw std::runtime_error(std::string("io_uring_setup failed - ") +
+                               strerror(errno));
+    }
+    sqEntries = params.sq_entries;
+    cqEntries = params.cq_entries;
+    sqRingSize = params.sq_off.array + sqEntries * sizeof(unsigned);
+    cqRingSize = params.cq_off.cqes +
+      cqEntries * sizeof(struct io_uring_cqe);
+    sqesSize = sqEntries * sizeof(struct io_uring_sqe);
+    sqRing = nullptr;
+    cqRing = nullptr;
+    sqes = nullptr;
+    try {
+      if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sqRingSize = std::max(sqRingSize, cqRingSize);
+        sqRing = mapRing(sqRingSize, IORING_OFF_SQ_RING);
+        cqRing = sqRing;
+        cqRingSize = 0;
+      } else {
+        sqRing = mapRing(sqRingSize, IORING_OFF_SQ_RING);
+        cqRing = mapRing(cqRingSize, IORING_OFF_CQ_RING);
+      }
+      sqes = static_cast<struct io_uring_sqe*>
+        (mapRing(sqesSize, IORING_OFF_SQES));
+    } catch (...) {
+      if (cqRing != nullptr && cqRing != sqRing) {
+        munmap(cqRing, cqRingSize);
+      }
+      if (sqRing != nullptr) {
+        munmap(sqRing, sqRingSize);
+      }
+      close(ringFd);
+      throw;
+    }
+    char* sq = static_cast<char*>(sqRing);
+    sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(cqRing);
+    cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+  }
+
+  IoRingImpl::~IoRingImpl() {
+    munmap(sqes, sqesSize);
+    if (cqRing != sqRing) {
+      munmap(cqRing, cqRingSize);
+    }
+    munmap(sqRing, sqRingSize);
+    close(ringFd);
+  }
+
+  void* IoRingImpl::mapRing(size_t size, off_t offset) {
+    void* result = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ringFd, offset);
+    if (result == MAP_FAILED) {
+      throw std::runtime_error(std::string("io_uring mmap failed - ") +
+                               strerror(errno));
+    }
+    return result;
+  }
+
+  /**
+   * Put the read in the submission queue.
+   * @return false if there isn't room for it
+   */
+  bool IoRingImpl::prepare(RingRead& read) {
+    unsigned tail = *sqTail;
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    if (tail - head >= sqEntries || inFlight >= cqEntries) {
+      return false;
+    }
+    unsigned index = tail & *sqMask;
+    struct io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = read.file;
+    sqe->addr = reinterpret_cast<uint64_t>(read.buffer);
+    sqe->len = static_cast<uint32_t>(read.length);
+    sqe->off = read.offset;
+    sqe->user_data = reinterpret_cast<uint64_t>(&read);
+    sqArray[index] = index;
+    read.position = tail;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    inFlight += 1;
+    unsubmitted += 1;
+    return true;
+  }
+
+  void IoRingImpl::submit() {
+    while (unsubmitted > 0) {
+      long result = syscall(__NR_io_uring_enter, ringFd, unsubmitted, 0, 0,
+                            nullptr, 0);
+      if (result < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        if (errno == EAGAIN || errno == EBUSY) {
+          // the kernel needs us to collect completions first
+          return;
+        }
+        isBroken = true;
+        throw std::runtime_error(std::string("io_uring_enter failed - ") +
+                                 strerror(errno));
+      }
+      unsubmitted -= static_cast<unsigned>(result);
+    }
+  }
+
+  void IoRingImpl::reap() {
+    unsigned head = *cqHead;
+    unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+      struct io_uring_cqe* cqe = &cqes[head & *cqMask];
+      RingRead* read = reinterpret_cast<RingRead*>(cqe->user_data);
+      read->result = cqe->res;
+      read->done = true;
+      inFlight -= 1;
+      head += 1;
+    }
+    __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+  }
+
+  void IoRingImpl::waitForCompletion(std::unique_lock<std::mutex>& lock) {
+    if (isWaiting) {
+      completed.wait(lock);
+      return;
+    }
+    // submit anything the kernel refused earlier while we wait
+    unsigned toSubmit = unsubmitted;
+    unsubmitted = 0;
+    isWaiting = true;
+    lock.unlock();
+    long result = syscall(__NR_io_uring_enter, ringFd, toSubmit, 1,
+                          IORING_ENTER_GETEVENTS, nullptr, 0);
+    int error = errno;
+    lock.lock();
+    isWaiting = false;
+    if (result >= 0) {
+      unsubmitted += toSubmit - static_cast<unsigned>(result);
+    } else {
+      unsubmitted += toSubmit;
+    }
+    reap();
+    completed.notify_all();
+    if (result < 0 && error != EINTR && error != EAGAIN && error != EBUSY) {
+      isBroken = true;
+      throw std::runtime_error(std::string("io_uring_enter failed - ") +
+                               strerror(error));
+    }
+  }
+
+  /**
+   * Has the kernel taken the read from the submission queue without
+   * finishing it yet?
+   */
+  bool IoRingImpl::isTakenAndPending(const RingRead& read) const {
+    unsigned taken = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    return !read.done && static_cast<int>(taken - read.position) > 0;
+  }
+
+  void IoRingImpl::readAll(std::vector<RingRead>& reads) {
+    std::unique_lock<std::mutex> lock(mutex);
+    size_t next = 0;
+    // all of the reads before this one are done
+    size_t firstPending = 0;
+    try {
+      while (true) {
+        if (isBroken) {
+          throw std::runtime_error("io_uring failed earlier");
+        }
+        while (next < reads.size() && prepare(reads[next])) {
+          next += 1;
+        }
+        submit();
+        reap();
+        while (firstPending < next && reads[firstPending].done) {
+          firstPending += 1;
+        }
+        if (firstPending == reads.size()) {
+          return;
+        }
+        waitForCompletion(lock);
+      }
+    } catch (std::runtime_error&) {
+      // Every error leaves the ring broken, so the reads that the kernel
+      // hasn't taken are never started. The ones it has taken may still
+      // write into their buffers and a reaper dereferences them, so wait
+      // for those before the caller can free them. Entering the ring is
+      // what failed, so poll the completion queue instead.
+      while (true) {
+        reap();
+        bool isPending = false;
+        for(size_t i=firstPending; i < next && !isPending; ++i) {
+          isPending = isTakenAndPending(reads[i]);
+        }
+        if (!isPending) {
+          break;
+        }
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        lock.lock();
+      }
+      throw;
+    }
+  }
+
+  static IoRing* createIoRing() {
+    try {
+      return new IoRingImpl(RING_ENTRIES);
+    } catch (std::runtime_error&) {
+      return nullptr;
+    }
+  }
+
+  IoRing* getSharedIoRing() {
+    static std::unique_ptr<IoRing> ring(createIoRing());
+    return ring.get();
+  }
+
+#else
+
+  IoRing* getSharedIoRing() {
+    return nullptr;
+  }
+
+#endif
+}
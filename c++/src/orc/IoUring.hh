@@ -0,0 +1,83 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_IO_URING_HH
+#define ORC_IO_URING_HH
+
+#include "orc/Adaptor.hh"
+
+#include <vector>
+
+namespace orc {
+
+  /**
+   * A read that is submitted to an IoRing.
+   */
+  struct RingRead {
+    int file;
+    char* buffer;
+    uint64_t offset;
+    uint64_t length;
+
+    // set when the read completes: the bytes read or -errno
+    int64_t result;
+    bool done;
+    // the position of the read in the submission queue
+    unsigned position;
+
+    RingRead(int _file, char* _buffer, uint64_t _offset, uint64_t _length
+             ): file(_file),
+                buffer(_buffer),
+                offset(_offset),
+                length(_length),
+                result(0),
+                done(false),
+                position(0) {
+      // PASS
+    }
+  };
+
+  /**
+   * A Linux io_uring instance that is shared by all of the streams in the
+   * process, so that many reads can be in flight without a thread per
+   * reader. The threads that are waiting take turns collecting the
+   * completions for everyone.
+   */
+  class IoRing {
+  public:
+    virtual ~IoRing();
+
+    /**
+     * Submit the reads and wait until all of them have completed. The
+     * result of each read is left in the RingRead. A short or failed read
+     * is not an error at this level. If the ring fails, the reads that
+     * the kernel took are waited for before the error is thrown, so none
+     * of them are still in flight. A failed ring stays failed and every
+     * later call throws without starting any reads.
+     */
+    virtual void readAll(std::vector<RingRead>& reads) = 0;
+  };
+
+  /**
+   * Get the process-wide ring.
+   * @return the ring or nullptr if io_uring isn't available
+   */
+  IoRing* getSharedIoRing();
+}
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "Lz4.hh"
+#include "LzReader.hh"
+
+namespace orc {
+
+  /*
+   * An LZ4 block is a sequence of literal runs, each followed by a match.
+   * Each sequence starts with a token whose high four bits are the number
+   * of literals and whose low four bits are the match length minus 4. A
+   * field of 15 continues with bytes that are added to it until one is less
+   * than 255. The literals are followed by the little endian 16 bit
+   * distance of the match and any continuation of the match length. The
+   * last sequence has only literals and ends the block.
+   */
+
+  static const uint64_t MIN_MATCH = 4;
+
+  /**
+   * Read the continuation of a length whose field was 15.
+   */
+  static uint64_t readLength(LzReader& reader, uint64_t field) {
+    uint64_t result = field;
+    if (field == 15) {
+      uint64_t next;
+      do {
+        next = reader.readByte();
+        result += next;
+      } while (next == 255);
+    }
+    return result;
+  }
+
+  uint64_t lz4Decompress(const char* input,
+                         uint64_t inputLength,
+                         char* output,
+                         uint64_t outputLength) {
+    LzReader reader("LZ4", input, inputLength, output, outputLength);
+    while (true) {
+      uint64_t token = reader.readByte();
+      reader.copyLiterals(readLength(reader, token >> 4));
+      if (reader.isInputDone()) {
+        break;
+      }
+      uint64_t distance = reader.readShort();
+      uint64_t length = readLength(reader, token & 15) + MIN_MATCH;
+      reader.copyMatch(distance, length);
+    }
+    return reader.getOutputLength();
+  }
+
+  uint64_t lz4UncompressedLength(const char* input, uint64_t inputLength) {
+    LzReader reader("LZ4", input, inputLength, nullptr, 0);
+    uint64_t result = 0;
+    while (true) {
+      uint64_t token = reader.readByte();
+      uint64_t literals = readLength(reader, token >> 4);
+      reader.skipLiterals(literals);
+      result += literals;
+      if (reader.isInputDone()) {
+        break;
+      }
+      reader.readShort();
+      result += readLength(reader, token & 15) + MIN_MATCH;
+    }
+    return result;
+  }
+}
@@ -0,0 +1,54 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_LZ4_HH
+#define ORC_LZ4_HH
+
+#include "orc/Adaptor.hh"
+
+#include <stdint.h>
+
+namespace orc {
+
+  /**
+   * Decompress a raw LZ4 block, as written by the Java ORC writer, without
+   * the LZ4 frame format around it.
+   * @param input the compressed bytes
+   * @param inputLength the number of compressed bytes
+   * @param output where to put the uncompressed bytes
+   * @param outputLength the size of the output buffer
+   * @return the number of uncompressed bytes
+   * @throws ParseError if the input is corrupt or doesn't fit in the output
+   */
+  uint64_t lz4Decompress(const char* input,
+                         uint64_t inputLength,
+                         char* output,
+                         uint64_t outputLength);
+
+  /**
+   * Get the uncompressed length of a raw LZ4 block by walking its sequences
+   * without copying any bytes. The match distances aren't checked.
+   * @param input the compressed bytes
+   * @param inputLength the number of compressed bytes
+   * @return the number of bytes that lz4Decompress would produce
+   * @throws ParseError if the sequences run past the end of the input
+   */
+  uint64_t lz4UncompressedLength(const char* input, uint64_t inputLength);
+}
+
+#endif
@@ -0,0 +1,143 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_LZ_READER_HH
+#define ORC_LZ_READER_HH
+
+#include "orc/Adaptor.hh"
+#include "Exceptions.hh"
+
+#include <algorithm>
+#include <string.h>
+#include <string>
+
+namespace orc {
+
+  /**
+   * The bounds checked input and output cursors shared by the LZ77 block
+   * decoders (LZO and LZ4), which copy literals from the input and matches
+   * from earlier in the output.
+   */
+  class LzReader {
+  private:
+    const char* const codec;
+    const unsigned char* ip;
+    const unsigned char* const inputEnd;
+    char* op;
+    char* const outputStart;
+    char* const outputEnd;
+
+    void needInput(uint64_t bytes) const {
+      if (bytes > static_cast<uint64_t>(inputEnd - ip)) {
+        throw ParseError(std::string(codec) + " input is truncated");
+      }
+    }
+
+    void needOutput(uint64_t bytes) const {
+      if (bytes > static_cast<uint64_t>(outputEnd - op)) {
+        throw ParseError(std::string(codec) +
+                         " output exceeds the block size");
+      }
+    }
+
+  public:
+    /**
+     * @param _codec the codec's name for the error messages
+     */
+    LzReader(const char* _codec,
+             const char* input,
+             uint64_t inputLength,
+             char* output,
+             uint64_t outputLength
+             ): codec(_codec),
+                ip(reinterpret_cast<const unsigned char*>(input)),
+                inputEnd(ip + inputLength),
+                op(output),
+                outputStart(output),
+                outputEnd(output + outputLength) {
+      // PASS
+    }
+
+    uint64_t readByte() {
+      needInput(1);
+      return *(ip++);
+    }
+
+    /**
+     * Read a little endian 16 bit value.
+     */
+    uint64_t readShort() {
+      needInput(2);
+      uint64_t result = ip[0] | (static_cast<uint64_t>(ip[1]) << 8);
+      ip += 2;
+      return result;
+    }
+
+    void copyLiterals(uint64_t length) {
+      needInput(length);
+      needOutput(length);
+      memcpy(op, ip, length);
+      op += length;
+      ip += length;
+    }
+
+    void skipLiterals(uint64_t length) {
+      needInput(length);
+      ip += length;
+    }
+
+    /**
+     * Copy length bytes from distance bytes back in the output, which may
+     * overlap the bytes being written.
+     */
+    void copyMatch(uint64_t distance, uint64_t length) {
+      if (distance == 0 ||
+          distance > static_cast<uint64_t>(op - outputStart)) {
+        throw ParseError(std::string(codec) +
+                         " match distance is outside the block");
+      }
+      needOutput(length);
+      const char* match = op - distance;
+      if (distance >= length) {
+        memcpy(op, match, length);
+      } else if (distance >= 8) {
+        // each 8 byte piece is before the bytes it writes
+        for(uint64_t i=0; i < length; i += 8) {
+          memcpy(op + i, match + i, std::min<uint64_t>(8, length - i));
+        }
+      } else if (distance == 1) {
+        memset(op, *match, length);
+      } else {
+        for(uint64_t i=0; i < length; ++i) {
+          op[i] = match[i];
+        }
+      }
+      op += length;
+    }
+
+    bool isInputDone() const {
+      return ip == inputEnd;
+    }
+
+    uint64_t getOutputLength() const {
+      return static_cast<uint64_t>(op - outputStart);
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "Lzo.hh"
+#include "Exceptions.hh"
+#include "LzReader.hh"
+
+namespace orc {
+
+  /*
+   * LZO1X streams are a sequence of instructions. Each one copies a run of
+   * literals or a match from earlier in the output and the low two bits of
+   * a match say how many literals (0 to 3) follow it. The meaning of the
+   * opcodes below 16 depends on how many literals the previous instruction
+   * copied, which is tracked as the state:
+   *
+   *   0000LLLL state 0: 3 + L literals, L = 0 is a long run
+   *   0000DDSS state 1-3: 2 bytes at distance (H << 2) + D + 1
+   *   0000DDSS state 4: 3 bytes at distance (H << 2) + D + 2049
+   *   0001HLLL 2 + L bytes at distance 16384 + (H << 14) + (E >> 2)
+   *   001LLLLL 2 + L bytes at distance (E >> 2) + 1
+   *   01LDDDSS 3 + L bytes at distance (H << 3) + D + 1
+   *   1LLDDDSS 5 + L bytes at distance (H << 3) + D + 1
+   *
+   * where H is the next byte, E is the next little endian 16 bit value,
+   * whose low two bits are the following literal count, and long lengths
+   * continue with 255 for each zero byte plus the first non-zero byte. The
+   * first byte of a stream may also be 17 + n for a run of n literals and
+   * the stream ends with a 0001HLLL match at distance 16384.
+   */
+
+  static const uint64_t M2_MAX_DISTANCE = 2048;
+  static const uint64_t M3_MAX_DISTANCE = 16384;
+
+  /**
+   * Read the rest of a length whose field in the opcode was zero.
+   */
+  static uint64_t readLongLength(LzReader& reader, uint64_t base) {
+    uint64_t result = base;
+    uint64_t next;
+    while ((next = reader.readByte()) == 0) {
+      result += 255;
+    }
+    return result + next;
+  }
+
+  uint64_t lzoDecompress(const char* input,
+                         uint64_t inputLength,
+                         char* output,
+                         uint64_t outputLength) {
+    LzReader reader("LZO", input, inputLength, output, outputLength);
+    uint64_t state = 0;
+    if (inputLength > 0 &&
+        static_cast<unsigned char>(input[0]) > 17) {
+      uint64_t literals = reader.readByte() - 17;
+      reader.copyLiterals(literals);
+      state = literals < 4 ? literals : 4;
+    }
+    while (true) {
+      uint64_t opcode = reader.readByte();
+      uint64_t length;
+      uint64_t distance;
+      uint64_t trailing;
+      if (opcode < 16) {
+        if (state == 0) {
+          length = opcode == 0 ? readLongLength(reader, 15) : opcode;
+          reader.copyLiterals(length + 3);
+          state = 4;
+          continue;
+        }
+        distance = (reader.readByte() << 2) + ((opcode >> 2) & 3) + 1;
+        if (state == 4) {
+          distance += M2_MAX_DISTANCE;
+          length = 3;
+        } else {
+          length = 2;
+        }
+        trailing = opcode & 3;
+      } else if (opcode < 32) {
+        length = (opcode & 7) == 0 ? readLongLength(reader, 7) : opcode & 7;
+        uint64_t extra = reader.readShort();
+        distance = M3_MAX_DISTANCE + ((opcode & 8) << 11) + (extra >> 2);
+        if (distance == M3_MAX_DISTANCE) {
+          break;
+        }
+        length += 2;
+        trailing = extra & 3;
+      } else if (opcode < 64) {
+        length = (opcode & 31) == 0 ? readLongLength(reader, 31) : opcode & 31;
+        uint64_t extra = reader.readShort();
+        distance = (extra >> 2) + 1;
+        length += 2;
+        trailing = extra & 3;
+      } else {
+        if (opcode < 128) {
+          length = 3 + ((opcode >> 5) & 1);
+        } else {
+          length = 5 + ((opcode >> 5) & 3);
+        }
+        distance = (reader.readByte() << 3) + ((opcode >> 2) & 7) + 1;
+        trailing = opcode & 3;
+      }
+      reader.copyMatch(distance, length);
+      reader.copyLiterals(trailing);
+      state = trailing;
+    }
+    if (!reader.isInputDone()) {
+      throw ParseError("LZO input has bytes after the end of stream");
+    }
+    return reader.getOutputLength();
+  }
+}
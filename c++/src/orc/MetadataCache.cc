@@ -0,0 +1,166 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "MetadataCache.hh"
+#include "TypeImpl.hh"
+
+#include <sstream>
+
+namespace orc {
+
+  static const uint64_t DEFAULT_METADATA_CACHE_CAPACITY = 64 * 1024 * 1024;
+
+  FileTailContents::FileTailContents(): postscriptLength(0),
+                                        fileLength(0) {
+    // PASS
+  }
+
+  uint64_t FileTailContents::getTailLength() const {
+    return 1 + postscriptLength + postscript.footerlength() +
+      postscript.metadatalength();
+  }
+
+  uint64_t FileTailContents::getMemoryUsage() const {
+    return sizeof(FileTailContents) +
+      static_cast<uint64_t>(postscript.SpaceUsed()) +
+      static_cast<uint64_t>(footer.SpaceUsed()) +
+      static_cast<uint64_t>(metadata.SpaceUsed()) +
+      static_cast<uint64_t>(footer.types_size()) * sizeof(TypeImpl);
+  }
+
+  MetadataCache::~MetadataCache() {
+    // PASS
+  }
+
+  MetadataCacheImpl::MetadataCacheImpl(uint64_t _capacity
+                                       ): capacity(_capacity),
+                                          memoryUsage(0),
+                                          hits(0),
+                                          misses(0) {
+    // PASS
+  }
+
+  MetadataCacheImpl::~MetadataCacheImpl() {
+    // PASS
+  }
+
+  uint64_t MetadataCacheImpl::getCapacity() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return capacity;
+  }
+
+  void MetadataCacheImpl::setCapacity(uint64_t _capacity) {
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = _capacity;
+    evict();
+  }
+
+  uint64_t MetadataCacheImpl::getMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return memoryUsage;
+  }
+
+  uint64_t MetadataCacheImpl::getNumberOfEntries() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+  }
+
+  uint64_t MetadataCacheImpl::getHits() const {
+    return hits;
+  }
+
+  uint64_t MetadataCacheImpl::getMisses() const {
+    return misses;
+  }
+
+  void MetadataCacheImpl::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    index.clear();
+    memoryUsage = 0;
+    hits = 0;
+    misses = 0;
+  }
+
+  std::shared_ptr<const FileTailContents>
+      MetadataCacheImpl::get(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<std::string, std::list<Entry>::iterator>::iterator itr =
+      index.find(key);
+    if (itr == index.end()) {
+      misses += 1;
+      return nullptr;
+    }
+    hits += 1;
+    entries.splice(entries.begin(), entries, itr->second);
+    return itr->second->tail;
+  }
+
+  void MetadataCacheImpl::put(const std::string& key,
+                              std::shared_ptr<const FileTailContents> tail) {
+    uint64_t size = tail->getMemoryUsage();
+    std::lock_guard<std::mutex> lock(mutex);
+    std::map<std::string, std::list<Entry>::iterator>::iterator itr =
+      index.find(key);
+    if (itr != index.end()) {
+      memoryUsage -= itr->second->memoryUsage;
+      entries.erase(itr->second);
+      index.erase(itr);
+    }
+    if (size > capacity) {
+      return;
+    }
+    Entry entry;
+    entry.key = key;
+    entry.tail = tail;
+    entry.memoryUsage = size;
+    entries.push_front(entry);
+    index[key] = entries.begin();
+    memoryUsage += size;
+    evict();
+  }
+
+  void MetadataCacheImpl::evict() {
+    while (memoryUsage > capacity) {
+      memoryUsage -= entries.back().memoryUsage;
+      index.erase(entries.back().key);
+      entries.pop_back();
+    }
+  }
+
+  std::string MetadataCacheImpl::makeKey(const std::string& name,
+                                         uint64_t length,
+                                         uint64_t modificationTime) {
+    if (modificationTime == 0) {
+      return "";
+    }
+    std::ostringstream key;
+    key << length << ":" << modificationTime << ":" << name;
+    return key.str();
+  }
+
+  MetadataCacheImpl& getMetadataCacheImpl() {
+    static MetadataCacheImpl cache(DEFAULT_METADATA_CACHE_CAPACITY);
+    return cache;
+  }
+
+  MetadataCache& getMetadataCache() {
+    return getMetadataCacheImpl();
+  }
+}
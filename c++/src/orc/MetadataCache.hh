@@ -0,0 +1,124 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_METADATA_CACHE_HH
+#define ORC_METADATA_CACHE_HH
+
+#include "orc/Adaptor.hh"
+#include "orc/Reader.hh"
+#include "wrap/orc-proto-wrapper.hh"
+
+#include <atomic>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace orc {
+
+  /**
+   * The parsed tail of a file. Once it has been built, it isn't modified,
+   * so it may be shared between readers.
+   */
+  struct FileTailContents {
+    proto::PostScript postscript;
+    proto::Footer footer;
+    proto::Metadata metadata;
+    uint64_t postscriptLength;
+    uint64_t fileLength;
+    std::unique_ptr<Type> schema;
+
+    FileTailContents();
+
+    /**
+     * Get the length of the file's tail in bytes.
+     */
+    uint64_t getTailLength() const;
+
+    /**
+     * Get the approximate number of bytes of memory used by the tail.
+     */
+    uint64_t getMemoryUsage() const;
+  };
+
+  class MetadataCacheImpl: public MetadataCache {
+  private:
+    struct Entry {
+      std::string key;
+      std::shared_ptr<const FileTailContents> tail;
+      uint64_t memoryUsage;
+    };
+
+    mutable std::mutex mutex;
+    // the most recently used entry is at the front
+    std::list<Entry> entries;
+    std::map<std::string, std::list<Entry>::iterator> index;
+    uint64_t capacity;
+    uint64_t memoryUsage;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+
+    void evict();
+
+  public:
+    MetadataCacheImpl(uint64_t capacity);
+    ~MetadataCacheImpl();
+
+    uint64_t getCapacity() const override;
+    void setCapacity(uint64_t capacity) override;
+    uint64_t getMemoryUsage() const override;
+    uint64_t getNumberOfEntries() const override;
+    uint64_t getHits() const override;
+    uint64_t getMisses() const override;
+    void clear() override;
+
+    /**
+     * Find a file's tail and mark it as the most recently used.
+     * @param key the key from makeKey
+     * @return the tail or nullptr if it isn't cached
+     */
+    std::shared_ptr<const FileTailContents> get(const std::string& key);
+
+    /**
+     * Add a file's tail to the cache, replacing any tail with the same
+     * key. Tails that are larger than the capacity aren't kept.
+     * @param key the key from makeKey
+     * @param tail the parsed tail
+     */
+    void put(const std::string& key,
+             std::shared_ptr<const FileTailContents> tail);
+
+    /**
+     * Build the key that identifies a version of a file.
+     * @param name the name of the file
+     * @param length the length of the file
+     * @param modificationTime the modification time of the file
+     * @return the key or an empty string if the file can't be cached
+     */
+    static std::string makeKey(const std::string& name,
+                               uint64_t length,
+                               uint64_t modificationTime);
+  };
+
+  /**
+   * Get the process-wide cache as its implementation.
+   */
+  MetadataCacheImpl& getMetadataCacheImpl();
+}
+
+#endif
@@ -19,52 +19,74 @@
 #include "orc/Adaptor.hh"
 #include "orc/OrcFile.hh"
 #include "Exceptions.hh"
+#include "HeapBuffer.hh"
+#include "IoUring.hh"
+#include "ThreadPool.hh"
 
+#include <algorithm>
+#include <atomic>
 #include <errno.h>
 #include <fcntl.h>
+#include <future>
+#include <limits.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <stdio.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#ifdef HAS_PREADV
+  #include <sys/uio.h>
+#endif
+
 namespace orc {
 
   Buffer::~Buffer() {
     // PASS
   }
 
-  class HeapBuffer: public Buffer {
-  private:
-    char* start;
-    uint64_t length;
-
-  public:
-    HeapBuffer(uint64_t size) {
-      start = new char[size];
-      length = size;
-    }
-
-    virtual ~HeapBuffer();
-
-    virtual char *getStart() const override {
-      return start;
-    }
-
-    virtual uint64_t getLength() const override {
-      return length;
-    }
-  };
-
   HeapBuffer::~HeapBuffer() {
     delete[] start;
   }
 
+  // vectored reads of at least this many bytes are split across threads
+  static const uint64_t PARALLEL_READ_THRESHOLD = 8 * 1024 * 1024;
+  static const uint64_t MAX_READ_THREADS = 4;
+  // ranges at most this far apart are read by one preadv, which reads the
+  // gaps between them into a scratch buffer
+  static const uint64_t MAX_READ_GAP = 64 * 1024;
+
+  /**
+   * Get the modification time of a file in nanoseconds.
+   */
+  static uint64_t getModificationNanos(const struct stat& fileStat) {
+    uint64_t result = static_cast<uint64_t>(fileStat.st_mtime) * 1000000000;
+#ifdef HAS_STAT_MTIM
+    result += static_cast<uint64_t>(fileStat.st_mtim.tv_nsec);
+#endif
+    return result;
+  }
+
   class FileInputStream : public InputStream {
-  private:
+  protected:
     std::string filename ;
     int file;
     uint64_t totalLength;
+    uint64_t modificationTime;
+
+  private:
+    // the process-wide pool for large vectored reads, which is only
+    // started once one is needed
+    std::once_flag readThreadsStarted;
+    std::shared_ptr<ThreadPool> readThreads;
+
+    void readGroup(const std::vector<ReadRange>& ranges,
+                   const std::vector<Buffer*>& buffers,
+                   size_t first,
+                   size_t last);
 
   public:
     FileInputStream(std::string _filename) {
@@ -78,6 +100,7 @@ namespace orc {
         throw ParseError("Can't stat " + filename);
       }
       totalLength = static_cast<uint64_t>(fileStat.st_size);
+      modificationTime = getModificationNanos(fileStat);
     }
 
     ~FileInputStream();
@@ -86,6 +109,10 @@ namespace orc {
       return totalLength;
     }
 
+    uint64_t getModificationTime() const override {
+      return modificationTime;
+    }
+
     Buffer* read(uint64_t offset,
                  uint64_t length,
                  Buffer* buffer) override {
@@ -106,6 +133,9 @@ namespace orc {
       return buffer;
     }
 
+    std::vector<Buffer*> readRanges(const std::vector<ReadRange>& ranges
+                                    ) override;
+
     const std::string& getName() const override {
       return filename;
     }
@@ -115,6 +145,235 @@ namespace orc {
     close(file);
   }
 
+  /**
+   * Read the ranges [first, last), which are in order in the file and at
+   * most MAX_READ_GAP apart, into their buffers.
+   */
+  void FileInputStream::readGroup(const std::vector<ReadRange>& ranges,
+                                  const std::vector<Buffer*>& buffers,
+                                  size_t first,
+                                  size_t last) {
+#ifdef HAS_PREADV
+    uint64_t length = ranges[last - 1].end() - ranges[first].offset;
+    uint64_t largestGap = 0;
+    for(size_t i=first + 1; i < last; ++i) {
+      largestGap = std::max(largestGap,
+                            ranges[i].offset - ranges[i - 1].end());
+    }
+    // every gap is read into the same scratch buffer and thrown away
+    std::vector<char> scratch(largestGap);
+    std::vector<struct iovec> iov;
+    for(size_t i=first; i < last; ++i) {
+      if (i > first && ranges[i].offset > ranges[i - 1].end()) {
+        struct iovec gap;
+        gap.iov_base = scratch.data();
+        gap.iov_len = ranges[i].offset - ranges[i - 1].end();
+        iov.push_back(gap);
+      }
+      struct iovec range;
+      range.iov_base = buffers[i]->getStart();
+      range.iov_len = ranges[i].length;
+      iov.push_back(range);
+    }
+    ssize_t bytesRead = preadv(file, iov.data(), static_cast<int>(iov.size()),
+                               static_cast<off_t>(ranges[first].offset));
+#else
+    uint64_t length = 0;
+    ssize_t bytesRead = 0;
+    for(size_t i=first; i < last; ++i) {
+      length += ranges[i].length;
+      ssize_t result = pread(file, buffers[i]->getStart(), ranges[i].length,
+                             static_cast<off_t>(ranges[i].offset));
+      if (result == -1) {
+        bytesRead = -1;
+        break;
+      }
+      bytesRead += result;
+    }
+#endif
+    if (bytesRead == -1) {
+      throw ParseError("Bad read of " + filename);
+    }
+    if (static_cast<uint64_t>(bytesRead) != length) {
+      throw ParseError("Short read of " + filename);
+    }
+  }
+
+  std::vector<Buffer*> FileInputStream::readRanges
+                              (const std::vector<ReadRange>& ranges) {
+    std::vector<std::unique_ptr<Buffer> > owned(ranges.size());
+    std::vector<Buffer*> result(ranges.size());
+    uint64_t totalBytes = 0;
+    for(size_t i=0; i < ranges.size(); ++i) {
+      owned[i].reset(new HeapBuffer(ranges[i].length));
+      result[i] = owned[i].get();
+      totalBytes += ranges[i].length;
+    }
+
+    // group the ranges that follow the previous one within the gap, since
+    // each group can be filled by a single preadv with an iovec per range
+    // and per gap
+    std::vector<size_t> groupStarts;
+    size_t groupIovecs = 0;
+    for(size_t i=0; i < ranges.size(); ++i) {
+      if (groupStarts.empty() ||
+          ranges[i].offset < ranges[i - 1].end() ||
+          ranges[i].offset - ranges[i - 1].end() > MAX_READ_GAP ||
+          groupIovecs + 2 > IOV_MAX) {
+        groupStarts.push_back(i);
+        groupIovecs = 0;
+      }
+      groupIovecs += 2;
+    }
+    groupStarts.push_back(ranges.size());
+    size_t groups = groupStarts.size() - 1;
+
+    uint64_t threads = std::min(static_cast<uint64_t>(groups),
+                                MAX_READ_THREADS);
+    if (threads < 2 || totalBytes < PARALLEL_READ_THRESHOLD) {
+      for(size_t g=0; g < groups; ++g) {
+        readGroup(ranges, result, groupStarts[g], groupStarts[g + 1]);
+      }
+    } else {
+      std::call_once(readThreadsStarted, [this] {
+          readThreads = getSharedThreadPool(MAX_READ_THREADS);
+        });
+      std::atomic<size_t> nextGroup(0);
+      std::vector<std::future<void> > workers;
+      for(size_t t=0; t < threads; ++t) {
+        std::shared_ptr<std::packaged_task<void()> > task
+          (new std::packaged_task<void()>([&] {
+              for(size_t g = nextGroup++; g < groups; g = nextGroup++) {
+                readGroup(ranges, result, groupStarts[g],
+                          groupStarts[g + 1]);
+              }
+            }));
+        workers.push_back(task->get_future());
+        readThreads->submit([task] { (*task)(); });
+      }
+      // the tasks use this frame, so all of them must finish before an
+      // error is rethrown
+      for(size_t t=0; t < workers.size(); ++t) {
+        workers[t].wait();
+      }
+      for(size_t t=0; t < workers.size(); ++t) {
+        workers[t].get();
+      }
+    }
+
+    for(size_t i=0; i < owned.size(); ++i) {
+      owned[i].release();
+    }
+    return result;
+  }
+
+  // the largest piece of a read that is given to the ring as one request
+  static const uint64_t MAX_RING_READ = 1024 * 1024;
+
+  /**
+   * A FileInputStream that issues its reads through the process-wide
+   * io_uring, so that the pieces of every read are in flight together. If
+   * io_uring isn't available, it reads with pread.
+   */
+  class UringInputStream : public FileInputStream {
+  private:
+    IoRing* ring;
+
+    void readThroughRing(const std::vector<ReadRange>& ranges,
+                         const std::vector<Buffer*>& buffers);
+
+  public:
+    UringInputStream(std::string _filename
+                     ): FileInputStream(_filename),
+                        ring(getSharedIoRing()) {
+      // PASS
+    }
+
+    ~UringInputStream();
+
+    Buffer* read(uint64_t offset,
+                 uint64_t length,
+                 Buffer* buffer) override;
+
+    std::vector<Buffer*> readRanges(const std::vector<ReadRange>& ranges
+                                    ) override;
+  };
+
+  UringInputStream::~UringInputStream() {
+    // PASS
+  }
+
+  void UringInputStream::readThroughRing(const std::vector<ReadRange>& ranges,
+                                         const std::vector<Buffer*>& buffers
+                                         ) {
+    std::vector<RingRead> pieces;
+    for(size_t i=0; i < ranges.size(); ++i) {
+      for(uint64_t posn=0; posn < ranges[i].length; posn += MAX_RING_READ) {
+        pieces.push_back(RingRead(file, buffers[i]->getStart() + posn,
+                                  ranges[i].offset + posn,
+                                  std::min(MAX_RING_READ,
+                                           ranges[i].length - posn)));
+      }
+    }
+    try {
+      ring->readAll(pieces);
+    } catch (std::runtime_error&) {
+      // PASS - none of the pieces are in flight, so pread does the rest
+    }
+    // finish any short, failed, or unsubmitted pieces with pread
+    for(size_t i=0; i < pieces.size(); ++i) {
+      const RingRead& piece = pieces[i];
+      uint64_t done = piece.result > 0 ?
+        static_cast<uint64_t>(piece.result) : 0;
+      if (done < piece.length) {
+        ssize_t bytesRead = pread(file, piece.buffer + done,
+                                  piece.length - done,
+                                  static_cast<off_t>(piece.offset + done));
+        if (bytesRead == -1) {
+          throw ParseError("Bad read of " + filename);
+        }
+        if (static_cast<uint64_t>(bytesRead) != piece.length - done) {
+          throw ParseError("Short read of " + filename);
+        }
+      }
+    }
+  }
+
+  Buffer* UringInputStream::read(uint64_t offset,
+                                 uint64_t length,
+                                 Buffer* buffer) {
+    if (ring == nullptr) {
+      return FileInputStream::read(offset, length, buffer);
+    }
+    if (buffer == nullptr) {
+      buffer = new HeapBuffer(length);
+    } else if (buffer->getLength() < length) {
+      delete buffer;
+      buffer = new HeapBuffer(length);
+    }
+    readThroughRing(std::vector<ReadRange>(1, ReadRange(offset, length)),
+                    std::vector<Buffer*>(1, buffer));
+    return buffer;
+  }
+
+  std::vector<Buffer*> UringInputStream::readRanges
+                              (const std::vector<ReadRange>& ranges) {
+    if (ring == nullptr) {
+      return FileInputStream::readRanges(ranges);
+    }
+    std::vector<std::unique_ptr<Buffer> > owned(ranges.size());
+    std::vector<Buffer*> result(ranges.size());
+    for(size_t i=0; i < ranges.size(); ++i) {
+      owned[i].reset(new HeapBuffer(ranges[i].length));
+      result[i] = owned[i].get();
+    }
+    readThroughRing(ranges, result);
+    for(size_t i=0; i < owned.size(); ++i) {
+      owned[i].release();
+    }
+    return result;
+  }
+
   /**
    * A buffer for use with an memmapped file where the Buffer doesn't own
    * the memory that it references.
@@ -158,6 +417,7 @@ namespace orc {
     std::string filename ;
     char* start;
     uint64_t totalLength;
+    uint64_t modificationTime;
 
   public:
     MmapInputStream(std::string _filename);
@@ -167,6 +427,10 @@ namespace orc {
       return totalLength;
     }
 
+    uint64_t getModificationTime() const override {
+      return modificationTime;
+    }
+
     const std::string& getName() const override {
       return filename;
     }
@@ -174,6 +438,8 @@ namespace orc {
     Buffer* read(uint64_t offset,
                  uint64_t length,
                  Buffer* buffer) override;
+
+    void willNeed(uint64_t offset, uint64_t length) override;
   };
 
   MmapInputStream::MmapInputStream(std::string _filename) {
@@ -184,43 +450,70 @@ namespace orc {
     }
     struct stat fileStat;
     if (fstat(file, &fileStat) == -1) {
+      close(file);
       throw ParseError("Can't stat " + filename);
     }
     totalLength = static_cast<uint64_t>(fileStat.st_size);
+    modificationTime = getModificationNanos(fileStat);
     start = static_cast<char*>(mmap(nullptr, totalLength, PROT_READ,
                                     MAP_FILE|MAP_PRIVATE,
                                     file, 0LL));
+    close(file);
     if (start == MAP_FAILED) {
       throw std::runtime_error("mmap failed " + filename + " " +
                                strerror(errno));
     }
-    close(file);
   }
 
   MmapInputStream::~MmapInputStream() {
-    int64_t result = munmap(reinterpret_cast<void*>(start), totalLength);
-    if (result != 0) {
-      throw std::runtime_error("Failed to unmap " + filename + " - " +
-                               strerror(errno));
-    }
+    // there is no way to report a failure from the destructor
+    munmap(reinterpret_cast<void*>(start), totalLength);
   }
 
   Buffer* MmapInputStream::read(uint64_t offset,
                                 uint64_t length,
                                 Buffer* buffer) {
-    if (buffer == nullptr) {
-      buffer = new MmapBuffer();
-    }
     if (offset + length > totalLength) {
       throw std::runtime_error("Read past end of file " + filename);
     }
-    dynamic_cast<MmapBuffer*>(buffer)->reset(start + offset, length);
-    return buffer;
+    MmapBuffer* result = dynamic_cast<MmapBuffer*>(buffer);
+    if (result == nullptr) {
+      delete buffer;
+      result = new MmapBuffer();
+    }
+    result->reset(start + offset, length);
+    return result;
+  }
+
+  void MmapInputStream::willNeed(uint64_t offset, uint64_t length) {
+    if (length == 0 || offset >= totalLength) {
+      return;
+    }
+    // madvise needs a page aligned start
+    uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t alignedOffset = offset - offset % pageSize;
+    uint64_t alignedLength = std::min(offset + length, totalLength) -
+      alignedOffset;
+    // the hints are advisory, so failures are ignored
+    madvise(start + alignedOffset, alignedLength, MADV_SEQUENTIAL);
+    madvise(start + alignedOffset, alignedLength, MADV_WILLNEED);
   }
 
   std::unique_ptr<InputStream> readLocalFile(const std::string& path) {
     return std::unique_ptr<InputStream>(new FileInputStream(path));
   }
+
+  std::unique_ptr<InputStream> readLocalFileMmap(const std::string& path) {
+    return std::unique_ptr<InputStream>(new MmapInputStream(path));
+  }
+
+  std::unique_ptr<InputStream> readLocalFileIoUring(const std::string& path) {
+    return std::unique_ptr<InputStream>(new UringInputStream(path));
+  }
+
+  bool isIoUringAvailable() {
+    return getSharedIoRing() != nullptr;
+  }
 }
 
 #ifndef HAS_STOLL
@@ -0,0 +1,424 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "ParallelDecompression.hh"
+#include "Exceptions.hh"
+
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <sstream>
+
+namespace orc {
+
+  namespace {
+    /**
+     * Where a chunk's bytes are in the compressed stream.
+     */
+    struct ChunkLocation {
+      // the offset of the chunk's header
+      uint64_t headerOffset;
+      // the offset and length of the bytes after the header
+      uint64_t offset;
+      uint64_t length;
+      bool isOriginal;
+      // the uncompressed length once it is known or
+      // ChunkIndex::UNKNOWN_LENGTH
+      uint64_t uncompressedLength;
+    };
+
+    /**
+     * A chunk that is being, or has been, decompressed.
+     */
+    struct PendingChunk {
+      const ChunkLocation* location;
+      std::unique_ptr<DataBuffer<char> > buffer;
+      // set when the chunk was found in the chunk cache
+      CachedChunk cached;
+      const char* data;
+      uint64_t length;
+      // set when the chunk is decompressed on the thread pool
+      std::future<void> done;
+    };
+  }
+
+  class ParallelDecompressionStream: public SeekableInputStream {
+  public:
+    ParallelDecompressionStream(CompressionKind kind,
+                                const char* data,
+                                uint64_t length,
+                                uint64_t blockSize,
+                                MemoryPool& pool,
+                                ThreadPool& threads,
+                                uint64_t window,
+                                DecompressionCounters* counters,
+                                const ChunkCacheStream* cacheStream);
+    virtual ~ParallelDecompressionStream();
+    virtual bool Next(const void** data, int*size) override;
+    virtual void BackUp(int count) override;
+    virtual bool Skip(int count) override;
+    virtual int64_t ByteCount() const override;
+    virtual void seek(PositionProvider& position) override;
+    virtual std::string getName() const override;
+
+  private:
+    const CompressionKind kind;
+    const char* const input;
+    const uint64_t inputLength;
+    const uint64_t blockSize;
+    MemoryPool& pool;
+    ThreadPool& threads;
+    const uint64_t window;
+    DecompressionCounters* const counters;
+    const std::unique_ptr<ChunkCacheStream> cacheStream;
+
+    // used on this thread to find the lengths of skipped chunks
+    std::unique_ptr<ChunkDecompressor> codec;
+    std::vector<ChunkLocation> chunks;
+
+    // the chunks that were submitted, but not returned yet
+    std::deque<std::unique_ptr<PendingChunk> > ahead;
+    size_t nextToSubmit;
+    // the chunk that was returned last
+    std::unique_ptr<PendingChunk> current;
+    std::vector<std::unique_ptr<DataBuffer<char> > > spareBuffers;
+
+    // the decompressors that no task is using
+    std::mutex decompressorMutex;
+    std::vector<std::unique_ptr<ChunkDecompressor> > spareDecompressors;
+
+    // the bytes of the current chunk that were backed up
+    const char* outputBufferPtr;
+    size_t outputBufferLength;
+
+    off_t bytesReturned;
+
+    // DELIBERATELY NOT IMPLEMENTED
+    ParallelDecompressionStream(const ParallelDecompressionStream&);
+    ParallelDecompressionStream& operator=
+      (const ParallelDecompressionStream&);
+
+    void scanHeaders();
+    void submit();
+    void decompress(const ChunkLocation& chunk, PendingChunk& pending);
+    void releaseCurrent();
+    void drain();
+  };
+
+  ParallelDecompressionStream::ParallelDecompressionStream
+                   (CompressionKind _kind,
+                    const char* data,
+                    uint64_t length,
+                    uint64_t _blockSize,
+                    MemoryPool& _pool,
+                    ThreadPool& _threads,
+                    uint64_t _window,
+                    DecompressionCounters* _counters,
+                    const ChunkCacheStream* _cacheStream
+                    ): kind(_kind),
+                       input(data),
+                       inputLength(length),
+                       blockSize(_blockSize),
+                       pool(_pool),
+                       threads(_threads),
+                       window(std::max<uint64_t>(_window, 1)),
+                       counters(_counters),
+                       cacheStream(_cacheStream == nullptr ? nullptr :
+                                   new ChunkCacheStream(*_cacheStream)),
+                       codec(createChunkDecompressor(_kind)),
+                       nextToSubmit(0),
+                       outputBufferPtr(nullptr),
+                       outputBufferLength(0),
+                       bytesReturned(0) {
+    scanHeaders();
+  }
+
+  ParallelDecompressionStream::~ParallelDecompressionStream() {
+    // the tasks use this object's buffers
+    drain();
+  }
+
+  void ParallelDecompressionStream::scanHeaders() {
+    uint64_t offset = 0;
+    while (offset < inputLength) {
+      if (inputLength - offset < 3) {
+        throw ParseError("Truncated chunk header in " + getName());
+      }
+      const unsigned char* header =
+        reinterpret_cast<const unsigned char*>(input + offset);
+      uint32_t value = header[0] | (static_cast<uint32_t>(header[1]) << 8) |
+        (static_cast<uint32_t>(header[2]) << 16);
+      ChunkLocation chunk;
+      chunk.headerOffset = offset;
+      chunk.offset = offset + 3;
+      chunk.length = value >> 1;
+      chunk.isOriginal = (value & 1) != 0;
+      chunk.uncompressedLength = chunk.isOriginal ? chunk.length :
+        ChunkIndex::UNKNOWN_LENGTH;
+      if (chunk.length > inputLength - chunk.offset) {
+        throw ParseError("Chunk runs past the end of " + getName());
+      }
+      chunks.push_back(chunk);
+      offset = chunk.offset + chunk.length;
+    }
+  }
+
+  void ParallelDecompressionStream::decompress(const ChunkLocation& chunk,
+                                               PendingChunk& pending) {
+    std::unique_ptr<ChunkDecompressor> decompressor;
+    {
+      std::lock_guard<std::mutex> lock(decompressorMutex);
+      if (!spareDecompressors.empty()) {
+        decompressor = std::move(spareDecompressors.back());
+        spareDecompressors.pop_back();
+      }
+    }
+    if (decompressor.get() == nullptr) {
+      decompressor = createChunkDecompressor(kind);
+    }
+    pending.length = decompressor->decompress(input + chunk.offset,
+                                              chunk.length,
+                                              pending.buffer->data(),
+                                              blockSize);
+    std::lock_guard<std::mutex> lock(decompressorMutex);
+    spareDecompressors.push_back(std::move(decompressor));
+  }
+
+  void ParallelDecompressionStream::submit() {
+    while (ahead.size() < window && nextToSubmit < chunks.size()) {
+      const ChunkLocation& chunk = chunks[nextToSubmit++];
+      std::unique_ptr<PendingChunk> pending(new PendingChunk());
+      pending->location = &chunk;
+      if (chunk.isOriginal) {
+        pending->data = input + chunk.offset;
+        pending->length = chunk.length;
+      } else if (cacheStream.get() != nullptr &&
+                 (pending->cached =
+                    cacheStream->cache->get(cacheStream->file,
+                                            cacheStream->streamOffset,
+                                            chunk.headerOffset))) {
+        pending->data = pending->cached->data();
+        pending->length = pending->cached->size();
+      } else {
+        // allocate here, since the pool may not be thread safe
+        if (spareBuffers.empty()) {
+          pending->buffer.reset(new DataBuffer<char>(pool, blockSize));
+        } else {
+          pending->buffer = std::move(spareBuffers.back());
+          spareBuffers.pop_back();
+        }
+        pending->data = pending->buffer->data();
+        pending->length = 0;
+        PendingChunk* target = pending.get();
+        std::shared_ptr<std::packaged_task<void()> > task
+          (new std::packaged_task<void()>([this, &chunk, target] {
+              decompress(chunk, *target);
+            }));
+        pending->done = task->get_future();
+        threads.submit([task] { (*task)(); });
+      }
+      ahead.push_back(std::move(pending));
+    }
+  }
+
+  void ParallelDecompressionStream::releaseCurrent() {
+    if (current.get() != nullptr) {
+      if (current->buffer.get() != nullptr) {
+        spareBuffers.push_back(std::move(current->buffer));
+      }
+      current.reset();
+    }
+    outputBufferPtr = nullptr;
+    outputBufferLength = 0;
+  }
+
+  void ParallelDecompressionStream::drain() {
+    releaseCurrent();
+    while (!ahead.empty()) {
+      std::unique_ptr<PendingChunk> pending = std::move(ahead.front());
+      ahead.pop_front();
+      if (pending->done.valid()) {
+        pending->done.wait();
+      }
+      if (pending->buffer.get() != nullptr) {
+        spareBuffers.push_back(std::move(pending->buffer));
+      }
+    }
+  }
+
+  bool ParallelDecompressionStream::Next(const void** data, int*size) {
+    // if the user pushed back, return them the partial buffer
+    if (outputBufferLength) {
+      *data = outputBufferPtr;
+      *size = static_cast<int>(outputBufferLength);
+      outputBufferPtr += outputBufferLength;
+      bytesReturned += static_cast<off_t>(outputBufferLength);
+      outputBufferLength = 0;
+      return true;
+    }
+    releaseCurrent();
+    submit();
+    if (ahead.empty()) {
+      return false;
+    }
+    current = std::move(ahead.front());
+    ahead.pop_front();
+    // keep the window full while we wait
+    submit();
+    if (current->done.valid()) {
+      // rethrows the decompressor's exceptions
+      current->done.get();
+      if (counters != nullptr) {
+        counters->decompressedBytes += current->length;
+      }
+      if (cacheStream.get() != nullptr) {
+        cacheStream->cache->put(cacheStream->file, cacheStream->streamOffset,
+                                current->location->headerOffset,
+                                current->data,
+                                current->length);
+      }
+    } else if (counters != nullptr && !current->cached) {
+      counters->passedThroughBytes += current->length;
+    }
+    chunks[static_cast<size_t>(current->location - chunks.data())]
+      .uncompressedLength = current->length;
+    *data = current->data;
+    *size = static_cast<int>(current->length);
+    outputBufferPtr = current->data + current->length;
+    bytesReturned += static_cast<off_t>(current->length);
+    return true;
+  }
+
+  void ParallelDecompressionStream::BackUp(int count) {
+    if (outputBufferPtr == nullptr || outputBufferLength != 0) {
+      throw std::logic_error("Backup without previous Next in " + getName());
+    }
+    outputBufferPtr -= static_cast<size_t>(count);
+    outputBufferLength = static_cast<size_t>(count);
+    bytesReturned -= count;
+  }
+
+  bool ParallelDecompressionStream::Skip(int signedCount) {
+    if (signedCount < 0) {
+      return false;
+    }
+    size_t count = static_cast<size_t>(signedCount);
+    // first use up anything that was pushed back
+    size_t buffered = std::min(outputBufferLength, count);
+    outputBufferPtr += buffered;
+    outputBufferLength -= buffered;
+    bytesReturned += static_cast<off_t>(buffered);
+    count -= buffered;
+    while (count > 0) {
+      uint64_t chunkLength;
+      if (ahead.empty() && nextToSubmit < chunks.size()) {
+        // the following chunks haven't been started, so skip the ones
+        // that are entirely covered without decompressing them
+        const ChunkLocation& chunk = chunks[nextToSubmit];
+        if (chunk.uncompressedLength != ChunkIndex::UNKNOWN_LENGTH) {
+          chunkLength = chunk.uncompressedLength;
+        } else if (!codec->getUncompressedLength(input + chunk.offset,
+                                                 chunk.length, chunk.length,
+                                                 &chunkLength)) {
+          chunkLength = count + 1;
+        }
+        if (chunkLength <= count) {
+          releaseCurrent();
+          nextToSubmit += 1;
+          bytesReturned += static_cast<off_t>(chunkLength);
+          count -= chunkLength;
+          continue;
+        }
+      }
+      const void *ptr;
+      int len;
+      if (!Next(&ptr, &len)) {
+        return false;
+      }
+      size_t unsignedLen = static_cast<size_t>(len);
+      if (unsignedLen > count) {
+        BackUp(static_cast<int>(unsignedLen - count));
+        count = 0;
+      } else {
+        count -= unsignedLen;
+      }
+    }
+    return true;
+  }
+
+  int64_t ParallelDecompressionStream::ByteCount() const {
+    return bytesReturned;
+  }
+
+  void ParallelDecompressionStream::seek(PositionProvider& position) {
+    uint64_t offset = position.next();
+    // seeking inside the chunk that was returned last keeps it and the
+    // chunks being decompressed after it
+    if (current.get() != nullptr &&
+        current->location->headerOffset == offset) {
+      uint64_t skip = position.next();
+      if (skip > current->length) {
+        throw ParseError("Bad skip in " + getName() + "::seek");
+      }
+      outputBufferPtr = current->data + skip;
+      outputBufferLength = current->length - skip;
+      bytesReturned = static_cast<off_t>(offset + skip);
+      return;
+    }
+    std::vector<ChunkLocation>::const_iterator chunk =
+      std::lower_bound(chunks.begin(), chunks.end(), offset,
+                       [](const ChunkLocation& location, uint64_t value) {
+                         return location.headerOffset < value;
+                       });
+    if (offset != inputLength &&
+        (chunk == chunks.end() || chunk->headerOffset != offset)) {
+      throw ParseError("Seek to the middle of a chunk in " + getName());
+    }
+    drain();
+    nextToSubmit = static_cast<size_t>(chunk - chunks.begin());
+    bytesReturned = static_cast<off_t>(offset);
+    if (!Skip(static_cast<int>(position.next()))) {
+      throw ParseError("Bad skip in " + getName() + "::seek");
+    }
+  }
+
+  std::string ParallelDecompressionStream::getName() const {
+    std::ostringstream result;
+    result << codec->getName() << "(parallel memory " << inputLength
+           << " bytes)";
+    return result.str();
+  }
+
+  std::unique_ptr<SeekableInputStream>
+     createParallelDecompressor(CompressionKind kind,
+                                const char* data,
+                                uint64_t length,
+                                uint64_t blockSize,
+                                MemoryPool& pool,
+                                ThreadPool& threads,
+                                uint64_t window,
+                                DecompressionCounters* counters,
+                                const ChunkCacheStream* cacheStream) {
+    return std::unique_ptr<SeekableInputStream>
+      (new ParallelDecompressionStream(kind, data, length, blockSize, pool,
+                                       threads, window, counters,
+                                       cacheStream));
+  }
+}
@@ -0,0 +1,56 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_PARALLEL_DECOMPRESSION_HH
+#define ORC_PARALLEL_DECOMPRESSION_HH
+
+#include "orc/Adaptor.hh"
+#include "Compression.hh"
+#include "ThreadPool.hh"
+
+namespace orc {
+
+  /**
+   * Create a decompressor for a compressed stream that is entirely in
+   * memory. The chunk headers are scanned up front and the chunks after
+   * the one being read are decompressed ahead on the thread pool, while
+   * the chunks are still returned in order.
+   * @param kind the compression type, which must not be NONE
+   * @param data the compressed stream, which must outlive the result
+   * @param length the number of bytes in the compressed stream
+   * @param blockSize the maximum size of an uncompressed chunk
+   * @param pool the memory pool, which is only used on the calling thread
+   * @param threads the threads to decompress on
+   * @param window the most chunks that are decompressed ahead
+   * @param counters if not null, the counters to add this stream's bytes to
+   * @param cacheStream if not null, where the stream's chunks are cached
+   */
+  std::unique_ptr<SeekableInputStream>
+     createParallelDecompressor(CompressionKind kind,
+                                const char* data,
+                                uint64_t length,
+                                uint64_t blockSize,
+                                MemoryPool& pool,
+                                ThreadPool& threads,
+                                uint64_t window,
+                                DecompressionCounters* counters = nullptr,
+                                const ChunkCacheStream* cacheStream =
+                                  nullptr);
+}
+
+#endif
@@ -19,6 +19,7 @@
 #ifndef ORC_RLE_HH
 #define ORC_RLE_HH
 
+#include "Bitmap.hh"
 #include "Compression.hh"
 
 #include <memory>
@@ -29,6 +30,46 @@ namespace orc {
     return value >> 1 ^ -(value & 1);
   }
 
+  /**
+   * Move values that were decoded together to the non-null positions.
+   * Starting from the end works in place, because no value moves to an
+   * earlier position. The mask is checked 8 positions at a time, so runs
+   * without nulls move as blocks and runs of nulls are passed over, and
+   * it stops once the values left are already in their positions.
+   * @param data the values, which are in data[0] to data[count - 1]
+   * @param length the number of positions
+   * @param count the number of non-null positions
+   * @param notNull which of the length positions have values
+   */
+  inline void spreadNonNulls(int64_t* data,
+                             uint64_t length,
+                             uint64_t count,
+                             const char* notNull) {
+    uint64_t i = length;
+    while (count > 0 && count < i) {
+      if (i < 8) {
+        --i;
+        if (notNull[i]) {
+          data[i] = data[--count];
+        }
+        continue;
+      }
+      uint64_t zeros = findZeroBytes(loadMaskWord(notNull + i - 8));
+      if (zeros == 0) {
+        memmove(data + i - 8, data + count - 8, 8 * sizeof(int64_t));
+        count -= 8;
+      } else if (zeros != 0x8080808080808080ULL) {
+        for(uint64_t j = i; j > i - 8 && count > 0; ) {
+          --j;
+          if (notNull[j]) {
+            data[j] = data[--count];
+          }
+        }
+      }
+      i -= 8;
+    }
+  }
+
   class RleDecoder {
   public:
     // must be non-inline!
@@ -49,7 +90,8 @@ namespace orc {
      * @param data the array to read into
      * @param numValues the number of values to read
      * @param notNull If the pointer is null, all values are read. If the
-     *    pointer is not null, positions that are false are skipped.
+     *    pointer is not null, positions that are false are skipped and
+     *    may be overwritten with any value.
      */
     virtual void next(int64_t* data, uint64_t numValues,
                       const char* notNull) = 0;
@@ -20,49 +20,45 @@
 #include "RLEv1.hh"
 #include "Compression.hh"
 #include "Exceptions.hh"
+#include "Varint.hh"
 
 #include <algorithm>
 
 namespace orc {
 
 const uint64_t MINIMUM_REPEAT = 3;
-const uint64_t BASE_128_MASK = 0x7f;
 
 signed char RleDecoderV1::readByte() {
-  if (bufferStart == bufferEnd) {
-    int bufferLength;
-    const void* bufferPointer;
-    if (!inputStream->Next(&bufferPointer, &bufferLength)) {
-      throw ParseError("bad read in readByte");
-    }
-    bufferStart = static_cast<const char*>(bufferPointer);
-    bufferEnd = bufferStart + bufferLength;
-  }
-  return *(bufferStart++);
+  return static_cast<signed char>(cursor.readByte());
 }
 
 uint64_t RleDecoderV1::readLong() {
-  uint64_t result = 0;
-  int64_t offset = 0;
-  signed char ch = readByte();
-  if (ch >= 0) {
-    result = static_cast<uint64_t>(ch);
-  } else {
-    result = static_cast<uint64_t>(ch) & BASE_128_MASK;
-    while ((ch = readByte()) < 0) {
-      offset += 7;
-      result |= (static_cast<uint64_t>(ch) & BASE_128_MASK) << offset;
-    }
-    result |= static_cast<uint64_t>(ch) << (offset + 7);
-  }
-  return result;
+  return cursor.readVarint();
 }
 
 void RleDecoderV1::skipLongs(uint64_t numValues) {
   while (numValues > 0) {
-    if (readByte() >= 0) {
-      --numValues;
+    cursor.fill();
+    // each value ends with the first byte that has the high bit clear
+    const char* bytes = cursor.data();
+    size_t length = cursor.available();
+    size_t used = 0;
+    // count the ends in 8 bytes at a time while they are all skipped
+    while (used + 8 <= length) {
+      uint64_t ends = ~loadVarintWord(bytes + used) & 0x8080808080808080ULL;
+      uint64_t count = static_cast<uint64_t>(__builtin_popcountll(ends));
+      if (count >= numValues) {
+        break;
+      }
+      numValues -= count;
+      used += 8;
+    }
+    while (used < length && numValues > 0) {
+      if (!(bytes[used++] & 0x80)) {
+        --numValues;
+      }
     }
+    cursor.advance(used);
   }
 }
 
@@ -85,16 +81,15 @@ RleDecoderV1::RleDecoderV1(std::unique_ptr<SeekableInputStream> input,
                            bool hasSigned)
     : inputStream(std::move(input)),
       isSigned(hasSigned),
-      remainingValues(0),
-      bufferStart(nullptr),
-      bufferEnd(bufferStart) {
+      cursor(inputStream.get(), "bad read in readByte"),
+      remainingValues(0) {
 }
 
 void RleDecoderV1::seek(PositionProvider& location) {
   // move the input stream
   inputStream->seek(location);
   // force a re-read from the stream
-  bufferEnd = bufferStart;
+  cursor.reset();
   // read a new header
   readHeader();
   // skip ahead the given number of records
@@ -152,27 +147,23 @@ void RleDecoderV1::next(int64_t* const data,
       }
       value += static_cast<int64_t>(consumed) * delta;
     } else {
+      // decode the literals together and then move them to the non-null
+      // positions
       if (notNull) {
-        for (uint64_t i = 0 ; i < count; ++i) {
-          if (notNull[i]) {
-            data[position + i] = isSigned
-                ? unZigZag(readLong())
-                : static_cast<int64_t>(readLong());
-            ++consumed;
-          }
-        }
+        consumed = countNonNulls(notNull + position, count);
       } else {
-        if (isSigned) {
-          for (uint64_t i = 0; i < count; ++i) {
-            data[position + i] = unZigZag(readLong());
-          }
-        } else {
-          for (uint64_t i = 0; i < count; ++i) {
-            data[position + i] = static_cast<int64_t>(readLong());
-          }
-        }
         consumed = count;
       }
+      cursor.readVarints(data + position, consumed);
+      if (isSigned) {
+        for (uint64_t i = 0; i < consumed; ++i) {
+          data[position + i] =
+            unZigZag(static_cast<uint64_t>(data[position + i]));
+        }
+      }
+      if (notNull) {
+        spreadNonNulls(data + position, count, consumed, notNull + position);
+      }
     }
     remainingValues -= consumed;
     position += count;
@@ -20,6 +20,7 @@
 #define ORC_RLEV1_HH
 
 #include "orc/Adaptor.hh"
+#include "InputCursor.hh"
 #include "RLE.hh"
 
 #include <memory>
@@ -58,10 +59,9 @@ private:
 
     const std::unique_ptr<SeekableInputStream> inputStream;
     const bool isSigned;
+    InputCursor cursor;
     uint64_t remainingValues;
     int64_t value;
-    const char *bufferStart;
-    const char *bufferEnd;
     int64_t delta;
     bool repeating;
 };
@@ -17,9 +17,14 @@
  */
 
 #include "orc/Adaptor.hh"
+#include "BitUnpack.hh"
 #include "RLEv2.hh"
 #include "Compression.hh"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #define MIN_REPEAT 3
 
 namespace orc {
@@ -82,15 +87,90 @@ inline uint32_t getClosestFixedBits(uint32_t n) {
   }
 }
 
-int64_t RleDecoderV2::readLongBE(uint64_t bsz) {
-  int64_t ret = 0, val;
-  uint64_t n = bsz;
-  while (n > 0) {
-    n--;
-    val = readByte();
-    ret |= (val << (n * 8));
+namespace {
+
+/**
+ * Set every value to the same one.
+ */
+void fillRepeat(int64_t* data, uint64_t count, int64_t value) {
+  uint64_t i = 0;
+#ifdef __SSE2__
+  __m128i values = _mm_set1_epi64x(value);
+  for( ; i + 2 <= count; i += 2) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), values);
+  }
+#endif
+  for( ; i < count; ++i) {
+    data[i] = value;
   }
-  return ret;
+}
+
+/**
+ * Set the values to first, first + delta, first + 2 * delta and so on.
+ * The arithmetic wraps around like the encoder's does.
+ */
+void fillSequence(int64_t* data, uint64_t count, int64_t first,
+                  int64_t delta) {
+  uint64_t i = 0;
+#ifdef __SSE2__
+  uint64_t udelta = static_cast<uint64_t>(delta);
+  __m128i values = _mm_set_epi64x
+    (static_cast<int64_t>(static_cast<uint64_t>(first) + udelta), first);
+  __m128i step = _mm_set1_epi64x(static_cast<int64_t>(2 * udelta));
+  for( ; i + 2 <= count; i += 2) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), values);
+    values = _mm_add_epi64(values, step);
+  }
+#endif
+  for( ; i < count; ++i) {
+    data[i] = static_cast<int64_t>(static_cast<uint64_t>(first) +
+                                   i * static_cast<uint64_t>(delta));
+  }
+}
+
+/**
+ * Replace each delta with the running total from previous, subtracting
+ * the deltas when the sequence decreases. The sums within a group of 4
+ * don't depend on previous, so only one add per group waits for the last
+ * group.
+ */
+template <bool DECREASING>
+void addDeltas(int64_t* data, uint64_t count, int64_t previous) {
+  uint64_t total = static_cast<uint64_t>(previous);
+  uint64_t i = 0;
+  for( ; i + 4 <= count; i += 4) {
+    uint64_t d0 = static_cast<uint64_t>(data[i]);
+    uint64_t d1 = d0 + static_cast<uint64_t>(data[i + 1]);
+    uint64_t d2 = d1 + static_cast<uint64_t>(data[i + 2]);
+    uint64_t d3 = d2 + static_cast<uint64_t>(data[i + 3]);
+    if (DECREASING) {
+      data[i] = static_cast<int64_t>(total - d0);
+      data[i + 1] = static_cast<int64_t>(total - d1);
+      data[i + 2] = static_cast<int64_t>(total - d2);
+      data[i + 3] = static_cast<int64_t>(total - d3);
+      total -= d3;
+    } else {
+      data[i] = static_cast<int64_t>(total + d0);
+      data[i + 1] = static_cast<int64_t>(total + d1);
+      data[i + 2] = static_cast<int64_t>(total + d2);
+      data[i + 3] = static_cast<int64_t>(total + d3);
+      total += d3;
+    }
+  }
+  for( ; i < count; ++i) {
+    if (DECREASING) {
+      total -= static_cast<uint64_t>(data[i]);
+    } else {
+      total += static_cast<uint64_t>(data[i]);
+    }
+    data[i] = static_cast<int64_t>(total);
+  }
+}
+}
+
+int64_t RleDecoderV2::readLongBE(uint64_t bsz) {
+  return static_cast<int64_t>
+    (cursor.readBigEndian(static_cast<uint32_t>(bsz)));
 }
 
 inline int64_t RleDecoderV2::readVslong() {
@@ -98,25 +178,39 @@ inline int64_t RleDecoderV2::readVslong() {
 }
 
 uint64_t RleDecoderV2::readVulong() {
-  uint64_t ret = 0, b;
-  uint64_t offset = 0;
-  do {
-    b = readByte();
-    ret |= (0x7f & b) << offset;
-    offset += 7;
-  } while (b >= 0x80);
-  return ret;
+  return cursor.readVarint();
+}
+
+void RleDecoderV2::unpackLongs(int64_t* data, uint64_t count, uint64_t fb) {
+  BitUnpacker unpacker = getBitUnpacker(static_cast<uint32_t>(fb));
+  uint64_t i = 0;
+  while (i < count) {
+    // whole groups of 8 values start on a byte boundary, so unpack all
+    // of the ones in the buffer at once
+    if (bitsLeft == 0 && unpacker != nullptr && count - i >= 8) {
+      cursor.fill();
+      uint64_t groups = std::min((count - i) / 8, cursor.available() / fb);
+      if (groups > 0) {
+        unpacker(cursor.data(), groups, data + i);
+        cursor.advance(groups * fb);
+        i += groups * 8;
+        continue;
+      }
+    }
+    // a group that is split between buffers, or the values at the end
+    data[i++] = static_cast<int64_t>(readLong(fb));
+  }
 }
 
 RleDecoderV2::RleDecoderV2(std::unique_ptr<SeekableInputStream> input,
                            bool _isSigned, MemoryPool& pool
                            ): inputStream(std::move(input)),
                               isSigned(_isSigned),
+                              cursor(inputStream.get(),
+                                     "bad read in RleDecoderV2::readByte"),
                               firstByte(0),
                               runLength(0),
                               runRead(0),
-                              bufferStart(nullptr),
-                              bufferEnd(bufferStart),
                               deltaBase(0),
                               byteSize(0),
                               firstValue(0),
@@ -125,6 +219,8 @@ RleDecoderV2::RleDecoderV2(std::unique_ptr<SeekableInputStream> input,
                               bitsLeft(0),
                               curByte(0),
                               patchBitSize(0),
+                              patchEntryBitSize(0),
+                              patchLength(0),
                               base(0),
                               curGap(0),
                               patchMask(0),
@@ -138,22 +234,261 @@ void RleDecoderV2::seek(PositionProvider& location) {
   // move the input stream
   inputStream->seek(location);
   // clear state
-  bufferEnd = bufferStart = 0;
+  cursor.reset();
   runRead = runLength = 0;
   // skip ahead the given number of records
   skip(location.next());
 }
 
+void RleDecoderV2::skipLongs(uint64_t count, uint64_t fb) {
+  uint64_t bits = count * fb;
+  if (bits <= bitsLeft) {
+    bitsLeft -= static_cast<uint32_t>(bits);
+    return;
+  }
+  // move past the whole bytes and keep the rest of the last one
+  bits -= bitsLeft;
+  cursor.skip(bits / 8);
+  bitsLeft = 0;
+  if (bits % 8 != 0) {
+    curByte = readByte();
+    bitsLeft = 8 - static_cast<uint32_t>(bits % 8);
+  }
+}
+
+void RleDecoderV2::readRunHeader() {
+  resetRun();
+  firstByte = readByte();
+  runRead = 0;
+  switch(static_cast<int64_t>(getEncoding())) {
+  case SHORT_REPEAT: {
+    // extract the number of fixed bytes
+    byteSize = (firstByte >> 3) & 0x07;
+    byteSize += 1;
+
+    runLength = firstByte & 0x07;
+    // run lengths values are stored only after MIN_REPEAT value is met
+    runLength += MIN_REPEAT;
+
+    // read the repeated value which is store using fixed bytes
+    firstValue = readLongBE(byteSize);
+
+    if (isSigned) {
+      firstValue = unZigZag(static_cast<uint64_t>(firstValue));
+    }
+    break;
+  }
+  case DIRECT: {
+    // extract the number of fixed bits
+    unsigned char fbo = (firstByte >> 1) & 0x1f;
+    bitSize = decodeBitWidth(fbo);
+
+    // extract the run length
+    runLength = static_cast<uint64_t>(firstByte & 0x01) << 8;
+    runLength |= readByte();
+    // runs are one off
+    runLength += 1;
+    break;
+  }
+  case PATCHED_BASE: {
+    // extract the number of fixed bits
+    unsigned char fbo = (firstByte >> 1) & 0x1f;
+    bitSize = decodeBitWidth(fbo);
+
+    // extract the run length
+    runLength = static_cast<uint64_t>(firstByte & 0x01) << 8;
+    runLength |= readByte();
+    // runs are one off
+    runLength += 1;
+
+    // extract the number of bytes occupied by base
+    uint64_t thirdByte = readByte();
+    byteSize = (thirdByte >> 5) & 0x07;
+    // base width is one off
+    byteSize += 1;
+
+    // extract patch width
+    uint32_t pwo = thirdByte & 0x1f;
+    patchBitSize = decodeBitWidth(pwo);
+
+    // read fourth byte and extract patch gap width
+    uint64_t fourthByte = readByte();
+    uint32_t pgw = (fourthByte >> 5) & 0x07;
+    // patch gap width is one off
+    pgw += 1;
+
+    // extract the length of the patch list
+    patchLength = fourthByte & 0x1f;
+    if (patchLength == 0) {
+      throw ParseError("Corrupt PATCHED_BASE encoded data (pl==0)!");
+    }
+
+    // read the next base width number of bytes to extract base value
+    base = readLongBE(byteSize);
+    int64_t mask = (static_cast<int64_t>(1) << ((byteSize * 8) - 1));
+    // if mask of base value is 1 then base is negative value else positive
+    if ((base & mask) != 0) {
+      base = base & ~mask;
+      base = -base;
+    }
+
+    // TODO: Skip corrupt?
+    //    if ((patchBitSize + pgw) > 64 && !skipCorrupt) {
+    if ((patchBitSize + pgw) > 64) {
+      throw ParseError("Corrupt PATCHED_BASE encoded data "
+                       "(patchBitSize + pgw > 64)!");
+    }
+    patchEntryBitSize = getClosestFixedBits(patchBitSize + pgw);
+    break;
+  }
+  case DELTA: {
+    // extract the number of fixed bits
+    unsigned char fbo = (firstByte >> 1) & 0x1f;
+    if (fbo != 0) {
+      bitSize = decodeBitWidth(fbo);
+    } else {
+      bitSize = 0;
+    }
+
+    // extract the run length
+    runLength = static_cast<uint64_t>(firstByte & 0x01) << 8;
+    runLength |= readByte();
+    ++runLength; // account for first value
+    deltaBase = 0;
+
+    // read the first value stored as vint
+    if (isSigned) {
+      firstValue = static_cast<int64_t>(readVslong());
+    } else {
+      firstValue = static_cast<int64_t>(readVulong());
+    }
+
+    prevValue = firstValue;
+
+    // read the fixed delta value stored as vint (deltas can be negative even
+    // if all number are positive)
+    deltaBase = static_cast<int64_t>(readVslong());
+    break;
+  }
+  default:
+    throw ParseError("unknown encoding");
+  }
+}
+
+void RleDecoderV2::unpackPatched() {
+  // TODO: something more efficient than resize
+  unpacked.resize(runLength);
+  unpackedIdx = 0;
+  readLongs(unpacked.data(), 0, runLength, bitSize);
+  // any remaining bits are thrown out
+  resetReadLongs();
+
+  // TODO: something more efficient than resize
+  unpackedPatch.resize(patchLength);
+  patchIdx = 0;
+  readLongs(unpackedPatch.data(), 0, patchLength, patchEntryBitSize);
+  // any remaining bits are thrown out
+  resetReadLongs();
+
+  // apply the patch directly when decoding the packed data
+  patchMask = ((static_cast<int64_t>(1) << patchBitSize) - 1);
+
+  adjustGapAndPatch();
+}
+
+void RleDecoderV2::skipRun() {
+  switch(static_cast<int64_t>(getEncoding())) {
+  case DIRECT:
+    skipLongs(runLength, bitSize);
+    break;
+  case PATCHED_BASE:
+    // the values and the patch list each end on a byte boundary
+    skipLongs(runLength, bitSize);
+    resetReadLongs();
+    skipLongs(patchLength, patchEntryBitSize);
+    break;
+  case DELTA:
+    // the first two values are in the header
+    if (bitSize != 0 && runLength > 2) {
+      skipLongs(runLength - 2, bitSize);
+    }
+    break;
+  default:
+    // SHORT_REPEAT runs only have a header
+    break;
+  }
+  runRead = runLength;
+}
+
+void RleDecoderV2::skipPatched(uint64_t count) {
+  // move past the patches of the skipped values
+  uint64_t end = unpackedIdx + count;
+  while (patchIdx < unpackedPatch.size() &&
+         static_cast<uint64_t>(actualGap) < end) {
+    uint64_t patchedIdx = static_cast<uint64_t>(actualGap);
+    ++patchIdx;
+    if (patchIdx < unpackedPatch.size()) {
+      adjustGapAndPatch();
+
+      // next gap is relative to the current gap
+      actualGap += static_cast<int64_t>(patchedIdx);
+    }
+  }
+  unpackedIdx = end;
+}
+
 void RleDecoderV2::skip(uint64_t numValues) {
-  // simple for now, until perf tests indicate something encoding specific is
-  // needed
+  // only the headers of the runs are read, except for the values that are
+  // skipped from the middle of a DELTA run with varying deltas, which are
+  // added up
   const uint64_t N = 64;
   int64_t dummy[N];
 
-  while (numValues) {
-    uint64_t nRead = std::min(N, numValues);
-    next(dummy, nRead, nullptr);
-    numValues -= nRead;
+  while (numValues > 0) {
+    if (runRead == runLength) {
+      readRunHeader();
+      if (numValues >= runLength) {
+        skipRun();
+        numValues -= runLength;
+        continue;
+      }
+      if (getEncoding() == PATCHED_BASE) {
+        unpackPatched();
+      }
+    }
+
+    uint64_t count = std::min(runLength - runRead, numValues);
+    switch(static_cast<int64_t>(getEncoding())) {
+    case SHORT_REPEAT:
+      runRead += count;
+      break;
+    case DIRECT:
+      skipLongs(count, bitSize);
+      runRead += count;
+      break;
+    case PATCHED_BASE:
+      skipPatched(count);
+      runRead += count;
+      break;
+    case DELTA:
+      if (bitSize == 0) {
+        // the value at each position of the run is known
+        runRead += count;
+        prevValue = static_cast<int64_t>
+          (static_cast<uint64_t>(firstValue) +
+           (runRead - 1) * static_cast<uint64_t>(deltaBase));
+      } else if (runRead >= 2 && count == runLength - runRead) {
+        skipLongs(count, bitSize);
+        runRead += count;
+      } else {
+        count = std::min(count, N);
+        nextDelta(dummy, 0, count, nullptr);
+      }
+      break;
+    default:
+      throw ParseError("unknown encoding");
+    }
+    numValues -= count;
   }
 }
 
@@ -171,15 +506,15 @@ void RleDecoderV2::next(int64_t* const data,
     }
 
     if (runRead == runLength) {
-      resetRun();
-      firstByte = readByte();
+      readRunHeader();
+      if (getEncoding() == PATCHED_BASE) {
+        unpackPatched();
+      }
     }
 
     uint64_t offset = nRead, length = numValues - nRead;
 
-    EncodingType enc = static_cast<EncodingType>
-        ((firstByte >> 6) & 0x03);
-    switch(static_cast<int64_t>(enc)) {
+    switch(static_cast<int64_t>(getEncoding())) {
     case SHORT_REPEAT:
       nRead += nextShortRepeats(data, offset, length, notNull);
       break;
@@ -202,39 +537,11 @@ uint64_t RleDecoderV2::nextShortRepeats(int64_t* const data,
                                         uint64_t offset,
                                         uint64_t numValues,
                                         const char* const notNull) {
-  if (runRead == runLength) {
-    // extract the number of fixed bytes
-    byteSize = (firstByte >> 3) & 0x07;
-    byteSize += 1;
-
-    runLength = firstByte & 0x07;
-    // run lengths values are stored only after MIN_REPEAT value is met
-    runLength += MIN_REPEAT;
-    runRead = 0;
-
-    // read the repeated value which is store using fixed bytes
-    firstValue = readLongBE(byteSize);
-
-    if (isSigned) {
-      firstValue = unZigZag(static_cast<uint64_t>(firstValue));
-    }
-  }
-
   uint64_t nRead = std::min(runLength - runRead, numValues);
 
-  if (notNull) {
-    for(uint64_t pos = offset; pos < offset + nRead; ++pos) {
-      if (notNull[pos]) {
-        data[pos] = firstValue;
-        ++runRead;
-      }
-    }
-  } else {
-    for(uint64_t pos = offset; pos < offset + nRead; ++pos) {
-      data[pos] = firstValue;
-      ++runRead;
-    }
-  }
+  // the null positions may be overwritten, so they are filled too
+  fillRepeat(data + offset, nRead, firstValue);
+  runRead += notNull ? countNonNulls(notNull + offset, nRead) : nRead;
 
   return nRead;
 }
@@ -243,19 +550,6 @@ uint64_t RleDecoderV2::nextDirect(int64_t* const data,
                                   uint64_t offset,
                                   uint64_t numValues,
                                   const char* const notNull) {
-  if (runRead == runLength) {
-    // extract the number of fixed bits
-    unsigned char fbo = (firstByte >> 1) & 0x1f;
-    bitSize = decodeBitWidth(fbo);
-
-    // extract the run length
-    runLength = static_cast<uint64_t>(firstByte & 0x01) << 8;
-    runLength |= readByte();
-    // runs are one off
-    runLength += 1;
-    runRead = 0;
-  }
-
   uint64_t nRead = std::min(runLength - runRead, numValues);
 
   runRead += readLongs(data, offset, nRead, bitSize, notNull);
@@ -281,76 +575,6 @@ uint64_t RleDecoderV2::nextPatched(int64_t* const data,
                                    uint64_t offset,
                                    uint64_t numValues,
                                    const char* const notNull) {
-  if (runRead == runLength) {
-    // extract the number of fixed bits
-    unsigned char fbo = (firstByte >> 1) & 0x1f;
-    bitSize = decodeBitWidth(fbo);
-
-    // extract the run length
-    runLength = static_cast<uint64_t>(firstByte & 0x01) << 8;
-    runLength |= readByte();
-    // runs are one off
-    runLength += 1;
-    runRead = 0;
-
-    // extract the number of bytes occupied by base
-    uint64_t thirdByte = readByte();
-    byteSize = (thirdByte >> 5) & 0x07;
-    // base width is one off
-    byteSize += 1;
-
-    // extract patch width
-    uint32_t pwo = thirdByte & 0x1f;
-    patchBitSize = decodeBitWidth(pwo);
-
-    // read fourth byte and extract patch gap width
-    uint64_t fourthByte = readByte();
-    uint32_t pgw = (fourthByte >> 5) & 0x07;
-    // patch gap width is one off
-    pgw += 1;
-
-    // extract the length of the patch list
-    size_t pl = fourthByte & 0x1f;
-    if (pl == 0) {
-      throw ParseError("Corrupt PATCHED_BASE encoded data (pl==0)!");
-    }
-
-    // read the next base width number of bytes to extract base value
-    base = readLongBE(byteSize);
-    int64_t mask = (static_cast<int64_t>(1) << ((byteSize * 8) - 1));
-    // if mask of base value is 1 then base is negative value else positive
-    if ((base & mask) != 0) {
-      base = base & ~mask;
-      base = -base;
-    }
-
-    // TODO: something more efficient than resize
-    unpacked.resize(runLength);
-    unpackedIdx = 0;
-    readLongs(unpacked.data(), 0, runLength, bitSize);
-    // any remaining bits are thrown out
-    resetReadLongs();
-
-    // TODO: something more efficient than resize
-    unpackedPatch.resize(pl);
-    patchIdx = 0;
-    // TODO: Skip corrupt?
-    //    if ((patchBitSize + pgw) > 64 && !skipCorrupt) {
-    if ((patchBitSize + pgw) > 64) {
-      throw ParseError("Corrupt PATCHED_BASE encoded data "
-                       "(patchBitSize + pgw > 64)!");
-    }
-    uint32_t cfb = getClosestFixedBits(patchBitSize + pgw);
-    readLongs(unpackedPatch.data(), 0, pl, cfb);
-    // any remaining bits are thrown out
-    resetReadLongs();
-
-    // apply the patch directly when decoding the packed data
-    patchMask = ((static_cast<int64_t>(1) << patchBitSize) - 1);
-
-    adjustGapAndPatch();
-  }
-
   uint64_t nRead = std::min(runLength - runRead, numValues);
 
   for(uint64_t pos = offset; pos < offset + nRead; ++pos) {
@@ -390,92 +614,47 @@ uint64_t RleDecoderV2::nextDelta(int64_t* const data,
                                  uint64_t offset,
                                  uint64_t numValues,
                                  const char* const notNull) {
-  if (runRead == runLength) {
-    // extract the number of fixed bits
-    unsigned char fbo = (firstByte >> 1) & 0x1f;
-    if (fbo != 0) {
-      bitSize = decodeBitWidth(fbo);
-    } else {
-      bitSize = 0;
-    }
-
-    // extract the run length
-    runLength = static_cast<uint64_t>(firstByte & 0x01) << 8;
-    runLength |= readByte();
-    ++runLength; // account for first value
-    runRead = deltaBase = 0;
-
-    // read the first value stored as vint
-    if (isSigned) {
-      firstValue = static_cast<int64_t>(readVslong());
-    } else {
-      firstValue = static_cast<int64_t>(readVulong());
-    }
-
-    prevValue = firstValue;
-
-    // read the fixed delta value stored as vint (deltas can be negative even
-    // if all number are positive)
-    deltaBase = static_cast<int64_t>(readVslong());
-  }
-
   uint64_t nRead = std::min(runLength - runRead, numValues);
 
-  uint64_t pos = offset;
-  for ( ; pos < offset + nRead; ++pos) {
-    // skip null positions
-    if (!notNull || notNull[pos]) break;
-  }
-  if (runRead == 0 && pos < offset + nRead) {
-    data[pos++] = firstValue;
+  // the values of the non-null positions are made together and then
+  // moved to their positions
+  int64_t* values = data + offset;
+  uint64_t count = notNull ? countNonNulls(notNull + offset, nRead) : nRead;
+  uint64_t done = 0;
+  if (runRead == 0 && done < count) {
+    values[done++] = firstValue;
     ++runRead;
   }
 
   if (bitSize == 0) {
     // add fixed deltas to adjacent values
-    for ( ; pos < offset + nRead; ++pos) {
-      // skip null positions
-      if (notNull && !notNull[pos]) {
-        continue;
-      }
-      prevValue = data[pos] = prevValue + deltaBase;
-      ++runRead;
-    }
+    fillSequence(values + done, count - done, prevValue + deltaBase,
+                 deltaBase);
   } else {
-    for ( ; pos < offset + nRead; ++pos) {
-      // skip null positions
-      if (!notNull || notNull[pos]) break;
-    }
-    if (runRead < 2 && pos < offset + nRead) {
+    if (runRead < 2 && done < count) {
       // add delta base and first value
-      prevValue = data[pos++] = firstValue + deltaBase;
+      prevValue = values[done++] = firstValue + deltaBase;
       ++runRead;
     }
 
-    // write the unpacked values, add it to previous value and store final
-    // value to result buffer. if the delta base value is negative then it
-    // is a decreasing sequence else an increasing sequence
-    uint64_t remaining = (offset + nRead) - pos;
-    runRead += readLongs(data, pos, remaining, bitSize, notNull);
-
+    // add the unpacked deltas to the previous values. if the delta base
+    // value is negative then it is a decreasing sequence else an
+    // increasing sequence
+    unpackLongs(values + done, count - done, bitSize);
     if (deltaBase < 0) {
-      for ( ; pos < offset + nRead; ++pos) {
-        // skip null positions
-        if (notNull && !notNull[pos]) {
-          continue;
-        }
-        prevValue = data[pos] = prevValue - data[pos];
-      }
+      addDeltas<true>(values + done, count - done, prevValue);
     } else {
-      for ( ; pos < offset + nRead; ++pos) {
-        // skip null positions
-        if (notNull && !notNull[pos]) {
-          continue;
-        }
-        prevValue = data[pos] = prevValue + data[pos];
-      }
+      addDeltas<false>(values + done, count - done, prevValue);
     }
   }
+  runRead += count - done;
+  if (count > 0) {
+    prevValue = values[count - 1];
+  }
+
+  if (notNull) {
+    spreadNonNulls(values, nRead, count, notNull + offset);
+  }
   return nRead;
 }
 
@@ -20,6 +20,7 @@
 #define ORC_RLEV2_HH
 
 #include "orc/Adaptor.hh"
+#include "InputCursor.hh"
 #include "RLE.hh"
 #include "Exceptions.hh"
 
@@ -53,6 +54,32 @@ public:
 
 private:
 
+  EncodingType getEncoding() const {
+    return static_cast<EncodingType>((firstByte >> 6) & 0x03);
+  }
+
+  /**
+   * Read the header of the next run.
+   */
+  void readRunHeader();
+
+  /**
+   * Read the values and the patch list of a PATCHED_BASE run after its
+   * header.
+   */
+  void unpackPatched();
+
+  /**
+   * Move past the rest of a run whose header was just read, without
+   * decoding its values.
+   */
+  void skipRun();
+
+  /**
+   * Move past count values of the current PATCHED_BASE run.
+   */
+  void skipPatched(uint64_t count);
+
   // Used by PATCHED_BASE
   void adjustGapAndPatch() {
     curGap = static_cast<uint64_t>(unpackedPatch[patchIdx]) >>
@@ -84,33 +111,17 @@ private:
   }
 
   unsigned char readByte() {
-  if (bufferStart == bufferEnd) {
-    int bufferLength;
-    const void* bufferPointer;
-    if (!inputStream->Next(&bufferPointer, &bufferLength)) {
-      throw ParseError("bad read in RleDecoderV2::readByte");
-    }
-    bufferStart = static_cast<const char*>(bufferPointer);
-    bufferEnd = bufferStart + bufferLength;
+    return cursor.readByte();
   }
 
-  unsigned char result = static_cast<unsigned char>(*bufferStart++);
-  return result;
-}
-
   int64_t readLongBE(uint64_t bsz);
   int64_t readVslong();
   uint64_t readVulong();
-  uint64_t readLongs(int64_t *data, uint64_t offset, uint64_t len,
-                     uint64_t fb, const char* notNull = nullptr) {
-  uint64_t ret = 0;
 
-  // TODO: unroll to improve performance
-  for(uint64_t i = offset; i < (offset + len); i++) {
-    // skip null positions
-    if (notNull && !notNull[i]) {
-      continue;
-    }
+  /**
+   * Read the next value of width fb from the bits after the last one.
+   */
+  uint64_t readLong(uint64_t fb) {
     uint64_t result = 0;
     uint64_t bitsLeftToRead = fb;
     while (bitsLeftToRead > bitsLeft) {
@@ -127,13 +138,32 @@ private:
       bitsLeft -= static_cast<uint32_t>(bitsLeftToRead);
       result |= (curByte >> bitsLeft) & ((1 << bitsLeftToRead) - 1);
     }
-    data[i] = static_cast<int64_t>(result);
-    ++ret;
+    return result;
   }
 
-  return ret;
-}
+  /**
+   * Read the next count values of width fb into consecutive positions.
+   */
+  void unpackLongs(int64_t* data, uint64_t count, uint64_t fb);
 
+  /**
+   * Move past the next count values of width fb.
+   */
+  void skipLongs(uint64_t count, uint64_t fb);
+
+  uint64_t readLongs(int64_t *data, uint64_t offset, uint64_t len,
+                     uint64_t fb, const char* notNull = nullptr) {
+    if (notNull == nullptr) {
+      unpackLongs(data + offset, len, fb);
+      return len;
+    }
+    // only the non-null positions have values, so unpack them together
+    // and then move each one to its position
+    uint64_t count = countNonNulls(notNull + offset, len);
+    unpackLongs(data + offset, count, fb);
+    spreadNonNulls(data + offset, len, count, notNull + offset);
+    return count;
+  }
 
   uint64_t nextShortRepeats(int64_t* data, uint64_t offset, uint64_t numValues,
                             const char* notNull);
@@ -146,12 +176,11 @@ private:
 
   const std::unique_ptr<SeekableInputStream> inputStream;
   const bool isSigned;
+  InputCursor cursor;
 
   unsigned char firstByte;
   uint64_t runLength;
   uint64_t runRead;
-  const char *bufferStart;
-  const char *bufferEnd;
   int64_t deltaBase; // Used by DELTA
   uint64_t byteSize; // Used by SHORT_REPEAT and PATCHED_BASE
   int64_t firstValue; // Used by SHORT_REPEAT and DELTA
@@ -160,6 +189,8 @@ private:
   uint32_t bitsLeft; // Used by anything that uses readLongs
   uint32_t curByte; // Used by anything that uses readLongs
   uint32_t patchBitSize; // Used by PATCHED_BASE
+  uint32_t patchEntryBitSize; // Used by PATCHED_BASE
+  uint64_t patchLength; // Used by PATCHED_BASE
   uint64_t unpackedIdx; // Used by PATCHED_BASE
   uint64_t patchIdx; // Used by PATCHED_BASE
   int64_t base; // Used by PATCHED_BASE
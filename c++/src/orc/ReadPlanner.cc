@@ -0,0 +1,112 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "ReadPlanner.hh"
+#include "Exceptions.hh"
+
+#include <algorithm>
+
+namespace orc {
+
+  static bool compareRanges(const ReadRange& left, const ReadRange& right) {
+    return left.offset < right.offset;
+  }
+
+  std::vector<ReadRange> coalesceRanges(std::vector<ReadRange> ranges,
+                                        uint64_t maxGap) {
+    std::vector<ReadRange> result;
+    std::sort(ranges.begin(), ranges.end(), compareRanges);
+    for(std::vector<ReadRange>::const_iterator itr = ranges.begin();
+        itr != ranges.end(); ++itr) {
+      if (itr->length == 0) {
+        continue;
+      }
+      if (!result.empty() &&
+          (itr->offset <= result.back().end() ||
+           itr->offset - result.back().end() <= maxGap)) {
+        ReadRange& last = result.back();
+        last.length = std::max(last.end(), itr->end()) - last.offset;
+      } else {
+        result.push_back(*itr);
+      }
+    }
+    return result;
+  }
+
+  ReadPlan::ReadPlan(const std::vector<ReadRange>& ranges,
+                     uint64_t maxGap
+                     ): reads(coalesceRanges(ranges, maxGap)) {
+    // PASS
+  }
+
+  ReadPlan::~ReadPlan() {
+    for(size_t i=0; i < buffers.size(); ++i) {
+      delete buffers[i];
+    }
+  }
+
+  const std::vector<ReadRange>& ReadPlan::getReads() const {
+    return reads;
+  }
+
+  uint64_t ReadPlan::getTotalLength() const {
+    uint64_t total = 0;
+    for(size_t i=0; i < reads.size(); ++i) {
+      total += reads[i].length;
+    }
+    return total;
+  }
+
+  void ReadPlan::execute(InputStream& input) {
+    if (isExecuted()) {
+      throw std::logic_error("ReadPlan executed twice");
+    }
+    // let the stream start fetching all of the ranges before we block
+    for(size_t i=0; i < reads.size(); ++i) {
+      input.willNeed(reads[i].offset, reads[i].length);
+    }
+    buffers = input.readRanges(reads);
+    if (buffers.size() != reads.size()) {
+      throw ParseError("Wrong number of buffers from " + input.getName());
+    }
+  }
+
+  bool ReadPlan::isExecuted() const {
+    return buffers.size() == reads.size() && !reads.empty();
+  }
+
+  const char* ReadPlan::find(uint64_t offset, uint64_t length) const {
+    if (buffers.size() != reads.size()) {
+      return nullptr;
+    }
+    // find the last read that starts at or before offset
+    std::vector<ReadRange>::const_iterator itr =
+      std::upper_bound(reads.begin(), reads.end(), ReadRange(offset, 0),
+                       compareRanges);
+    if (itr == reads.begin()) {
+      return nullptr;
+    }
+    --itr;
+    if (offset + length > itr->end()) {
+      return nullptr;
+    }
+    size_t index = static_cast<size_t>(itr - reads.begin());
+    return buffers[index]->getStart() + (offset - itr->offset);
+  }
+}
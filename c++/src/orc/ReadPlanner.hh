@@ -0,0 +1,95 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_READ_PLANNER_HH
+#define ORC_READ_PLANNER_HH
+
+#include "orc/Adaptor.hh"
+#include "orc/OrcFile.hh"
+
+#include <vector>
+
+namespace orc {
+
+  /**
+   * Sort the ranges and merge the ones that overlap or are separated by
+   * at most maxGap bytes. Empty ranges are dropped.
+   * @param ranges the ranges that need to be read
+   * @param maxGap the largest hole that is read through rather than
+   *    splitting the read
+   * @return the ranges to actually read, in file order
+   */
+  std::vector<ReadRange> coalesceRanges(std::vector<ReadRange> ranges,
+                                        uint64_t maxGap);
+
+  /**
+   * A plan to fetch a set of byte ranges using as few reads as possible.
+   * Once executed, the bytes for any of the requested ranges can be found
+   * in memory.
+   */
+  class ReadPlan {
+  private:
+    std::vector<ReadRange> reads;
+    std::vector<Buffer*> buffers;
+
+    // DELIBERATELY NOT IMPLEMENTED
+    ReadPlan(const ReadPlan&);
+    ReadPlan& operator=(const ReadPlan&);
+
+  public:
+    /**
+     * Create a plan for the given ranges.
+     * @param ranges the byte ranges that will be looked up after execution
+     * @param maxGap the largest hole between two ranges that is read
+     *    through
+     */
+    ReadPlan(const std::vector<ReadRange>& ranges, uint64_t maxGap);
+    ~ReadPlan();
+
+    /**
+     * Get the coalesced reads that this plan will issue.
+     */
+    const std::vector<ReadRange>& getReads() const;
+
+    /**
+     * Get the total number of bytes that this plan will read.
+     */
+    uint64_t getTotalLength() const;
+
+    /**
+     * Issue the reads against the given stream as a single vectored read.
+     * The stream is told about all of the reads before they are made.
+     */
+    void execute(InputStream& input);
+
+    /**
+     * Has the plan been executed?
+     */
+    bool isExecuted() const;
+
+    /**
+     * Find the bytes of a range after the plan has been executed.
+     * @param offset the file offset of the range
+     * @param length the length of the range
+     * @return a pointer to the bytes or nullptr if the range isn't covered
+     */
+    const char* find(uint64_t offset, uint64_t length) const;
+  };
+}
+
+#endif
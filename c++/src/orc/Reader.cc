@@ -19,16 +19,25 @@
 #include "orc/Adaptor.hh"
 #include "orc/Reader.hh"
 #include "orc/OrcFile.hh"
+#include "ChunkCache.hh"
 #include "ColumnReader.hh"
 #include "Exceptions.hh"
+#include "MetadataCache.hh"
+#include "ParallelDecompression.hh"
+#include "ReadPlanner.hh"
 #include "RLE.hh"
+#include "StripePrefetcher.hh"
+#include "ThreadPool.hh"
 #include "TypeImpl.hh"
 #include "orc/Int128.hh"
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -44,6 +53,17 @@ namespace orc {
     int32_t forcedScaleOnHive11Decimal;
     std::ostream* errorStream;
     MemoryPool* memoryPool;
+    uint64_t readCoalescingGap;
+    uint64_t prefetchDepth;
+    uint64_t prefetchMemoryLimit;
+    uint64_t decompressionThreads;
+    uint64_t decompressionWindow;
+    ChunkCache* chunkCache;
+    uint64_t tailReadSize;
+    uint64_t tailLengthHint;
+    bool learnTailSize;
+    std::string serializedTail;
+    bool useMetadataCache;
 
     ReaderOptionsPrivate() {
       includedColumns.assign(1,0);
@@ -54,6 +74,16 @@ namespace orc {
       forcedScaleOnHive11Decimal = 6;
       errorStream = &std::cerr;
       memoryPool = getDefaultPool();
+      readCoalescingGap = 1024 * 1024;
+      prefetchDepth = 0;
+      prefetchMemoryLimit = 256 * 1024 * 1024;
+      decompressionThreads = 0;
+      decompressionWindow = 8;
+      chunkCache = nullptr;
+      tailReadSize = 16 * 1024;
+      tailLengthHint = 0;
+      learnTailSize = false;
+      useMetadataCache = false;
     }
   };
 
@@ -162,6 +192,106 @@ namespace orc {
     return privateBits->errorStream;
   }
 
+  ReaderOptions& ReaderOptions::setReadCoalescingGap(uint64_t gap) {
+    privateBits->readCoalescingGap = gap;
+    return *this;
+  }
+
+  uint64_t ReaderOptions::getReadCoalescingGap() const {
+    return privateBits->readCoalescingGap;
+  }
+
+  ReaderOptions& ReaderOptions::setPrefetchDepth(uint64_t depth) {
+    privateBits->prefetchDepth = depth;
+    return *this;
+  }
+
+  uint64_t ReaderOptions::getPrefetchDepth() const {
+    return privateBits->prefetchDepth;
+  }
+
+  ReaderOptions& ReaderOptions::setPrefetchMemoryLimit(uint64_t bytes) {
+    privateBits->prefetchMemoryLimit = bytes;
+    return *this;
+  }
+
+  uint64_t ReaderOptions::getPrefetchMemoryLimit() const {
+    return privateBits->prefetchMemoryLimit;
+  }
+
+  ReaderOptions& ReaderOptions::setDecompressionThreads(uint64_t threads) {
+    privateBits->decompressionThreads = threads;
+    return *this;
+  }
+
+  uint64_t ReaderOptions::getDecompressionThreads() const {
+    return privateBits->decompressionThreads;
+  }
+
+  ReaderOptions& ReaderOptions::setDecompressionWindow(uint64_t chunks) {
+    privateBits->decompressionWindow = chunks;
+    return *this;
+  }
+
+  uint64_t ReaderOptions::getDecompressionWindow() const {
+    return privateBits->decompressionWindow;
+  }
+
+  ReaderOptions& ReaderOptions::setChunkCache(ChunkCache& cache) {
+    privateBits->chunkCache = &cache;
+    return *this;
+  }
+
+  ChunkCache* ReaderOptions::getChunkCache() const {
+    return privateBits->chunkCache;
+  }
+
+  ReaderOptions& ReaderOptions::setTailReadSize(uint64_t size) {
+    privateBits->tailReadSize = size;
+    return *this;
+  }
+
+  uint64_t ReaderOptions::getTailReadSize() const {
+    return privateBits->tailReadSize;
+  }
+
+  ReaderOptions& ReaderOptions::setTailLengthHint(uint64_t length) {
+    privateBits->tailLengthHint = length;
+    return *this;
+  }
+
+  uint64_t ReaderOptions::getTailLengthHint() const {
+    return privateBits->tailLengthHint;
+  }
+
+  ReaderOptions& ReaderOptions::setLearnTailSize(bool learn) {
+    privateBits->learnTailSize = learn;
+    return *this;
+  }
+
+  bool ReaderOptions::getLearnTailSize() const {
+    return privateBits->learnTailSize;
+  }
+
+  ReaderOptions& ReaderOptions::setSerializedFileTail(const std::string&
+                                                      serialization) {
+    privateBits->serializedTail = serialization;
+    return *this;
+  }
+
+  std::string ReaderOptions::getSerializedFileTail() const {
+    return privateBits->serializedTail;
+  }
+
+  ReaderOptions& ReaderOptions::setUseMetadataCache(bool useCache) {
+    privateBits->useMetadataCache = useCache;
+    return *this;
+  }
+
+  bool ReaderOptions::getUseMetadataCache() const {
+    return privateBits->useMetadataCache;
+  }
+
   StripeInformation::~StripeInformation() {
 
   }
@@ -833,33 +963,143 @@ namespace orc {
     // PASS
   }
 
-  static const uint64_t DIRECTORY_SIZE_GUESS = 16 * 1024;
+  // the postscript and its length byte always fit in this many bytes
+  static const uint64_t MAX_POSTSCRIPT_SIZE = 256;
 
-  class ReaderImpl : public Reader {
+  /**
+   * The longest file tail that has been seen in each directory.
+   */
+  class TailSizeCache {
+  private:
+    std::mutex mutex;
+    std::map<std::string, uint64_t> sizes;
+
+    static std::string getDirectory(const std::string& filename) {
+      size_t slash = filename.rfind('/');
+      return slash == std::string::npos ? "" : filename.substr(0, slash);
+    }
+
+  public:
+    uint64_t get(const std::string& filename) {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::map<std::string, uint64_t>::const_iterator itr =
+        sizes.find(getDirectory(filename));
+      return itr == sizes.end() ? 0 : itr->second;
+    }
+
+    void learn(const std::string& filename, uint64_t tailLength) {
+      std::lock_guard<std::mutex> lock(mutex);
+      uint64_t& size = sizes[getDirectory(filename)];
+      size = std::max(size, tailLength);
+    }
+  };
+
+  static uint64_t getCompressionBlockSize(const proto::PostScript& ps) {
+    if (ps.has_compressionblocksize()) {
+      return ps.compressionblocksize();
+    } else {
+      return 256 * 1024;
+    }
+  }
+
+  static TailSizeCache& getTailSizeCache() {
+    static TailSizeCache cache;
+    return cache;
+  }
+
+  /**
+   * An InputStream that passes requests through to another stream and
+   * counts them. The counts may be updated from the prefetching thread.
+   */
+  class CountingInputStream: public InputStream {
+  private:
+    std::unique_ptr<InputStream> input;
+    std::atomic<uint64_t> readCount;
+    std::atomic<uint64_t> bytesRead;
+
+  public:
+    CountingInputStream(std::unique_ptr<InputStream> _input
+                        ): input(std::move(_input)),
+                           readCount(0),
+                           bytesRead(0) {
+      // PASS
+    }
+
+    ~CountingInputStream();
+
+    uint64_t getLength() const override {
+      return input->getLength();
+    }
+
+    Buffer* read(uint64_t offset,
+                 uint64_t length,
+                 Buffer* buffer) override {
+      readCount += 1;
+      bytesRead += length;
+      return input->read(offset, length, buffer);
+    }
+
+    void willNeed(uint64_t offset, uint64_t length) override {
+      input->willNeed(offset, length);
+    }
+
+    std::vector<Buffer*> readRanges(const std::vector<ReadRange>& ranges
+                                    ) override {
+      for(size_t i=0; i < ranges.size(); ++i) {
+        readCount += 1;
+        bytesRead += ranges[i].length;
+      }
+      return input->readRanges(ranges);
+    }
+
+    uint64_t getModificationTime() const override {
+      return input->getModificationTime();
+    }
+
+    const std::string& getName() const override {
+      return input->getName();
+    }
+
+    uint64_t getReadCount() const {
+      return readCount;
+    }
+
+    uint64_t getBytesRead() const {
+      return bytesRead;
+    }
+  };
+
+  CountingInputStream::~CountingInputStream() {
+    // PASS
+  }
+
+  class ReaderImpl : public Reader, public StripeLoader {
   private:
     // inputs
-    std::unique_ptr<InputStream> stream;
+    std::unique_ptr<CountingInputStream> stream;
     ReaderOptions options;
     std::vector<bool> selectedColumns;
 
     // custom memory pool
     MemoryPool& memoryPool;
 
+    // the parsed tail, which may be shared with other readers
+    std::shared_ptr<const FileTailContents> tail;
+
     // postscript
-    proto::PostScript postscript;
+    const proto::PostScript& postscript;
     uint64_t blockSize;
     CompressionKind compression;
-    uint64_t postscriptLength;
 
     // footer
-    proto::Footer footer;
+    const proto::Footer& footer;
     DataBuffer<uint64_t> firstRowOfStripe;
     uint64_t numberOfStripes;
-    std::unique_ptr<Type> schema;
+    const Type& schema;
 
     // metadata
     bool isMetadataLoaded;
-    proto::Metadata metadata;
+    const proto::Metadata& metadata;
     uint64_t numberOfStripeStatistics;
 
     // reading state
@@ -870,15 +1110,35 @@ namespace orc {
     uint64_t currentRowInStripe;
     uint64_t rowsInCurrentStripe;
     proto::StripeInformation currentStripeInfo;
-    proto::StripeFooter currentStripeFooter;
+    std::unique_ptr<LoadedStripe> currentStripeData;
+    // the column readers' streams may have chunks queued on these threads
+    std::shared_ptr<ThreadPool> decompressionThreads;
+    // where the decompressed chunks are shared, if they are
+    ChunkCache* chunkCache;
+    std::string chunkCacheFile;
     std::unique_ptr<ColumnReader> reader;
+    DecompressionCounters decompressionCounters;
+
+    // must be destroyed before the state that it loads from
+    std::unique_ptr<StripePrefetcher> prefetcher;
 
     // internal methods
-    void readPostscript(Buffer *buffer);
-    void readFooter(Buffer *&buffer, uint64_t fileLength);
-    proto::StripeFooter getStripeFooter(const proto::StripeInformation& info);
+    std::shared_ptr<const FileTailContents> loadFileTail();
+    void readFileTail(FileTailContents& contents, uint64_t fileLength);
+    void useFileTail(FileTailContents& contents,
+                     const std::string& serialization,
+                     uint64_t fileLength);
+    void readPostscript(FileTailContents& contents, Buffer *buffer);
+    void readFooter(FileTailContents& contents,
+                    Buffer *buffer,
+                    uint64_t fileLength);
+    proto::StripeFooter getStripeFooter(const proto::StripeInformation& info
+                                        ) const;
+    std::unique_ptr<ReadPlan> planStripeReads
+      (const proto::StripeInformation& info,
+       const proto::StripeFooter& stripeFooter) const;
     void startNextStripe();
-    void ensureOrcFooter(Buffer * buffer);
+    void ensureOrcFooter(Buffer * buffer, uint64_t postscriptLength);
     void checkOrcVersion();
     void selectTypeParent(size_t columnId);
     void selectTypeChildren(size_t columnId);
@@ -949,35 +1209,74 @@ namespace orc {
     MemoryPool* getMemoryPool() const ;
 
     bool hasCorrectStatistics() const override;
+
+    uint64_t getReadCount() const override;
+
+    uint64_t getBytesRead() const override;
+
+    uint64_t getBytesDecompressed() const override;
+
+    uint64_t getBytesCopied() const override;
+
+    uint64_t getBytesPassedThrough() const override;
+
+    uint64_t getFileTailLength() const override;
+
+    std::string getSerializedFileTail() const override;
+
+    uint64_t getLoadedSize(uint64_t stripeIndex) const override;
+
+    std::unique_ptr<LoadedStripe> loadStripe(uint64_t stripeIndex
+                                             ) const override;
   };
 
   InputStream::~InputStream() {
     // PASS
   };
 
+  void InputStream::willNeed(uint64_t, uint64_t) {
+    // PASS
+  }
+
+  std::vector<Buffer*> InputStream::readRanges(const std::vector<ReadRange>&
+                                               ranges) {
+    std::vector<Buffer*> result;
+    result.reserve(ranges.size());
+    try {
+      for(size_t i=0; i < ranges.size(); ++i) {
+        result.push_back(read(ranges[i].offset, ranges[i].length, nullptr));
+      }
+    } catch (...) {
+      for(size_t i=0; i < result.size(); ++i) {
+        delete result[i];
+      }
+      throw;
+    }
+    return result;
+  }
+
+  uint64_t InputStream::getModificationTime() const {
+    return 0;
+  }
+
   ReaderImpl::ReaderImpl(std::unique_ptr<InputStream> input,
                          const ReaderOptions& opts
-                         ): stream(std::move(input)),
+                         ): stream(new CountingInputStream(std::move(input))),
                             options(opts),
                             memoryPool(*opts.getMemoryPool()),
-                            firstRowOfStripe(memoryPool, 0) {
+                            tail(loadFileTail()),
+                            postscript(tail->postscript),
+                            footer(tail->footer),
+                            firstRowOfStripe(memoryPool, 0),
+                            schema(*tail->schema),
+                            metadata(tail->metadata) {
     isMetadataLoaded = false;
-    // figure out the size of the file using the option or filesystem
-    uint64_t size = std::min(options.getTailLocation(),
-                                  static_cast<uint64_t>
-                                  (stream->getLength()));
-
-    //read last bytes into buffer to get PostScript
-    uint64_t readSize = std::min(size, DIRECTORY_SIZE_GUESS);
-
-    if (readSize < 1) {
-      throw ParseError("File size too small");
-    }
-
-    Buffer *buffer = stream->read(size - readSize, readSize, nullptr);
-    readPostscript(buffer);
-    readFooter(buffer, size);
-    delete buffer;
+    blockSize = getCompressionBlockSize(postscript);
+    compression = static_cast<CompressionKind>(postscript.compression());
+    checkOrcVersion();
+    numberOfStripes = static_cast<uint64_t>(footer.stripes_size());
+    numberOfStripeStatistics =
+      static_cast<uint64_t>(metadata.stripestats_size());
 
     currentStripe = static_cast<uint64_t>(footer.stripes_size());
     lastStripe = 0;
@@ -1011,8 +1310,6 @@ namespace orc {
       previousRow = firstRowOfStripe[firstStripe]-1;
     }
 
-    schema = convertType(footer.types(0), footer);
-    schema->assignIds(0);
     previousRow = (std::numeric_limits<uint64_t>::max)();
 
     selectedColumns.assign(static_cast<size_t>(footer.types_size()), false);
@@ -1020,11 +1317,26 @@ namespace orc {
     const std::list<int64_t>& included = options.getInclude();
     for(std::list<int64_t>::const_iterator columnId = included.begin();
         columnId != included.end(); ++columnId) {
-      if (*columnId <= static_cast<int64_t>(schema->getSubtypeCount())) {
+      if (*columnId <= static_cast<int64_t>(schema.getSubtypeCount())) {
         selectTypeParent(static_cast<size_t>(*columnId));
         selectTypeChildren(static_cast<size_t>(*columnId));
       }
     }
+
+    if (options.getDecompressionThreads() > 0 &&
+        compression != CompressionKind_NONE) {
+      decompressionThreads =
+        getSharedThreadPool(options.getDecompressionThreads());
+    }
+    chunkCache = options.getChunkCache();
+    if (chunkCache != nullptr && compression != CompressionKind_NONE) {
+      chunkCacheFile =
+        MetadataCacheImpl::makeKey(stream->getName(), stream->getLength(),
+                                   stream->getModificationTime());
+    }
+    if (chunkCacheFile.empty()) {
+      chunkCache = nullptr;
+    }
   }
 
   const ReaderOptions& ReaderImpl::getReaderOptions() const {
@@ -1144,7 +1456,8 @@ namespace orc {
     }
   }
 
-  void ReaderImpl::ensureOrcFooter(Buffer *buffer) {
+  void ReaderImpl::ensureOrcFooter(Buffer *buffer,
+                                   uint64_t postscriptLength) {
 
     const std::string MAGIC("ORC");
     const uint64_t magicLength = MAGIC.length();
@@ -1175,7 +1488,7 @@ namespace orc {
   }
 
   const Type& ReaderImpl::getType() const {
-    return *(schema.get());
+    return schema;
   }
 
   uint64_t ReaderImpl::getRowNumber() const {
@@ -1259,91 +1572,235 @@ namespace orc {
     return postscript.has_writerversion() && postscript.writerversion();
   }
 
-  void ReaderImpl::readPostscript(Buffer *buffer) {
-    char *ptr = buffer->getStart();
-    uint64_t readSize = buffer->getLength();
-    postscriptLength = ptr[readSize - 1] & 0xff;
+  uint64_t ReaderImpl::getReadCount() const {
+    return stream->getReadCount();
+  }
+
+  uint64_t ReaderImpl::getBytesRead() const {
+    return stream->getBytesRead();
+  }
 
-    ensureOrcFooter(buffer);
+  uint64_t ReaderImpl::getBytesDecompressed() const {
+    return decompressionCounters.decompressedBytes;
+  }
 
-    if (!postscript.ParseFromArray(ptr + readSize - 1 - postscriptLength,
-                                   static_cast<int>(postscriptLength))) {
-      throw ParseError("Failed to parse the postscript");
+  uint64_t ReaderImpl::getBytesCopied() const {
+    return decompressionCounters.copiedBytes;
+  }
+
+  uint64_t ReaderImpl::getBytesPassedThrough() const {
+    return decompressionCounters.passedThroughBytes;
+  }
+
+  uint64_t ReaderImpl::getFileTailLength() const {
+    return tail->getTailLength();
+  }
+
+  std::shared_ptr<const FileTailContents> ReaderImpl::loadFileTail() {
+    // figure out the size of the file using the option or filesystem
+    uint64_t size = std::min(options.getTailLocation(),
+                                  static_cast<uint64_t>
+                                  (stream->getLength()));
+
+    std::string key;
+    if (options.getUseMetadataCache()) {
+      key = MetadataCacheImpl::makeKey(stream->getName(), size,
+                                       stream->getModificationTime());
+      if (!key.empty()) {
+        std::shared_ptr<const FileTailContents> cached =
+          getMetadataCacheImpl().get(key);
+        if (cached) {
+          return cached;
+        }
+      }
     }
-    if (postscript.has_compressionblocksize()) {
-      blockSize = postscript.compressionblocksize();
+
+    std::shared_ptr<FileTailContents> contents(new FileTailContents());
+    std::string serializedTail = options.getSerializedFileTail();
+    if (serializedTail.empty()) {
+      readFileTail(*contents, size);
     } else {
-      blockSize = 256 * 1024;
+      useFileTail(*contents, serializedTail, size);
     }
+    if (contents->footer.types_size() == 0) {
+      throw ParseError("Footer has no types in " + stream->getName());
+    }
+    contents->schema = convertType(contents->footer.types(0),
+                                   contents->footer);
+    contents->schema->assignIds(0);
 
-    checkOrcVersion();
+    if (!key.empty()) {
+      getMetadataCacheImpl().put(key, contents);
+    }
+    return contents;
+  }
 
-    //check compression codec
-    compression = static_cast<CompressionKind>(postscript.compression());
+  void ReaderImpl::readFileTail(FileTailContents& contents,
+                                uint64_t fileLength) {
+    // pick how much of the tail to read with the first request
+    uint64_t tailGuess = options.getTailLengthHint();
+    if (tailGuess == 0) {
+      tailGuess = options.getTailReadSize();
+      if (options.getLearnTailSize()) {
+        tailGuess = std::max(tailGuess,
+                             getTailSizeCache().get(stream->getName()));
+      }
+    }
+
+    //read last bytes into buffer to get PostScript
+    uint64_t readSize = std::min(fileLength, std::max(tailGuess,
+                                                      MAX_POSTSCRIPT_SIZE));
+
+    if (readSize < 1) {
+      throw ParseError("File size too small");
+    }
+
+    Buffer *buffer = stream->read(fileLength - readSize, readSize, nullptr);
+    try {
+      readPostscript(contents, buffer);
+      readFooter(contents, buffer, fileLength);
+    } catch (...) {
+      delete buffer;
+      throw;
+    }
+    delete buffer;
+    contents.fileLength = fileLength;
+    if (options.getLearnTailSize()) {
+      getTailSizeCache().learn(stream->getName(), contents.getTailLength());
+    }
+  }
+
+  void ReaderImpl::useFileTail(FileTailContents& contents,
+                               const std::string& serialization,
+                               uint64_t fileLength) {
+    proto::FileTail fileTail;
+    if (!fileTail.ParseFromString(serialization)) {
+      throw ParseError("Failed to parse the file tail");
+    }
+    if (fileTail.filelength() != fileLength) {
+      std::ostringstream msg;
+      msg << "File tail is for a file of " << fileTail.filelength()
+          << " bytes, but " << stream->getName() << " has " << fileLength;
+      throw ParseError(msg.str());
+    }
+    contents.postscript.Swap(fileTail.mutable_postscript());
+    contents.footer.Swap(fileTail.mutable_footer());
+    contents.metadata.Swap(fileTail.mutable_metadata());
+    contents.postscriptLength = fileTail.postscriptlength();
+    contents.fileLength = fileLength;
+  }
+
+  std::string ReaderImpl::getSerializedFileTail() const {
+    proto::FileTail fileTail;
+    *fileTail.mutable_postscript() = postscript;
+    *fileTail.mutable_footer() = footer;
+    *fileTail.mutable_metadata() = metadata;
+    fileTail.set_filelength(tail->fileLength);
+    fileTail.set_postscriptlength(tail->postscriptLength);
+    std::string result;
+    if (!fileTail.SerializeToString(&result)) {
+      throw ParseError("Failed to serialize the file tail");
+    }
+    return result;
+  }
+
+  void ReaderImpl::readPostscript(FileTailContents& contents,
+                                  Buffer *buffer) {
+    char *ptr = buffer->getStart();
+    uint64_t readSize = buffer->getLength();
+    uint64_t postscriptLength = ptr[readSize - 1] & 0xff;
+
+    if (postscriptLength + 1 > readSize) {
+      throw ParseError("Invalid ORC postscript length");
+    }
+    ensureOrcFooter(buffer, postscriptLength);
+
+    if (!contents.postscript.ParseFromArray(ptr + readSize - 1 -
+                                            postscriptLength,
+                                            static_cast<int>
+                                            (postscriptLength))) {
+      throw ParseError("Failed to parse the postscript");
+    }
+    contents.postscriptLength = postscriptLength;
   }
 
-  void ReaderImpl::readFooter(Buffer *&buffer, uint64_t fileLength) {
+  void ReaderImpl::readFooter(FileTailContents& contents,
+                              Buffer *buffer,
+                              uint64_t fileLength) {
     uint64_t readSize = buffer->getLength();
-    uint64_t footerSize = postscript.footerlength();
-    uint64_t metadataSize = postscript.metadatalength();
-    uint64_t tailSize = 1 + postscriptLength + footerSize + metadataSize;
+    uint64_t footerSize = contents.postscript.footerlength();
+    uint64_t metadataSize = contents.postscript.metadatalength();
+    uint64_t tailSize = contents.getTailLength();
+    CompressionKind kind =
+      static_cast<CompressionKind>(contents.postscript.compression());
+    uint64_t compressionBlockSize =
+      getCompressionBlockSize(contents.postscript);
     char *metadataStart;
     char *footerStart;
+    DataBuffer<char> tailBuffer(memoryPool, 0);
 
+    if (tailSize > fileLength) {
+      throw ParseError("Invalid ORC tail length");
+    }
     if (tailSize > readSize) {
-      buffer = stream->read(fileLength - tailSize,
-                            metadataSize + footerSize, buffer);
-      metadataStart = buffer->getStart();
+      // only read the start of the tail that we don't already have
+      uint64_t missing = tailSize - readSize;
+      std::unique_ptr<Buffer> prefix(stream->read(fileLength - tailSize,
+                                                  missing, nullptr));
+      tailBuffer.resize(metadataSize + footerSize);
+      memcpy(tailBuffer.data(), prefix->getStart(), missing);
+      memcpy(tailBuffer.data() + missing, buffer->getStart(),
+             metadataSize + footerSize - missing);
+      metadataStart = tailBuffer.data();
     } else {
       metadataStart = buffer->getStart() + (readSize - tailSize);
     }
     footerStart = metadataStart + metadataSize;
     std::unique_ptr<SeekableInputStream> pbStream =
-      createDecompressor(compression,
+      createDecompressor(kind,
                          std::unique_ptr<SeekableInputStream>
                          (new SeekableArrayInputStream(footerStart,
                                                        footerSize)),
-                         blockSize,
+                         compressionBlockSize,
                          memoryPool);
-    if (!footer.ParseFromZeroCopyStream(pbStream.get())) {
+    if (!contents.footer.ParseFromZeroCopyStream(pbStream.get())) {
       throw ParseError("Failed to parse the footer");
     }
 
-    numberOfStripes = static_cast<uint64_t>(footer.stripes_size());
     pbStream =
-      createDecompressor(compression,
+      createDecompressor(kind,
                          std::unique_ptr<SeekableInputStream>
                          (new SeekableArrayInputStream(metadataStart,
                                                        metadataSize)),
-                         blockSize,
+                         compressionBlockSize,
                          memoryPool);
-    if (!metadata.ParseFromZeroCopyStream(pbStream.get())) {
+    if (!contents.metadata.ParseFromZeroCopyStream(pbStream.get())) {
       throw ParseError("Failed to parse the metadata");
     }
-    numberOfStripeStatistics =
-      static_cast<uint64_t>(metadata.stripestats_size());
   }
 
   proto::StripeFooter ReaderImpl::getStripeFooter
-  (const proto::StripeInformation& info) {
+  (const proto::StripeInformation& info) const {
     uint64_t footerStart = info.offset() + info.indexlength() +
       info.datalength();
     uint64_t footerLength = info.footerlength();
+    ReadPlan footerRead(std::vector<ReadRange>
+                        (1, ReadRange(footerStart, footerLength)), 0);
+    footerRead.execute(*stream);
+    const char* footerBytes = footerRead.find(footerStart, footerLength);
     std::unique_ptr<SeekableInputStream> pbStream =
       createDecompressor(compression,
                          std::unique_ptr<SeekableInputStream>
-                         (new SeekableFileInputStream(stream.get(),
-                                                      footerStart,
-                                                      footerLength,
-                                                      static_cast<int64_t>
-                                                      (blockSize)
-                                                      )),
+                         (new SeekableArrayInputStream(footerBytes,
+                                                       footerLength)),
                          blockSize,
                          memoryPool);
     proto::StripeFooter result;
     if (!result.ParseFromZeroCopyStream(pbStream.get())) {
-      throw ParseError(std::string("bad StripeFooter from ") +
-                       pbStream->getName());
+      std::ostringstream msg;
+      msg << "bad StripeFooter from " << stream->getName() << " at "
+          << footerStart << " for " << footerLength;
+      throw ParseError(msg.str());
     }
     return result;
   }
@@ -1354,14 +1811,24 @@ namespace orc {
     const proto::StripeFooter& footer;
     const uint64_t stripeStart;
     InputStream& input;
+    const ReadPlan* readPlan;
     MemoryPool& memoryPool;
+    DecompressionCounters& counters;
+    ThreadPool* decompressionThreads;
+    ChunkCache* chunkCache;
+    const std::string& chunkCacheFile;
 
   public:
     StripeStreamsImpl(const ReaderImpl& reader,
                       const proto::StripeFooter& footer,
                       uint64_t stripeStart,
                       InputStream& input,
-                      MemoryPool& memoryPool);
+                      const ReadPlan* readPlan,
+                      MemoryPool& memoryPool,
+                      DecompressionCounters& counters,
+                      ThreadPool* decompressionThreads,
+                      ChunkCache* chunkCache,
+                      const std::string& chunkCacheFile);
 
     virtual ~StripeStreamsImpl();
 
@@ -1383,12 +1850,23 @@ namespace orc {
                                        const proto::StripeFooter& _footer,
                                        uint64_t _stripeStart,
                                        InputStream& _input,
-                                       MemoryPool& _memoryPool
+                                       const ReadPlan* _readPlan,
+                                       MemoryPool& _memoryPool,
+                                       DecompressionCounters& _counters,
+                                       ThreadPool* _decompressionThreads,
+                                       ChunkCache* _chunkCache,
+                                       const std::string& _chunkCacheFile
                                        ): reader(_reader),
                                           footer(_footer),
                                           stripeStart(_stripeStart),
                                           input(_input),
-                                          memoryPool(_memoryPool) {
+                                          readPlan(_readPlan),
+                                          memoryPool(_memoryPool),
+                                          counters(_counters),
+                                          decompressionThreads
+                                            (_decompressionThreads),
+                                          chunkCache(_chunkCache),
+                                          chunkCacheFile(_chunkCacheFile) {
     // PASS
   }
 
@@ -1408,6 +1886,21 @@ namespace orc {
     return footer.columns(static_cast<int>(columnId));
   }
 
+  /**
+   * Does the compressed stream continue past its first chunk?
+   */
+  static bool hasSeveralChunks(const char* bytes, uint64_t length) {
+    if (length < 3) {
+      return false;
+    }
+    const unsigned char* header =
+      reinterpret_cast<const unsigned char*>(bytes);
+    uint64_t firstChunk = (header[0] |
+                           (static_cast<uint64_t>(header[1]) << 8) |
+                           (static_cast<uint64_t>(header[2]) << 16)) >> 1;
+    return 3 + firstChunk < length;
+  }
+
   std::unique_ptr<SeekableInputStream>
   StripeStreamsImpl::getStream(int64_t columnId,
                                proto::Stream_Kind kind,
@@ -1418,18 +1911,51 @@ namespace orc {
       if (stream.has_kind() &&
           stream.kind() == kind &&
           stream.column() == static_cast<uint64_t>(columnId)) {
-        int64_t myBlock = static_cast<int64_t>(shouldStream ?
-                                         1024 * 1024 :
-                                         stream.length());
+        // use the bytes from the stripe's coalesced reads if we have them
+        const char* bytes = readPlan == nullptr ? nullptr :
+          readPlan->find(offset, stream.length());
+        ChunkCacheStream cacheStream;
+        cacheStream.cache = chunkCache;
+        cacheStream.file = chunkCacheFile;
+        cacheStream.streamOffset = offset;
+        const ChunkCacheStream* cacheLocation =
+          chunkCache == nullptr ? nullptr : &cacheStream;
+        // data streams with several chunks that are already in memory can
+        // have their chunks decompressed ahead of the column reader
+        if (bytes != nullptr && decompressionThreads != nullptr &&
+            (kind == proto::Stream_Kind_DATA ||
+             kind == proto::Stream_Kind_DICTIONARY_DATA) &&
+            hasSeveralChunks(bytes, stream.length())) {
+          return createParallelDecompressor(reader.getCompression(),
+                                            bytes,
+                                            stream.length(),
+                                            reader.getCompressionSize(),
+                                            memoryPool,
+                                            *decompressionThreads,
+                                            getReaderOptions()
+                                              .getDecompressionWindow(),
+                                            &counters,
+                                            cacheLocation);
+        }
+        std::unique_ptr<SeekableInputStream> rawStream;
+        if (bytes != nullptr) {
+          rawStream.reset(new SeekableArrayInputStream(bytes,
+                                                       stream.length()));
+        } else {
+          int64_t myBlock = static_cast<int64_t>(shouldStream ?
+                                                 1024 * 1024 :
+                                                 stream.length());
+          rawStream.reset(new SeekableFileInputStream(&input,
+                                                      offset,
+                                                      stream.length(),
+                                                      myBlock));
+        }
         return createDecompressor(reader.getCompression(),
-                                  std::unique_ptr<SeekableInputStream>
-                                  (new SeekableFileInputStream
-                                   (&input,
-                                    offset,
-                                    stream.length(),
-                                    myBlock)),
+                                  std::move(rawStream),
                                   reader.getCompressionSize(),
-                                  memoryPool);
+                                  memoryPool,
+                                  &counters,
+                                  cacheLocation);
       }
       offset += stream.length();
     }
@@ -1440,15 +1966,72 @@ namespace orc {
     return memoryPool;
   }
 
+  std::unique_ptr<ReadPlan> ReaderImpl::planStripeReads
+                    (const proto::StripeInformation& info,
+                     const proto::StripeFooter& stripeFooter) const {
+    std::vector<ReadRange> ranges;
+    uint64_t offset = info.offset();
+    for(int i = 0; i < stripeFooter.streams_size(); ++i) {
+      const proto::Stream& stream = stripeFooter.streams(i);
+      size_t column = static_cast<size_t>(stream.column());
+      // the column readers don't use the index streams
+      if (stream.has_kind() &&
+          stream.kind() != proto::Stream_Kind_ROW_INDEX &&
+          stream.kind() != proto::Stream_Kind_BLOOM_FILTER &&
+          column < selectedColumns.size() && selectedColumns[column]) {
+        ranges.push_back(ReadRange(offset, stream.length()));
+      }
+      offset += stream.length();
+    }
+    return std::unique_ptr<ReadPlan>
+      (new ReadPlan(ranges, options.getReadCoalescingGap()));
+  }
+
+  uint64_t ReaderImpl::getLoadedSize(uint64_t stripeIndex) const {
+    const proto::StripeInformation& info =
+      footer.stripes(static_cast<int>(stripeIndex));
+    return info.datalength() + info.footerlength();
+  }
+
+  std::unique_ptr<LoadedStripe> ReaderImpl::loadStripe(uint64_t stripeIndex
+                                                       ) const {
+    const proto::StripeInformation& info =
+      footer.stripes(static_cast<int>(stripeIndex));
+    std::unique_ptr<LoadedStripe> result(new LoadedStripe());
+    result->stripeIndex = stripeIndex;
+    result->footer = getStripeFooter(info);
+    result->reads = planStripeReads(info, result->footer);
+    result->reads->execute(*stream);
+    return result;
+  }
+
   void ReaderImpl::startNextStripe() {
+    // drop the old readers before the buffers that they point into
+    reader.reset();
     currentStripeInfo = footer.stripes(static_cast<int>(currentStripe));
-    currentStripeFooter = getStripeFooter(currentStripeInfo);
     rowsInCurrentStripe = currentStripeInfo.numberofrows();
-    StripeStreamsImpl stripeStreams(*this, currentStripeFooter,
+    if (options.getPrefetchDepth() > 0) {
+      if (prefetcher.get() == nullptr) {
+        prefetcher.reset(new StripePrefetcher(*this, currentStripe,
+                                              lastStripe,
+                                              options.getPrefetchDepth(),
+                                              options.getPrefetchMemoryLimit()
+                                              ));
+      }
+      currentStripeData = prefetcher->take(currentStripe);
+    } else {
+      currentStripeData = loadStripe(currentStripe);
+    }
+    StripeStreamsImpl stripeStreams(*this, currentStripeData->footer,
                                     currentStripeInfo.offset(),
                                     *(stream.get()),
-                                    memoryPool);
-    reader = buildReader(*(schema.get()), stripeStreams);
+                                    currentStripeData->reads.get(),
+                                    memoryPool,
+                                    decompressionCounters,
+                                    decompressionThreads.get(),
+                                    chunkCache,
+                                    chunkCacheFile);
+    reader = buildReader(schema, stripeStreams);
   }
 
   void ReaderImpl::checkOrcVersion() {
@@ -1570,7 +2153,7 @@ namespace orc {
 
   std::unique_ptr<ColumnVectorBatch> ReaderImpl::createRowBatch
                                               (uint64_t capacity) const {
-    return createRowBatch(*(schema.get()), capacity);
+    return createRowBatch(schema, capacity);
   }
 
   std::unique_ptr<Reader> createReader(std::unique_ptr<InputStream> stream,
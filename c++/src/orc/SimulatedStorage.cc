@@ -0,0 +1,254 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "orc/OrcFile.hh"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace orc {
+
+  SimulatedStorage::~SimulatedStorage() {
+    // PASS
+  }
+
+  class SimulatedStorageImpl: public SimulatedStorage {
+  private:
+    const uint64_t latency;
+    const uint64_t bandwidth;
+    const uint64_t maxConcurrency;
+    const std::chrono::steady_clock::time_point created;
+
+    mutable std::mutex mutex;
+    std::condition_variable connectionFreed;
+    uint64_t activeRequests;
+    std::vector<StorageRequest> requests;
+    uint64_t bytesRequested;
+
+  public:
+    SimulatedStorageImpl(uint64_t latency,
+                         uint64_t bandwidth,
+                         uint64_t maxConcurrency);
+    ~SimulatedStorageImpl();
+
+    uint64_t getLatency() const override;
+    uint64_t getBandwidth() const override;
+    uint64_t getMaxConcurrency() const override;
+    std::vector<StorageRequest> getRequests() const override;
+    uint64_t getRequestCount() const override;
+    uint64_t getBytesRequested() const override;
+    void clearRequests() override;
+
+    /**
+     * Get the microseconds since the storage was created.
+     */
+    uint64_t now() const;
+
+    /**
+     * Get the simulated time in microseconds to fetch the given bytes.
+     */
+    uint64_t getRequestTime(uint64_t length) const;
+
+    /**
+     * Wait until a connection is free and take it.
+     */
+    void acquireConnection();
+
+    /**
+     * Give back a connection and record the request that used it.
+     */
+    void releaseConnection(const StorageRequest& request);
+  };
+
+  SimulatedStorageImpl::SimulatedStorageImpl(uint64_t _latency,
+                                             uint64_t _bandwidth,
+                                             uint64_t _maxConcurrency
+                                             ): latency(_latency),
+                                                bandwidth(_bandwidth),
+                                                maxConcurrency
+                                                  (_maxConcurrency),
+                                                created(std::chrono::
+                                                        steady_clock::
+                                                        now()),
+                                                activeRequests(0),
+                                                bytesRequested(0) {
+    // PASS
+  }
+
+  SimulatedStorageImpl::~SimulatedStorageImpl() {
+    // PASS
+  }
+
+  uint64_t SimulatedStorageImpl::getLatency() const {
+    return latency;
+  }
+
+  uint64_t SimulatedStorageImpl::getBandwidth() const {
+    return bandwidth;
+  }
+
+  uint64_t SimulatedStorageImpl::getMaxConcurrency() const {
+    return maxConcurrency;
+  }
+
+  std::vector<StorageRequest> SimulatedStorageImpl::getRequests() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return requests;
+  }
+
+  uint64_t SimulatedStorageImpl::getRequestCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return requests.size();
+  }
+
+  uint64_t SimulatedStorageImpl::getBytesRequested() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytesRequested;
+  }
+
+  void SimulatedStorageImpl::clearRequests() {
+    std::lock_guard<std::mutex> lock(mutex);
+    requests.clear();
+    bytesRequested = 0;
+  }
+
+  uint64_t SimulatedStorageImpl::now() const {
+    return static_cast<uint64_t>
+      (std::chrono::duration_cast<std::chrono::microseconds>
+       (std::chrono::steady_clock::now() - created).count());
+  }
+
+  uint64_t SimulatedStorageImpl::getRequestTime(uint64_t length) const {
+    uint64_t result = latency;
+    if (bandwidth != 0) {
+      result += length * 1000000 / bandwidth;
+    }
+    return result;
+  }
+
+  void SimulatedStorageImpl::acquireConnection() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (maxConcurrency != 0 && activeRequests >= maxConcurrency) {
+      connectionFreed.wait(lock);
+    }
+    activeRequests += 1;
+  }
+
+  void SimulatedStorageImpl::releaseConnection(const StorageRequest&
+                                               request) {
+    std::lock_guard<std::mutex> lock(mutex);
+    activeRequests -= 1;
+    requests.push_back(request);
+    bytesRequested += request.length;
+    connectionFreed.notify_one();
+  }
+
+  std::shared_ptr<SimulatedStorage>
+      createSimulatedStorage(uint64_t latency,
+                             uint64_t bandwidth,
+                             uint64_t maxConcurrency) {
+    return std::shared_ptr<SimulatedStorage>
+      (new SimulatedStorageImpl(latency, bandwidth, maxConcurrency));
+  }
+
+  /**
+   * An InputStream that delays each read as if it came from the
+   * simulated storage.
+   */
+  class SimulatedInputStream: public InputStream {
+  private:
+    std::unique_ptr<InputStream> input;
+    std::shared_ptr<SimulatedStorageImpl> storage;
+
+  public:
+    SimulatedInputStream(std::unique_ptr<InputStream> _input,
+                         std::shared_ptr<SimulatedStorageImpl> _storage
+                         ): input(std::move(_input)),
+                            storage(_storage) {
+      // PASS
+    }
+
+    ~SimulatedInputStream();
+
+    uint64_t getLength() const override {
+      return input->getLength();
+    }
+
+    uint64_t getModificationTime() const override {
+      return input->getModificationTime();
+    }
+
+    const std::string& getName() const override {
+      return input->getName();
+    }
+
+    Buffer* read(uint64_t offset,
+                 uint64_t length,
+                 Buffer* buffer) override;
+  };
+
+  SimulatedInputStream::~SimulatedInputStream() {
+    // PASS
+  }
+
+  Buffer* SimulatedInputStream::read(uint64_t offset,
+                                     uint64_t length,
+                                     Buffer* buffer) {
+    StorageRequest request;
+    request.name = getName();
+    request.offset = offset;
+    request.length = length;
+    request.start = storage->now();
+    storage->acquireConnection();
+    uint64_t began = storage->now();
+    request.wait = began - request.start;
+    try {
+      buffer = input->read(offset, length, buffer);
+    } catch (...) {
+      request.duration = storage->now() - began;
+      storage->releaseConnection(request);
+      throw;
+    }
+    // the time spent reading the local copy counts against the model
+    uint64_t elapsed = storage->now() - began;
+    uint64_t simulated = storage->getRequestTime(length);
+    if (elapsed < simulated) {
+      std::this_thread::sleep_for(std::chrono::microseconds
+                                  (simulated - elapsed));
+    }
+    request.duration = storage->now() - began;
+    storage->releaseConnection(request);
+    return buffer;
+  }
+
+  std::unique_ptr<InputStream>
+      createSimulatedStream(std::unique_ptr<InputStream> input,
+                            std::shared_ptr<SimulatedStorage> storage) {
+    std::shared_ptr<SimulatedStorageImpl> impl =
+      std::dynamic_pointer_cast<SimulatedStorageImpl>(storage);
+    if (!impl) {
+      throw std::logic_error("Storage wasn't created by "
+                             "createSimulatedStorage");
+    }
+    return std::unique_ptr<InputStream>
+      (new SimulatedInputStream(std::move(input), impl));
+  }
+}
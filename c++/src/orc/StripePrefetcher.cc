@@ -0,0 +1,125 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "StripePrefetcher.hh"
+
+namespace orc {
+
+  StripeLoader::~StripeLoader() {
+    // PASS
+  }
+
+  StripePrefetcher::StripePrefetcher(const StripeLoader& _loader,
+                                     uint64_t firstStripe,
+                                     uint64_t _lastStripe,
+                                     uint64_t _depth,
+                                     uint64_t _memoryLimit
+                                     ): loader(_loader),
+                                        lastStripe(_lastStripe),
+                                        depth(_depth),
+                                        memoryLimit(_memoryLimit),
+                                        stopping(false),
+                                        nextToLoad(firstStripe),
+                                        nextToTake(firstStripe),
+                                        loadedBytes(0) {
+    start(firstStripe);
+  }
+
+  StripePrefetcher::~StripePrefetcher() {
+    stop();
+  }
+
+  bool StripePrefetcher::canLoad() const {
+    if (error || nextToLoad >= lastStripe || loaded.size() >= depth) {
+      return false;
+    }
+    return loaded.empty() ||
+      loadedBytes + loader.getLoadedSize(nextToLoad) <= memoryLimit;
+  }
+
+  void StripePrefetcher::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      changed.wait(lock, [this] { return stopping || canLoad(); });
+      if (stopping) {
+        return;
+      }
+      uint64_t stripeIndex = nextToLoad++;
+      uint64_t size = loader.getLoadedSize(stripeIndex);
+      lock.unlock();
+      std::unique_ptr<LoadedStripe> stripe;
+      std::exception_ptr failure;
+      try {
+        stripe = loader.loadStripe(stripeIndex);
+      } catch (...) {
+        failure = std::current_exception();
+      }
+      lock.lock();
+      if (stopping) {
+        return;
+      }
+      if (failure) {
+        error = failure;
+      } else {
+        loaded.push_back(std::move(stripe));
+        loadedBytes += size;
+      }
+      changed.notify_all();
+    }
+  }
+
+  void StripePrefetcher::start(uint64_t firstStripe) {
+    stopping = false;
+    nextToLoad = firstStripe;
+    nextToTake = firstStripe;
+    worker = std::thread(&StripePrefetcher::run, this);
+  }
+
+  void StripePrefetcher::stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    changed.notify_all();
+    if (worker.joinable()) {
+      worker.join();
+    }
+    loaded.clear();
+    loadedBytes = 0;
+    error = std::exception_ptr();
+  }
+
+  std::unique_ptr<LoadedStripe> StripePrefetcher::take(uint64_t stripeIndex) {
+    if (stripeIndex != nextToTake) {
+      stop();
+      start(stripeIndex);
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return !loaded.empty() || error; });
+    if (loaded.empty()) {
+      std::rethrow_exception(error);
+    }
+    std::unique_ptr<LoadedStripe> result = std::move(loaded.front());
+    loaded.pop_front();
+    loadedBytes -= loader.getLoadedSize(stripeIndex);
+    nextToTake = stripeIndex + 1;
+    changed.notify_all();
+    return result;
+  }
+}
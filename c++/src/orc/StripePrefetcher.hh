@@ -0,0 +1,123 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_STRIPE_PREFETCHER_HH
+#define ORC_STRIPE_PREFETCHER_HH
+
+#include "orc/Adaptor.hh"
+#include "ReadPlanner.hh"
+#include "wrap/orc-proto-wrapper.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace orc {
+
+  /**
+   * The footer and the stream bytes of a stripe that are needed before
+   * the stripe can be decoded.
+   */
+  struct LoadedStripe {
+    uint64_t stripeIndex;
+    proto::StripeFooter footer;
+    std::unique_ptr<ReadPlan> reads;
+  };
+
+  /**
+   * The source of stripes for a StripePrefetcher.
+   */
+  class StripeLoader {
+  public:
+    virtual ~StripeLoader();
+
+    /**
+     * Get an upper bound on the bytes that loading the stripe will take.
+     */
+    virtual uint64_t getLoadedSize(uint64_t stripeIndex) const = 0;
+
+    /**
+     * Read the stripe's footer and streams. This is called from the
+     * prefetching thread.
+     */
+    virtual std::unique_ptr<LoadedStripe> loadStripe(uint64_t stripeIndex
+                                                     ) const = 0;
+  };
+
+  /**
+   * Loads the following stripes on a background thread, so that the
+   * reads of stripe N+1 overlap with the decoding of stripe N.
+   */
+  class StripePrefetcher {
+  private:
+    const StripeLoader& loader;
+    const uint64_t lastStripe;
+    const uint64_t depth;
+    const uint64_t memoryLimit;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread worker;
+    bool stopping;
+    uint64_t nextToLoad;
+    uint64_t nextToTake;
+    std::deque<std::unique_ptr<LoadedStripe> > loaded;
+    uint64_t loadedBytes;
+    std::exception_ptr error;
+
+    // DELIBERATELY NOT IMPLEMENTED
+    StripePrefetcher(const StripePrefetcher&);
+    StripePrefetcher& operator=(const StripePrefetcher&);
+
+    bool canLoad() const;
+    void run();
+    void start(uint64_t firstStripe);
+    void stop();
+
+  public:
+    /**
+     * Start loading stripes.
+     * @param loader the source of the stripes
+     * @param firstStripe the first stripe to load
+     * @param lastStripe the stripe after the last one to load
+     * @param depth the maximum number of stripes to load ahead
+     * @param memoryLimit the maximum bytes of the stripes loaded ahead
+     */
+    StripePrefetcher(const StripeLoader& loader,
+                     uint64_t firstStripe,
+                     uint64_t lastStripe,
+                     uint64_t depth,
+                     uint64_t memoryLimit);
+    ~StripePrefetcher();
+
+    /**
+     * Get a stripe, waiting for it to be loaded if required. If the
+     * stripe isn't the one after the previous one that was taken, the
+     * stripes that were loaded ahead are discarded and loading restarts
+     * from this stripe.
+     * @param stripeIndex the stripe to get
+     * @return the loaded stripe
+     */
+    std::unique_ptr<LoadedStripe> take(uint64_t stripeIndex);
+  };
+}
+
+#endif
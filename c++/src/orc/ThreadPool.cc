@@ -0,0 +1,82 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "ThreadPool.hh"
+
+#include <map>
+
+namespace orc {
+
+  ThreadPool::ThreadPool(uint64_t threads): stopping(false) {
+    for(uint64_t i=0; i < threads; ++i) {
+      workers.push_back(std::thread(&ThreadPool::run, this));
+    }
+  }
+
+  ThreadPool::~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    changed.notify_all();
+    for(size_t i=0; i < workers.size(); ++i) {
+      workers[i].join();
+    }
+  }
+
+  uint64_t ThreadPool::getThreadCount() const {
+    return workers.size();
+  }
+
+  void ThreadPool::submit(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.push_back(std::move(task));
+    }
+    changed.notify_one();
+  }
+
+  void ThreadPool::run() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty()) {
+          return;
+        }
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::shared_ptr<ThreadPool> getSharedThreadPool(uint64_t threads) {
+    static std::mutex poolMutex;
+    static std::map<uint64_t, std::weak_ptr<ThreadPool> > pools;
+    std::lock_guard<std::mutex> lock(poolMutex);
+    std::shared_ptr<ThreadPool> result = pools[threads].lock();
+    if (!result) {
+      result.reset(new ThreadPool(threads));
+      pools[threads] = result;
+    }
+    return result;
+  }
+}
@@ -0,0 +1,84 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_THREAD_POOL_HH
+#define ORC_THREAD_POOL_HH
+
+#include "orc/Adaptor.hh"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace orc {
+
+  /**
+   * A fixed set of threads that run tasks in the order they were
+   * submitted.
+   */
+  class ThreadPool {
+  private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::function<void()> > tasks;
+    std::vector<std::thread> workers;
+    bool stopping;
+
+    // DELIBERATELY NOT IMPLEMENTED
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+    void run();
+
+  public:
+    /**
+     * Start the threads.
+     * @param threads the number of threads, which must be positive
+     */
+    ThreadPool(uint64_t threads);
+
+    /**
+     * Run the tasks that were already submitted and stop the threads.
+     */
+    ~ThreadPool();
+
+    /**
+     * Get the number of threads.
+     */
+    uint64_t getThreadCount() const;
+
+    /**
+     * Queue a task to run on one of the threads. The task must not throw.
+     */
+    void submit(std::function<void()> task);
+  };
+
+  /**
+   * Get the process-wide pool with the given number of threads. The
+   * callers that ask for the same number share one pool, which stops
+   * once the last of them releases it.
+   * @param threads the number of threads, which must be positive
+   */
+  std::shared_ptr<ThreadPool> getSharedThreadPool(uint64_t threads);
+}
+
+#endif
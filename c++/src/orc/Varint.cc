@@ -0,0 +1,215 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "Varint.hh"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef HAS_BMI2_TARGET
+#include <immintrin.h>
+#endif
+
+namespace orc {
+
+  namespace {
+
+    /**
+     * The number of bytes whose varint ends are found together.
+     */
+    const uint32_t BLOCK_SIZE = 16;
+
+    /**
+     * The bytes that must follow the start of a block, so that the 8 byte
+     * loads of the varints that end in it stay in the input.
+     */
+    const uint64_t BLOCK_READ = BLOCK_SIZE + 8;
+
+    /**
+     * Decode a varint of 9 or 10 bytes.
+     * @return the length of the varint or 0 if it is longer than 10 bytes
+     */
+    uint32_t decodeLongVarint(const char* input, uint64_t& value) {
+      const unsigned char* bytes = reinterpret_cast<const unsigned char*>
+        (input);
+      value = 0;
+      for(uint32_t i=0; i < 10; ++i) {
+        value |= static_cast<uint64_t>(bytes[i] & 0x7f) << (7 * i);
+        if (bytes[i] < 0x80) {
+          return i + 1;
+        }
+      }
+      return 0;
+    }
+
+#ifdef __SSE2__
+    /**
+     * Get a bit for each byte of a block that ends a varint.
+     */
+    inline uint32_t findEnds(const char* input) {
+      return ~static_cast<uint32_t>
+        (_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>
+                                           (input)))) & 0xffff;
+    }
+
+    /**
+     * Widen 16 bytes that are each a whole varint to 16 values.
+     */
+    inline void widenBytes(const char* input, int64_t* output) {
+      const __m128i zero = _mm_setzero_si128();
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>
+                                      (input));
+      __m128i shorts[2] = {_mm_unpacklo_epi8(block, zero),
+                           _mm_unpackhi_epi8(block, zero)};
+      for(int s=0; s < 2; ++s) {
+        __m128i ints[2] = {_mm_unpacklo_epi16(shorts[s], zero),
+                           _mm_unpackhi_epi16(shorts[s], zero)};
+        for(int i=0; i < 2; ++i) {
+          __m128i* out = reinterpret_cast<__m128i*>(output + 8 * s + 4 * i);
+          _mm_storeu_si128(out, _mm_unpacklo_epi32(ints[i], zero));
+          _mm_storeu_si128(out + 1, _mm_unpackhi_epi32(ints[i], zero));
+        }
+      }
+    }
+#else
+    /**
+     * Gather the high bits of 8 bytes, so that bit i is set when byte i
+     * ends a varint.
+     */
+    inline uint32_t findWordEnds(uint64_t word) {
+      uint64_t ends = (~word & 0x8080808080808080ULL) >> 7;
+      return static_cast<uint32_t>((ends * 0x0102040810204080ULL) >> 56);
+    }
+
+    inline uint32_t findEnds(const char* input) {
+      return findWordEnds(loadVarintWord(input)) |
+        findWordEnds(loadVarintWord(input + 8)) << 8;
+    }
+
+    inline void widenBytes(const char* input, int64_t* output) {
+      for(uint32_t i=0; i < BLOCK_SIZE; ++i) {
+        output[i] = static_cast<unsigned char>(input[i]);
+      }
+    }
+#endif
+
+    /**
+     * Gets the value of a varint with the portable shifts and masks.
+     */
+    struct ScalarCompactor {
+      static uint64_t compact(uint64_t word, uint32_t length) {
+        return compactVarint(word, length);
+      }
+    };
+
+#ifdef HAS_BMI2_TARGET
+    /**
+     * Gets the value of a varint by extracting the low 7 bits of each
+     * byte in one instruction.
+     */
+    struct Bmi2Compactor {
+      __attribute__((target("bmi2")))
+      static uint64_t compact(uint64_t word, uint32_t length) {
+        return _pext_u64(_bzhi_u64(word, 8 * length), 0x7f7f7f7f7f7f7f7fULL);
+      }
+    };
+#endif
+
+    template <typename Compactor>
+    inline __attribute__((always_inline))
+    uint64_t decodeBlocks(const char* input,
+                          uint64_t length,
+                          int64_t* output,
+                          uint64_t count,
+                          uint64_t& used) {
+      uint64_t decoded = 0;
+      uint64_t position = 0;
+      while (decoded < count && length - position >= BLOCK_READ) {
+        const char* block = input + position;
+        uint32_t ends = findEnds(block);
+        if (ends == 0xffff && count - decoded >= BLOCK_SIZE) {
+          // 16 varints of one byte
+          widenBytes(block, output + decoded);
+          decoded += BLOCK_SIZE;
+          position += BLOCK_SIZE;
+          continue;
+        }
+        if (ends == 0) {
+          // a varint that is longer than a block is too long
+          break;
+        }
+        // The varints that end in the block only depend on the mask for
+        // where they start, so their loads don't wait for each other.
+        uint32_t start = 0;
+        while (ends != 0 && decoded < count) {
+          uint32_t size = static_cast<uint32_t>(__builtin_ctz(ends)) + 1 -
+            start;
+          ends &= ends - 1;
+          uint64_t value;
+          if (size <= 8) {
+            value = Compactor::compact(loadVarintWord(block + start), size);
+          } else if (decodeLongVarint(block + start, value) != size) {
+            // leave a varint that is too long to the caller
+            used = position + start;
+            return decoded;
+          }
+          output[decoded++] = static_cast<int64_t>(value);
+          start += size;
+        }
+        position += start;
+      }
+      used = position;
+      return decoded;
+    }
+
+#ifdef HAS_BMI2_TARGET
+    __attribute__((target("bmi2")))
+    uint64_t decodeVarintsBmi2(const char* input,
+                               uint64_t length,
+                               int64_t* output,
+                               uint64_t count,
+                               uint64_t& used) {
+      return decodeBlocks<Bmi2Compactor>(input, length, output, count, used);
+    }
+#endif
+  }
+
+  uint64_t decodeVarints(const char* input,
+                         uint64_t length,
+                         int64_t* output,
+                         uint64_t count,
+                         uint64_t& used) {
+#ifdef HAS_BMI2_TARGET
+    static const bool useBmi2 = __builtin_cpu_supports("bmi2");
+    if (useBmi2) {
+      return decodeVarintsBmi2(input, length, output, count, used);
+    }
+#endif
+    return decodeScalarVarints(input, length, output, count, used);
+  }
+
+  uint64_t decodeScalarVarints(const char* input,
+                               uint64_t length,
+                               int64_t* output,
+                               uint64_t count,
+                               uint64_t& used) {
+    return decodeBlocks<ScalarCompactor>(input, length, output, count, used);
+  }
+}
@@ -0,0 +1,107 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_VARINT_HH
+#define ORC_VARINT_HH
+
+#include "orc/Adaptor.hh"
+
+#include <string.h>
+
+namespace orc {
+
+  /**
+   * Load 8 bytes as a little endian number.
+   */
+  inline uint64_t loadVarintWord(const char* input) {
+    uint64_t word;
+    memcpy(&word, input, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+  }
+
+  /**
+   * Get the value of a varint from its bytes.
+   * @param word the bytes of the varint, which may be followed by others
+   * @param length the length of the varint from 1 to 8 bytes
+   */
+  inline uint64_t compactVarint(uint64_t word, uint32_t length) {
+    // keep the bytes of the varint and then squeeze out the high bits,
+    // doubling the width of the packed parts at each step
+    uint64_t bits = word & (~static_cast<uint64_t>(0) >> (64 - 8 * length)) &
+      0x7f7f7f7f7f7f7f7fULL;
+    bits = (bits & 0x007f007f007f007fULL) |
+      ((bits & 0x7f007f007f007f00ULL) >> 1);
+    bits = (bits & 0x00003fff00003fffULL) |
+      ((bits & 0x3fff00003fff0000ULL) >> 2);
+    return (bits & 0x000000000fffffffULL) |
+      ((bits & 0x0fffffff00000000ULL) >> 4);
+  }
+
+  /**
+   * Decode the base 128 varint at the start of input if it is at most 8
+   * bytes long. The bytes of the varint are found from a single 8 byte
+   * load, so there are no branches on the value.
+   * @param input at least 8 readable bytes
+   * @param value set to the decoded value
+   * @return the length of the varint or 0 if it is longer than 8 bytes
+   */
+  inline uint32_t decodeShortVarint(const char* input, uint64_t& value) {
+    uint64_t word = loadVarintWord(input);
+    // the last byte of a varint has its high bit clear
+    uint64_t ends = ~word & 0x8080808080808080ULL;
+    if (ends == 0) {
+      return 0;
+    }
+    uint32_t length = static_cast<uint32_t>(__builtin_ctzll(ends) + 1) / 8;
+    value = compactVarint(word, length);
+    return length;
+  }
+
+  /**
+   * Decode a run of consecutive base 128 varints from a buffer. The ends
+   * of the varints in each 16 bytes are found together, and then each
+   * value is extracted from an 8 byte load, using BMI2 when the machine
+   * has it. Decoding stops when the varints left may not be whole in the
+   * buffer, so the caller finishes the run with a byte at a time decoder.
+   * @param input the encoded varints
+   * @param length the number of bytes in input
+   * @param output where the values are written
+   * @param count the most values to decode
+   * @param used set to the number of bytes that were decoded
+   * @return the number of values that were decoded
+   */
+  uint64_t decodeVarints(const char* input,
+                         uint64_t length,
+                         int64_t* output,
+                         uint64_t count,
+                         uint64_t& used);
+
+  /**
+   * The same as decodeVarints, but only using portable code.
+   */
+  uint64_t decodeScalarVarints(const char* input,
+                               uint64_t length,
+                               int64_t* output,
+                               uint64_t count,
+                               uint64_t& used);
+}
+
+#endif
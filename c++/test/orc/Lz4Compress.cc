@@ -0,0 +1,130 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "Lz4Compress.hh"
+
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+namespace orc {
+
+  // the block format is described in Lz4.cc
+  static const uint64_t MIN_MATCH = 4;
+  static const uint64_t MAX_DISTANCE = 65535;
+  // the encoder must leave the last bytes of the block as literals
+  static const uint64_t LAST_LITERALS = 5;
+  static const uint64_t MATCH_FIND_LIMIT = 12;
+
+  uint64_t lz4MaxCompressedLength(uint64_t length) {
+    return length + length / 255 + 16;
+  }
+
+  namespace {
+    class Lz4Writer {
+    private:
+      unsigned char* op;
+      unsigned char* const outputStart;
+
+      void writeLength(uint64_t value) {
+        while (value >= 255) {
+          *(op++) = 255;
+          value -= 255;
+        }
+        *(op++) = static_cast<unsigned char>(value);
+      }
+
+    public:
+      Lz4Writer(char* output
+                ): op(reinterpret_cast<unsigned char*>(output)),
+                   outputStart(op) {
+        // PASS
+      }
+
+      /**
+       * Write a sequence. A match length of zero means there is no match,
+       * which is only allowed for the last sequence.
+       */
+      void writeSequence(const char* literals,
+                         uint64_t literalLength,
+                         uint64_t distance,
+                         uint64_t matchLength) {
+        uint64_t matchField = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+        *(op++) = static_cast<unsigned char>
+          ((std::min<uint64_t>(literalLength, 15) << 4) |
+           std::min<uint64_t>(matchField, 15));
+        if (literalLength >= 15) {
+          writeLength(literalLength - 15);
+        }
+        memcpy(op, literals, literalLength);
+        op += literalLength;
+        if (matchLength != 0) {
+          *(op++) = static_cast<unsigned char>(distance);
+          *(op++) = static_cast<unsigned char>(distance >> 8);
+          if (matchField >= 15) {
+            writeLength(matchField - 15);
+          }
+        }
+      }
+
+      uint64_t getLength() const {
+        return static_cast<uint64_t>(op - outputStart);
+      }
+    };
+  }
+
+  static uint32_t read32(const char* ptr) {
+    uint32_t result;
+    memcpy(&result, ptr, sizeof(result));
+    return result;
+  }
+
+  uint64_t lz4Compress(const char* input, uint64_t length, char* output) {
+    const uint64_t HASH_BITS = 14;
+    // positions are stored plus one, so that zero means empty
+    std::vector<uint64_t> table(1 << HASH_BITS, 0);
+    Lz4Writer writer(output);
+    uint64_t anchor = 0;
+    uint64_t position = 0;
+    while (length >= MATCH_FIND_LIMIT &&
+           position + MATCH_FIND_LIMIT <= length) {
+      uint32_t value = read32(input + position);
+      uint64_t hash = (value * 2654435761U) >> (32 - HASH_BITS);
+      uint64_t candidate = table[hash];
+      table[hash] = position + 1;
+      if (candidate != 0 && position - (candidate - 1) <= MAX_DISTANCE &&
+          read32(input + candidate - 1) == value) {
+        uint64_t start = candidate - 1;
+        uint64_t matchLength = MIN_MATCH;
+        while (position + matchLength < length - LAST_LITERALS &&
+               input[start + matchLength] == input[position + matchLength]) {
+          matchLength += 1;
+        }
+        writer.writeSequence(input + anchor, position - anchor,
+                             position - start, matchLength);
+        position += matchLength;
+        anchor = position;
+      } else {
+        position += 1;
+      }
+    }
+    writer.writeSequence(input + anchor, length - anchor, 0, 0);
+    return writer.getLength();
+  }
+}
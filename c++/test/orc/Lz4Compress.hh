@@ -0,0 +1,45 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ORC_LZ4_COMPRESS_HH
+#define ORC_LZ4_COMPRESS_HH
+
+#include "orc/Adaptor.hh"
+
+#include <stdint.h>
+
+namespace orc {
+
+  /**
+   * Get the largest size that lz4Compress can produce for the given input.
+   */
+  uint64_t lz4MaxCompressedLength(uint64_t length);
+
+  /**
+   * Compress bytes as a raw LZ4 block using a simple greedy matcher.
+   * Like lzoCompress, this is only used to create data for the tests and
+   * benchmarks.
+   * @param input the bytes to compress
+   * @param length the number of bytes to compress
+   * @param output a buffer of at least lz4MaxCompressedLength(length)
+   * @return the number of compressed bytes
+   */
+  uint64_t lz4Compress(const char* input, uint64_t length, char* output);
+}
+
+#endif
@@ -0,0 +1,165 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "LzoCompress.hh"
+
+#include <string.h>
+#include <vector>
+
+namespace orc {
+
+  // the longest distances of the M2, M3, and M4 matches, which are
+  // described in Lzo.cc
+  static const uint64_t M2_MAX_DISTANCE = 2048;
+  static const uint64_t M3_MAX_DISTANCE = 16384;
+  static const uint64_t M4_MAX_DISTANCE = 49151;
+
+  uint64_t lzoMaxCompressedLength(uint64_t length) {
+    return length + length / 16 + 64 + 3;
+  }
+
+  namespace {
+    class LzoWriter {
+    private:
+      unsigned char* op;
+      unsigned char* const outputStart;
+      // the byte holding the literal count of the last match
+      unsigned char* lastMatch;
+
+      void writeLongLength(uint64_t value) {
+        while (value > 255) {
+          *(op++) = 0;
+          value -= 255;
+        }
+        *(op++) = static_cast<unsigned char>(value);
+      }
+
+    public:
+      LzoWriter(char* output
+                ): op(reinterpret_cast<unsigned char*>(output)),
+                   outputStart(op),
+                   lastMatch(nullptr) {
+        // PASS
+      }
+
+      void writeLiterals(const char* literals, uint64_t length) {
+        if (length == 0) {
+          return;
+        }
+        if (lastMatch == nullptr) {
+          if (length <= 238) {
+            *(op++) = static_cast<unsigned char>(17 + length);
+          } else {
+            *(op++) = 0;
+            writeLongLength(length - 18);
+          }
+        } else if (length <= 3) {
+          *lastMatch = static_cast<unsigned char>(*lastMatch | length);
+        } else if (length <= 18) {
+          *(op++) = static_cast<unsigned char>(length - 3);
+        } else {
+          *(op++) = 0;
+          writeLongLength(length - 18);
+        }
+        memcpy(op, literals, length);
+        op += length;
+      }
+
+      void writeMatch(uint64_t distance, uint64_t length) {
+        if (length <= 8 && distance <= M2_MAX_DISTANCE) {
+          uint64_t d = distance - 1;
+          uint64_t opcode = length <= 4 ? 0x40 | ((length - 3) << 5)
+            : 0x80 | ((length - 5) << 5);
+          lastMatch = op;
+          *(op++) = static_cast<unsigned char>(opcode | ((d & 7) << 2));
+          *(op++) = static_cast<unsigned char>(d >> 3);
+          return;
+        }
+        uint64_t d;
+        if (distance <= M3_MAX_DISTANCE) {
+          d = distance - 1;
+          if (length - 2 <= 31) {
+            *(op++) = static_cast<unsigned char>(0x20 | (length - 2));
+          } else {
+            *(op++) = 0x20;
+            writeLongLength(length - 2 - 31);
+          }
+        } else {
+          d = distance - M3_MAX_DISTANCE;
+          uint64_t high = (d >> 11) & 8;
+          d &= 0x3fff;
+          if (length - 2 <= 7) {
+            *(op++) = static_cast<unsigned char>(0x10 | high | (length - 2));
+          } else {
+            *(op++) = static_cast<unsigned char>(0x10 | high);
+            writeLongLength(length - 2 - 7);
+          }
+        }
+        lastMatch = op;
+        *(op++) = static_cast<unsigned char>((d << 2) & 0xff);
+        *(op++) = static_cast<unsigned char>(d >> 6);
+      }
+
+      uint64_t finish() {
+        *(op++) = 0x11;
+        *(op++) = 0;
+        *(op++) = 0;
+        return static_cast<uint64_t>(op - outputStart);
+      }
+    };
+  }
+
+  static uint32_t read32(const char* ptr) {
+    uint32_t result;
+    memcpy(&result, ptr, sizeof(result));
+    return result;
+  }
+
+  uint64_t lzoCompress(const char* input, uint64_t length, char* output) {
+    const uint64_t HASH_BITS = 14;
+    // positions are stored plus one, so that zero means empty
+    std::vector<uint64_t> table(1 << HASH_BITS, 0);
+    LzoWriter writer(output);
+    uint64_t anchor = 0;
+    uint64_t position = 0;
+    while (position + 4 <= length) {
+      uint32_t value = read32(input + position);
+      uint64_t hash = (value * 2654435761U) >> (32 - HASH_BITS);
+      uint64_t candidate = table[hash];
+      table[hash] = position + 1;
+      if (candidate != 0 && position - (candidate - 1) <= M4_MAX_DISTANCE &&
+          read32(input + candidate - 1) == value) {
+        uint64_t start = candidate - 1;
+        uint64_t matchLength = 4;
+        while (position + matchLength < length &&
+               input[start + matchLength] == input[position + matchLength]) {
+          matchLength += 1;
+        }
+        writer.writeLiterals(input + anchor, position - anchor);
+        writer.writeMatch(position - start, matchLength);
+        position += matchLength;
+        anchor = position;
+      } else {
+        position += 1;
+      }
+    }
+    writer.writeLiterals(input + anchor, length - anchor);
+    return writer.finish();
+  }
+}
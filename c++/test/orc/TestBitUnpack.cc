@@ -0,0 +1,190 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/BitUnpack.hh"
+#include "orc/Compression.hh"
+#include "orc/RLE.hh"
+#include "wrap/gtest-wrapper.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace orc {
+
+  static const uint32_t WIDTHS[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+                                    13, 14, 15, 16, 17, 18, 19, 20, 21, 22,
+                                    23, 24, 26, 28, 30, 32, 40, 48, 56, 64};
+  // the encoded widths of RLEv2 in the same order
+  static const uint32_t ENCODED_WIDTHS[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+                                            10, 11, 12, 13, 14, 15, 16, 17,
+                                            18, 19, 20, 21, 22, 23, 24, 25,
+                                            26, 27, 28, 29, 30, 31};
+
+  /**
+   * Make values that use every bit of the width.
+   */
+  static std::vector<uint64_t> makeValues(uint64_t count, uint32_t width) {
+    std::vector<uint64_t> result;
+    uint64_t seed = width;
+    uint64_t mask = ~static_cast<uint64_t>(0) >> (64 - width);
+    for(uint64_t i=0; i < count; ++i) {
+      seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+      uint64_t value = seed ^ (seed >> 29);
+      // include the extremes
+      if (i % 13 == 0) {
+        value = ~static_cast<uint64_t>(0);
+      } else if (i % 17 == 0) {
+        value = 0;
+      }
+      result.push_back(value & mask);
+    }
+    return result;
+  }
+
+  /**
+   * Pack values most significant bit first.
+   */
+  static void packValues(const std::vector<uint64_t>& values,
+                         uint32_t width,
+                         std::vector<char>& output) {
+    uint32_t current = 0;
+    uint32_t bits = 0;
+    for(size_t i=0; i < values.size(); ++i) {
+      for(uint32_t b=width; b-- > 0; ) {
+        current = (current << 1) | ((values[i] >> b) & 1);
+        if (++bits == 8) {
+          output.push_back(static_cast<char>(current));
+          current = 0;
+          bits = 0;
+        }
+      }
+    }
+    if (bits > 0) {
+      output.push_back(static_cast<char>(current << (8 - bits)));
+    }
+  }
+
+  static void checkUnpacker(BitUnpacker unpacker, uint32_t width) {
+    ASSERT_NE(nullptr, unpacker) << "width " << width;
+    // every number of groups up to a few, so both the wide loads and the
+    // exact reads at the end are used
+    for(uint64_t groups=1; groups < 12; ++groups) {
+      std::vector<uint64_t> values = makeValues(groups * 8, width);
+      std::vector<char> packed;
+      packValues(values, width, packed);
+      ASSERT_EQ(groups * width, packed.size());
+      std::vector<int64_t> output(groups * 8 + 1, 42);
+      unpacker(packed.data(), groups, output.data());
+      for(size_t i=0; i < values.size(); ++i) {
+        ASSERT_EQ(values[i], static_cast<uint64_t>(output[i]))
+          << "width " << width << " groups " << groups << " value " << i;
+      }
+      // nothing past the groups is written
+      EXPECT_EQ(42, output[groups * 8]);
+    }
+  }
+
+  TEST(BitUnpack, testScalarWidths) {
+    for(size_t w=0; w < sizeof(WIDTHS) / sizeof(WIDTHS[0]); ++w) {
+      checkUnpacker(getScalarBitUnpacker(WIDTHS[w]), WIDTHS[w]);
+    }
+  }
+
+  TEST(BitUnpack, testFastestWidths) {
+    for(size_t w=0; w < sizeof(WIDTHS) / sizeof(WIDTHS[0]); ++w) {
+      checkUnpacker(getBitUnpacker(WIDTHS[w]), WIDTHS[w]);
+    }
+  }
+
+  TEST(BitUnpack, testUnusedWidths) {
+    EXPECT_EQ(nullptr, getBitUnpacker(0));
+    EXPECT_EQ(nullptr, getBitUnpacker(25));
+    EXPECT_EQ(nullptr, getBitUnpacker(63));
+    EXPECT_EQ(nullptr, getScalarBitUnpacker(65));
+  }
+
+  /**
+   * Decode DIRECT runs of every width through buffers of the given size,
+   * so that the groups are split between buffers in every way.
+   */
+  static void checkDirectRuns(int blockSize, bool withNulls) {
+    for(size_t w=0; w < sizeof(WIDTHS) / sizeof(WIDTHS[0]); ++w) {
+      uint32_t width = WIDTHS[w];
+      // one long run and one that doesn't end on a group
+      std::vector<uint64_t> values = makeValues(512 + 37, width);
+      std::vector<char> bytes;
+      for(size_t start=0; start < values.size(); start += 512) {
+        size_t length = std::min<size_t>(512, values.size() - start);
+        bytes.push_back(static_cast<char>(0x40 | ENCODED_WIDTHS[w] << 1 |
+                                          (length - 1) >> 8));
+        bytes.push_back(static_cast<char>((length - 1) & 0xff));
+        std::vector<uint64_t> run(values.begin() + static_cast<long>(start),
+                                  values.begin() +
+                                  static_cast<long>(start + length));
+        packValues(run, width, bytes);
+      }
+
+      // a null after every other value and a long stretch of nulls
+      std::vector<char> notNull;
+      for(size_t i=0; i < values.size(); ++i) {
+        notNull.push_back(1);
+        if (withNulls && i % 2 == 1) {
+          notNull.push_back(0);
+        }
+        if (withNulls && i == 100) {
+          notNull.insert(notNull.end(), 20, 0);
+        }
+      }
+      size_t rows = notNull.size();
+
+      std::unique_ptr<RleDecoder> rle =
+        createRleDecoder(std::unique_ptr<SeekableInputStream>
+                         (new SeekableArrayInputStream(bytes.data(),
+                                                       bytes.size(),
+                                                       blockSize)),
+                         false, RleVersion_2, *getDefaultPool());
+      std::vector<int64_t> data(rows);
+      // read in batches that don't line up with the groups
+      for(size_t start=0; start < rows; start += 99) {
+        size_t length = std::min<size_t>(99, rows - start);
+        rle->next(data.data() + start, length,
+                  withNulls ? notNull.data() + start : nullptr);
+      }
+      size_t next = 0;
+      for(size_t i=0; i < rows; ++i) {
+        if (!withNulls || notNull[i]) {
+          ASSERT_EQ(values[next], static_cast<uint64_t>(data[i]))
+            << "width " << width << " row " << i;
+          next += 1;
+        }
+      }
+      EXPECT_EQ(values.size(), next);
+    }
+  }
+
+  TEST(BitUnpack, testDirectRuns) {
+    checkDirectRuns(1, false);
+    checkDirectRuns(7, false);
+    checkDirectRuns(100000, false);
+  }
+
+  TEST(BitUnpack, testDirectRunsWithNulls) {
+    checkDirectRuns(3, true);
+    checkDirectRuns(100000, true);
+  }
+}
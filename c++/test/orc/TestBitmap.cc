@@ -0,0 +1,107 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Bitmap.hh"
+#include "wrap/gtest-wrapper.h"
+
+#include <string>
+#include <vector>
+
+namespace orc {
+
+  TEST(Bitmap, testReverseBitsInBytes) {
+    EXPECT_EQ(0x8001ULL, reverseBitsInBytes(0x0180ULL));
+    EXPECT_EQ(0x0f1e2d3c4b5a6978ULL, reverseBitsInBytes(0xf078b43cd25a961eULL));
+  }
+
+  TEST(Bitmap, testCountBits) {
+    std::vector<unsigned char> bitmap;
+    for (int i = 0; i < 40; ++i) {
+      bitmap.push_back(static_cast<unsigned char>(i * 53 + 7));
+    }
+    for (uint64_t length = 0; length <= bitmap.size() * 8; ++length) {
+      uint64_t expected = 0;
+      for (uint64_t i = 0; i < length; ++i) {
+        expected += (bitmap[i / 8] >> (i % 8)) & 1;
+      }
+      EXPECT_EQ(expected, countBits(bitmap.data(), length))
+        << "length " << length;
+    }
+  }
+
+  TEST(Bitmap, testExpandBitmap) {
+    std::vector<unsigned char> bitmap;
+    for (int i = 0; i < 40; ++i) {
+      bitmap.push_back(static_cast<unsigned char>(i * 53 + 7));
+    }
+    for (uint64_t length = 0; length <= bitmap.size() * 8; length += 7) {
+      std::vector<char> output(length + 1, 5);
+      expandBitmap(bitmap.data(), length, output.data());
+      // and in place over the bitmap
+      std::vector<char> inPlace(length + 1, 5);
+      std::copy(bitmap.begin(), bitmap.begin() + (length + 7) / 8,
+                inPlace.begin());
+      expandBitmap(reinterpret_cast<unsigned char*>(inPlace.data()), length,
+                   inPlace.data());
+      for (uint64_t i = 0; i < length; ++i) {
+        char expected = static_cast<char>((bitmap[i / 8] >> (i % 8)) & 1);
+        ASSERT_EQ(expected, output[i]) << "length " << length << " at " << i;
+        ASSERT_EQ(expected, inPlace[i]) << "length " << length << " at " << i;
+      }
+      EXPECT_EQ(5, output[length]);
+    }
+  }
+
+  TEST(Bitmap, testCountNonNulls) {
+    std::string mask = "\x01\x00\x02\x00\x80\xff\x00\x01\x01\x00\x00\x07";
+    for (size_t length = 0; length <= mask.size(); ++length) {
+      uint64_t expected = 0;
+      for (size_t i = 0; i < length; ++i) {
+        expected += mask[i] != 0;
+      }
+      EXPECT_EQ(expected, countNonNulls(mask.data(), length))
+        << "length " << length;
+    }
+  }
+
+  TEST(Bitmap, testPackBitmap) {
+    // blocks of 64 that are all set, all clear, and mixed
+    std::vector<char> mask;
+    for (int i = 0; i < 64; ++i) {
+      mask.push_back(2);
+    }
+    for (int i = 0; i < 64; ++i) {
+      mask.push_back(0);
+    }
+    for (int i = 0; i < 100; ++i) {
+      mask.push_back(static_cast<char>((i * 7) % 3 == 0 ? 0 : i + 1));
+    }
+    for (uint64_t length = 0; length <= mask.size(); length += 9) {
+      std::vector<unsigned char> bitmap((length + 7) / 8 + 1, 0xaa);
+      packBitmap(mask.data(), length, bitmap.data());
+      for (uint64_t i = 0; i < length; ++i) {
+        ASSERT_EQ(mask[i] != 0, (bitmap[i / 8] >> (i % 8)) & 1)
+          << "length " << length << " at " << i;
+      }
+      if (length % 8 != 0) {
+        EXPECT_EQ(0, bitmap[length / 8] >> (length % 8));
+      }
+      EXPECT_EQ(0xaa, bitmap[(length + 7) / 8]);
+    }
+  }
+}
@@ -836,6 +836,52 @@ TEST(BooleanRle, simpleTest) {
   }
 }
 
+TEST(BooleanRle, bitmapTest) {
+  // a literal run of bytes with a pattern that changes in every byte
+  std::vector<unsigned char> buffer;
+  std::vector<char> expected;
+  buffer.push_back(0x80);
+  for (int i = 0; i < 128; ++i) {
+    unsigned char byte = static_cast<unsigned char>(i * 37 + 11);
+    buffer.push_back(byte);
+    for (int bit = 7; bit >= 0; --bit) {
+      expected.push_back(static_cast<char>((byte >> bit) & 1));
+    }
+  }
+  // batches that start at every bit and end in the middle of bytes
+  const size_t batches[] = {1, 3, 8, 13, 64, 70, 129, 5, 200};
+  for (size_t first = 0; first < 8; ++first) {
+    std::unique_ptr<ByteRleDecoder> rle =
+      createBooleanRleDecoder(std::unique_ptr<SeekableInputStream>
+                              (new SeekableArrayInputStream
+                               (buffer.data(), buffer.size(), 7)));
+    std::vector<char> data(first + 1);
+    rle->next(data.data(), first, nullptr);
+    size_t position = first;
+    for (size_t b = 0; b < ARRAY_SIZE(batches); ++b) {
+      size_t count = batches[b];
+      std::vector<unsigned char> bitmap((count + 7) / 8 + 1, 0xff);
+      uint64_t falses = rle->nextBitmap(bitmap.data(), count);
+      uint64_t expectedFalses = 0;
+      for (size_t i = 0; i < count; ++i) {
+        EXPECT_EQ(expected[position + i], (bitmap[i / 8] >> (i % 8)) & 1)
+          << "Output wrong at " << position + i << " from " << first;
+        expectedFalses += expected[position + i] == 0;
+      }
+      EXPECT_EQ(expectedFalses, falses);
+      // the bits past the end are cleared and the next byte is untouched
+      if (count % 8 != 0) {
+        EXPECT_EQ(0, bitmap[count / 8] >> (count % 8));
+      }
+      EXPECT_EQ(0xff, bitmap[(count + 7) / 8]);
+      position += count;
+    }
+    // the decoder carries on after the bitmaps with bytes
+    rle->next(data.data(), 1, nullptr);
+    EXPECT_EQ(expected[position], data[0]);
+  }
+}
+
 TEST(BooleanRle, runsTest) {
   const unsigned char buffer[] = {0xf7, 0xff, 0x80, 0x3f, 0xe0, 0x0f,
 				  0xf8, 0x03, 0xfe, 0x00};
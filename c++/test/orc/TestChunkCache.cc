@@ -0,0 +1,179 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/ChunkCache.hh"
+#include "orc/Compression.hh"
+#include "orc/Exceptions.hh"
+#include "wrap/gtest-wrapper.h"
+
+#include <string.h>
+#include <vector>
+
+#include "wrap/snappy-wrapper.h"
+
+namespace orc {
+
+  TEST(ChunkCache, testGetAndPut) {
+    ChunkCacheImpl cache(1024, *getDefaultPool());
+    EXPECT_EQ(nullptr, cache.get("a", 0, 0));
+    cache.put("a", 10, 20, "hello", 5);
+    CachedChunk chunk = cache.get("a", 10, 20);
+    ASSERT_NE(nullptr, chunk);
+    EXPECT_EQ(5, chunk->size());
+    EXPECT_EQ(0, memcmp("hello", chunk->data(), 5));
+    // every part of the key matters
+    EXPECT_EQ(nullptr, cache.get("b", 10, 20));
+    EXPECT_EQ(nullptr, cache.get("a", 11, 20));
+    EXPECT_EQ(nullptr, cache.get("a", 10, 21));
+    EXPECT_EQ(1, cache.getHits());
+    EXPECT_EQ(4, cache.getMisses());
+    EXPECT_EQ(1, cache.getNumberOfEntries());
+    EXPECT_EQ(5, cache.getMemoryUsage());
+
+    // replacing a chunk doesn't leak its memory
+    cache.put("a", 10, 20, "goodbye", 7);
+    EXPECT_EQ(1, cache.getNumberOfEntries());
+    EXPECT_EQ(7, cache.getMemoryUsage());
+    // the old chunk lives as long as someone is using it
+    EXPECT_EQ(0, memcmp("hello", chunk->data(), 5));
+
+    cache.clear();
+    EXPECT_EQ(0, cache.getNumberOfEntries());
+    EXPECT_EQ(0, cache.getMemoryUsage());
+    EXPECT_EQ(0, cache.getHits());
+    EXPECT_EQ(0, cache.getMisses());
+    EXPECT_EQ(nullptr, cache.get("a", 10, 20));
+  }
+
+  TEST(ChunkCache, testEviction) {
+    std::vector<char> bytes(100, 'x');
+    ChunkCacheImpl cache(300, *getDefaultPool());
+    cache.put("f", 0, 0, bytes.data(), 100);
+    cache.put("f", 0, 100, bytes.data(), 100);
+    cache.put("f", 0, 200, bytes.data(), 100);
+    EXPECT_EQ(3, cache.getNumberOfEntries());
+    EXPECT_EQ(0, cache.getEvictions());
+
+    // using the first chunk makes the second the least recently used
+    EXPECT_NE(nullptr, cache.get("f", 0, 0));
+    cache.put("f", 0, 300, bytes.data(), 100);
+    EXPECT_EQ(3, cache.getNumberOfEntries());
+    EXPECT_EQ(1, cache.getEvictions());
+    EXPECT_EQ(nullptr, cache.get("f", 0, 100));
+    EXPECT_NE(nullptr, cache.get("f", 0, 0));
+
+    // chunks larger than the cache aren't kept
+    cache.put("f", 0, 400, bytes.data(), 100);
+    std::vector<char> big(301);
+    cache.put("f", 0, 500, big.data(), big.size());
+    EXPECT_EQ(nullptr, cache.get("f", 0, 500));
+    EXPECT_EQ(300, cache.getMemoryUsage());
+
+    cache.setCapacity(150);
+    EXPECT_EQ(1, cache.getNumberOfEntries());
+    EXPECT_EQ(100, cache.getMemoryUsage());
+    EXPECT_EQ(4, cache.getEvictions());
+  }
+
+  /**
+   * Build a stream of snappy chunks holding the ints 0 to N - 1 mod 8.
+   */
+  static std::vector<char> makeSnappyChunks(int N, int chunkSize) {
+    std::vector<char> result;
+    std::vector<char> chunk(static_cast<size_t>(chunkSize) * sizeof(int));
+    std::vector<char> compressed
+      (snappy::MaxCompressedLength(chunk.size()));
+    for(int start=0; start < N; start += chunkSize) {
+      for(int i=0; i < chunkSize; ++i) {
+        (reinterpret_cast<int *>(chunk.data()))[i] = (start + i) % 8;
+      }
+      size_t size;
+      snappy::RawCompress(chunk.data(), chunk.size(), compressed.data(),
+                          &size);
+      result.push_back(static_cast<char>(size << 1));
+      result.push_back(static_cast<char>(size >> 7));
+      result.push_back(static_cast<char>(size >> 15));
+      result.insert(result.end(), compressed.begin(),
+                    compressed.begin() + static_cast<long>(size));
+    }
+    return result;
+  }
+
+  static void readInts(SeekableInputStream& stream, int N) {
+    const void *data;
+    int length;
+    int value = 0;
+    while (stream.Next(&data, &length)) {
+      for(int i=0; i < length / static_cast<int>(sizeof(int)); ++i) {
+        EXPECT_EQ(value % 8, (reinterpret_cast<const int *>(data))[i]);
+        ++value;
+      }
+    }
+    EXPECT_EQ(N, value);
+  }
+
+  TEST(ChunkCache, testDecompressor) {
+    const int N = 1024;
+    const int chunkSize = 64;
+    std::vector<char> input = makeSnappyChunks(N, chunkSize);
+    ChunkCacheImpl cache(1024 * 1024, *getDefaultPool());
+    ChunkCacheStream cacheStream;
+    cacheStream.cache = &cache;
+    cacheStream.file = "file";
+    cacheStream.streamOffset = 3;
+
+    DecompressionCounters first;
+    std::unique_ptr<SeekableInputStream> stream =
+      createDecompressor(CompressionKind_SNAPPY,
+                         std::unique_ptr<SeekableInputStream>
+                         (new SeekableArrayInputStream(input.data(),
+                                                       input.size(), 100)),
+                         chunkSize * sizeof(int), *getDefaultPool(), &first,
+                         &cacheStream);
+    readInts(*stream, N);
+    EXPECT_EQ(N / chunkSize, cache.getMisses());
+    EXPECT_EQ(N / chunkSize, cache.getNumberOfEntries());
+    EXPECT_EQ(N * sizeof(int), first.decompressedBytes);
+
+    // a second reader of the same stream doesn't decompress anything
+    DecompressionCounters second;
+    stream = createDecompressor(CompressionKind_SNAPPY,
+                                std::unique_ptr<SeekableInputStream>
+                                (new SeekableArrayInputStream(input.data(),
+                                                              input.size(),
+                                                              100)),
+                                chunkSize * sizeof(int), *getDefaultPool(),
+                                &second, &cacheStream);
+    readInts(*stream, N);
+    EXPECT_EQ(N / chunkSize, cache.getHits());
+    EXPECT_EQ(0, second.decompressedBytes);
+
+    // seeking finds the chunks by their offset in the stream
+    std::list<uint64_t> offsets;
+    offsets.push_back(0);
+    offsets.push_back(8);
+    PositionProvider posn(offsets);
+    stream->seek(posn);
+    const void *data;
+    int length;
+    ASSERT_TRUE(stream->Next(&data, &length));
+    EXPECT_EQ(chunkSize * static_cast<int>(sizeof(int)) - 8, length);
+    EXPECT_EQ(2, (reinterpret_cast<const int *>(data))[0]);
+    EXPECT_EQ(0, second.decompressedBytes);
+  }
+}
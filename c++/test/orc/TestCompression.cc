@@ -19,6 +19,8 @@
 #include "orc/Compression.hh"
 #include "orc/Exceptions.hh"
 #include "wrap/gtest-wrapper.h"
+#include "Lz4Compress.hh"
+#include "LzoCompress.hh"
 #include "OrcTest.hh"
 
 #include <cstdio>
@@ -29,6 +31,8 @@
 #include "zlib.h"
 #include "wrap/snappy-wrapper.h"
 
+#include "zstd.h"
+
 namespace orc {
 
   class TestCompression : public ::testing::Test {
@@ -232,6 +236,32 @@ namespace orc {
     EXPECT_EQ(200, stream.ByteCount());
   }
 
+  TEST_F(TestCompression, testFileContiguous) {
+    SCOPED_TRACE("testFileContiguous");
+    std::unique_ptr<InputStream> file = readLocalFile(simpleFile);
+    SeekableFileInputStream stream(file.get(), 0, 200, 20);
+    const void *ptr;
+    int len;
+    ASSERT_EQ(true, stream.Next(&ptr, &len));
+    EXPECT_EQ(20, len);
+    stream.BackUp(15);
+    // within the backed up bytes
+    ASSERT_EQ(true, stream.nextContiguous(&ptr, 5));
+    checkBytes(static_cast<const char*>(ptr), 5, 5);
+    // past the end of the buffer
+    ASSERT_EQ(true, stream.nextContiguous(&ptr, 50));
+    checkBytes(static_cast<const char*>(ptr), 50, 10);
+    EXPECT_EQ(60, stream.ByteCount());
+    ASSERT_EQ(true, stream.Next(&ptr, &len));
+    EXPECT_EQ(20, len);
+    checkBytes(static_cast<const char*>(ptr), len, 60);
+    ASSERT_EQ(false, stream.nextContiguous(&ptr, 121));
+    EXPECT_EQ(80, stream.ByteCount());
+    ASSERT_EQ(true, stream.nextContiguous(&ptr, 120));
+    checkBytes(static_cast<const char*>(ptr), 120, 80);
+    ASSERT_EQ(true, !stream.Next(&ptr, &len));
+  }
+
   TEST_F(TestCompression, testFileSkip) {
     SCOPED_TRACE("testFileSkip");
     std::unique_ptr<InputStream> file = readLocalFile(simpleFile);
@@ -327,12 +357,60 @@ namespace orc {
   }
 
   TEST_F(TestCompression, testCreateLzo) {
-    const unsigned char buffer[] = {0};
-    EXPECT_THROW(createDecompressor(CompressionKind_LZO,
-                             std::unique_ptr<SeekableInputStream>
-                                    (new SeekableArrayInputStream(buffer, 0)),
-                                    32768, *getDefaultPool()),
-                 NotImplementedYet);
+    const unsigned char buffer[] = {0x0b, 0x0, 0x0, 0x1, 0x2, 0x3, 0x4, 0x5};
+    std::unique_ptr<SeekableInputStream> result =
+      createDecompressor(CompressionKind_LZO,
+                         std::unique_ptr<SeekableInputStream>
+                         (new SeekableArrayInputStream
+                          (buffer, ARRAY_SIZE(buffer))),
+                         32768, *getDefaultPool());
+    EXPECT_EQ("lzo(SeekableArrayInputStream 0 of 8)", result->getName());
+    const void *ptr;
+    int length;
+    ASSERT_EQ(true, result->Next(&ptr, &length));
+    ASSERT_EQ(5, length);
+    for(int i=0; i < 5; ++i) {
+      EXPECT_EQ(i + 1, static_cast<const char*>(ptr)[i]);
+    }
+    ASSERT_EQ(false, result->Next(&ptr, &length));
+  }
+
+  TEST_F(TestCompression, testCreateLz4) {
+    const unsigned char buffer[] = {0x0b, 0x0, 0x0, 0x1, 0x2, 0x3, 0x4, 0x5};
+    std::unique_ptr<SeekableInputStream> result =
+      createDecompressor(CompressionKind_LZ4,
+                         std::unique_ptr<SeekableInputStream>
+                         (new SeekableArrayInputStream
+                          (buffer, ARRAY_SIZE(buffer))),
+                         32768, *getDefaultPool());
+    EXPECT_EQ("lz4(SeekableArrayInputStream 0 of 8)", result->getName());
+    const void *ptr;
+    int length;
+    ASSERT_EQ(true, result->Next(&ptr, &length));
+    ASSERT_EQ(5, length);
+    for(int i=0; i < 5; ++i) {
+      EXPECT_EQ(i + 1, static_cast<const char*>(ptr)[i]);
+    }
+    ASSERT_EQ(false, result->Next(&ptr, &length));
+  }
+
+  TEST_F(TestCompression, testCreateZstd) {
+    const unsigned char buffer[] = {0x0b, 0x0, 0x0, 0x1, 0x2, 0x3, 0x4, 0x5};
+    std::unique_ptr<SeekableInputStream> result =
+      createDecompressor(CompressionKind_ZSTD,
+                         std::unique_ptr<SeekableInputStream>
+                         (new SeekableArrayInputStream
+                          (buffer, ARRAY_SIZE(buffer))),
+                         32768, *getDefaultPool());
+    EXPECT_EQ("zstd(SeekableArrayInputStream 0 of 8)", result->getName());
+    const void *ptr;
+    int length;
+    ASSERT_EQ(true, result->Next(&ptr, &length));
+    ASSERT_EQ(5, length);
+    for(int i=0; i < 5; ++i) {
+      EXPECT_EQ(i + 1, static_cast<const char*>(ptr)[i]);
+    }
+    ASSERT_EQ(false, result->Next(&ptr, &length));
   }
 
   TEST(Zlib, testCreateZlib) {
@@ -480,17 +558,21 @@ namespace orc {
     int length;
     ASSERT_EQ(true, result->Next(&ptr, &length));
     ASSERT_EQ(2, length);
+    // the skipped literal bytes are never read from the input
     result->Skip(2);
     ASSERT_EQ(true, result->Next(&ptr, &length));
-    ASSERT_EQ(3, length);
+    ASSERT_EQ(5, length);
     EXPECT_EQ(4, static_cast<const char*>(ptr)[0]);
     EXPECT_EQ(5, static_cast<const char*>(ptr)[1]);
     EXPECT_EQ(6, static_cast<const char*>(ptr)[2]);
-    result->BackUp(2);
+    EXPECT_EQ(7, static_cast<const char*>(ptr)[3]);
+    EXPECT_EQ(8, static_cast<const char*>(ptr)[4]);
+    result->BackUp(4);
     ASSERT_EQ(true, result->Next(&ptr, &length));
-    ASSERT_EQ(2, length);
+    ASSERT_EQ(4, length);
     EXPECT_EQ(5, static_cast<const char*>(ptr)[0]);
     EXPECT_EQ(6, static_cast<const char*>(ptr)[1]);
+    result->BackUp(2);
     result->Skip(8);
     ASSERT_EQ(true, result->Next(&ptr, &length));
     ASSERT_EQ(2, length);
@@ -644,4 +726,753 @@ namespace orc {
     }
   }
 
+  TEST(Lzo, testBasic) {
+    const int N = 1024;
+    std::vector<char> buf(N * sizeof(int));
+    for (int i=0; i < N; ++i) {
+      (reinterpret_cast<int *>(buf.data()))[i] = i % 8;
+    }
+
+    CompressBuffer compressBuffer(lzoMaxCompressedLength(buf.size()));
+    size_t compressedSize = lzoCompress(buf.data(), buf.size(),
+                                        compressBuffer.getCompressed());
+    // compressed size must be < original
+    ASSERT_LT(compressedSize, buf.size());
+    compressBuffer.writeHeader(compressedSize);
+
+    const long blockSize = 3;
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_LZO,
+         std::unique_ptr<SeekableInputStream>
+           (new SeekableArrayInputStream(compressBuffer.getBuffer(),
+                                         compressBuffer.getBufferSize(),
+                                         blockSize)),
+         buf.size(),
+         *getDefaultPool());
+    const void *data;
+    int length;
+    ASSERT_TRUE(result->Next(&data, &length));
+    ASSERT_EQ(N * sizeof(int), length);
+    for (int i=0; i < N; ++i) {
+      EXPECT_EQ(i % 8, (reinterpret_cast<const int *>(data))[i]);
+    }
+    ASSERT_FALSE(result->Next(&data, &length));
+  }
+
+  TEST(Lzo, testMultiBuffer) {
+    const int N = 1024;
+    std::vector<char> buf(N * sizeof(int));
+    for (int i=0; i < N; ++i) {
+      (reinterpret_cast<int *>(buf.data()))[i] = i % 8;
+    }
+
+    CompressBuffer compressBuffer(lzoMaxCompressedLength(buf.size()));
+    size_t compressedSize = lzoCompress(buf.data(), buf.size(),
+                                        compressBuffer.getCompressed());
+    // compressed size must be < original
+    ASSERT_LT(compressedSize, buf.size());
+    compressBuffer.writeHeader(compressedSize);
+
+    std::vector<char> input(compressBuffer.getBufferSize() * 4);
+    for (size_t i=0; i < 4; ++i) {
+      ::memcpy(input.data() + i * compressBuffer.getBufferSize(),
+               compressBuffer.getBuffer(), compressBuffer.getBufferSize());
+    }
+
+    const long blockSize = 3;
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_LZO,
+         std::unique_ptr<SeekableInputStream>
+         (new SeekableArrayInputStream(input.data(), input.size(), blockSize)),
+         buf.size(),
+         *getDefaultPool());
+    for (int i=0; i < 4; ++i) {
+      const void *data;
+      int length;
+      ASSERT_TRUE(result->Next(&data, &length));
+      ASSERT_EQ(N * sizeof(int), length);
+      for (int j=0; j < N; ++j) {
+          EXPECT_EQ(j % 8, (reinterpret_cast<const int *>(data))[j]);
+      }
+    }
+  }
+
+  TEST(Lzo, testSkip) {
+    const int N = 1024;
+    std::vector<char> buf(N * sizeof(int));
+    for (int i=0; i < N; ++i) {
+      (reinterpret_cast<int *>(buf.data()))[i] = i % 8;
+    }
+
+    CompressBuffer compressBuffer(lzoMaxCompressedLength(buf.size()));
+    size_t compressedSize = lzoCompress(buf.data(), buf.size(),
+                                        compressBuffer.getCompressed());
+    // compressed size must be < original
+    ASSERT_LT(compressedSize, buf.size());
+    compressBuffer.writeHeader(compressedSize);
+
+    const long blockSize = 3;
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_LZO,
+         std::unique_ptr<SeekableInputStream>
+           (new SeekableArrayInputStream(compressBuffer.getBuffer(),
+                                         compressBuffer.getBufferSize(),
+                                         blockSize)),
+         buf.size(),
+         *getDefaultPool());
+    const void *data;
+    int length;
+    // skip 1/2; in 2 jumps
+    ASSERT_TRUE(result->Skip(static_cast<int>(((N / 2) - 2) * sizeof(int))));
+    ASSERT_TRUE(result->Skip(static_cast<int>(2 * sizeof(int))));
+    ASSERT_TRUE(result->Next(&data, &length));
+    ASSERT_EQ((N / 2) * sizeof(int), length);
+    for (int i=N/2; i < N; ++i) {
+      EXPECT_EQ(i % 8, (reinterpret_cast<const int *>(data))[i - N/2]);
+    }
+  }
+
+  TEST(Lzo, testCorruptBlock) {
+    // a match that reaches before the start of the block
+    const unsigned char buffer[] = {0x16, 0x0, 0x0, 0x15, 'a', 'b', 'c', 'd',
+                                    0x20 | 4, 0xff, 0xff, 0x11, 0x0, 0x0};
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_LZO,
+         std::unique_ptr<SeekableInputStream>
+         (new SeekableArrayInputStream(buffer, ARRAY_SIZE(buffer))),
+         1024,
+         *getDefaultPool());
+    const void *data;
+    int length;
+    EXPECT_THROW(result->Next(&data, &length), ParseError);
+  }
+  /**
+   * Build a stream of compressed chunks holding the ints 0 to N - 1 mod 8,
+   * with one chunk for every chunkSize values.
+   */
+  static std::vector<char> compressInts(uint64_t (*compress)(const char*,
+                                                             uint64_t,
+                                                             char*,
+                                                             uint64_t),
+                                        uint64_t maxCompressedLength,
+                                        int N,
+                                        int chunkSize) {
+    std::vector<char> result;
+    std::vector<char> chunk(static_cast<size_t>(chunkSize) * sizeof(int));
+    std::vector<char> compressed(maxCompressedLength);
+    for(int start=0; start < N; start += chunkSize) {
+      for(int i=0; i < chunkSize; ++i) {
+        (reinterpret_cast<int *>(chunk.data()))[i] = (start + i) % 8;
+      }
+      uint64_t size = compress(chunk.data(), chunk.size(),
+                               compressed.data(), compressed.size());
+      // compressed size must be < original
+      EXPECT_LT(size, chunk.size());
+      result.push_back(static_cast<char>(size << 1));
+      result.push_back(static_cast<char>(size >> 7));
+      result.push_back(static_cast<char>(size >> 15));
+      result.insert(result.end(), compressed.begin(),
+                    compressed.begin() + static_cast<long>(size));
+    }
+    return result;
+  }
+
+  static uint64_t compressLz4(const char* input,
+                              uint64_t length,
+                              char* output,
+                              uint64_t) {
+    return lz4Compress(input, length, output);
+  }
+
+  static uint64_t compressSnappy(const char* input,
+                                 uint64_t length,
+                                 char* output,
+                                 uint64_t) {
+    size_t result;
+    snappy::RawCompress(input, length, output, &result);
+    return result;
+  }
+
+  /**
+   * Check seeking to the middle of each chunk of a stream from
+   * compressInts.
+   */
+  static void checkSeek(CompressionKind kind,
+                        const std::vector<char>& input,
+                        int N,
+                        int chunkSize) {
+    // find where each chunk starts
+    std::vector<uint64_t> chunkOffsets;
+    for(uint64_t offset=0; offset < input.size(); ) {
+      chunkOffsets.push_back(offset);
+      uint64_t header = static_cast<unsigned char>(input[offset]) |
+        (static_cast<uint64_t>(static_cast<unsigned char>
+                               (input[offset + 1])) << 8) |
+        (static_cast<uint64_t>(static_cast<unsigned char>
+                               (input[offset + 2])) << 16);
+      offset += 3 + (header >> 1);
+    }
+    ASSERT_EQ(static_cast<size_t>(N / chunkSize), chunkOffsets.size());
+
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (kind,
+         std::unique_ptr<SeekableInputStream>
+         (new SeekableArrayInputStream(input.data(), input.size(), 5)),
+         static_cast<uint64_t>(chunkSize) * sizeof(int),
+         *getDefaultPool());
+    // visit the chunks backwards
+    for(size_t c=chunkOffsets.size(); c-- > 0; ) {
+      std::list<uint64_t> offsets;
+      offsets.push_back(chunkOffsets[c]);
+      offsets.push_back(static_cast<uint64_t>(chunkSize / 2) * sizeof(int));
+      PositionProvider posn(offsets);
+      result->seek(posn);
+      const void *data;
+      int length;
+      ASSERT_TRUE(result->Next(&data, &length));
+      ASSERT_EQ((chunkSize / 2) * static_cast<int>(sizeof(int)), length);
+      int first = static_cast<int>(c) * chunkSize + chunkSize / 2;
+      for(int i=0; i < chunkSize / 2; ++i) {
+        EXPECT_EQ((first + i) % 8,
+                  (reinterpret_cast<const int *>(data))[i]);
+      }
+    }
+  }
+
+  TEST(Lz4, testBasic) {
+    const int N = 1024;
+    std::vector<char> input = compressInts(compressLz4,
+                                           lz4MaxCompressedLength
+                                           (N * sizeof(int)),
+                                           N, N);
+
+    const long blockSize = 3;
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_LZ4,
+         std::unique_ptr<SeekableInputStream>
+         (new SeekableArrayInputStream(input.data(), input.size(),
+                                       blockSize)),
+         N * sizeof(int),
+         *getDefaultPool());
+    const void *data;
+    int length;
+    ASSERT_TRUE(result->Next(&data, &length));
+    ASSERT_EQ(N * sizeof(int), length);
+    for (int i=0; i < N; ++i) {
+      EXPECT_EQ(i % 8, (reinterpret_cast<const int *>(data))[i]);
+    }
+    ASSERT_FALSE(result->Next(&data, &length));
+  }
+
+  TEST(Lz4, testMultiBuffer) {
+    const int N = 4096;
+    const int chunkSize = 1024;
+    std::vector<char> input = compressInts(compressLz4,
+                                           lz4MaxCompressedLength
+                                           (chunkSize * sizeof(int)),
+                                           N, chunkSize);
+
+    const long blockSize = 3;
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_LZ4,
+         std::unique_ptr<SeekableInputStream>
+         (new SeekableArrayInputStream(input.data(), input.size(), blockSize)),
+         chunkSize * sizeof(int),
+         *getDefaultPool());
+    for (int i=0; i < N / chunkSize; ++i) {
+      const void *data;
+      int length;
+      ASSERT_TRUE(result->Next(&data, &length));
+      ASSERT_EQ(chunkSize * sizeof(int), length);
+      for (int j=0; j < chunkSize; ++j) {
+          EXPECT_EQ(j % 8, (reinterpret_cast<const int *>(data))[j]);
+      }
+    }
+  }
+
+  TEST(Lz4, testSkip) {
+    const int N = 1024;
+    std::vector<char> input = compressInts(compressLz4,
+                                           lz4MaxCompressedLength
+                                           (N * sizeof(int)),
+                                           N, N);
+
+    const long blockSize = 3;
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_LZ4,
+         std::unique_ptr<SeekableInputStream>
+         (new SeekableArrayInputStream(input.data(), input.size(),
+                                       blockSize)),
+         N * sizeof(int),
+         *getDefaultPool());
+    const void *data;
+    int length;
+    // skip 1/2; in 2 jumps
+    ASSERT_TRUE(result->Skip(static_cast<int>(((N / 2) - 2) * sizeof(int))));
+    ASSERT_TRUE(result->Skip(static_cast<int>(2 * sizeof(int))));
+    ASSERT_TRUE(result->Next(&data, &length));
+    ASSERT_EQ((N / 2) * sizeof(int), length);
+    for (int i=N/2; i < N; ++i) {
+      EXPECT_EQ(i % 8, (reinterpret_cast<const int *>(data))[i - N/2]);
+    }
+  }
+
+  TEST(Lz4, testSeek) {
+    const int N = 4096;
+    const int chunkSize = 1024;
+    checkSeek(CompressionKind_LZ4,
+              compressInts(compressLz4,
+                           lz4MaxCompressedLength(chunkSize * sizeof(int)),
+                           N, chunkSize),
+              N, chunkSize);
+  }
+
+  TEST(Lz4, testCorruptBlock) {
+    // a match that reaches before the start of the block
+    const unsigned char buffer[] = {0x10, 0x0, 0x0, 0x40, 'a', 'b', 'c', 'd',
+                                    0x10, 0x0, 0x00};
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_LZ4,
+         std::unique_ptr<SeekableInputStream>
+         (new SeekableArrayInputStream(buffer, ARRAY_SIZE(buffer))),
+         1024,
+         *getDefaultPool());
+    const void *data;
+    int length;
+    EXPECT_THROW(result->Next(&data, &length), ParseError);
+  }
+
+  TEST(Lz4, testSkipCorruptChunk) {
+    // the same bad match, followed by an original chunk
+    const unsigned char buffer[] = {0x10, 0x0, 0x0, 0x40, 'a', 'b', 'c', 'd',
+                                    0x10, 0x0, 0x0, 0x7, 0x0, 0x0, 0x1, 0x2,
+                                    0x3};
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_LZ4,
+         std::unique_ptr<SeekableInputStream>
+         (new SeekableArrayInputStream(buffer, ARRAY_SIZE(buffer))),
+         1024,
+         *getDefaultPool());
+    // skipping the whole chunk only needs its length
+    ASSERT_TRUE(result->Skip(9));
+    EXPECT_EQ(9, result->ByteCount());
+    const void *data;
+    int length;
+    ASSERT_TRUE(result->Next(&data, &length));
+    ASSERT_EQ(2, length);
+    EXPECT_EQ(2, static_cast<const char*>(data)[0]);
+    EXPECT_EQ(3, static_cast<const char*>(data)[1]);
+    ASSERT_FALSE(result->Next(&data, &length));
+  }
+
+  TEST(Snappy, testSkipCorruptChunk) {
+    const int N = 1024;
+    const int chunkSize = 256;
+    std::vector<char> input = compressInts(compressSnappy,
+                                           snappy::MaxCompressedLength
+                                           (chunkSize * sizeof(int)),
+                                           N, chunkSize);
+    // garble the first chunk after its length prefix
+    size_t firstLength = (static_cast<unsigned char>(input[0]) |
+                          (static_cast<size_t>(static_cast<unsigned char>
+                                               (input[1])) << 8)) >> 1;
+    for(size_t i=5; i < 3 + firstLength; ++i) {
+      input[i] = static_cast<char>(0xff);
+    }
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_SNAPPY,
+         std::unique_ptr<SeekableInputStream>
+         (new SeekableArrayInputStream(input.data(), input.size())),
+         chunkSize * sizeof(int),
+         *getDefaultPool());
+    // skip the first chunk and half of the second
+    ASSERT_TRUE(result->Skip(static_cast<int>((chunkSize + chunkSize / 2) *
+                                              sizeof(int))));
+    const void *data;
+    int length;
+    ASSERT_TRUE(result->Next(&data, &length));
+    ASSERT_EQ((chunkSize / 2) * sizeof(int), length);
+    for (int i=0; i < chunkSize / 2; ++i) {
+      EXPECT_EQ((chunkSize / 2 + i) % 8,
+                (reinterpret_cast<const int *>(data))[i]);
+    }
+    // and then the rest of the stream in one go
+    ASSERT_TRUE(result->Skip(static_cast<int>(2 * chunkSize * sizeof(int))));
+    ASSERT_FALSE(result->Next(&data, &length));
+  }
+
+  TEST(Zlib, testSkipLiteralBlocks) {
+    const unsigned char buffer[] = {0x19, 0x0, 0x0, 0x0, 0x1,
+                                    0x2, 0x3, 0x4, 0x5, 0x6,
+                                    0x7, 0x8, 0x9, 0xa, 0xb,
+                                    0xb, 0x0, 0x0, 0xc, 0xd,
+                                    0xe, 0xf, 0x10};
+    std::unique_ptr<SeekableInputStream> result =
+      createDecompressor(CompressionKind_ZLIB,
+                         std::unique_ptr<SeekableInputStream>
+                         (new SeekableArrayInputStream
+                          (buffer, ARRAY_SIZE(buffer), 5)),
+                         5, *getDefaultPool());
+    const void *ptr;
+    int length;
+    ASSERT_TRUE(result->Next(&ptr, &length));
+    ASSERT_EQ(2, length);
+    result->BackUp(1);
+    // across the rest of the first chunk and into the second one
+    ASSERT_TRUE(result->Skip(13));
+    EXPECT_EQ(14, result->ByteCount());
+    ASSERT_TRUE(result->Next(&ptr, &length));
+    ASSERT_EQ(3, length);
+    EXPECT_EQ(14, static_cast<const char*>(ptr)[0]);
+    EXPECT_EQ(15, static_cast<const char*>(ptr)[1]);
+    EXPECT_EQ(16, static_cast<const char*>(ptr)[2]);
+    ASSERT_FALSE(result->Skip(1));
+  }
+
+  /**
+   * A stream that only returns its bytes in small pieces, like an input
+   * that can't read a range on demand.
+   */
+  class PiecewiseInputStream: public SeekableInputStream {
+  private:
+    SeekableArrayInputStream array;
+
+  public:
+    PiecewiseInputStream(const char* data, uint64_t length, int64_t blockSize
+                         ): array(data, length, blockSize) {
+      // PASS
+    }
+
+    bool Next(const void** data, int* size) override {
+      return array.Next(data, size);
+    }
+
+    void BackUp(int count) override {
+      array.BackUp(count);
+    }
+
+    bool Skip(int count) override {
+      return array.Skip(count);
+    }
+
+    google::protobuf::int64 ByteCount() const override {
+      return array.ByteCount();
+    }
+
+    void seek(PositionProvider& position) override {
+      array.seek(position);
+    }
+
+    std::string getName() const override {
+      return "piecewise";
+    }
+  };
+
+  TEST(Snappy, testContiguousChunks) {
+    const int N = 1024;
+    const int chunkSize = 256;
+    std::vector<char> input = compressInts(compressSnappy,
+                                           snappy::MaxCompressedLength
+                                           (chunkSize * sizeof(int)),
+                                           N, chunkSize);
+    for (int piecewise=0; piecewise < 2; ++piecewise) {
+      DecompressionCounters counters;
+      std::unique_ptr<SeekableInputStream> inStream;
+      if (piecewise) {
+        inStream.reset(new PiecewiseInputStream(input.data(), input.size(),
+                                                5));
+      } else {
+        inStream.reset(new SeekableArrayInputStream(input.data(),
+                                                    input.size(), 5));
+      }
+      std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_SNAPPY, std::move(inStream),
+         chunkSize * sizeof(int), *getDefaultPool(), &counters);
+      for (int i=0; i < N / chunkSize; ++i) {
+        const void *data;
+        int length;
+        ASSERT_TRUE(result->Next(&data, &length));
+        ASSERT_EQ(chunkSize * sizeof(int), length);
+        for (int j=0; j < chunkSize; ++j) {
+          EXPECT_EQ(j % 8, (reinterpret_cast<const int *>(data))[j]);
+        }
+      }
+      EXPECT_EQ(N * sizeof(int), counters.decompressedBytes);
+      EXPECT_EQ(0, counters.passedThroughBytes);
+      // only the piecewise stream needs the chunks copied together
+      EXPECT_EQ(piecewise ? input.size() - 3 * (N / chunkSize) : 0,
+                counters.copiedBytes);
+    }
+  }
+
+  TEST(Zlib, testPassedThroughCounter) {
+    const unsigned char buffer[] = {0x19, 0x0, 0x0, 0x0, 0x1,
+                                    0x2, 0x3, 0x4, 0x5, 0x6,
+                                    0x7, 0x8, 0x9, 0xa, 0xb,
+                                    0xb, 0x0, 0x0, 0xc, 0xd,
+                                    0xe, 0xf, 0x10};
+    DecompressionCounters counters;
+    std::unique_ptr<SeekableInputStream> result =
+      createDecompressor(CompressionKind_ZLIB,
+                         std::unique_ptr<SeekableInputStream>
+                         (new SeekableArrayInputStream
+                          (buffer, ARRAY_SIZE(buffer), 5)),
+                         5, *getDefaultPool(), &counters);
+    const void *ptr;
+    int length;
+    while (result->Next(&ptr, &length)) {
+      // PASS
+    }
+    EXPECT_EQ(17, counters.passedThroughBytes);
+    EXPECT_EQ(0, counters.decompressedBytes);
+    EXPECT_EQ(0, counters.copiedBytes);
+  }
+
+  static uint64_t compressZstd(const char* input,
+                               uint64_t length,
+                               char* output,
+                               uint64_t outputLength) {
+    size_t result = ZSTD_compress(output, outputLength, input, length, 3);
+    EXPECT_FALSE(ZSTD_isError(result));
+    return result;
+  }
+
+  TEST(Zstd, testBasic) {
+    const int N = 1024;
+    std::vector<char> input = compressInts(compressZstd,
+                                           ZSTD_compressBound
+                                           (N * sizeof(int)),
+                                           N, N);
+
+    const long blockSize = 3;
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_ZSTD,
+         std::unique_ptr<SeekableInputStream>
+         (new SeekableArrayInputStream(input.data(), input.size(),
+                                       blockSize)),
+         N * sizeof(int),
+         *getDefaultPool());
+    const void *data;
+    int length;
+    ASSERT_TRUE(result->Next(&data, &length));
+    ASSERT_EQ(N * sizeof(int), length);
+    for (int i=0; i < N; ++i) {
+      EXPECT_EQ(i % 8, (reinterpret_cast<const int *>(data))[i]);
+    }
+    ASSERT_FALSE(result->Next(&data, &length));
+  }
+
+  TEST(Zstd, testMultiBuffer) {
+    const int N = 4096;
+    const int chunkSize = 1024;
+    std::vector<char> input = compressInts(compressZstd,
+                                           ZSTD_compressBound
+                                           (chunkSize * sizeof(int)),
+                                           N, chunkSize);
+
+    const long blockSize = 3;
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_ZSTD,
+         std::unique_ptr<SeekableInputStream>
+         (new SeekableArrayInputStream(input.data(), input.size(), blockSize)),
+         chunkSize * sizeof(int),
+         *getDefaultPool());
+    for (int i=0; i < N / chunkSize; ++i) {
+      const void *data;
+      int length;
+      ASSERT_TRUE(result->Next(&data, &length));
+      ASSERT_EQ(chunkSize * sizeof(int), length);
+      for (int j=0; j < chunkSize; ++j) {
+          EXPECT_EQ(j % 8, (reinterpret_cast<const int *>(data))[j]);
+      }
+    }
+  }
+
+  TEST(Zstd, testSkip) {
+    const int N = 1024;
+    std::vector<char> input = compressInts(compressZstd,
+                                           ZSTD_compressBound
+                                           (N * sizeof(int)),
+                                           N, N);
+
+    const long blockSize = 3;
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_ZSTD,
+         std::unique_ptr<SeekableInputStream>
+         (new SeekableArrayInputStream(input.data(), input.size(),
+                                       blockSize)),
+         N * sizeof(int),
+         *getDefaultPool());
+    const void *data;
+    int length;
+    // skip 1/2; in 2 jumps
+    ASSERT_TRUE(result->Skip(static_cast<int>(((N / 2) - 2) * sizeof(int))));
+    ASSERT_TRUE(result->Skip(static_cast<int>(2 * sizeof(int))));
+    ASSERT_TRUE(result->Next(&data, &length));
+    ASSERT_EQ((N / 2) * sizeof(int), length);
+    for (int i=N/2; i < N; ++i) {
+      EXPECT_EQ(i % 8, (reinterpret_cast<const int *>(data))[i - N/2]);
+    }
+  }
+
+  TEST(Zstd, testSeek) {
+    const int N = 4096;
+    const int chunkSize = 1024;
+    checkSeek(CompressionKind_ZSTD,
+              compressInts(compressZstd,
+                           ZSTD_compressBound(chunkSize * sizeof(int)),
+                           N, chunkSize),
+              N, chunkSize);
+  }
+
+  TEST(Zstd, testCorruptBlock) {
+    // not a zstd frame
+    const unsigned char buffer[] = {0x10, 0x0, 0x0, 0x28, 0xb5, 0x2f, 0xfd,
+                                    0x00, 0x01, 0x02, 0x03};
+    std::unique_ptr<SeekableInputStream> result = createDecompressor
+        (CompressionKind_ZSTD,
+         std::unique_ptr<SeekableInputStream>
+         (new SeekableArrayInputStream(buffer, ARRAY_SIZE(buffer))),
+         1024,
+         *getDefaultPool());
+    const void *data;
+    int length;
+    EXPECT_THROW(result->Next(&data, &length), ParseError);
+  }
+
+  TEST(ChunkIndex, testSkipChunks) {
+    ChunkIndex index;
+    index.addChunk(0, 10, false);
+    index.addChunk(13, 20, true);
+    index.addChunk(36, 5, false);
+    EXPECT_EQ(3, index.size());
+    EXPECT_EQ(ChunkIndex::UNKNOWN_LENGTH,
+              index.findChunk(0)->uncompressedLength);
+    EXPECT_EQ(20, index.findChunk(13)->uncompressedLength);
+    EXPECT_EQ(nullptr, index.findChunk(1));
+
+    uint64_t compressedBytes;
+    // the first chunk's length isn't known
+    EXPECT_EQ(0, index.skipChunks(0, 1000, &compressedBytes));
+    EXPECT_EQ(0, compressedBytes);
+    index.setUncompressedLength(0, 100);
+    index.setUncompressedLength(36, 50);
+    EXPECT_EQ(170, index.skipChunks(0, 1000, &compressedBytes));
+    EXPECT_EQ(44, compressedBytes);
+    // only whole chunks are skipped
+    EXPECT_EQ(120, index.skipChunks(0, 169, &compressedBytes));
+    EXPECT_EQ(36, compressedBytes);
+    EXPECT_EQ(70, index.skipChunks(13, 1000, &compressedBytes));
+    EXPECT_EQ(31, compressedBytes);
+
+    // a different chunk at the same offset replaces the old one
+    index.addChunk(36, 6, false);
+    EXPECT_EQ(ChunkIndex::UNKNOWN_LENGTH,
+              index.findChunk(36)->uncompressedLength);
+    index.addChunk(0, 10, false);
+    EXPECT_EQ(100, index.findChunk(0)->uncompressedLength);
+  }
+
+  static uint64_t compressZlib(const char* input,
+                               uint64_t length,
+                               char* output,
+                               uint64_t outputLength) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    EXPECT_EQ(Z_OK, deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                                 -15, 8, Z_DEFAULT_STRATEGY));
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+    stream.avail_in = static_cast<uInt>(length);
+    stream.next_out = reinterpret_cast<Bytef*>(output);
+    stream.avail_out = static_cast<uInt>(outputLength);
+    EXPECT_EQ(Z_STREAM_END, deflate(&stream, Z_FINISH));
+    uint64_t result = stream.total_out;
+    deflateEnd(&stream);
+    return result;
+  }
+
+  static void seekTo(SeekableInputStream& stream,
+                     uint64_t chunkOffset,
+                     uint64_t offset) {
+    std::list<uint64_t> offsets;
+    offsets.push_back(chunkOffset);
+    offsets.push_back(offset);
+    PositionProvider posn(offsets);
+    stream.seek(posn);
+  }
+
+  /**
+   * Check that seeks into the chunk that was just read and skips over
+   * chunks that were read before don't decompress anything.
+   */
+  static void checkIndexedSeeks(CompressionKind kind,
+                                const std::vector<char>& input,
+                                int N,
+                                int chunkSize) {
+    DecompressionCounters counters;
+    uint64_t chunkBytes = static_cast<uint64_t>(chunkSize) * sizeof(int);
+    std::unique_ptr<SeekableInputStream> stream = createDecompressor
+        (kind,
+         std::unique_ptr<SeekableInputStream>
+         (new SeekableArrayInputStream(input.data(), input.size(), 7)),
+         chunkBytes, *getDefaultPool(), &counters);
+    const void *data;
+    int length;
+    ASSERT_TRUE(stream->Next(&data, &length));
+    ASSERT_EQ(chunkBytes, length);
+    EXPECT_EQ(chunkBytes, counters.decompressedBytes);
+
+    // back into the middle of the first chunk
+    seekTo(*stream, 0, 8);
+    EXPECT_EQ(8, stream->ByteCount());
+    ASSERT_TRUE(stream->Next(&data, &length));
+    ASSERT_EQ(chunkBytes - 8, length);
+    EXPECT_EQ(2, static_cast<const int*>(data)[0]);
+    EXPECT_EQ(chunkBytes, counters.decompressedBytes);
+
+    // read the rest, so that every chunk is in the index
+    while (stream->Next(&data, &length)) {
+      // PASS
+    }
+    uint64_t total = counters.decompressedBytes;
+    EXPECT_EQ(N * sizeof(int), total);
+
+    // skipping whole chunks that were read doesn't decompress them, so
+    // only the chunk that the skip ends in is decompressed
+    seekTo(*stream, 0, 0);
+    ASSERT_TRUE(stream->Skip(static_cast<int>(3 * chunkBytes + 4)));
+    EXPECT_EQ(total + chunkBytes, counters.decompressedBytes);
+    ASSERT_TRUE(stream->Next(&data, &length));
+    EXPECT_EQ(3 * chunkBytes + 4 + static_cast<uint64_t>(length),
+              stream->ByteCount());
+    EXPECT_EQ((3 * chunkSize + 1) % 8, static_cast<const int*>(data)[0]);
+    EXPECT_EQ(total + chunkBytes, counters.decompressedBytes);
+    ASSERT_TRUE(stream->Skip(static_cast<int>((N / chunkSize - 5) *
+                                              chunkBytes)));
+    EXPECT_EQ(total + chunkBytes, counters.decompressedBytes);
+    ASSERT_TRUE(stream->Next(&data, &length));
+    EXPECT_EQ(chunkBytes, length);
+    EXPECT_FALSE(stream->Next(&data, &length));
+    EXPECT_FALSE(stream->Skip(1));
+  }
+
+  TEST(Zlib, testIndexedSeeks) {
+    const int N = 1024;
+    const int chunkSize = 64;
+    std::vector<char> input = compressInts(compressZlib,
+                                           compressBound(chunkSize *
+                                                         sizeof(int)),
+                                           N, chunkSize);
+    checkIndexedSeeks(CompressionKind_ZLIB, input, N, chunkSize);
+  }
+
+  TEST(Snappy, testIndexedSeeks) {
+    const int N = 1024;
+    const int chunkSize = 64;
+    std::vector<char> input = compressInts(compressSnappy,
+                                           snappy::MaxCompressedLength
+                                           (chunkSize * sizeof(int)),
+                                           N, chunkSize);
+    checkIndexedSeeks(CompressionKind_SNAPPY, input, N, chunkSize);
+  }
 }
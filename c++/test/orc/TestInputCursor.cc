@@ -0,0 +1,155 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Exceptions.hh"
+#include "orc/InputCursor.hh"
+#include "wrap/gtest-wrapper.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace orc {
+
+  /**
+   * Encode values as base 128 varints.
+   */
+  static std::vector<char> encodeVarints(const std::vector<uint64_t>& values) {
+    std::vector<char> result;
+    for(size_t i=0; i < values.size(); ++i) {
+      uint64_t value = values[i];
+      while (value >= 0x80) {
+        result.push_back(static_cast<char>(0x80 | (value & 0x7f)));
+        value >>= 7;
+      }
+      result.push_back(static_cast<char>(value));
+    }
+    return result;
+  }
+
+  TEST(InputCursor, testReadByte) {
+    const char bytes[] = {1, 2, 3, 4, 5};
+    for(int blockSize=1; blockSize < 7; ++blockSize) {
+      SeekableArrayInputStream stream(bytes, sizeof(bytes), blockSize);
+      InputCursor cursor(&stream, "end of test");
+      for(unsigned char i=1; i <= 5; ++i) {
+        EXPECT_EQ(i, cursor.readByte());
+      }
+      EXPECT_THROW(cursor.readByte(), ParseError);
+    }
+  }
+
+  TEST(InputCursor, testReadWindow) {
+    std::vector<char> bytes;
+    for(int i=0; i < 100; ++i) {
+      bytes.push_back(static_cast<char>(i));
+    }
+    for(int blockSize=1; blockSize < 20; ++blockSize) {
+      SeekableArrayInputStream stream(bytes.data(), bytes.size(),
+                                      static_cast<uint64_t>(blockSize));
+      InputCursor cursor(&stream, "end of test");
+      // windows of every size that start in the middle of buffers
+      size_t position = 0;
+      for(size_t length=1; position + length <= bytes.size(); ++length) {
+        length = std::min(length, InputCursor::MAX_WINDOW);
+        const char* window = cursor.read(length);
+        for(size_t i=0; i < length; ++i) {
+          ASSERT_EQ(bytes[position + i], window[i])
+            << "block " << blockSize << " position " << position;
+        }
+        position += length;
+      }
+    }
+  }
+
+  TEST(InputCursor, testReadNumbers) {
+    const char bytes[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                          static_cast<char>(0xf8), 0x11, 0x22, 0x33};
+    for(int blockSize=1; blockSize < 12; ++blockSize) {
+      SeekableArrayInputStream stream(bytes, sizeof(bytes), blockSize);
+      InputCursor cursor(&stream, "end of test");
+      EXPECT_EQ(0x01020304050607f8ULL, cursor.readBigEndian(8));
+      EXPECT_EQ(0x332211ULL, cursor.readLittleEndian(3));
+    }
+  }
+
+  TEST(InputCursor, testReadVarints) {
+    std::vector<uint64_t> values;
+    for(uint32_t shift=0; shift < 64; ++shift) {
+      values.push_back(1ULL << shift);
+      values.push_back((1ULL << shift) - 1);
+    }
+    values.push_back(~static_cast<uint64_t>(0));
+    std::vector<char> bytes = encodeVarints(values);
+    // a varint that is too long keeps its low 64 bits
+    for(int i=0; i < 11; ++i) {
+      bytes.push_back(static_cast<char>(0xff));
+    }
+    bytes.push_back(0x01);
+    bytes.push_back(0x2a);
+    for(int blockSize=1; blockSize < 24; ++blockSize) {
+      SeekableArrayInputStream stream(bytes.data(), bytes.size(),
+                                      static_cast<uint64_t>(blockSize));
+      InputCursor cursor(&stream, "end of test");
+      for(size_t i=0; i < values.size(); ++i) {
+        ASSERT_EQ(values[i], cursor.readVarint())
+          << "block " << blockSize << " value " << i;
+      }
+      EXPECT_EQ(~static_cast<uint64_t>(0), cursor.readVarint());
+      EXPECT_EQ(42, cursor.readVarint());
+      EXPECT_THROW(cursor.readVarint(), ParseError);
+    }
+  }
+
+  TEST(InputCursor, testReadBytesAndSkip) {
+    std::vector<char> bytes;
+    for(int i=0; i < 1000; ++i) {
+      bytes.push_back(static_cast<char>(i * 7));
+    }
+    for(int blockSize=1; blockSize < 300; blockSize += 37) {
+      SeekableArrayInputStream stream(bytes.data(), bytes.size(),
+                                      static_cast<uint64_t>(blockSize));
+      InputCursor cursor(&stream, "end of test");
+      std::vector<char> output(400);
+      cursor.readBytes(output.data(), 400);
+      EXPECT_TRUE(std::equal(output.begin(), output.end(), bytes.begin()));
+      // within the buffer and past it
+      cursor.skip(1);
+      cursor.skip(300);
+      EXPECT_EQ(static_cast<unsigned char>(bytes[701]), cursor.readByte());
+      // the rest of the buffer is dropped
+      cursor.reset();
+      size_t position = static_cast<size_t>(stream.ByteCount());
+      EXPECT_EQ(static_cast<unsigned char>(bytes[position]),
+                cursor.readByte());
+      EXPECT_THROW(cursor.skip(1000), ParseError);
+    }
+  }
+
+  TEST(InputCursor, testErrorMessage) {
+    const char bytes[] = {1};
+    SeekableArrayInputStream stream(bytes, sizeof(bytes));
+    InputCursor cursor(&stream, "bad read in test");
+    cursor.readByte();
+    try {
+      cursor.read(4);
+      FAIL() << "Expected an error";
+    } catch (ParseError& err) {
+      EXPECT_EQ("bad read in test", std::string(err.what()));
+    }
+  }
+}
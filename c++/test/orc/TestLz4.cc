@@ -0,0 +1,160 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Lz4.hh"
+#include "orc/Exceptions.hh"
+#include "wrap/gtest-wrapper.h"
+#include "Lz4Compress.hh"
+
+#include <string>
+#include <vector>
+
+namespace orc {
+
+  static std::string decompress(const std::vector<unsigned char>& input,
+                                uint64_t outputSize = 1024) {
+    std::vector<char> output(outputSize);
+    uint64_t length =
+      lz4Decompress(reinterpret_cast<const char*>(input.data()),
+                    input.size(), output.data(), output.size());
+    return std::string(output.data(), length);
+  }
+
+  static void expectRoundTrip(const std::string& input) {
+    std::vector<char> compressed(lz4MaxCompressedLength(input.size()));
+    uint64_t compressedLength = lz4Compress(input.data(), input.size(),
+                                            compressed.data());
+    ASSERT_LE(compressedLength, compressed.size());
+    std::vector<char> output(input.size() + 1);
+    uint64_t length = lz4Decompress(compressed.data(), compressedLength,
+                                    output.data(), output.size());
+    ASSERT_EQ(input.size(), length);
+    EXPECT_EQ(input, std::string(output.data(), length));
+  }
+
+  TEST(Lz4, testLiterals) {
+    EXPECT_EQ("", decompress({0x00}));
+    EXPECT_EQ("abc", decompress({0x30, 'a', 'b', 'c'}));
+
+    // 15 literals need a zero continuation byte
+    std::vector<unsigned char> input = {0xf0, 0};
+    std::string literals = "abcdefghijklmno";
+    input.insert(input.end(), literals.begin(), literals.end());
+    EXPECT_EQ(literals, decompress(input));
+
+    // 15 + 255 + 30 literals
+    literals = std::string(300, 'q');
+    std::vector<unsigned char> longInput = {0xf0, 255, 30};
+    longInput.insert(longInput.end(), literals.begin(), literals.end());
+    EXPECT_EQ(literals, decompress(longInput));
+  }
+
+  TEST(Lz4, testMatches) {
+    // 4 byte match at distance 4, then the last literals
+    EXPECT_EQ("abcdabcdxyzzy",
+              decompress({0x40, 'a', 'b', 'c', 'd', 4, 0,
+                          0x50, 'x', 'y', 'z', 'z', 'y'}));
+    // overlapping run of a single byte: 1 + 4 + 6
+    EXPECT_EQ(std::string(11, 'a') + "end",
+              decompress({0x16, 'a', 1, 0, 0x30, 'e', 'n', 'd'}));
+    // overlapping match at distance 3
+    EXPECT_EQ("abcabcabcab!",
+              decompress({0x34, 'a', 'b', 'c', 3, 0, 0x10, '!'}));
+    // long match: 4 + 15 + 255 + 10 bytes at distance 8
+    std::string expected;
+    for(int i=0; i < 37; ++i) {
+      expected += "01234567";
+    }
+    expected.resize(8 + 284);
+    expected += "tail";
+    std::vector<unsigned char> input = {0x8f, '0', '1', '2', '3', '4', '5',
+                                        '6', '7', 8, 0, 255, 10,
+                                        0x40, 't', 'a', 'i', 'l'};
+    EXPECT_EQ(expected, decompress(input));
+    // match at the largest distance after 15 + 256 * 255 + 240 literals
+    std::string far(65535, 'x');
+    far[0] = 'y';
+    input.assign(258, 255);
+    input.front() = 0xf0;
+    input.back() = 240;
+    input.insert(input.end(), far.begin(), far.end());
+    input.insert(input.end(), {0xff, 0xff, 0x00});
+    EXPECT_EQ(far + "yxxx", decompress(input, 70000));
+  }
+
+  TEST(Lz4, testCorruption) {
+    // empty input
+    EXPECT_THROW(decompress({}), ParseError);
+    // truncated literals
+    EXPECT_THROW(decompress({0x30, 'a', 'b'}), ParseError);
+    // truncated literal length
+    EXPECT_THROW(decompress({0xf0, 255}), ParseError);
+    // truncated distance
+    EXPECT_THROW(decompress({0x10, 'a', 1}), ParseError);
+    // a match before the start of the output
+    EXPECT_THROW(decompress({0x10, 'a', 2, 0, 0x00}), ParseError);
+    // a zero distance
+    EXPECT_THROW(decompress({0x10, 'a', 0, 0, 0x00}), ParseError);
+    // a sequence that ends with a match
+    EXPECT_THROW(decompress({0x10, 'a', 1, 0}), ParseError);
+    // output that doesn't fit
+    EXPECT_THROW(decompress({0x60, 'a', 'b', 'c', 'd', 'e', 'f'}, 5),
+                 ParseError);
+    EXPECT_THROW(decompress({0x16, 'z', 1, 0, 0x00}, 8), ParseError);
+  }
+
+  TEST(Lz4, testRoundTrip) {
+    expectRoundTrip("");
+    expectRoundTrip("a");
+    expectRoundTrip("abcdabcdabcdabcd");
+    expectRoundTrip(std::string(100000, 'x'));
+
+    // text with matches at every distance and length
+    std::string text;
+    uint64_t seed = 1;
+    for(int i=0; i < 200000; ++i) {
+      seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+      uint64_t choice = seed >> 60;
+      if (choice < 4 && text.size() > 70000) {
+        uint64_t distance = 1 + (seed >> 20) % 70000;
+        uint64_t length = 3 + (seed >> 8) % 400;
+        for(uint64_t j=0; j < length; ++j) {
+          text += text[text.size() - distance];
+        }
+      } else if (choice < 10 && text.size() > 10) {
+        uint64_t distance = 1 + (seed >> 20) % std::min<uint64_t>
+          (text.size(), 3000);
+        uint64_t length = 3 + (seed >> 8) % 12;
+        for(uint64_t j=0; j < length; ++j) {
+          text += text[text.size() - distance];
+        }
+      } else {
+        text += static_cast<char>(seed >> 40);
+      }
+    }
+    expectRoundTrip(text);
+
+    // random bytes don't compress
+    std::string noise;
+    for(int i=0; i < 70000; ++i) {
+      seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+      noise += static_cast<char>(seed >> 56);
+    }
+    expectRoundTrip(noise);
+  }
+}
@@ -0,0 +1,215 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Lzo.hh"
+#include "orc/Exceptions.hh"
+#include "wrap/gtest-wrapper.h"
+#include "LzoCompress.hh"
+
+#include <string>
+#include <vector>
+
+namespace orc {
+
+  static std::string decompress(const std::vector<unsigned char>& input,
+                         uint64_t outputSize = 1024) {
+    std::vector<char> output(outputSize);
+    uint64_t length =
+      lzoDecompress(reinterpret_cast<const char*>(input.data()),
+                    input.size(), output.data(), output.size());
+    return std::string(output.data(), length);
+  }
+
+  /**
+   * Add a run of literals with the 0000LLLL instruction, which is only
+   * valid where the previous instruction didn't copy any literals.
+   */
+  static void appendLiteralRun(std::vector<unsigned char>& input,
+                               const std::string& literals) {
+    input.push_back(0);
+    uint64_t run = literals.size() - 18;
+    while (run > 255) {
+      input.push_back(0);
+      run -= 255;
+    }
+    input.push_back(static_cast<unsigned char>(run));
+    input.insert(input.end(), literals.begin(), literals.end());
+  }
+
+  static void expectRoundTrip(const std::string& input) {
+    std::vector<char> compressed(lzoMaxCompressedLength(input.size()));
+    uint64_t compressedLength = lzoCompress(input.data(), input.size(),
+                                            compressed.data());
+    ASSERT_LE(compressedLength, compressed.size());
+    std::vector<char> output(input.size() + 1);
+    uint64_t length = lzoDecompress(compressed.data(), compressedLength,
+                                    output.data(), output.size());
+    ASSERT_EQ(input.size(), length);
+    EXPECT_EQ(input, std::string(output.data(), length));
+  }
+
+  TEST(Lzo, testFirstLiterals) {
+    // 17 + n literals at the start of the stream
+    EXPECT_EQ("abc", decompress({0x14, 'a', 'b', 'c', 0x11, 0, 0}));
+    EXPECT_EQ("abcdef", decompress({0x17, 'a', 'b', 'c', 'd', 'e', 'f',
+                                    0x11, 0, 0}));
+    EXPECT_EQ("", decompress({0x11, 0, 0}));
+  }
+
+  TEST(Lzo, testLongLiterals) {
+    // 0000LLLL: 3 + L literals
+    std::vector<unsigned char> input = {0x02, 'a', 'b', 'c', 'd', 'e',
+                                        0x11, 0, 0};
+    EXPECT_EQ("abcde", decompress(input));
+
+    // a long run of 18 + 255 * zeros + n literals
+    std::string expected(18 + 255 + 7, 'x');
+    input = {0x00, 0x00, 0x07};
+    input.insert(input.end(), expected.begin(), expected.end());
+    input.insert(input.end(), {0x11, 0, 0});
+    EXPECT_EQ(expected, decompress(input));
+  }
+
+  TEST(Lzo, testShortMatches) {
+    // 01LDDDSS: 3 + L bytes at distance (H << 3) + D + 1
+    EXPECT_EQ("abcdabcd", decompress({0x15, 'a', 'b', 'c', 'd',
+                                      0x60 | (3 << 2), 0x00,
+                                      0x11, 0, 0}));
+    // 1LLDDDSS: 5 + L bytes followed by two literals in the low bits
+    EXPECT_EQ("ababababab" "yz",
+              decompress({0x13, 'a', 'b', 0xe0 | (1 << 2) | 2, 0x00,
+                          'y', 'z', 0x11, 0, 0}));
+    // overlapping matches with a distance of 1 repeat the byte
+    EXPECT_EQ("zzzzzzzzz", decompress({0x12, 'z', 0xe0, 0x00, 0x11, 0, 0}));
+  }
+
+  TEST(Lzo, testMediumMatches) {
+    // 001LLLLL: 2 + L bytes at distance (E >> 2) + 1
+    std::string literals(3000, 'q');
+    literals.replace(0, 3, "abc");
+    std::vector<unsigned char> input;
+    appendLiteralRun(input, literals);
+    uint64_t distance = 3000 - 1;
+    input.insert(input.end(), {0x20 | 1,
+                               static_cast<unsigned char>(distance << 2),
+                               static_cast<unsigned char>(distance >> 6),
+                               0x11, 0, 0});
+    EXPECT_EQ(literals + "abc", decompress(input, 4096));
+
+    // a long length of 33 + 255 * zeros + n from distance 3
+    std::string expected = "abc";
+    for(int i=0; i < 33 + 255 + 1; ++i) {
+      expected += expected[expected.size() - 3];
+    }
+    EXPECT_EQ(expected, decompress({0x14, 'a', 'b', 'c', 0x20, 0x00, 0x01,
+                                    (2 << 2), 0x00, 0x11, 0, 0}));
+  }
+
+  TEST(Lzo, testLongDistanceMatches) {
+    // 0001HLLL: 2 + L bytes at distance 16384 + (H << 14) + (E >> 2)
+    std::string literals;
+    for(int i=0; i < 40000; ++i) {
+      literals += static_cast<char>('a' + (i * 7) % 26);
+    }
+    std::vector<unsigned char> input;
+    appendLiteralRun(input, literals);
+    // copy 5 bytes from distance 16384 + 16384 + 100 with one literal
+    uint64_t extra = 100;
+    input.insert(input.end(), {0x10 | 0x08 | 3,
+                               static_cast<unsigned char>((extra << 2) | 1),
+                               static_cast<unsigned char>(extra >> 6),
+                               '!', 0x11, 0, 0});
+    std::string expected = literals +
+      literals.substr(literals.size() - 32868, 5) + "!";
+    EXPECT_EQ(expected, decompress(input, 65536));
+  }
+
+  TEST(Lzo, testTwoByteMatches) {
+    // after 1-3 literals, 0000DDSS copies 2 bytes from (H << 2) + D + 1
+    EXPECT_EQ("abcab" "x",
+              decompress({0x14, 'a', 'b', 'c', (2 << 2) | 1, 0x00, 'x',
+                          0x11, 0, 0}));
+    // after 4 or more literals, it copies 3 bytes from 2049 or more back
+    std::string literals(2100, 'm');
+    literals.replace(0, 3, "xyz");
+    std::vector<unsigned char> input;
+    appendLiteralRun(input, literals);
+    // distance 2100 = (12 << 2) + 3 + 2049
+    input.insert(input.end(), {(3 << 2), 12, 0x11, 0, 0});
+    EXPECT_EQ(literals + "xyz", decompress(input, 4096));
+  }
+
+  TEST(Lzo, testCorruption) {
+    // truncated literals
+    EXPECT_THROW(decompress({0x17, 'a', 'b'}), ParseError);
+    // missing end of stream
+    EXPECT_THROW(decompress({0x14, 'a', 'b', 'c'}), ParseError);
+    // a match before the start of the output
+    EXPECT_THROW(decompress({0x14, 'a', 'b', 'c', 0xe0 | (7 << 2), 0x00,
+                             0x11, 0, 0}), ParseError);
+    // output that doesn't fit
+    EXPECT_THROW(decompress({0x17, 'a', 'b', 'c', 'd', 'e', 'f',
+                             0x11, 0, 0}, 5), ParseError);
+    EXPECT_THROW(decompress({0x12, 'z', 0xe0, 0x00, 0x11, 0, 0}, 8),
+                 ParseError);
+    // bytes after the end of stream
+    EXPECT_THROW(decompress({0x14, 'a', 'b', 'c', 0x11, 0, 0, 0}),
+                 ParseError);
+    EXPECT_THROW(decompress({}), ParseError);
+  }
+
+  TEST(Lzo, testRoundTrip) {
+    expectRoundTrip("");
+    expectRoundTrip("a");
+    expectRoundTrip("abcd");
+    expectRoundTrip(std::string(100000, 'x'));
+
+    // text with matches at every distance and length
+    std::string text;
+    uint64_t seed = 1;
+    for(int i=0; i < 200000; ++i) {
+      seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+      uint64_t choice = seed >> 60;
+      if (choice < 4 && text.size() > 60000) {
+        uint64_t distance = 1 + (seed >> 20) % 60000;
+        uint64_t length = 3 + (seed >> 8) % 400;
+        for(uint64_t j=0; j < length; ++j) {
+          text += text[text.size() - distance];
+        }
+      } else if (choice < 10 && text.size() > 10) {
+        uint64_t distance = 1 + (seed >> 20) % std::min<uint64_t>
+          (text.size(), 3000);
+        uint64_t length = 3 + (seed >> 8) % 12;
+        for(uint64_t j=0; j < length; ++j) {
+          text += text[text.size() - distance];
+        }
+      } else {
+        text += static_cast<char>(seed >> 40);
+      }
+    }
+    expectRoundTrip(text);
+
+    // random bytes don't compress
+    std::string noise;
+    for(int i=0; i < 70000; ++i) {
+      seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+      noise += static_cast<char>(seed >> 56);
+    }
+    expectRoundTrip(noise);
+  }
+}
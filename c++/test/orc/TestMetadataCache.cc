@@ -0,0 +1,101 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/MetadataCache.hh"
+#include "wrap/gtest-wrapper.h"
+
+namespace orc {
+
+  static std::shared_ptr<const FileTailContents> makeTail(uint64_t stripes) {
+    std::shared_ptr<FileTailContents> result(new FileTailContents());
+    for(uint64_t i=0; i < stripes; ++i) {
+      proto::StripeInformation* stripe = result->footer.add_stripes();
+      stripe->set_offset(3 + i * 1000);
+      stripe->set_numberofrows(1000);
+    }
+    return result;
+  }
+
+  TEST(MetadataCache, testMakeKey) {
+    EXPECT_EQ("", MetadataCacheImpl::makeKey("foo.orc", 100, 0));
+    EXPECT_NE(MetadataCacheImpl::makeKey("foo.orc", 100, 1),
+              MetadataCacheImpl::makeKey("foo.orc", 101, 1));
+    EXPECT_NE(MetadataCacheImpl::makeKey("foo.orc", 100, 1),
+              MetadataCacheImpl::makeKey("foo.orc", 100, 2));
+    EXPECT_NE(MetadataCacheImpl::makeKey("foo.orc", 100, 1),
+              MetadataCacheImpl::makeKey("bar.orc", 100, 1));
+  }
+
+  TEST(MetadataCache, testGetAndPut) {
+    MetadataCacheImpl cache(1024 * 1024);
+    EXPECT_EQ(nullptr, cache.get("a"));
+    std::shared_ptr<const FileTailContents> tail = makeTail(10);
+    cache.put("a", tail);
+    EXPECT_EQ(tail, cache.get("a"));
+    EXPECT_EQ(nullptr, cache.get("b"));
+    EXPECT_EQ(1, cache.getHits());
+    EXPECT_EQ(2, cache.getMisses());
+    EXPECT_EQ(1, cache.getNumberOfEntries());
+    EXPECT_EQ(tail->getMemoryUsage(), cache.getMemoryUsage());
+
+    // replacing a tail doesn't leak its memory
+    std::shared_ptr<const FileTailContents> other = makeTail(20);
+    cache.put("a", other);
+    EXPECT_EQ(other, cache.get("a"));
+    EXPECT_EQ(1, cache.getNumberOfEntries());
+    EXPECT_EQ(other->getMemoryUsage(), cache.getMemoryUsage());
+
+    cache.clear();
+    EXPECT_EQ(0, cache.getNumberOfEntries());
+    EXPECT_EQ(0, cache.getMemoryUsage());
+    EXPECT_EQ(0, cache.getHits());
+    EXPECT_EQ(0, cache.getMisses());
+    EXPECT_EQ(nullptr, cache.get("a"));
+  }
+
+  TEST(MetadataCache, testEviction) {
+    std::shared_ptr<const FileTailContents> tail = makeTail(10);
+    uint64_t size = tail->getMemoryUsage();
+    MetadataCacheImpl cache(3 * size);
+    cache.put("a", makeTail(10));
+    cache.put("b", makeTail(10));
+    cache.put("c", makeTail(10));
+    EXPECT_EQ(3, cache.getNumberOfEntries());
+
+    // using a makes b the least recently used
+    EXPECT_NE(nullptr, cache.get("a"));
+    cache.put("d", tail);
+    EXPECT_EQ(3, cache.getNumberOfEntries());
+    EXPECT_EQ(nullptr, cache.get("b"));
+    EXPECT_NE(nullptr, cache.get("a"));
+    EXPECT_NE(nullptr, cache.get("c"));
+    EXPECT_NE(nullptr, cache.get("d"));
+
+    // shrinking the cache drops the oldest tails
+    cache.setCapacity(size);
+    EXPECT_EQ(size, cache.getCapacity());
+    EXPECT_EQ(1, cache.getNumberOfEntries());
+    EXPECT_EQ(tail, cache.get("d"));
+
+    // tails that don't fit aren't kept
+    cache.put("e", makeTail(1000));
+    EXPECT_EQ(nullptr, cache.get("e"));
+    EXPECT_EQ(tail, cache.get("d"));
+    EXPECT_LE(cache.getMemoryUsage(), cache.getCapacity());
+  }
+}
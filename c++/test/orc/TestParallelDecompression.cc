@@ -0,0 +1,266 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Exceptions.hh"
+#include "orc/ParallelDecompression.hh"
+#include "orc/ThreadPool.hh"
+#include "wrap/gtest-wrapper.h"
+
+#include <atomic>
+#include <vector>
+
+#include "wrap/snappy-wrapper.h"
+
+namespace orc {
+
+  TEST(ThreadPool, testRunsEveryTask) {
+    std::atomic<int> total(0);
+    {
+      ThreadPool threads(3);
+      EXPECT_EQ(3, threads.getThreadCount());
+      for(int i=1; i <= 100; ++i) {
+        threads.submit([&total, i] { total += i; });
+      }
+    }
+    // the destructor runs the queued tasks
+    EXPECT_EQ(5050, total);
+  }
+
+  TEST(ThreadPool, testSharedPool) {
+    std::shared_ptr<ThreadPool> first = getSharedThreadPool(2);
+    EXPECT_EQ(2, first->getThreadCount());
+    EXPECT_EQ(first.get(), getSharedThreadPool(2).get());
+    std::shared_ptr<ThreadPool> other = getSharedThreadPool(3);
+    EXPECT_NE(first.get(), other.get());
+    EXPECT_EQ(3, other->getThreadCount());
+  }
+
+  /**
+   * Build a stream holding the ints 0 to N - 1 mod 8 in chunks of
+   * chunkSize values. Every fourth chunk is stored original and the
+   * others are compressed with snappy.
+   */
+  static std::vector<char> makeChunks(int N, int chunkSize) {
+    std::vector<char> result;
+    std::vector<char> chunk(static_cast<size_t>(chunkSize) * sizeof(int));
+    std::vector<char> compressed
+      (snappy::MaxCompressedLength(chunk.size()));
+    for(int start=0; start < N; start += chunkSize) {
+      for(int i=0; i < chunkSize; ++i) {
+        (reinterpret_cast<int *>(chunk.data()))[i] = (start + i) % 8;
+      }
+      const char* body = compressed.data();
+      size_t size;
+      bool isOriginal = (start / chunkSize) % 4 == 3;
+      if (isOriginal) {
+        body = chunk.data();
+        size = chunk.size();
+      } else {
+        snappy::RawCompress(chunk.data(), chunk.size(), compressed.data(),
+                            &size);
+      }
+      result.push_back(static_cast<char>((size << 1) | isOriginal));
+      result.push_back(static_cast<char>(size >> 7));
+      result.push_back(static_cast<char>(size >> 15));
+      result.insert(result.end(), body, body + size);
+    }
+    return result;
+  }
+
+  static std::unique_ptr<SeekableInputStream>
+      makeStream(const std::vector<char>& input,
+                 int chunkSize,
+                 ThreadPool& threads,
+                 uint64_t window,
+                 DecompressionCounters* counters = nullptr) {
+    return createParallelDecompressor(CompressionKind_SNAPPY,
+                                      input.data(),
+                                      input.size(),
+                                      static_cast<uint64_t>(chunkSize) *
+                                        sizeof(int),
+                                      *getDefaultPool(),
+                                      threads,
+                                      window,
+                                      counters);
+  }
+
+  TEST(ParallelDecompression, testBasic) {
+    const int N = 4096;
+    const int chunkSize = 64;
+    std::vector<char> input = makeChunks(N, chunkSize);
+    ThreadPool threads(4);
+    DecompressionCounters counters;
+    std::unique_ptr<SeekableInputStream> result =
+      makeStream(input, chunkSize, threads, 3, &counters);
+    EXPECT_EQ("snappy(parallel memory " + std::to_string(input.size()) +
+              " bytes)", result->getName());
+    const void *data;
+    int length;
+    int value = 0;
+    while (result->Next(&data, &length)) {
+      ASSERT_EQ(chunkSize * static_cast<int>(sizeof(int)), length);
+      for(int i=0; i < chunkSize; ++i) {
+        EXPECT_EQ(value % 8, (reinterpret_cast<const int *>(data))[i]);
+        ++value;
+      }
+    }
+    EXPECT_EQ(N, value);
+    EXPECT_EQ(N * sizeof(int), result->ByteCount());
+    EXPECT_EQ(N * sizeof(int) * 3 / 4, counters.decompressedBytes);
+    EXPECT_EQ(N * sizeof(int) / 4, counters.passedThroughBytes);
+  }
+
+  TEST(ParallelDecompression, testBackUpAndSkip) {
+    const int N = 4096;
+    const int chunkSize = 64;
+    std::vector<char> input = makeChunks(N, chunkSize);
+    ThreadPool threads(2);
+    std::unique_ptr<SeekableInputStream> result =
+      makeStream(input, chunkSize, threads, 2);
+    const void *data;
+    int length;
+    ASSERT_TRUE(result->Next(&data, &length));
+    result->BackUp(8);
+    ASSERT_TRUE(result->Next(&data, &length));
+    ASSERT_EQ(8, length);
+    EXPECT_EQ(6, (reinterpret_cast<const int *>(data))[0]);
+    EXPECT_EQ(chunkSize * sizeof(int), result->ByteCount());
+
+    // skip across whole chunks, some of which were decompressed ahead
+    for(int value=chunkSize; value + 10 * chunkSize < N; value += 4) {
+      ASSERT_TRUE(result->Skip(static_cast<int>(10 * chunkSize *
+                                                sizeof(int))));
+      value += 10 * chunkSize;
+      ASSERT_TRUE(result->Next(&data, &length));
+      EXPECT_EQ(value % 8, (reinterpret_cast<const int *>(data))[0]);
+      EXPECT_EQ((value + 1) % 8, (reinterpret_cast<const int *>(data))[1]);
+      EXPECT_EQ(value * static_cast<int>(sizeof(int)) + length,
+                result->ByteCount());
+      result->BackUp(length - 16);
+    }
+    EXPECT_FALSE(result->Skip(static_cast<int>(N * sizeof(int))));
+  }
+
+  TEST(ParallelDecompression, testSeek) {
+    const int N = 1024;
+    const int chunkSize = 64;
+    std::vector<char> input = makeChunks(N, chunkSize);
+    std::vector<uint64_t> chunkOffsets;
+    for(uint64_t offset=0; offset < input.size(); ) {
+      chunkOffsets.push_back(offset);
+      uint64_t header = static_cast<unsigned char>(input[offset]) |
+        (static_cast<uint64_t>(static_cast<unsigned char>
+                               (input[offset + 1])) << 8) |
+        (static_cast<uint64_t>(static_cast<unsigned char>
+                               (input[offset + 2])) << 16);
+      offset += 3 + (header >> 1);
+    }
+    ASSERT_EQ(static_cast<size_t>(N / chunkSize), chunkOffsets.size());
+
+    ThreadPool threads(2);
+    std::unique_ptr<SeekableInputStream> result =
+      makeStream(input, chunkSize, threads, 4);
+    // visit the chunks backwards
+    for(size_t c=chunkOffsets.size(); c-- > 0; ) {
+      std::list<uint64_t> offsets;
+      offsets.push_back(chunkOffsets[c]);
+      offsets.push_back(static_cast<uint64_t>(chunkSize / 2) * sizeof(int));
+      PositionProvider posn(offsets);
+      result->seek(posn);
+      const void *data;
+      int length;
+      ASSERT_TRUE(result->Next(&data, &length));
+      ASSERT_EQ((chunkSize / 2) * static_cast<int>(sizeof(int)), length);
+      int first = static_cast<int>(c) * chunkSize + chunkSize / 2;
+      for(int i=0; i < chunkSize / 2; ++i) {
+        EXPECT_EQ((first + i) % 8,
+                  (reinterpret_cast<const int *>(data))[i]);
+      }
+    }
+
+    std::list<uint64_t> offsets;
+    offsets.push_back(chunkOffsets[1] + 1);
+    offsets.push_back(0);
+    PositionProvider posn(offsets);
+    EXPECT_THROW(result->seek(posn), ParseError);
+  }
+
+  TEST(ParallelDecompression, testSeekWithinChunk) {
+    const int N = 1024;
+    const int chunkSize = 64;
+    std::vector<char> input = makeChunks(N, chunkSize);
+    ThreadPool threads(2);
+    DecompressionCounters counters;
+    std::unique_ptr<SeekableInputStream> result =
+      makeStream(input, chunkSize, threads, 4, &counters);
+    const void *data;
+    int length;
+    ASSERT_TRUE(result->Next(&data, &length));
+    uint64_t decompressed = counters.decompressedBytes;
+
+    // the chunk that was returned is reused
+    std::list<uint64_t> offsets;
+    offsets.push_back(0);
+    offsets.push_back(12);
+    PositionProvider posn(offsets);
+    result->seek(posn);
+    EXPECT_EQ(12, result->ByteCount());
+    ASSERT_TRUE(result->Next(&data, &length));
+    EXPECT_EQ(chunkSize * static_cast<int>(sizeof(int)) - 12, length);
+    EXPECT_EQ(3, (reinterpret_cast<const int *>(data))[0]);
+    EXPECT_EQ(decompressed, counters.decompressedBytes);
+
+    // and the chunks after it are still on their way
+    ASSERT_TRUE(result->Next(&data, &length));
+    EXPECT_EQ(chunkSize % 8, (reinterpret_cast<const int *>(data))[0]);
+  }
+
+  TEST(ParallelDecompression, testCorruptChunk) {
+    const int N = 1024;
+    const int chunkSize = 64;
+    std::vector<char> input = makeChunks(N, chunkSize);
+    // break the snappy length of the third chunk
+    uint64_t offset = 0;
+    for(int c=0; c < 2; ++c) {
+      uint64_t header = static_cast<unsigned char>(input[offset]) |
+        (static_cast<uint64_t>(static_cast<unsigned char>
+                               (input[offset + 1])) << 8);
+      offset += 3 + (header >> 1);
+    }
+    for(uint64_t i=3; i < 8; ++i) {
+      input[offset + i] = static_cast<char>(0xff);
+    }
+
+    ThreadPool threads(2);
+    std::unique_ptr<SeekableInputStream> result =
+      makeStream(input, chunkSize, threads, 8);
+    const void *data;
+    int length;
+    ASSERT_TRUE(result->Next(&data, &length));
+    ASSERT_TRUE(result->Next(&data, &length));
+    // the error from the pool's thread is thrown by the chunk's Next
+    EXPECT_THROW(result->Next(&data, &length), ParseError);
+  }
+
+  TEST(ParallelDecompression, testTruncatedChunk) {
+    std::vector<char> input = makeChunks(256, 64);
+    input.pop_back();
+    ThreadPool threads(1);
+    EXPECT_THROW(makeStream(input, 64, threads, 2), ParseError);
+  }
+}
@@ -0,0 +1,166 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/ReadPlanner.hh"
+#include "wrap/gtest-wrapper.h"
+
+namespace orc {
+
+  /**
+   * A Buffer that points into memory owned by someone else.
+   */
+  class MemoryBuffer: public Buffer {
+  private:
+    char* start;
+    uint64_t length;
+
+  public:
+    MemoryBuffer(char* _start, uint64_t _length
+                 ): start(_start), length(_length) {
+      // PASS
+    }
+
+    ~MemoryBuffer();
+
+    char *getStart() const override {
+      return start;
+    }
+
+    uint64_t getLength() const override {
+      return length;
+    }
+  };
+
+  MemoryBuffer::~MemoryBuffer() {
+    // PASS
+  }
+
+  /**
+   * An InputStream over an in-memory buffer that remembers the reads.
+   */
+  class MemoryInputStream: public InputStream {
+  private:
+    std::vector<char> data;
+    std::string name;
+
+  public:
+    std::vector<ReadRange> requests;
+
+    MemoryInputStream(uint64_t length): data(length), name("memory") {
+      for(size_t i=0; i < data.size(); ++i) {
+        data[i] = static_cast<char>(i);
+      }
+    }
+
+    ~MemoryInputStream();
+
+    uint64_t getLength() const override {
+      return data.size();
+    }
+
+    Buffer* read(uint64_t offset,
+                 uint64_t length,
+                 Buffer* buffer) override {
+      requests.push_back(ReadRange(offset, length));
+      delete buffer;
+      return new MemoryBuffer(data.data() + offset, length);
+    }
+
+    const std::string& getName() const override {
+      return name;
+    }
+  };
+
+  MemoryInputStream::~MemoryInputStream() {
+    // PASS
+  }
+
+  TEST(ReadPlan, coalesceEmpty) {
+    std::vector<ReadRange> ranges;
+    EXPECT_EQ(0, coalesceRanges(ranges, 100).size());
+    ranges.push_back(ReadRange(10, 0));
+    EXPECT_EQ(0, coalesceRanges(ranges, 100).size());
+  }
+
+  TEST(ReadPlan, coalesceGaps) {
+    std::vector<ReadRange> ranges;
+    ranges.push_back(ReadRange(500, 100));
+    ranges.push_back(ReadRange(0, 100));
+    ranges.push_back(ReadRange(100, 50));
+    ranges.push_back(ReadRange(160, 40));
+    ranges.push_back(ReadRange(550, 10));
+
+    std::vector<ReadRange> result = coalesceRanges(ranges, 0);
+    ASSERT_EQ(3, result.size());
+    EXPECT_EQ(0, result[0].offset);
+    EXPECT_EQ(150, result[0].length);
+    EXPECT_EQ(160, result[1].offset);
+    EXPECT_EQ(40, result[1].length);
+    EXPECT_EQ(500, result[2].offset);
+    EXPECT_EQ(100, result[2].length);
+
+    result = coalesceRanges(ranges, 10);
+    ASSERT_EQ(2, result.size());
+    EXPECT_EQ(0, result[0].offset);
+    EXPECT_EQ(200, result[0].length);
+    EXPECT_EQ(500, result[1].offset);
+    EXPECT_EQ(100, result[1].length);
+
+    result = coalesceRanges(ranges, 300);
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(0, result[0].offset);
+    EXPECT_EQ(600, result[0].length);
+  }
+
+  TEST(ReadPlan, execute) {
+    MemoryInputStream input(1000);
+    std::vector<ReadRange> ranges;
+    ranges.push_back(ReadRange(700, 100));
+    ranges.push_back(ReadRange(10, 20));
+    ranges.push_back(ReadRange(40, 20));
+    ReadPlan plan(ranges, 10);
+    ASSERT_EQ(2, plan.getReads().size());
+    EXPECT_EQ(150, plan.getTotalLength());
+    EXPECT_FALSE(plan.isExecuted());
+    EXPECT_EQ(nullptr, plan.find(10, 20));
+
+    plan.execute(input);
+    EXPECT_TRUE(plan.isExecuted());
+    ASSERT_EQ(2, input.requests.size());
+    EXPECT_EQ(10, input.requests[0].offset);
+    EXPECT_EQ(50, input.requests[0].length);
+    EXPECT_EQ(700, input.requests[1].offset);
+    EXPECT_EQ(100, input.requests[1].length);
+
+    const char* bytes = plan.find(40, 20);
+    ASSERT_NE(nullptr, bytes);
+    for(int i=0; i < 20; ++i) {
+      EXPECT_EQ(static_cast<char>(40 + i), bytes[i]);
+    }
+    bytes = plan.find(750, 50);
+    ASSERT_NE(nullptr, bytes);
+    EXPECT_EQ(static_cast<char>(750), bytes[0]);
+
+    // ranges outside of the reads
+    EXPECT_EQ(nullptr, plan.find(0, 20));
+    EXPECT_EQ(nullptr, plan.find(50, 20));
+    EXPECT_EQ(nullptr, plan.find(800, 1));
+
+    EXPECT_THROW(plan.execute(input), std::logic_error);
+  }
+}
@@ -23,6 +23,7 @@
 #include "OrcTest.hh"
 
 #include <iostream>
+#include <limits>
 #include <vector>
 
 namespace orc {
@@ -61,6 +62,37 @@ void checkResults(const std::vector<int64_t> &e, const std::vector<int64_t> &a,
   }
 }
 
+/**
+ * Alternately skip and read values, checking the ones that are read.
+ */
+void checkSkips(const std::vector<int64_t> &e, const unsigned char *bytes,
+                unsigned long l) {
+  const size_t skips[] = {1, 2, 7, 30, 200, e.size() - 1};
+  const size_t reads[] = {1, 3};
+  for (size_t s = 0; s < sizeof(skips) / sizeof(skips[0]); ++s) {
+    for (size_t r = 0; r < sizeof(reads) / sizeof(reads[0]); ++r) {
+      std::unique_ptr<RleDecoder> rle =
+        createRleDecoder(std::unique_ptr<SeekableInputStream>
+                         (new SeekableArrayInputStream(bytes, l)), true,
+                         RleVersion_2, *getDefaultPool());
+      size_t pos = 0;
+      while (pos < e.size()) {
+        size_t count = std::min(skips[s], e.size() - pos);
+        rle->skip(count);
+        pos += count;
+        count = std::min(reads[r], e.size() - pos);
+        std::vector<int64_t> data(count);
+        rle->next(data.data(), count, nullptr);
+        for (size_t i = 0; i < count; ++i) {
+          EXPECT_EQ(e[pos + i], data[i]) << "Output wrong at " << pos + i
+                                         << ", skip=" << skips[s];
+        }
+        pos += count;
+      }
+    }
+  }
+}
+
 TEST(RLEv2, basicDelta0) {
   const size_t count = 20;
   std::vector<int64_t> values;
@@ -75,6 +107,7 @@ TEST(RLEv2, basicDelta0) {
   checkResults(values, decodeRLEv2(bytes, l, 3, count), 3);
   checkResults(values, decodeRLEv2(bytes, l, 7, count), 7);
   checkResults(values, decodeRLEv2(bytes, l, count, count), count);
+  checkSkips(values, bytes, l);
 };
 
 TEST(RLEv2, basicDelta1) {
@@ -93,6 +126,7 @@ TEST(RLEv2, basicDelta1) {
   checkResults(values, decodeRLEv2(bytes, l, 7, values.size()), 7);
   checkResults(values, decodeRLEv2(bytes, l, values.size(), values.size()),
                values.size());
+  checkSkips(values, bytes, l);
 };
 
 TEST(RLEv2, basicDelta2) {
@@ -215,6 +249,7 @@ TEST(RLEv2, shortRepeats) {
   checkResults(values, decodeRLEv2(bytes, l, 3, count), 3);
   checkResults(values, decodeRLEv2(bytes, l, 7, count), 7);
   checkResults(values, decodeRLEv2(bytes, l, count, count), count);
+  checkSkips(values, bytes, l);
 };
 
 TEST(RLEv2, multiByteShortRepeats) {
@@ -239,6 +274,99 @@ TEST(RLEv2, multiByteShortRepeats) {
   checkResults(values, decodeRLEv2(bytes, l, count, count), count);
 };
 
+TEST(RLEv2, shortRepeatsWithNulls) {
+  std::vector<int64_t> values;
+  std::vector<char> notNull;
+  for (size_t i = 0; i < 10; ++i) {
+    for (size_t j = 0; j < 7; ++j) {
+      values.push_back(static_cast<int64_t>(i));
+      notNull.push_back(true);
+      if ((i + j) % 4 == 0) {
+        values.push_back(-1);
+        notNull.push_back(false);
+      }
+    }
+  }
+
+  const unsigned char bytes[] = {0x04,0x00,0x04,0x02,0x04,0x04,0x04,
+                                 0x06,0x04,0x08,0x04,0x0a,0x04,0x0c,
+                                 0x04,0x0e,0x04,0x10,0x04,0x12};
+  unsigned long l = sizeof(bytes) / sizeof(char);
+  const size_t count = values.size();
+  for (size_t n = 1; n <= count; n += 6) {
+    checkResults(values, decodeRLEv2(bytes, l, n, count, notNull.data()),
+                 n, notNull.data());
+  }
+};
+
+/**
+ * Build a DELTA run with 8 bit deltas.
+ */
+static std::vector<unsigned char> makeDeltaRun(int64_t first,
+                                               int64_t deltaBase,
+                                               size_t length,
+                                               std::vector<int64_t>& values) {
+  std::vector<unsigned char> bytes;
+  bytes.push_back(static_cast<unsigned char>(0xce | ((length - 1) >> 8)));
+  bytes.push_back(static_cast<unsigned char>((length - 1) & 0xff));
+  int64_t signedValues[] = {first, deltaBase};
+  for (size_t i = 0; i < 2; ++i) {
+    uint64_t zigzag = (static_cast<uint64_t>(signedValues[i]) << 1) ^
+      static_cast<uint64_t>(signedValues[i] >> 63);
+    while (zigzag >= 0x80) {
+      bytes.push_back(static_cast<unsigned char>(0x80 | (zigzag & 0x7f)));
+      zigzag >>= 7;
+    }
+    bytes.push_back(static_cast<unsigned char>(zigzag));
+  }
+  values.push_back(first);
+  values.push_back(first + deltaBase);
+  for (size_t i = 2; i < length; ++i) {
+    unsigned char delta = static_cast<unsigned char>(i * 37);
+    bytes.push_back(delta);
+    values.push_back(deltaBase < 0 ? values.back() - delta :
+                     values.back() + delta);
+  }
+  return bytes;
+}
+
+TEST(RLEv2, longDeltaRunsWithNulls) {
+  std::vector<int64_t> runValues;
+  std::vector<unsigned char> bytes = makeDeltaRun(10, 3, 100, runValues);
+  std::vector<unsigned char> decreasing =
+    makeDeltaRun(-7, -3, 301, runValues);
+  bytes.insert(bytes.end(), decreasing.begin(), decreasing.end());
+  // a fixed delta run of 20 values from 0
+  const unsigned char fixed[] = {0xc0,0x13,0x00,0x02};
+  bytes.insert(bytes.end(), fixed, fixed + sizeof(fixed));
+  for (int64_t i = 0; i < 20; ++i) {
+    runValues.push_back(i);
+  }
+
+  std::vector<int64_t> values;
+  std::vector<char> notNull;
+  for (size_t i = 0; i < runValues.size(); ++i) {
+    values.push_back(runValues[i]);
+    notNull.push_back(true);
+    if (i % 5 == 1 || i % 7 == 0) {
+      values.push_back(-1);
+      notNull.push_back(false);
+    }
+  }
+
+  const size_t count = values.size();
+  const size_t batches[] = {1, 3, 7, 64, count};
+  for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); ++b) {
+    checkResults(runValues, decodeRLEv2(bytes.data(), bytes.size(),
+                                        batches[b], runValues.size()),
+                 batches[b]);
+    checkResults(values, decodeRLEv2(bytes.data(), bytes.size(),
+                                     batches[b], count, notNull.data()),
+                 batches[b], notNull.data());
+  }
+  checkSkips(runValues, bytes.data(), bytes.size());
+};
+
 TEST(RLEv2, 0to2Repeat1Direct) {
   const unsigned char buffer[] = {0x46, 0x02, 0x02, 0x40};
   std::unique_ptr<RleDecoder> rle =
@@ -312,6 +440,7 @@ TEST(RLEv2, multipleRunsDirect) {
  checkResults(values, decodeRLEv2(bytes, l, 7, values.size()), 7);
  checkResults(values, decodeRLEv2(bytes, l, values.size(), values.size()),
               values.size());
+ checkSkips(values, bytes, l);
 };
 
 TEST(RLEv2, largeNegativesDirect) {
@@ -371,6 +500,7 @@ TEST(RLEv2, basicPatched0) {
   checkResults(values, decodeRLEv2(bytes, l, 7, values.size()), 7);
   checkResults(values, decodeRLEv2(bytes, l, values.size(), values.size()),
                values.size());
+  checkSkips(values, bytes, l);
 };
 
 TEST(RLEv2, basicPatched1) {
@@ -407,6 +537,7 @@ TEST(RLEv2, basicPatched1) {
   checkResults(values, decodeRLEv2(bytes, l, 7, values.size()), 7);
   checkResults(values, decodeRLEv2(bytes, l, values.size(), values.size()),
                values.size());
+  checkSkips(values, bytes, l);
 };
 
 TEST(RLEv2, mixedPatchedAndShortRepeats) {
@@ -424,6 +555,7 @@ TEST(RLEv2, mixedPatchedAndShortRepeats) {
   checkResults(values, decodeRLEv2(bytes, l, 7, values.size()), 7);
   checkResults(values, decodeRLEv2(bytes, l, values.size(), values.size()),
                values.size());
+  checkSkips(values, bytes, l);
 };
 
 TEST(RLEv2, basicDirectSeek) {
@@ -528,6 +660,31 @@ TEST(RLEv2, bitsLeftByPreviousStream) {
   }
 };
 
+TEST(RLE, spreadNonNulls) {
+  // runs of non-nulls and nulls that are longer and shorter than 8
+  std::vector<char> notNull;
+  for (size_t i = 0; i < 300; ++i) {
+    notNull.push_back((i / 20) % 3 == 1 || (i > 200 && i % 3 == 0) ? 0 : 1);
+  }
+  for (size_t length = 0; length <= notNull.size(); length += 13) {
+    std::vector<int64_t> data(length, -1);
+    uint64_t count = 0;
+    for (size_t i = 0; i < length; ++i) {
+      if (notNull[i]) {
+        data[count] = static_cast<int64_t>(count);
+        ++count;
+      }
+    }
+    spreadNonNulls(data.data(), length, count, notNull.data());
+    int64_t expected = 0;
+    for (size_t i = 0; i < length; ++i) {
+      if (notNull[i]) {
+        EXPECT_EQ(expected++, data[i]) << "length " << length << " at " << i;
+      }
+    }
+  }
+}
+
 TEST(RLEv1, simpleTest) {
   const unsigned char buffer[] = {0x61, 0xff, 0x64, 0xfb, 0x02, 0x03, 0x5, 0x7,
 				  0xb};
@@ -690,6 +847,126 @@ TEST(RLEv1, testAllNulls) {
   rle->next(data.data(), data.size(), allNull.data());
 }
 
+TEST(RLEv1, literalsWithNulls) {
+  // a literal run of 0 to 9
+  const unsigned char buffer[] = {0xf6, 0x00, 0x01, 0x02, 0x03, 0x04,
+                                  0x05, 0x06, 0x07, 0x08, 0x09};
+  SeekableInputStream* const stream =
+    new SeekableArrayInputStream(buffer, ARRAY_SIZE(buffer));
+  std::unique_ptr<RleDecoder> rle =
+      createRleDecoder(std::unique_ptr<SeekableInputStream>(stream),
+                       false, RleVersion_1, *getDefaultPool());
+  const char notNull[] = {0, 1, 0, 1, 1, 0, 0, 1, 1, 1, 1, 0, 1, 1, 1};
+  std::vector<int64_t> data(ARRAY_SIZE(notNull), -1);
+  rle->next(data.data(), data.size(), notNull);
+  int64_t next = 0;
+  for (size_t i = 0; i < data.size(); ++i) {
+    if (notNull[i]) {
+      EXPECT_EQ(next++, data[i]) << "Output wrong at " << i;
+    }
+  }
+  EXPECT_EQ(10, next);
+}
+
+TEST(RLEv1, longLiterals) {
+  // literal runs of signed values with every varint length
+  std::vector<int64_t> values;
+  for (uint32_t shift = 0; shift < 63; ++shift) {
+    values.push_back(static_cast<int64_t>(1ULL << shift));
+    values.push_back(-static_cast<int64_t>(1ULL << shift) - 1);
+    values.push_back(static_cast<int64_t>(shift % 5));
+  }
+  values.push_back(std::numeric_limits<int64_t>::max());
+  values.push_back(std::numeric_limits<int64_t>::min());
+  std::vector<char> bytes;
+  for (size_t start = 0; start < values.size(); start += 128) {
+    size_t length = std::min<size_t>(128, values.size() - start);
+    bytes.push_back(static_cast<char>(-static_cast<int>(length)));
+    for (size_t i = start; i < start + length; ++i) {
+      uint64_t zigzag = (static_cast<uint64_t>(values[i]) << 1) ^
+        static_cast<uint64_t>(values[i] >> 63);
+      while (zigzag >= 0x80) {
+        bytes.push_back(static_cast<char>(0x80 | (zigzag & 0x7f)));
+        zigzag >>= 7;
+      }
+      bytes.push_back(static_cast<char>(zigzag));
+    }
+  }
+  const uint64_t blockSizes[] = {1, 5, 16, 17, 100000};
+  for (size_t b = 0; b < ARRAY_SIZE(blockSizes); ++b) {
+    std::unique_ptr<RleDecoder> rle =
+      createRleDecoder(std::unique_ptr<SeekableInputStream>
+                       (new SeekableArrayInputStream(bytes.data(),
+                                                     bytes.size(),
+                                                     blockSizes[b])),
+                       true, RleVersion_1, *getDefaultPool());
+    std::vector<int64_t> data(values.size());
+    for (size_t start = 0; start < data.size(); start += 50) {
+      rle->next(data.data() + start,
+                std::min<size_t>(50, data.size() - start), nullptr);
+    }
+    for (size_t i = 0; i < values.size(); ++i) {
+      EXPECT_EQ(values[i], data[i])
+        << "Output wrong at " << i << " with blocks of " << blockSizes[b];
+    }
+
+    // skip runs of values of every length and read the one after each
+    rle = createRleDecoder(std::unique_ptr<SeekableInputStream>
+                           (new SeekableArrayInputStream(bytes.data(),
+                                                         bytes.size(),
+                                                         blockSizes[b])),
+                           true, RleVersion_1, *getDefaultPool());
+    size_t pos = 0;
+    for (size_t skip = 0; pos + skip < values.size(); ++skip) {
+      rle->skip(skip);
+      pos += skip;
+      int64_t value;
+      rle->next(&value, 1, nullptr);
+      EXPECT_EQ(values[pos], value)
+        << "Output wrong at " << pos << " with blocks of " << blockSizes[b];
+      ++pos;
+    }
+  }
+}
+
+TEST(RLEv1, skipMultiByteLiterals) {
+  // every value is a 3 byte varint, so only one byte in three ends a value
+  // and a continuation byte must never be counted as an end, whether or
+  // not char is signed
+  std::vector<int64_t> values;
+  std::vector<char> bytes;
+  for (size_t start = 0; start < 400; start += 100) {
+    bytes.push_back(static_cast<char>(-100));
+    for (size_t i = start; i < start + 100; ++i) {
+      uint64_t value = (1ULL << 15) + i * 97;
+      values.push_back(static_cast<int64_t>(value));
+      bytes.push_back(static_cast<char>(0x80 | (value & 0x7f)));
+      bytes.push_back(static_cast<char>(0x80 | ((value >> 7) & 0x7f)));
+      bytes.push_back(static_cast<char>(value >> 14));
+    }
+  }
+  // blocks of 1 and 7 bytes only use the byte at a time tail loop
+  const uint64_t blockSizes[] = {1, 7, 100000};
+  for (size_t b = 0; b < ARRAY_SIZE(blockSizes); ++b) {
+    for (size_t skip = 1; skip < 12; ++skip) {
+      std::unique_ptr<RleDecoder> rle =
+        createRleDecoder(std::unique_ptr<SeekableInputStream>
+                         (new SeekableArrayInputStream(bytes.data(),
+                                                       bytes.size(),
+                                                       blockSizes[b])),
+                         false, RleVersion_1, *getDefaultPool());
+      for (size_t pos = skip; pos < values.size(); pos += skip + 1) {
+        rle->skip(skip);
+        int64_t value;
+        rle->next(&value, 1, nullptr);
+        ASSERT_EQ(values[pos], value) << "Output wrong at " << pos
+                                      << " skipping " << skip
+                                      << " with blocks of " << blockSizes[b];
+      }
+    }
+  }
+}
+
 TEST(RLEv1, skipTest) {
   // Create the RLE stream from Java's TestRunLengthIntegerEncoding.testSkips
   // for (size_t i = 0; i < 1024; ++i)
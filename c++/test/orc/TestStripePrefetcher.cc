@@ -0,0 +1,176 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/StripePrefetcher.hh"
+#include "orc/Exceptions.hh"
+#include "wrap/gtest-wrapper.h"
+
+#include <vector>
+
+namespace orc {
+
+  /**
+   * A StripeLoader that records which stripes were loaded, so that the
+   * tests can wait for loads. It also counts the loads that start after
+   * the test's limit is reached, which catches a prefetcher that loads
+   * too far ahead no matter when its thread runs.
+   */
+  class MockStripeLoader: public StripeLoader {
+  public:
+    uint64_t stripeSize;
+    uint64_t failingStripe;
+    mutable std::mutex mutex;
+    mutable std::condition_variable changed;
+    mutable std::vector<uint64_t> loads;
+    // the number of loads that may start
+    uint64_t loadLimit;
+    mutable uint64_t extraLoads;
+
+    MockStripeLoader(uint64_t size
+                     ): stripeSize(size),
+                        failingStripe(std::numeric_limits<uint64_t>::max()),
+                        loadLimit(std::numeric_limits<uint64_t>::max()),
+                        extraLoads(0) {
+      // PASS
+    }
+
+    ~MockStripeLoader();
+
+    uint64_t getLoadedSize(uint64_t) const override {
+      return stripeSize;
+    }
+
+    std::unique_ptr<LoadedStripe> loadStripe(uint64_t stripeIndex
+                                             ) const override {
+      if (stripeIndex == failingStripe) {
+        throw ParseError("bad stripe");
+      }
+      std::unique_ptr<LoadedStripe> result(new LoadedStripe());
+      result->stripeIndex = stripeIndex;
+      std::lock_guard<std::mutex> lock(mutex);
+      if (loads.size() >= loadLimit) {
+        extraLoads += 1;
+      }
+      loads.push_back(stripeIndex);
+      changed.notify_all();
+      return result;
+    }
+
+    /**
+     * Wait until the given number of stripes have been loaded.
+     */
+    void waitForLoads(size_t count) const {
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock, [this, count] { return loads.size() >= count; });
+    }
+
+    size_t getLoadCount() const {
+      std::lock_guard<std::mutex> lock(mutex);
+      return loads.size();
+    }
+
+    /**
+     * Set the number of loads that may start. This must be raised before
+     * the take that lets the prefetcher load more.
+     */
+    void setLoadLimit(uint64_t limit) {
+      std::lock_guard<std::mutex> lock(mutex);
+      loadLimit = limit;
+    }
+
+    uint64_t getExtraLoads() const {
+      std::lock_guard<std::mutex> lock(mutex);
+      return extraLoads;
+    }
+  };
+
+  MockStripeLoader::~MockStripeLoader() {
+    // PASS
+  }
+
+  TEST(StripePrefetcher, inOrder) {
+    MockStripeLoader loader(100);
+    StripePrefetcher prefetcher(loader, 2, 10, 3, 1000);
+    for(uint64_t i=2; i < 10; ++i) {
+      EXPECT_EQ(i, prefetcher.take(i)->stripeIndex);
+    }
+    ASSERT_EQ(8, loader.getLoadCount());
+    for(uint64_t i=0; i < 8; ++i) {
+      EXPECT_EQ(i + 2, loader.loads[i]);
+    }
+  }
+
+  TEST(StripePrefetcher, depth) {
+    MockStripeLoader loader(100);
+    loader.setLoadLimit(3);
+    {
+      StripePrefetcher prefetcher(loader, 0, 10, 3, 1000);
+      loader.waitForLoads(3);
+      loader.setLoadLimit(4);
+      EXPECT_EQ(0, prefetcher.take(0)->stripeIndex);
+      loader.waitForLoads(4);
+    }
+    // stopping the thread means no load can still start
+    EXPECT_EQ(0, loader.getExtraLoads());
+    EXPECT_EQ(4, loader.getLoadCount());
+  }
+
+  TEST(StripePrefetcher, memoryLimit) {
+    MockStripeLoader loader(100);
+    loader.setLoadLimit(2);
+    {
+      StripePrefetcher prefetcher(loader, 0, 10, 5, 250);
+      loader.waitForLoads(2);
+    }
+    EXPECT_EQ(0, loader.getExtraLoads());
+    EXPECT_EQ(2, loader.getLoadCount());
+
+    // stripes larger than the limit are still loaded one at a time
+    MockStripeLoader bigLoader(1000);
+    bigLoader.setLoadLimit(1);
+    {
+      StripePrefetcher bigPrefetcher(bigLoader, 0, 10, 5, 250);
+      bigLoader.waitForLoads(1);
+      bigLoader.setLoadLimit(2);
+      EXPECT_EQ(0, bigPrefetcher.take(0)->stripeIndex);
+      bigLoader.setLoadLimit(3);
+      EXPECT_EQ(1, bigPrefetcher.take(1)->stripeIndex);
+    }
+    EXPECT_EQ(0, bigLoader.getExtraLoads());
+  }
+
+  TEST(StripePrefetcher, seek) {
+    MockStripeLoader loader(100);
+    StripePrefetcher prefetcher(loader, 0, 10, 2, 1000);
+    EXPECT_EQ(0, prefetcher.take(0)->stripeIndex);
+    EXPECT_EQ(7, prefetcher.take(7)->stripeIndex);
+    EXPECT_EQ(8, prefetcher.take(8)->stripeIndex);
+    EXPECT_EQ(3, prefetcher.take(3)->stripeIndex);
+    EXPECT_EQ(4, prefetcher.take(4)->stripeIndex);
+  }
+
+  TEST(StripePrefetcher, error) {
+    MockStripeLoader loader(100);
+    loader.failingStripe = 2;
+    StripePrefetcher prefetcher(loader, 0, 10, 4, 1000);
+    EXPECT_EQ(0, prefetcher.take(0)->stripeIndex);
+    EXPECT_EQ(1, prefetcher.take(1)->stripeIndex);
+    EXPECT_THROW(prefetcher.take(2), ParseError);
+    EXPECT_EQ(4, prefetcher.take(4)->stripeIndex);
+  }
+}
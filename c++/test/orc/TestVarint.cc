@@ -0,0 +1,146 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Varint.hh"
+#include "wrap/gtest-wrapper.h"
+
+#include <vector>
+
+namespace orc {
+
+  static void appendVarint(uint64_t value, std::vector<char>& output) {
+    while (value >= 0x80) {
+      output.push_back(static_cast<char>(0x80 | (value & 0x7f)));
+      value >>= 7;
+    }
+    output.push_back(static_cast<char>(value));
+  }
+
+  /**
+   * Make values with lengths from 1 to maxLength bytes, with long
+   * stretches of one byte values in between.
+   */
+  static std::vector<uint64_t> makeValues(uint64_t count,
+                                          uint32_t maxLength) {
+    std::vector<uint64_t> result;
+    uint64_t seed = maxLength;
+    for(uint64_t i=0; i < count; ++i) {
+      seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+      uint32_t bits = (i / 40) % 2 == 0 ? 7 :
+        std::min<uint32_t>(64, 7 * (1 + static_cast<uint32_t>(seed >> 59) %
+                                    maxLength));
+      result.push_back((seed ^ (seed << 17)) >> (64 - bits));
+    }
+    return result;
+  }
+
+  TEST(Varint, testShortVarints) {
+    for(uint32_t shift=0; shift < 64; ++shift) {
+      uint64_t value = (1ULL << shift) - 1;
+      std::vector<char> bytes;
+      appendVarint(value, bytes);
+      size_t length = bytes.size();
+      bytes.resize(16, static_cast<char>(0xff));
+      uint64_t result = 42;
+      uint32_t decoded = decodeShortVarint(bytes.data(), result);
+      if (length <= 8) {
+        EXPECT_EQ(length, decoded) << "shift " << shift;
+        EXPECT_EQ(value, result) << "shift " << shift;
+      } else {
+        EXPECT_EQ(0, decoded) << "shift " << shift;
+      }
+    }
+  }
+
+  typedef uint64_t (*VarintDecoder)(const char* input,
+                                    uint64_t length,
+                                    int64_t* output,
+                                    uint64_t count,
+                                    uint64_t& used);
+
+  static void checkRuns(VarintDecoder decoder) {
+    for(uint32_t maxLength=1; maxLength <= 10; ++maxLength) {
+      std::vector<uint64_t> values = makeValues(1000, maxLength);
+      std::vector<char> bytes;
+      for(size_t i=0; i < values.size(); ++i) {
+        appendVarint(values[i], bytes);
+      }
+      std::vector<int64_t> output(values.size() + 1, 42);
+      uint64_t used;
+      uint64_t decoded = decoder(bytes.data(), bytes.size(), output.data(),
+                                 values.size(), used);
+      // only the varints near the end are left to the caller
+      EXPECT_LT(bytes.size() - 24, used) << "length " << maxLength;
+      uint64_t position = 0;
+      for(size_t i=0; i < decoded; ++i) {
+        ASSERT_EQ(values[i], static_cast<uint64_t>(output[i]))
+          << "length " << maxLength << " value " << i;
+        std::vector<char> encoded;
+        appendVarint(values[i], encoded);
+        position += encoded.size();
+      }
+      EXPECT_EQ(position, used);
+      EXPECT_EQ(42, output[decoded]);
+
+      // stopping after a count
+      for(uint64_t count=1; count < 40; ++count) {
+        decoded = decoder(bytes.data(), bytes.size(), output.data(), count,
+                          used);
+        EXPECT_EQ(count, decoded);
+        position = 0;
+        for(size_t i=0; i < count; ++i) {
+          std::vector<char> encoded;
+          appendVarint(values[i], encoded);
+          position += encoded.size();
+        }
+        EXPECT_EQ(position, used);
+      }
+    }
+  }
+
+  TEST(Varint, testRuns) {
+    checkRuns(decodeVarints);
+  }
+
+  TEST(Varint, testScalarRuns) {
+    checkRuns(decodeScalarVarints);
+  }
+
+  TEST(Varint, testShortInput) {
+    const char bytes[] = {1, 2, 3};
+    int64_t output[3];
+    uint64_t used = 42;
+    EXPECT_EQ(0, decodeVarints(bytes, sizeof(bytes), output, 3, used));
+    EXPECT_EQ(0, used);
+  }
+
+  TEST(Varint, testTooLong) {
+    std::vector<char> bytes;
+    appendVarint(300, bytes);
+    bytes.insert(bytes.end(), 11, static_cast<char>(0x80));
+    bytes.resize(40, 0);
+    int64_t output[10];
+    uint64_t used;
+    EXPECT_EQ(1, decodeVarints(bytes.data(), bytes.size(), output, 10, used));
+    EXPECT_EQ(300, output[0]);
+    EXPECT_EQ(2, used);
+    EXPECT_EQ(1, decodeScalarVarints(bytes.data(), bytes.size(), output, 10,
+                                     used));
+    EXPECT_EQ(2, used);
+  }
+}
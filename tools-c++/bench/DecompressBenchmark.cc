@@ -0,0 +1,241 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Compression.hh"
+#include "LzoCompress.hh"
+#include "wrap/snappy-wrapper.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "zlib.h"
+
+/**
+ * Measures the decompression streams by compressing the given files (or
+ * generated data if there are none) into ORC compression chunks with each
+ * codec and then reading them back through createDecompressor. The ZLIB
+ * chunks are also inflated directly with zlib and with the native kernel
+ * to compare the two in MB/s on one core.
+ */
+
+typedef uint64_t (*Compressor)(const char* input,
+                               uint64_t length,
+                               char* output,
+                               uint64_t outputLength);
+
+struct Codec {
+  const char* name;
+  orc::CompressionKind kind;
+  Compressor compress;
+};
+
+uint64_t compressSnappy(const char* input,
+                        uint64_t length,
+                        char* output,
+                        uint64_t) {
+  size_t result;
+  snappy::RawCompress(input, length, output, &result);
+  return result;
+}
+
+uint64_t compressLzo(const char* input,
+                     uint64_t length,
+                     char* output,
+                     uint64_t) {
+  return orc::lzoCompress(input, length, output);
+}
+
+uint64_t compressZlib(const char* input,
+                      uint64_t length,
+                      char* output,
+                      uint64_t outputLength) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("can't initialize deflate");
+  }
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input));
+  stream.avail_in = static_cast<uInt>(length);
+  stream.next_out = reinterpret_cast<Bytef*>(output);
+  stream.avail_out = static_cast<uInt>(outputLength);
+  int result = deflate(&stream, Z_FINISH);
+  uint64_t compressed = stream.total_out;
+  deflateEnd(&stream);
+  // report chunks that don't fit as incompressible
+  return result == Z_STREAM_END ? compressed : length;
+}
+
+/**
+ * Build an ORC compressed stream with a header before each chunk. Chunks
+ * that don't get smaller are stored as originals like the writer does.
+ */
+std::vector<char> compressStream(const Codec& codec,
+                                 const std::string& data,
+                                 uint64_t blockSize) {
+  std::vector<char> result;
+  std::vector<char> buffer(std::max(std::max(snappy::MaxCompressedLength
+                                             (blockSize),
+                                             static_cast<size_t>
+                                             (orc::lzoMaxCompressedLength
+                                              (blockSize))),
+                                    static_cast<size_t>
+                                    (compressBound(static_cast<uLong>
+                                                   (blockSize)))));
+  for(uint64_t offset=0; offset < data.size(); offset += blockSize) {
+    uint64_t length = std::min(blockSize, data.size() - offset);
+    uint64_t compressed = codec.compress(data.data() + offset, length,
+                                         buffer.data(), buffer.size());
+    bool isOriginal = compressed >= length;
+    uint64_t chunkLength = isOriginal ? length : compressed;
+    uint64_t header = (chunkLength << 1) | (isOriginal ? 1 : 0);
+    result.push_back(static_cast<char>(header));
+    result.push_back(static_cast<char>(header >> 8));
+    result.push_back(static_cast<char>(header >> 16));
+    const char* chunk = isOriginal ? data.data() + offset : buffer.data();
+    result.insert(result.end(), chunk, chunk + chunkLength);
+  }
+  return result;
+}
+
+/**
+ * Generate data that looks like the contents of ORC streams: runs of
+ * small integers, repeated strings and some noise.
+ */
+std::string generateData(uint64_t length) {
+  std::string result;
+  uint64_t seed = 42;
+  const char* words[] = {"alpha", "bravo", "charlie", "delta", "echo",
+                         "foxtrot", "golf", "hotel"};
+  while (result.size() < length) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    switch (seed >> 62) {
+    case 0:
+      for(uint64_t i=0; i < 64; ++i) {
+        uint32_t value = static_cast<uint32_t>(i + (seed & 0xffff));
+        result.append(reinterpret_cast<const char*>(&value), sizeof(value));
+      }
+      break;
+    case 1:
+    case 2:
+      result += words[(seed >> 20) % 8];
+      result += ',';
+      break;
+    default:
+      for(uint64_t i=0; i < 16; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        result += static_cast<char>(seed >> 56);
+      }
+    }
+  }
+  result.resize(length);
+  return result;
+}
+
+void runCodec(const Codec& codec,
+              const std::string& data,
+              uint64_t blockSize,
+              uint64_t iterations) {
+  std::vector<char> stream = compressStream(codec, data, blockSize);
+  uint64_t bytes = 0;
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  for(uint64_t i=0; i < iterations; ++i) {
+    std::unique_ptr<orc::SeekableInputStream> input =
+      orc::createDecompressor(codec.kind,
+                              std::unique_ptr<orc::SeekableInputStream>
+                              (new orc::SeekableArrayInputStream
+                               (stream.data(), stream.size())),
+                              blockSize,
+                              *orc::getDefaultPool());
+    const void* ptr;
+    int length;
+    while (input->Next(&ptr, &length)) {
+      bytes += static_cast<uint64_t>(length);
+    }
+  }
+  double seconds = std::chrono::duration<double>
+    (std::chrono::steady_clock::now() - start).count();
+  if (bytes != data.size() * iterations) {
+    std::cout << codec.name << " returned the wrong number of bytes\n";
+  }
+  std::cout << std::setw(10) << codec.name
+            << std::fixed << std::setprecision(3)
+            << std::setw(10) << static_cast<double>(stream.size()) /
+                                static_cast<double>(data.size())
+            << " ratio"
+            << std::setw(12) << static_cast<double>(bytes) / 1e6 / seconds
+            << " MB/s\n";
+}
+
+int main(int argc, char* argv[]) {
+  uint64_t blockSize = 256 * 1024;
+  uint64_t iterations = 10;
+  std::string data;
+  for(int i=1; i < argc; ++i) {
+    if (strcmp(argv[i], "--block") == 0 && i + 1 < argc) {
+      blockSize = std::strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = std::strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--help") == 0) {
+      std::cout << "Usage: decompress-benchmark [--block <bytes>]"
+                << " [--iterations <n>] [<filename>...]\n";
+      return 1;
+    } else {
+      std::ifstream file(argv[i], std::ios::in | std::ios::binary);
+      if (!file) {
+        std::cout << "Can't read " << argv[i] << "\n";
+        return 1;
+      }
+      data.append(std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>());
+    }
+  }
+  if (data.empty()) {
+    data = generateData(32 * 1024 * 1024);
+  }
+
+  std::vector<Codec> codecs;
+  Codec snappyCodec = { "snappy", orc::CompressionKind_SNAPPY,
+                        compressSnappy };
+  Codec lzoCodec = { "lzo", orc::CompressionKind_LZO, compressLzo };
+  Codec zlibCodec = { "zlib", orc::CompressionKind_ZLIB, compressZlib };
+  codecs.push_back(snappyCodec);
+  codecs.push_back(lzoCodec);
+  codecs.push_back(zlibCodec);
+
+  std::cout << "decompressing " << data.size() << " bytes in "
+            << blockSize << " byte chunks " << iterations << " times\n";
+  try {
+    for(size_t c=0; c < codecs.size(); ++c) {
+      runCodec(codecs[c], data, blockSize, iterations);
+    }
+  } catch (std::exception& e) {
+    std::cout << "Error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/OrcFile.hh"
+#include "orc/Exceptions.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Compares the local file backends by scanning the given files from many
+ * readers at once. Each thread scans every file the given number of times,
+ * so small example files can be scaled up to a useful amount of I/O.
+ */
+
+typedef std::unique_ptr<orc::InputStream> (*StreamFactory)
+  (const std::string& path);
+
+struct Backend {
+  const char* name;
+  StreamFactory factory;
+};
+
+struct ScanResult {
+  uint64_t rows;
+  uint64_t bytes;
+};
+
+ScanResult scanFile(StreamFactory factory,
+                    const std::string& filename,
+                    uint64_t prefetchDepth) {
+  orc::ReaderOptions opts;
+  opts.setPrefetchDepth(prefetchDepth);
+  std::unique_ptr<orc::Reader> reader =
+    orc::createReader(factory(filename), opts);
+  std::unique_ptr<orc::ColumnVectorBatch> batch =
+    reader->createRowBatch(1024);
+  ScanResult result;
+  result.rows = 0;
+  while (reader->next(*batch)) {
+    result.rows += batch->numElements;
+  }
+  result.bytes = reader->getBytesRead();
+  return result;
+}
+
+void runBackend(const Backend& backend,
+                const std::vector<std::string>& files,
+                uint64_t threads,
+                uint64_t copies,
+                uint64_t prefetchDepth) {
+  std::vector<ScanResult> results(threads);
+  std::vector<std::thread> workers;
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  for(uint64_t t=0; t < threads; ++t) {
+    workers.push_back(std::thread([&, t] {
+          results[t].rows = 0;
+          results[t].bytes = 0;
+          for(uint64_t c=0; c < copies; ++c) {
+            for(size_t f=0; f < files.size(); ++f) {
+              ScanResult scan = scanFile(backend.factory, files[f],
+                                         prefetchDepth);
+              results[t].rows += scan.rows;
+              results[t].bytes += scan.bytes;
+            }
+          }
+        }));
+  }
+  for(uint64_t t=0; t < threads; ++t) {
+    workers[t].join();
+  }
+  double seconds = std::chrono::duration<double>
+    (std::chrono::steady_clock::now() - start).count();
+  uint64_t rows = 0;
+  uint64_t bytes = 0;
+  for(uint64_t t=0; t < threads; ++t) {
+    rows += results[t].rows;
+    bytes += results[t].bytes;
+  }
+  std::cout << std::setw(10) << backend.name
+            << std::fixed << std::setprecision(3)
+            << std::setw(10) << seconds << " s"
+            << std::setw(12) << static_cast<double>(bytes) / 1e6 / seconds
+            << " MB/s"
+            << std::setw(14) << static_cast<double>(rows) / 1e6 / seconds
+            << " Mrows/s\n";
+}
+
+int main(int argc, char* argv[]) {
+  uint64_t threads = 4;
+  uint64_t copies = 10;
+  uint64_t prefetchDepth = 2;
+  std::vector<std::string> files;
+  for(int i=1; i < argc; ++i) {
+    if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = std::strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--copies") == 0 && i + 1 < argc) {
+      copies = std::strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc) {
+      prefetchDepth = std::strtoull(argv[++i], nullptr, 10);
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+  if (files.empty()) {
+    std::cout << "Usage: read-benchmark [--threads <n>] [--copies <n>]"
+              << " [--prefetch <depth>] <filename>...\n";
+    return 1;
+  }
+
+  std::vector<Backend> backends;
+  Backend pread = { "pread", orc::readLocalFile };
+  Backend mmap = { "mmap", orc::readLocalFileMmap };
+  Backend uring = { "io_uring", orc::readLocalFileIoUring };
+  backends.push_back(pread);
+  backends.push_back(mmap);
+  if (orc::isIoUringAvailable()) {
+    backends.push_back(uring);
+  } else {
+    std::cout << "io_uring is not available\n";
+  }
+
+  std::cout << threads << " threads scanning " << files.size()
+            << " files " << copies << " times with prefetch depth "
+            << prefetchDepth << "\n";
+  try {
+    for(size_t b=0; b < backends.size(); ++b) {
+      runBackend(backends[b], files, threads, copies, prefetchDepth);
+    }
+  } catch (std::exception& e) {
+    std::cout << "Error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
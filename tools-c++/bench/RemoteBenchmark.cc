@@ -0,0 +1,188 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/OrcFile.hh"
+#include "orc/Exceptions.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * Scans ORC files through simulated remote storage and reports how many
+ * requests each scan makes and how many bytes it fetches compared to the
+ * size of the file. Because the storage model is deterministic, changes
+ * to the reader's I/O pattern show up directly in these numbers.
+ */
+
+struct Settings {
+  uint64_t latency;
+  uint64_t bandwidth;
+  uint64_t concurrency;
+  uint64_t coalescingGap;
+  uint64_t prefetchDepth;
+};
+
+struct ScanResult {
+  uint64_t fileLength;
+  uint64_t requests;
+  uint64_t bytes;
+  uint64_t rows;
+  double seconds;
+};
+
+std::vector<std::string> findFiles(const std::string& path) {
+  std::vector<std::string> result;
+  DIR* dir = opendir(path.c_str());
+  if (dir == nullptr) {
+    result.push_back(path);
+    return result;
+  }
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    std::string name(entry->d_name);
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".orc") == 0) {
+      result.push_back(path + "/" + name);
+    }
+  }
+  closedir(dir);
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+ScanResult scanFile(const std::string& filename, const Settings& settings) {
+  std::shared_ptr<orc::SimulatedStorage> storage =
+    orc::createSimulatedStorage(settings.latency, settings.bandwidth,
+                                settings.concurrency);
+  orc::ReaderOptions opts;
+  opts.setReadCoalescingGap(settings.coalescingGap);
+  opts.setPrefetchDepth(settings.prefetchDepth);
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  std::unique_ptr<orc::Reader> reader =
+    orc::createReader(orc::createSimulatedStream(orc::readLocalFile
+                                                 (filename), storage),
+                      opts);
+  std::unique_ptr<orc::ColumnVectorBatch> batch =
+    reader->createRowBatch(1024);
+  ScanResult result;
+  result.rows = 0;
+  while (reader->next(*batch)) {
+    result.rows += batch->numElements;
+  }
+  // the reader must be done with the stream before it is measured
+  reader.reset();
+  result.seconds = std::chrono::duration<double>
+    (std::chrono::steady_clock::now() - start).count();
+  result.fileLength = orc::readLocalFile(filename)->getLength();
+  result.requests = storage->getRequestCount();
+  result.bytes = storage->getBytesRequested();
+  return result;
+}
+
+void printRow(const std::string& name, const ScanResult& result) {
+  std::cout << std::left << std::setw(40) << name << std::right
+            << std::setw(12) << result.fileLength
+            << std::setw(10) << result.requests
+            << std::setw(12) << result.bytes
+            << std::fixed << std::setprecision(2)
+            << std::setw(8) << (result.fileLength == 0 ? 0.0 :
+                                static_cast<double>(result.bytes) /
+                                static_cast<double>(result.fileLength))
+            << std::setprecision(3)
+            << std::setw(10) << result.seconds << "\n";
+}
+
+int main(int argc, char* argv[]) {
+  Settings settings;
+  settings.latency = 20000;
+  settings.bandwidth = 100 * 1000 * 1000;
+  settings.concurrency = 8;
+  settings.coalescingGap = orc::ReaderOptions().getReadCoalescingGap();
+  settings.prefetchDepth = 0;
+  std::vector<std::string> paths;
+  for(int i=1; i < argc; ++i) {
+    if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+      settings.latency = std::strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--bandwidth") == 0 && i + 1 < argc) {
+      settings.bandwidth = std::strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--concurrency") == 0 && i + 1 < argc) {
+      settings.concurrency = std::strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--gap") == 0 && i + 1 < argc) {
+      settings.coalescingGap = std::strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc) {
+      settings.prefetchDepth = std::strtoull(argv[++i], nullptr, 10);
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty()) {
+    std::cout << "Usage: remote-benchmark [--latency <us>]"
+              << " [--bandwidth <bytes/s>] [--concurrency <n>]"
+              << " [--gap <bytes>] [--prefetch <depth>]"
+              << " <directory or filename>...\n";
+    return 1;
+  }
+
+  std::vector<std::string> files;
+  for(size_t i=0; i < paths.size(); ++i) {
+    std::vector<std::string> found = findFiles(paths[i]);
+    files.insert(files.end(), found.begin(), found.end());
+  }
+
+  std::cout << "latency " << settings.latency << " us, bandwidth "
+            << settings.bandwidth << " bytes/s, concurrency "
+            << settings.concurrency << ", coalescing gap "
+            << settings.coalescingGap << ", prefetch depth "
+            << settings.prefetchDepth << "\n";
+  std::cout << std::left << std::setw(40) << "file" << std::right
+            << std::setw(12) << "length"
+            << std::setw(10) << "requests"
+            << std::setw(12) << "bytes"
+            << std::setw(8) << "amp"
+            << std::setw(10) << "seconds" << "\n";
+  ScanResult total;
+  total.fileLength = 0;
+  total.requests = 0;
+  total.bytes = 0;
+  total.rows = 0;
+  total.seconds = 0;
+  for(size_t i=0; i < files.size(); ++i) {
+    std::string name = files[i].substr(files[i].rfind('/') + 1);
+    try {
+      ScanResult result = scanFile(files[i], settings);
+      printRow(name, result);
+      total.fileLength += result.fileLength;
+      total.requests += result.requests;
+      total.bytes += result.bytes;
+      total.rows += result.rows;
+      total.seconds += result.seconds;
+    } catch (std::exception& e) {
+      std::cout << name << " failed: " << e.what() << "\n";
+    }
+  }
+  printRow("total", total);
+  return 0;
+}
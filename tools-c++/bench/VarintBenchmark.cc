@@ -0,0 +1,228 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Compression.hh"
+#include "orc/RLE.hh"
+#include "orc/Varint.hh"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/**
+ * Measures decoding base 128 varints, the way RLEv1 literals and decimal
+ * values are stored, with the byte at a time loop that the decoders used
+ * to have and with decodeVarints, both with the fastest instructions the
+ * machine has and with only portable code. The RLEv1 decoder is also timed
+ * on the same values in literal runs. Each case uses values of a different
+ * size and the results are in nanoseconds per value on one core.
+ */
+
+struct Distribution {
+  const char* name;
+  // the values have a random number of bits up to these
+  uint32_t minBits;
+  uint32_t maxBits;
+};
+
+std::vector<uint64_t> generateValues(const Distribution& distribution,
+                                     uint64_t count) {
+  std::vector<uint64_t> result;
+  uint64_t seed = 42;
+  uint32_t range = distribution.maxBits - distribution.minBits + 1;
+  for(uint64_t i=0; i < count; ++i) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    uint32_t bits = distribution.minBits +
+      static_cast<uint32_t>(seed >> 40) % range;
+    uint64_t value = seed ^ (seed >> 29);
+    result.push_back(bits == 0 ? 0 : value >> (64 - bits));
+  }
+  return result;
+}
+
+void appendVarint(uint64_t value, std::vector<char>& output) {
+  while (value >= 0x80) {
+    output.push_back(static_cast<char>(0x80 | (value & 0x7f)));
+    value >>= 7;
+  }
+  output.push_back(static_cast<char>(value));
+}
+
+/**
+ * The loop that the decoders used before decodeVarints.
+ */
+uint64_t decodeBytewise(const char* input,
+                        uint64_t count,
+                        int64_t* output) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(input);
+  uint64_t position = 0;
+  for(uint64_t i=0; i < count; ++i) {
+    uint64_t result = 0;
+    uint64_t offset = 0;
+    unsigned char ch;
+    do {
+      ch = bytes[position++];
+      result |= static_cast<uint64_t>(ch & 0x7f) << offset;
+      offset += 7;
+    } while (ch >= 0x80);
+    output[i] = static_cast<int64_t>(result);
+  }
+  return position;
+}
+
+double nanosPerValue(std::chrono::steady_clock::time_point start,
+                     uint64_t values) {
+  return std::chrono::duration<double, std::nano>
+    (std::chrono::steady_clock::now() - start).count() /
+    static_cast<double>(values);
+}
+
+typedef uint64_t (*VarintDecoder)(const char* input,
+                                  uint64_t length,
+                                  int64_t* output,
+                                  uint64_t count,
+                                  uint64_t& used);
+
+double timeDecoder(VarintDecoder decoder,
+                   const std::vector<char>& bytes,
+                   const std::vector<uint64_t>& values,
+                   std::vector<int64_t>& output,
+                   uint64_t iterations) {
+  uint64_t count = values.size();
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  for(uint64_t i=0; i < iterations; ++i) {
+    uint64_t used;
+    if (decoder(bytes.data(), bytes.size(), output.data(), count,
+                used) != count) {
+      throw std::logic_error("the decoder stopped early");
+    }
+  }
+  double result = nanosPerValue(start, count * iterations);
+  for(size_t i=0; i < values.size(); ++i) {
+    if (static_cast<uint64_t>(output[i]) != values[i]) {
+      throw std::logic_error("the decoder returned a wrong value");
+    }
+  }
+  return result;
+}
+
+void runDistribution(const Distribution& distribution,
+                     uint64_t count,
+                     uint64_t iterations) {
+  std::vector<uint64_t> values = generateValues(distribution, count);
+  std::vector<char> bytes;
+  for(size_t i=0; i < values.size(); ++i) {
+    appendVarint(values[i], bytes);
+  }
+  // RLEv1 literal runs of 128 values
+  std::vector<char> runs;
+  for(size_t start=0; start < values.size(); start += 128) {
+    size_t length = std::min<size_t>(128, values.size() - start);
+    runs.push_back(static_cast<char>(-static_cast<int>(length)));
+    for(size_t i=start; i < start + length; ++i) {
+      appendVarint(values[i], runs);
+    }
+  }
+  // leave room so that decodeVarints decodes every value
+  bytes.resize(bytes.size() + 32);
+  std::vector<int64_t> output(count);
+
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  for(uint64_t i=0; i < iterations; ++i) {
+    decodeBytewise(bytes.data(), count, output.data());
+  }
+  double bytewise = nanosPerValue(start, count * iterations);
+
+  double bulk = timeDecoder(orc::decodeVarints, bytes, values, output,
+                            iterations);
+  double scalar = timeDecoder(orc::decodeScalarVarints, bytes, values,
+                              output, iterations);
+
+  const uint64_t batchSize = 1024;
+  start = std::chrono::steady_clock::now();
+  for(uint64_t i=0; i < iterations; ++i) {
+    std::unique_ptr<orc::RleDecoder> rle =
+      orc::createRleDecoder(std::unique_ptr<orc::SeekableInputStream>
+                            (new orc::SeekableArrayInputStream
+                             (runs.data(), runs.size(), 256 * 1024)),
+                            false, orc::RleVersion_1,
+                            *orc::getDefaultPool());
+    for(uint64_t done=0; done < count; done += batchSize) {
+      rle->next(output.data() + done, std::min(batchSize, count - done),
+                nullptr);
+    }
+  }
+  double rlev1 = nanosPerValue(start, count * iterations);
+
+  std::cout << std::setw(12) << distribution.name
+            << std::fixed << std::setprecision(3)
+            << std::setw(10) << bytewise
+            << std::setw(10) << bulk
+            << std::setw(10) << scalar
+            << std::setw(10) << rlev1 << "\n";
+}
+
+int main(int argc, char* argv[]) {
+  uint64_t count = 1024 * 1024;
+  uint64_t iterations = 20;
+  for(int i=1; i < argc; ++i) {
+    if (strcmp(argv[i], "--values") == 0 && i + 1 < argc) {
+      count = std::strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = std::strtoull(argv[++i], nullptr, 10);
+    } else {
+      std::cout << "Usage: varint-benchmark [--values <n>]"
+                << " [--iterations <n>]\n";
+      return 1;
+    }
+  }
+
+  const Distribution distributions[] = {
+    {"1 byte", 0, 7},
+    {"1-2 bytes", 0, 14},
+    {"3 bytes", 15, 21},
+    {"1-4 bytes", 0, 28},
+    {"5-8 bytes", 29, 56},
+    {"1-10 bytes", 0, 64}
+  };
+  std::cout << "decoding " << count << " varints " << iterations
+            << " times in ns/value\n"
+            << std::setw(12) << "values"
+            << std::setw(10) << "bytewise"
+            << std::setw(10) << "bulk"
+            << std::setw(10) << "scalar"
+            << std::setw(10) << "rlev1" << "\n";
+  try {
+    for(size_t d=0; d < sizeof(distributions) / sizeof(distributions[0]);
+        ++d) {
+      runDistribution(distributions[d], count, iterations);
+    }
+  } catch (std::exception& e) {
+    std::cout << "Error: " << e.what() << "\n";
+    return 1;
+  }
+  return 0;
+}
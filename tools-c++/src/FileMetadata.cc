@@ -72,6 +72,8 @@ int main(int argc, char* argv[])
   case ZLIB:
   case SNAPPY:
   case LZO:
+  case LZ4:
+  case ZSTD:
   default:
       std::cout << "ORC files with compression are not supported" << std::endl ;
       input.close();
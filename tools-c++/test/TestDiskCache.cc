@@ -0,0 +1,373 @@
+/**
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "orc/Adaptor.hh"
+#include "orc/Exceptions.hh"
+#include "orc/OrcFile.hh"
+#include "ToolTest.hh"
+
+#include "wrap/gtest-wrapper.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sstream>
+#include <stdlib.h>
+#include <sys/file.h>
+#include <thread>
+#include <unistd.h>
+
+namespace orc {
+
+  /**
+   * A local file that acts like a slow remote file system by sleeping on
+   * every read. It counts the reads that reach it.
+   */
+  class ThrottledInputStream: public InputStream {
+  private:
+    std::unique_ptr<InputStream> file;
+    std::chrono::microseconds delay;
+    std::atomic<uint64_t>* reads;
+
+  public:
+    ThrottledInputStream(const std::string& path,
+                         std::chrono::microseconds _delay,
+                         std::atomic<uint64_t>* _reads
+                         ): file(readLocalFile(path)),
+                            delay(_delay),
+                            reads(_reads) {
+      // PASS
+    }
+
+    uint64_t getLength() const override {
+      return file->getLength();
+    }
+
+    uint64_t getModificationTime() const override {
+      return file->getModificationTime();
+    }
+
+    const std::string& getName() const override {
+      return file->getName();
+    }
+
+    Buffer* read(uint64_t offset,
+                 uint64_t length,
+                 Buffer* buffer) override {
+      *reads += 1;
+      std::this_thread::sleep_for(delay);
+      return file->read(offset, length, buffer);
+    }
+  };
+
+  /**
+   * A throttled file that doesn't know its modification time.
+   */
+  class UntimedInputStream: public ThrottledInputStream {
+  public:
+    UntimedInputStream(const std::string& path,
+                       std::atomic<uint64_t>* _reads
+                       ): ThrottledInputStream(path,
+                                               std::chrono::microseconds(0),
+                                               _reads) {
+      // PASS
+    }
+
+    uint64_t getModificationTime() const override {
+      return 0;
+    }
+  };
+
+  /**
+   * A temporary directory that is removed with its files.
+   */
+  class TempDirectory {
+  private:
+    std::string path;
+
+  public:
+    TempDirectory() {
+      char name[] = "/tmp/orc-disk-cache-XXXXXX";
+      if (mkdtemp(name) == nullptr) {
+        throw std::runtime_error("Can't create a temporary directory");
+      }
+      path = name;
+    }
+
+    ~TempDirectory() {
+      DIR* dir = opendir(path.c_str());
+      if (dir != nullptr) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != nullptr) {
+          std::string name(entry->d_name);
+          if (name != "." && name != "..") {
+            unlink((path + "/" + name).c_str());
+          }
+        }
+        closedir(dir);
+      }
+      rmdir(path.c_str());
+    }
+
+    const std::string& getPath() const {
+      return path;
+    }
+  };
+
+  static std::string getExample(const std::string& name) {
+    std::ostringstream filename;
+    filename << exampleDirectory << "/" << name;
+    return filename.str();
+  }
+
+  static void expectSameBytes(InputStream& expected,
+                       InputStream& actual,
+                       uint64_t offset,
+                       uint64_t length) {
+    std::unique_ptr<Buffer> want(expected.read(offset, length, nullptr));
+    std::unique_ptr<Buffer> got(actual.read(offset, length, nullptr));
+    EXPECT_EQ(0, memcmp(want->getStart(), got->getStart(), length))
+      << "offset " << offset << " length " << length;
+  }
+
+  TEST(DiskCache, testReadThrough) {
+    TempDirectory dir;
+    std::string filename = getExample("demo-12-zlib.orc");
+    std::shared_ptr<DiskCache> cache =
+      openDiskCache(dir.getPath(), 1024 * 1024, 4096);
+    EXPECT_EQ(dir.getPath(), cache->getDirectory());
+    EXPECT_EQ(4096, cache->getBlockSize());
+    EXPECT_EQ(0, cache->getNumberOfBlocks());
+
+    std::atomic<uint64_t> reads(0);
+    std::unique_ptr<InputStream> direct = readLocalFile(filename);
+    std::unique_ptr<InputStream> cached =
+      createDiskCachedStream(std::unique_ptr<InputStream>
+                             (new ThrottledInputStream
+                              (filename, std::chrono::microseconds(100),
+                               &reads)), cache);
+    uint64_t length = cached->getLength();
+    EXPECT_EQ(direct->getLength(), length);
+    EXPECT_EQ(filename, cached->getName());
+
+    // unaligned reads that span several blocks
+    expectSameBytes(*direct, *cached, 100, 10000);
+    EXPECT_EQ(1, reads);
+    EXPECT_EQ(3, cache->getNumberOfBlocks());
+    expectSameBytes(*direct, *cached, 5000, 3000);
+    EXPECT_EQ(1, reads);
+
+    // the missing blocks around a cached block are read separately
+    expectSameBytes(*direct, *cached, 0, 20000);
+    EXPECT_EQ(2, reads);
+    expectSameBytes(*direct, *cached, length - 5000, 5000);
+    expectSameBytes(*direct, *cached, 0, length);
+    uint64_t before = reads;
+    expectSameBytes(*direct, *cached, 0, length);
+    EXPECT_EQ(before, reads);
+    EXPECT_EQ(length, cache->getCachedBytes());
+    EXPECT_EQ((length + 4095) / 4096, cache->getNumberOfBlocks());
+    EXPECT_LT(0, cache->getHits());
+    EXPECT_LT(0, cache->getMisses());
+
+    // a reader over the cached stream reads nothing from the slow stream
+    std::unique_ptr<Reader> reader =
+      createReader(createDiskCachedStream
+                   (std::unique_ptr<InputStream>
+                    (new ThrottledInputStream
+                     (filename, std::chrono::microseconds(0), &reads)),
+                    cache), ReaderOptions());
+    std::unique_ptr<ColumnVectorBatch> batch = reader->createRowBatch(1024);
+    uint64_t rows = 0;
+    while (reader->next(*batch)) {
+      rows += batch->numElements;
+    }
+    EXPECT_EQ(1920800, rows);
+    EXPECT_EQ(before, reads);
+
+    EXPECT_THROW(cached->read(length - 10, 11, nullptr), ParseError);
+  }
+
+  TEST(DiskCache, testUnknownModificationTime) {
+    TempDirectory dir;
+    std::string filename = getExample("demo-12-zlib.orc");
+    std::shared_ptr<DiskCache> cache =
+      openDiskCache(dir.getPath(), 1024 * 1024, 4096);
+    std::atomic<uint64_t> reads(0);
+    std::unique_ptr<InputStream> direct = readLocalFile(filename);
+    std::unique_ptr<InputStream> uncached =
+      createDiskCachedStream(std::unique_ptr<InputStream>
+                             (new UntimedInputStream(filename, &reads)),
+                             cache);
+    expectSameBytes(*direct, *uncached, 100, 10000);
+    expectSameBytes(*direct, *uncached, 100, 10000);
+    EXPECT_EQ(2, reads);
+    EXPECT_EQ(0, cache->getNumberOfBlocks());
+  }
+
+  TEST(DiskCache, testPersistence) {
+    TempDirectory dir;
+    std::string filename = getExample("TestOrcFile.testSeek.orc");
+    std::atomic<uint64_t> reads(0);
+    uint64_t blocks;
+    {
+      std::shared_ptr<DiskCache> cache =
+        openDiskCache(dir.getPath(), 1024 * 1024, 8192);
+      EXPECT_EQ(cache, openDiskCache(dir.getPath(), 1, 8192));
+      EXPECT_THROW(openDiskCache(dir.getPath(), 1024 * 1024, 1024),
+                   std::logic_error);
+      std::unique_ptr<InputStream> cached =
+        createDiskCachedStream(std::unique_ptr<InputStream>
+                               (new ThrottledInputStream
+                                (filename, std::chrono::microseconds(0),
+                                 &reads)), cache);
+      std::unique_ptr<Buffer> buffer(cached->read(0, 100000, nullptr));
+      blocks = cache->getNumberOfBlocks();
+      EXPECT_EQ(13, blocks);
+    }
+
+    // a new cache over the directory finds the blocks
+    std::unique_ptr<InputStream> direct = readLocalFile(filename);
+    {
+      std::shared_ptr<DiskCache> cache =
+        openDiskCache(dir.getPath(), 1024 * 1024, 8192);
+      EXPECT_EQ(blocks, cache->getNumberOfBlocks());
+      std::unique_ptr<InputStream> cached =
+        createDiskCachedStream(std::unique_ptr<InputStream>
+                               (new ThrottledInputStream
+                                (filename, std::chrono::microseconds(0),
+                                 &reads)), cache);
+      expectSameBytes(*direct, *cached, 1000, 90000);
+      EXPECT_EQ(1, reads);
+      EXPECT_EQ(0, cache->getMisses());
+    }
+
+    // one with another block size starts over
+    std::shared_ptr<DiskCache> cache =
+      openDiskCache(dir.getPath(), 1024 * 1024, 1024);
+    EXPECT_EQ(1024, cache->getBlockSize());
+    EXPECT_EQ(0, cache->getNumberOfBlocks());
+    std::unique_ptr<InputStream> cached =
+      createDiskCachedStream(std::unique_ptr<InputStream>
+                             (new ThrottledInputStream
+                              (filename, std::chrono::microseconds(0),
+                               &reads)), cache);
+    expectSameBytes(*direct, *cached, 1000, 9000);
+    EXPECT_EQ(2, reads);
+    EXPECT_EQ(10, cache->getNumberOfBlocks());
+  }
+
+  TEST(DiskCache, testOtherProcess) {
+    TempDirectory dir;
+    {
+      std::shared_ptr<DiskCache> cache =
+        openDiskCache(dir.getPath(), 1024 * 1024, 4096);
+    }
+
+    // a lock from another open of the file acts like another process
+    std::string lockPath = dir.getPath() + "/lock";
+    int lockFile = open(lockPath.c_str(), O_RDWR);
+    ASSERT_NE(-1, lockFile);
+    ASSERT_EQ(0, flock(lockFile, LOCK_EX | LOCK_NB));
+    EXPECT_THROW(openDiskCache(dir.getPath(), 1024 * 1024, 4096),
+                 ParseError);
+    close(lockFile);
+    std::shared_ptr<DiskCache> cache =
+      openDiskCache(dir.getPath(), 1024 * 1024, 4096);
+    EXPECT_EQ(0, cache->getNumberOfBlocks());
+  }
+
+  TEST(DiskCache, testEviction) {
+    TempDirectory dir;
+    std::string filename = getExample("demo-12-zlib.orc");
+    std::shared_ptr<DiskCache> cache =
+      openDiskCache(dir.getPath(), 4 * 4096, 4096);
+    std::atomic<uint64_t> reads(0);
+    std::unique_ptr<InputStream> direct = readLocalFile(filename);
+    std::unique_ptr<InputStream> cached =
+      createDiskCachedStream(std::unique_ptr<InputStream>
+                             (new ThrottledInputStream
+                              (filename, std::chrono::microseconds(0),
+                               &reads)), cache);
+    expectSameBytes(*direct, *cached, 0, 4 * 4096);
+    EXPECT_EQ(4, cache->getNumberOfBlocks());
+
+    // using block 0 makes block 1 the least recently used
+    expectSameBytes(*direct, *cached, 0, 10);
+    expectSameBytes(*direct, *cached, 4 * 4096, 10);
+    EXPECT_EQ(4, cache->getNumberOfBlocks());
+    EXPECT_EQ(4 * 4096, cache->getCachedBytes());
+    uint64_t before = reads;
+    expectSameBytes(*direct, *cached, 0, 10);
+    expectSameBytes(*direct, *cached, 2 * 4096, 2 * 4096);
+    EXPECT_EQ(before, reads);
+    expectSameBytes(*direct, *cached, 4096, 10);
+    EXPECT_EQ(before + 1, reads);
+
+    // reading more than the capacity keeps the cache within it
+    expectSameBytes(*direct, *cached, 0, direct->getLength());
+    EXPECT_LE(cache->getCachedBytes(), cache->getCapacity());
+
+    // reopening with a smaller capacity evicts down to it
+    cached.reset();
+    cache.reset();
+    cache = openDiskCache(dir.getPath(), 4096, 4096);
+    EXPECT_EQ(1, cache->getNumberOfBlocks());
+  }
+
+  TEST(DiskCache, testConcurrentReaders) {
+    TempDirectory dir;
+    std::string filename = getExample("demo-12-zlib.orc");
+    std::shared_ptr<DiskCache> cache =
+      openDiskCache(dir.getPath(), 16 * 1024, 1024);
+    std::atomic<uint64_t> reads(0);
+    std::atomic<uint64_t> failures(0);
+    std::vector<std::thread> threads;
+    for(uint64_t t=0; t < 8; ++t) {
+      threads.push_back(std::thread([&, t]() {
+            std::unique_ptr<InputStream> direct = readLocalFile(filename);
+            std::unique_ptr<InputStream> cached =
+              createDiskCachedStream(std::unique_ptr<InputStream>
+                                     (new ThrottledInputStream
+                                      (filename,
+                                       std::chrono::microseconds(10),
+                                       &reads)), cache);
+            uint64_t length = direct->getLength();
+            for(uint64_t i=0; i < 200; ++i) {
+              uint64_t offset = (i * 7919 + t * 104729) % (length - 3000);
+              uint64_t size = 1 + (i * 31 + t) % 3000;
+              std::unique_ptr<Buffer> want(direct->read(offset, size,
+                                                        nullptr));
+              std::unique_ptr<Buffer> got(cached->read(offset, size,
+                                                       nullptr));
+              if (memcmp(want->getStart(), got->getStart(), size) != 0) {
+                failures += 1;
+              }
+            }
+          }));
+    }
+    for(size_t t=0; t < threads.size(); ++t) {
+      threads[t].join();
+    }
+    EXPECT_EQ(0, failures);
+    EXPECT_LE(cache->getCachedBytes(), cache->getCapacity());
+    EXPECT_LT(0, cache->getHits());
+  }
+}
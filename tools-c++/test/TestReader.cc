@@ -20,13 +20,20 @@
 
 #include "gzip.hh"
 #include "orc/ColumnPrinter.hh"
+#include "orc/Exceptions.hh"
 #include "orc/OrcFile.hh"
 #include "ToolTest.hh"
 
 #include "wrap/gmock.h"
 #include "wrap/gtest-wrapper.h"
 
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 #ifdef __clang__
   DIAGNOSTIC_IGNORE("-Wmissing-variable-declarations")
@@ -98,6 +105,8 @@ namespace orc {
       filename << exampleDirectory << "/expected/" << GetParam().json;
       return filename.str();
     }
+
+    void checkContents(std::unique_ptr<InputStream> stream);
   };
 
   MatchTest::~MatchTest() {
@@ -144,10 +153,9 @@ namespace orc {
     return std::string(buffer, posn);
   }
 
-  TEST_P(MatchTest, Contents) {
+  void MatchTest::checkContents(std::unique_ptr<InputStream> stream) {
     orc::ReaderOptions opts;
-    std::unique_ptr<Reader> reader =
-      createReader(readLocalFile(getFilename()), opts);
+    std::unique_ptr<Reader> reader = createReader(std::move(stream), opts);
     unsigned long rowCount = 0;
     std::unique_ptr<ColumnVectorBatch> batch = reader->createRowBatch(1024);
     std::string line;
@@ -171,6 +179,14 @@ namespace orc {
     EXPECT_EQ(GetParam().rowCount, reader->getRowNumber());
   }
 
+  TEST_P(MatchTest, Contents) {
+    checkContents(readLocalFile(getFilename()));
+  }
+
+  TEST_P(MatchTest, MmapContents) {
+    checkContents(readLocalFileMmap(getFilename()));
+  }
+
   std::map<std::string, std::string> makeMetadata();
 
   INSTANTIATE_TEST_CASE_P(TestReader, MatchTest,
@@ -612,6 +628,600 @@ INSTANTIATE_TEST_CASE_P(TestReader1900, MatchTest,
     EXPECT_EQ(5000, stripeInfo->getNumberOfRows());
   }
 
+  /**
+   * Read both readers to the end and expect them to return the same rows
+   * in the selected columns. When seekAt is positive, both readers seek
+   * to seekTo once seekAt rows have been read.
+   */
+  void expectSameRows(Reader& expected, Reader& actual,
+                      uint64_t seekAt = 0, uint64_t seekTo = 0) {
+    std::unique_ptr<ColumnVectorBatch> expectedBatch =
+      expected.createRowBatch(1000);
+    std::unique_ptr<ColumnVectorBatch> actualBatch =
+      actual.createRowBatch(1000);
+    StructVectorBatch& expectedRoot =
+      dynamic_cast<StructVectorBatch&>(*expectedBatch);
+    StructVectorBatch& actualRoot =
+      dynamic_cast<StructVectorBatch&>(*actualBatch);
+    // the batches only hold the selected columns
+    std::string expectedLine, actualLine;
+    std::vector<std::unique_ptr<ColumnPrinter> > expectedPrinters;
+    std::vector<std::unique_ptr<ColumnPrinter> > actualPrinters;
+    const std::vector<bool> selected = expected.getSelectedColumns();
+    const Type& type = expected.getType();
+    for(uint64_t c=0; c < type.getSubtypeCount(); ++c) {
+      const Type& column = type.getSubtype(c);
+      if (selected[static_cast<size_t>(column.getColumnId())]) {
+        expectedPrinters.push_back(createColumnPrinter(expectedLine, column));
+        actualPrinters.push_back(createColumnPrinter(actualLine, column));
+      }
+    }
+    ASSERT_EQ(expectedPrinters.size(), expectedRoot.fields.size());
+    uint64_t rowCount = 0;
+    bool hasSeeked = false;
+    while (expected.next(*expectedBatch)) {
+      ASSERT_TRUE(actual.next(*actualBatch));
+      ASSERT_EQ(expectedBatch->numElements, actualBatch->numElements);
+      for(size_t c=0; c < expectedPrinters.size(); ++c) {
+        expectedPrinters[c]->reset(*expectedRoot.fields[c]);
+        actualPrinters[c]->reset(*actualRoot.fields[c]);
+      }
+      for(unsigned int i=0; i < expectedBatch->numElements; ++i) {
+        expectedLine.clear();
+        actualLine.clear();
+        for(size_t c=0; c < expectedPrinters.size(); ++c) {
+          expectedPrinters[c]->printRow(i);
+          actualPrinters[c]->printRow(i);
+        }
+        ASSERT_EQ(expectedLine, actualLine) << "row " << (rowCount + i);
+      }
+      rowCount += expectedBatch->numElements;
+
+      if (seekAt > 0 && rowCount == seekAt && !hasSeeked) {
+        hasSeeked = true;
+        expected.seekToRow(seekTo);
+        actual.seekToRow(seekTo);
+        rowCount = seekTo;
+      }
+    }
+    EXPECT_FALSE(actual.next(*actualBatch));
+    EXPECT_EQ(expected.getNumberOfRows(), rowCount);
+  }
+
+  TEST(Reader, coalescedReadsTest) {
+    ReaderOptions splitOpts, mergedOpts;
+    std::list<int64_t> includes;
+    for(int i=1; i < 10; i += 2) {
+      includes.push_back(i);
+    }
+    splitOpts.include(includes);
+    splitOpts.setReadCoalescingGap(0);
+    mergedOpts.include(includes);
+    EXPECT_EQ(1024 * 1024, mergedOpts.getReadCoalescingGap());
+    std::ostringstream filename;
+    filename << exampleDirectory << "/demo-12-zlib.orc";
+    std::unique_ptr<Reader> splitReader =
+      createReader(readLocalFile(filename.str()), splitOpts);
+    std::unique_ptr<Reader> mergedReader =
+      createReader(readLocalFile(filename.str()), mergedOpts);
+    uint64_t tailReads = mergedReader->getReadCount();
+    EXPECT_EQ(tailReads, splitReader->getReadCount());
+
+    expectSameRows(*splitReader, *mergedReader);
+
+    // a footer read and one data read per stripe once the gaps are merged
+    EXPECT_EQ(tailReads + 2 * mergedReader->getNumberOfStripes(),
+              mergedReader->getReadCount());
+    EXPECT_LT(mergedReader->getReadCount(), splitReader->getReadCount());
+    EXPECT_GT(mergedReader->getBytesRead(), splitReader->getBytesRead());
+  }
+
+  TEST(Reader, prefetchTest) {
+    ReaderOptions plainOpts, prefetchOpts;
+    prefetchOpts.setPrefetchDepth(2);
+    prefetchOpts.setPrefetchMemoryLimit(1024 * 1024);
+    EXPECT_EQ(0, plainOpts.getPrefetchDepth());
+    EXPECT_EQ(256 * 1024 * 1024, plainOpts.getPrefetchMemoryLimit());
+    EXPECT_EQ(2, prefetchOpts.getPrefetchDepth());
+    EXPECT_EQ(1024 * 1024, prefetchOpts.getPrefetchMemoryLimit());
+    std::ostringstream filename;
+    filename << exampleDirectory << "/demo-12-zlib.orc";
+    std::unique_ptr<Reader> plainReader =
+      createReader(readLocalFile(filename.str()), plainOpts);
+    std::unique_ptr<Reader> prefetchReader =
+      createReader(readLocalFile(filename.str()), prefetchOpts);
+
+    // jump around to make the prefetcher restart
+    expectSameRows(*plainReader, *prefetchReader, 200000, 100000);
+    // the stripes loaded ahead of the seek are discarded
+    EXPECT_LE(plainReader->getBytesRead(), prefetchReader->getBytesRead());
+  }
+
+  void checkReadRanges(InputStream& stream,
+                       const std::vector<ReadRange>& ranges) {
+    std::vector<Buffer*> buffers = stream.readRanges(ranges);
+    ASSERT_EQ(ranges.size(), buffers.size());
+    for(size_t i=0; i < ranges.size(); ++i) {
+      Buffer* expected = stream.read(ranges[i].offset, ranges[i].length,
+                                     nullptr);
+      ASSERT_LE(ranges[i].length, buffers[i]->getLength());
+      EXPECT_EQ(0, memcmp(expected->getStart(), buffers[i]->getStart(),
+                          ranges[i].length)) << "range " << i;
+      delete expected;
+      delete buffers[i];
+    }
+  }
+
+  TEST(Reader, readRangesTest) {
+    std::ostringstream filename;
+    filename << exampleDirectory << "/demo-12-zlib.orc";
+    std::unique_ptr<InputStream> file = readLocalFile(filename.str());
+    std::unique_ptr<InputStream> mmapFile = readLocalFileMmap(filename.str());
+    std::unique_ptr<InputStream> uringFile =
+      readLocalFileIoUring(filename.str());
+    uint64_t length = file->getLength();
+
+    // adjacent ranges, gaps and an empty range
+    std::vector<ReadRange> ranges;
+    ranges.push_back(ReadRange(0, 3));
+    ranges.push_back(ReadRange(3, 1000));
+    ranges.push_back(ReadRange(1003, 0));
+    ranges.push_back(ReadRange(1003, 20));
+    ranges.push_back(ReadRange(30000, 100));
+    ranges.push_back(ReadRange(10, 10));
+    ranges.push_back(ReadRange(length - 100, 100));
+    checkReadRanges(*file, ranges);
+    checkReadRanges(*mmapFile, ranges);
+    checkReadRanges(*uringFile, ranges);
+
+    // enough bytes to be split across threads
+    ranges.clear();
+    for(uint64_t i=0; i < 200; ++i) {
+      ranges.push_back(ReadRange(i, length - i));
+    }
+    checkReadRanges(*file, ranges);
+    checkReadRanges(*uringFile, ranges);
+
+    // ranges with small gaps between them are read together
+    ranges.clear();
+    for(uint64_t offset=0; offset + 1000 <= length; offset += 4096) {
+      ranges.push_back(ReadRange(offset, 1000));
+    }
+    checkReadRanges(*file, ranges);
+
+    ranges.clear();
+    ranges.push_back(ReadRange(length - 10, 20));
+    EXPECT_THROW(file->readRanges(ranges), ParseError);
+    EXPECT_THROW(uringFile->readRanges(ranges), ParseError);
+  }
+
+  TEST(Reader, ioUringTest) {
+    std::ostringstream filename;
+    filename << exampleDirectory << "/demo-12-zlib.orc";
+
+    // several readers share the ring at the same time
+    std::vector<std::thread> threads;
+    std::vector<uint64_t> rowCounts(4);
+    for(size_t t=0; t < rowCounts.size(); ++t) {
+      threads.push_back(std::thread([&filename, &rowCounts, t] {
+            ReaderOptions opts;
+            opts.setPrefetchDepth(t);
+            std::unique_ptr<Reader> reader =
+              createReader(readLocalFileIoUring(filename.str()), opts);
+            std::unique_ptr<ColumnVectorBatch> batch =
+              reader->createRowBatch(1024);
+            LongVectorBatch* longVector =
+              dynamic_cast<LongVectorBatch*>
+              (dynamic_cast<StructVectorBatch&>(*batch).fields[0]);
+            uint64_t rowCount = 0;
+            while (reader->next(*batch)) {
+              for(unsigned int i=0; i < batch->numElements; ++i) {
+                if (longVector->data[i] !=
+                    static_cast<int64_t>(rowCount + i + 1)) {
+                  return;
+                }
+              }
+              rowCount += batch->numElements;
+            }
+            rowCounts[t] = rowCount;
+          }));
+    }
+    for(size_t t=0; t < threads.size(); ++t) {
+      threads[t].join();
+      EXPECT_EQ(1920800, rowCounts[t]) << "reader " << t;
+    }
+  }
+
+  TEST(Reader, tailReadTest) {
+    std::ostringstream filename;
+    // the metadata and footer of this file are larger than 16 KB
+    filename << exampleDirectory << "/TestOrcFile.metaData.orc";
+    ReaderOptions opts;
+    EXPECT_EQ(16 * 1024, opts.getTailReadSize());
+    EXPECT_EQ(0, opts.getTailLengthHint());
+    EXPECT_FALSE(opts.getLearnTailSize());
+    std::unique_ptr<Reader> reader =
+      createReader(readLocalFile(filename.str()), opts);
+    uint64_t tailLength = reader->getFileTailLength();
+    EXPECT_EQ(40955, tailLength);
+
+    // the second read only fetches the part of the tail that is missing
+    EXPECT_EQ(2, reader->getReadCount());
+    EXPECT_EQ(tailLength, reader->getBytesRead());
+
+    opts.setTailReadSize(300);
+    reader = createReader(readLocalFile(filename.str()), opts);
+    EXPECT_EQ(2, reader->getReadCount());
+    EXPECT_EQ(tailLength, reader->getBytesRead());
+
+    // the hint gets the whole tail at once
+    opts.setTailLengthHint(tailLength);
+    reader = createReader(readLocalFile(filename.str()), opts);
+    EXPECT_EQ(1, reader->getReadCount());
+    EXPECT_EQ(tailLength, reader->getBytesRead());
+
+    // the postscript is always read with the first request
+    opts.setTailLengthHint(1);
+    reader = createReader(readLocalFile(filename.str()), opts);
+    EXPECT_EQ(2, reader->getReadCount());
+    EXPECT_EQ(tailLength, reader->getBytesRead());
+    EXPECT_EQ(1, reader->getNumberOfRows());
+    EXPECT_EQ(true, reader->hasMetadataValue("clobber"));
+
+    // later files in the same directory use the learned size
+    ReaderOptions learnOpts;
+    learnOpts.setLearnTailSize(true);
+    reader = createReader(readLocalFile(filename.str()), learnOpts);
+    EXPECT_LE(reader->getReadCount(), 2);
+    reader = createReader(readLocalFile(filename.str()), learnOpts);
+    EXPECT_EQ(1, reader->getReadCount());
+    EXPECT_EQ(tailLength, reader->getBytesRead());
+  }
+
+  TEST(Reader, serializedTailTest) {
+    std::ostringstream filename;
+    filename << exampleDirectory << "/demo-12-zlib.orc";
+    std::unique_ptr<Reader> reader =
+      createReader(readLocalFile(filename.str()), ReaderOptions());
+    std::string tail = reader->getSerializedFileTail();
+    EXPECT_LT(0, tail.size());
+
+    // the second reader doesn't read the tail
+    ReaderOptions opts;
+    opts.setSerializedFileTail(tail);
+    EXPECT_EQ(tail, opts.getSerializedFileTail());
+    std::unique_ptr<Reader> tailReader =
+      createReader(readLocalFile(filename.str()), opts);
+    EXPECT_EQ(0, tailReader->getReadCount());
+    EXPECT_EQ(0, tailReader->getBytesRead());
+    EXPECT_EQ(reader->getFileTailLength(), tailReader->getFileTailLength());
+    EXPECT_EQ(CompressionKind_ZLIB, tailReader->getCompression());
+    EXPECT_EQ(reader->getCompressionSize(),
+              tailReader->getCompressionSize());
+    EXPECT_EQ(reader->getNumberOfStripes(),
+              tailReader->getNumberOfStripes());
+    EXPECT_EQ(reader->getNumberOfStripeStatistics(),
+              tailReader->getNumberOfStripeStatistics());
+    EXPECT_EQ(tail, tailReader->getSerializedFileTail());
+
+    std::unique_ptr<ColumnVectorBatch> batch =
+      tailReader->createRowBatch(1024);
+    uint64_t rows = 0;
+    while (tailReader->next(*batch)) {
+      rows += batch->numElements;
+    }
+    EXPECT_EQ(1920800, rows);
+    EXPECT_EQ(reader->getNumberOfRows(), rows);
+
+    // a tail for another file is rejected
+    std::ostringstream otherName;
+    otherName << exampleDirectory << "/TestOrcFile.testSeek.orc";
+    EXPECT_THROW(createReader(readLocalFile(otherName.str()), opts),
+                 ParseError);
+
+    opts.setSerializedFileTail("not a file tail");
+    EXPECT_THROW(createReader(readLocalFile(filename.str()), opts),
+                 ParseError);
+  }
+
+  TEST(Reader, metadataCacheTest) {
+    std::ostringstream filename;
+    filename << exampleDirectory << "/demo-12-zlib.orc";
+    MetadataCache& cache = getMetadataCache();
+    cache.clear();
+    ReaderOptions opts;
+    EXPECT_FALSE(opts.getUseMetadataCache());
+
+    // readers don't use the cache by default
+    std::unique_ptr<Reader> reader =
+      createReader(readLocalFile(filename.str()), opts);
+    EXPECT_EQ(0, cache.getMisses());
+    EXPECT_EQ(0, cache.getNumberOfEntries());
+
+    opts.setUseMetadataCache(true);
+    reader = createReader(readLocalFile(filename.str()), opts);
+    EXPECT_LT(0, reader->getReadCount());
+    EXPECT_EQ(1, cache.getMisses());
+    EXPECT_EQ(0, cache.getHits());
+    EXPECT_EQ(1, cache.getNumberOfEntries());
+    EXPECT_LT(0, cache.getMemoryUsage());
+
+    // the second reader gets the tail without any I/O
+    std::unique_ptr<Reader> cachedReader =
+      createReader(readLocalFileMmap(filename.str()), opts);
+    EXPECT_EQ(0, cachedReader->getReadCount());
+    EXPECT_EQ(1, cache.getHits());
+    EXPECT_EQ(reader->getSerializedFileTail(),
+              cachedReader->getSerializedFileTail());
+    std::unique_ptr<ColumnVectorBatch> batch =
+      cachedReader->createRowBatch(1024);
+    uint64_t rows = 0;
+    while (cachedReader->next(*batch)) {
+      rows += batch->numElements;
+    }
+    EXPECT_EQ(reader->getNumberOfRows(), rows);
+
+    // other files get their own entries
+    std::ostringstream otherName;
+    otherName << exampleDirectory << "/TestOrcFile.testSeek.orc";
+    reader = createReader(readLocalFile(otherName.str()), opts);
+    EXPECT_EQ(2, cache.getMisses());
+    EXPECT_EQ(2, cache.getNumberOfEntries());
+
+    // tails that don't fit aren't cached
+    uint64_t capacity = cache.getCapacity();
+    cache.setCapacity(0);
+    EXPECT_EQ(0, cache.getNumberOfEntries());
+    reader = createReader(readLocalFile(filename.str()), opts);
+    EXPECT_EQ(0, cache.getNumberOfEntries());
+    cache.setCapacity(capacity);
+    cache.clear();
+  }
+
+  TEST(Reader, simulatedStorageTest) {
+    std::ostringstream filename;
+    filename << exampleDirectory << "/demo-12-zlib.orc";
+    std::shared_ptr<SimulatedStorage> storage =
+      createSimulatedStorage(1000, 100 * 1000 * 1000, 1);
+    EXPECT_EQ(1000, storage->getLatency());
+    EXPECT_EQ(100 * 1000 * 1000, storage->getBandwidth());
+    EXPECT_EQ(1, storage->getMaxConcurrency());
+
+    // each read of the reader becomes one recorded request
+    std::unique_ptr<Reader> reader =
+      createReader(createSimulatedStream(readLocalFile(filename.str()),
+                                         storage), ReaderOptions());
+    std::unique_ptr<ColumnVectorBatch> batch = reader->createRowBatch(1024);
+    while (reader->next(*batch)) {
+      // PASS
+    }
+    std::vector<StorageRequest> requests = storage->getRequests();
+    EXPECT_EQ(reader->getReadCount(), requests.size());
+    EXPECT_EQ(reader->getReadCount(), storage->getRequestCount());
+    EXPECT_EQ(reader->getBytesRead(), storage->getBytesRequested());
+    uint64_t fileLength = readLocalFile(filename.str())->getLength();
+    for(size_t i=0; i < requests.size(); ++i) {
+      EXPECT_EQ(filename.str(), requests[i].name);
+      EXPECT_LE(requests[i].offset + requests[i].length, fileLength);
+      EXPECT_LE(1000 + requests[i].length / 100, requests[i].duration);
+    }
+
+    // with one connection the requests from several threads never overlap
+    storage->clearRequests();
+    EXPECT_EQ(0, storage->getRequestCount());
+    EXPECT_EQ(0, storage->getBytesRequested());
+    std::vector<std::thread> threads;
+    for(int t=0; t < 4; ++t) {
+      threads.push_back(std::thread([&]() {
+            std::unique_ptr<InputStream> stream =
+              createSimulatedStream(readLocalFile(filename.str()), storage);
+            for(uint64_t i=0; i < 5; ++i) {
+              delete stream->read(i * 1000, 1000, nullptr);
+            }
+          }));
+    }
+    for(size_t t=0; t < threads.size(); ++t) {
+      threads[t].join();
+    }
+    requests = storage->getRequests();
+    EXPECT_EQ(20, requests.size());
+    for(size_t i=1; i < requests.size(); ++i) {
+      EXPECT_LE(requests[i-1].start + requests[i-1].wait +
+                requests[i-1].duration,
+                requests[i].start + requests[i].wait);
+    }
+  }
+
+  TEST(Reader, decompressionCountersTest) {
+    const char* files[] = {"demo-12-zlib.orc", "TestOrcFile.testSnappy.orc"};
+    for(size_t f=0; f < 2; ++f) {
+      std::ostringstream filename;
+      filename << exampleDirectory << "/" << files[f];
+      std::unique_ptr<Reader> reader =
+        createReader(readLocalFile(filename.str()), ReaderOptions());
+      EXPECT_EQ(0, reader->getBytesDecompressed());
+      std::unique_ptr<ColumnVectorBatch> batch = reader->createRowBatch(1024);
+      while (reader->next(*batch)) {
+        // PASS
+      }
+      EXPECT_LT(0, reader->getBytesDecompressed()) << files[f];
+      // the stripe's streams are read whole, so no chunk is copied
+      EXPECT_EQ(0, reader->getBytesCopied()) << files[f];
+    }
+  }
+
+  TEST(Reader, parallelDecompressionTest) {
+    ReaderOptions plainOpts, parallelOpts;
+    EXPECT_EQ(0, plainOpts.getDecompressionThreads());
+    EXPECT_EQ(8, plainOpts.getDecompressionWindow());
+    parallelOpts.setDecompressionThreads(3).setDecompressionWindow(2);
+    EXPECT_EQ(3, parallelOpts.getDecompressionThreads());
+    EXPECT_EQ(2, parallelOpts.getDecompressionWindow());
+    std::ostringstream filename;
+    filename << exampleDirectory << "/demo-12-zlib.orc";
+    std::unique_ptr<Reader> plainReader =
+      createReader(readLocalFile(filename.str()), plainOpts);
+    std::unique_ptr<Reader> parallelReader =
+      createReader(readLocalFile(filename.str()), parallelOpts);
+
+    // seek into the middle of a stripe's chunks
+    expectSameRows(*plainReader, *parallelReader, 200000, 123456);
+    EXPECT_EQ(plainReader->getBytesDecompressed() +
+              plainReader->getBytesPassedThrough(),
+              parallelReader->getBytesDecompressed() +
+              parallelReader->getBytesPassedThrough());
+  }
+
+  TEST(Reader, chunkCacheTest) {
+    std::ostringstream filename;
+    filename << exampleDirectory << "/demo-12-zlib.orc";
+    std::unique_ptr<ChunkCache> cache = createChunkCache(64 * 1024 * 1024);
+    ReaderOptions opts;
+    EXPECT_EQ(nullptr, opts.getChunkCache());
+    opts.setChunkCache(*cache);
+    EXPECT_EQ(cache.get(), opts.getChunkCache());
+
+    std::unique_ptr<Reader> firstReader =
+      createReader(readLocalFile(filename.str()), opts);
+    std::unique_ptr<ColumnVectorBatch> firstBatch =
+      firstReader->createRowBatch(1000);
+    while (firstReader->next(*firstBatch)) {
+      // PASS
+    }
+    EXPECT_EQ(0, cache->getHits());
+    EXPECT_LT(0, cache->getMisses());
+    EXPECT_EQ(cache->getMisses(), cache->getNumberOfEntries());
+    EXPECT_LT(0, cache->getMemoryUsage());
+    EXPECT_EQ(0, cache->getEvictions());
+
+    // a second reader finds every chunk and matches a reader without
+    // the cache
+    ReaderOptions plainOpts;
+    std::unique_ptr<Reader> plainReader =
+      createReader(readLocalFile(filename.str()), plainOpts);
+    std::unique_ptr<Reader> cachedReader =
+      createReader(readLocalFile(filename.str()), opts);
+    uint64_t misses = cache->getMisses();
+    expectSameRows(*plainReader, *cachedReader);
+    EXPECT_EQ(misses, cache->getMisses());
+    EXPECT_EQ(misses, cache->getHits());
+    EXPECT_EQ(0, cachedReader->getBytesDecompressed());
+
+    // shrinking the cache evicts chunks
+    cache->setCapacity(cache->getMemoryUsage() / 2);
+    EXPECT_LT(0, cache->getEvictions());
+    EXPECT_GE(cache->getCapacity(), cache->getMemoryUsage());
+  }
+
+  /**
+   * A chunk cache from an application that keeps every chunk in a map.
+   */
+  class MapChunkCache: public ChunkCache {
+  private:
+    std::mutex mutex;
+    std::map<std::string, CachedChunk> chunks;
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+
+    static std::string makeKey(const std::string& file,
+                               uint64_t streamOffset,
+                               uint64_t chunkOffset) {
+      std::ostringstream key;
+      key << file << "/" << streamOffset << "/" << chunkOffset;
+      return key.str();
+    }
+
+  public:
+    MapChunkCache(): hits(0), misses(0) {
+      // PASS
+    }
+
+    CachedChunk get(const std::string& file,
+                    uint64_t streamOffset,
+                    uint64_t chunkOffset) override {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::map<std::string, CachedChunk>::iterator itr =
+        chunks.find(makeKey(file, streamOffset, chunkOffset));
+      if (itr == chunks.end()) {
+        misses += 1;
+        return nullptr;
+      }
+      hits += 1;
+      return itr->second;
+    }
+
+    void put(const std::string& file,
+             uint64_t streamOffset,
+             uint64_t chunkOffset,
+             const char* data,
+             uint64_t length) override {
+      CachedChunk chunk(new DataBuffer<char>(*getDefaultPool(), length));
+      memcpy(chunk->data(), data, length);
+      std::lock_guard<std::mutex> lock(mutex);
+      chunks[makeKey(file, streamOffset, chunkOffset)] = chunk;
+    }
+
+    uint64_t getCapacity() const override {
+      return std::numeric_limits<uint64_t>::max();
+    }
+
+    void setCapacity(uint64_t) override {
+      // PASS
+    }
+
+    uint64_t getMemoryUsage() const override {
+      return 0;
+    }
+
+    uint64_t getNumberOfEntries() const override {
+      return chunks.size();
+    }
+
+    uint64_t getHits() const override {
+      return hits;
+    }
+
+    uint64_t getMisses() const override {
+      return misses;
+    }
+
+    uint64_t getEvictions() const override {
+      return 0;
+    }
+
+    void clear() override {
+      std::lock_guard<std::mutex> lock(mutex);
+      chunks.clear();
+    }
+  };
+
+  TEST(Reader, customChunkCacheTest) {
+    std::ostringstream filename;
+    filename << exampleDirectory << "/demo-12-zlib.orc";
+    MapChunkCache cache;
+    ReaderOptions opts;
+    opts.setChunkCache(cache);
+    std::unique_ptr<Reader> firstReader =
+      createReader(readLocalFile(filename.str()), opts);
+    std::unique_ptr<ColumnVectorBatch> firstBatch =
+      firstReader->createRowBatch(1000);
+    while (firstReader->next(*firstBatch)) {
+      // PASS
+    }
+    EXPECT_LT(0, cache.getMisses());
+    EXPECT_EQ(cache.getMisses(), cache.getNumberOfEntries());
+
+    // the reader gets its chunks from the application's cache
+    ReaderOptions plainOpts;
+    std::unique_ptr<Reader> plainReader =
+      createReader(readLocalFile(filename.str()), plainOpts);
+    std::unique_ptr<Reader> cachedReader =
+      createReader(readLocalFile(filename.str()), opts);
+    expectSameRows(*plainReader, *cachedReader);
+    EXPECT_EQ(cache.getMisses(), cache.getHits());
+    EXPECT_EQ(0, cachedReader->getBytesDecompressed());
+  }
+
   TEST(Reader, readRangeTest) {
     ReaderOptions fullOpts, lastOpts, oobOpts, offsetOpts;
     // stripes[N-1]